@@ -297,6 +297,14 @@ typedef enum libvlc_media_parse_flag_t
      * when the input is asking for credentials.
      */
     libvlc_media_do_interact    = 0x08,
+    /**
+     * Parse this media before the media requested without this flag, e.g.
+     * because it is visible to the user (see the "preparse-threads" option to
+     * parse several media at once).
+     *
+     * \version LibVLC 3.0.22 and later.
+     */
+    libvlc_media_parse_priority = 0x10,
 } libvlc_media_parse_flag_t;
 
 /**
@@ -890,6 +898,86 @@ LIBVLC_API
 void libvlc_media_slaves_release( libvlc_media_slave_t **pp_slaves,
                                   unsigned int i_count );
 
+/**
+ * A picture decoded by libvlc_media_thumbnail_request()
+ */
+typedef struct libvlc_media_thumbnail_t
+{
+    unsigned i_width; /**< width of the picture in pixels */
+    unsigned i_height; /**< height of the picture in pixels */
+    unsigned i_planes; /**< number of planes of the chroma */
+    struct
+    {
+        unsigned char *p_pixels; /**< first pixel of the plane */
+        unsigned i_pitch; /**< bytes per line of the plane */
+        unsigned i_lines; /**< number of lines of the plane */
+    } planes[4];
+    libvlc_time_t i_time; /**< timestamp of the picture (in ms), or -1 */
+} libvlc_media_thumbnail_t;
+
+/**
+ * Decode a thumbnail of a media.
+ *
+ * The media is seeked to the nearest keyframe of the requested time or
+ * position, and a single picture is decoded, without a media player, an
+ * audio output nor a video output. It is then converted to the requested
+ * chroma and size.
+ *
+ * This function is synchronous: it returns once the picture is decoded, or
+ * on error or timeout.
+ *
+ * \param p_md media descriptor object
+ * \param i_time time to seek to (in ms), or -1 to use f_pos
+ * \param f_pos position to seek to, in [0.0, 1.0]
+ * \param psz_chroma a four-characters string identifying the chroma of the
+ *                   picture (e.g. "RV32" or "I420")
+ * \param i_width width of the picture, 0 to keep the aspect ratio
+ * \param i_height height of the picture, 0 to keep the aspect ratio (if both
+ *                 are 0, the picture has the size of the video)
+ * \param i_timeout maximum time allowed (in ms), 0 for none
+ * \return the thumbnail (must be released with
+ *         libvlc_media_thumbnail_release()), or NULL on error
+ * \version LibVLC 3.0.22 and later.
+ */
+LIBVLC_API libvlc_media_thumbnail_t *
+libvlc_media_thumbnail_request( libvlc_media_t *p_md,
+                                libvlc_time_t i_time, float f_pos,
+                                const char *psz_chroma,
+                                unsigned i_width, unsigned i_height,
+                                int i_timeout );
+
+/**
+ * Decode thumbnails of several media.
+ *
+ * This is libvlc_media_thumbnail_request() applied to each media, with as
+ * many media decoded in parallel as there are CPUs.
+ *
+ * \param pp_md array of media descriptor objects of the same instance
+ * \param i_count number of elements in the arrays
+ * \param pp_thumbnails array to store the thumbnails (NULL on error for a
+ *                      media) [OUT]
+ * \return the number of thumbnails decoded
+ * \version LibVLC 3.0.22 and later.
+ * \see libvlc_media_thumbnail_request
+ */
+LIBVLC_API unsigned
+libvlc_media_thumbnail_request_batch( libvlc_media_t *const *pp_md,
+                                      unsigned i_count,
+                                      libvlc_time_t i_time, float f_pos,
+                                      const char *psz_chroma,
+                                      unsigned i_width, unsigned i_height,
+                                      int i_timeout,
+                                      libvlc_media_thumbnail_t **pp_thumbnails );
+
+/**
+ * Release a thumbnail
+ *
+ * \param p_thumbnail thumbnail to release
+ * \version LibVLC 3.0.22 and later.
+ */
+LIBVLC_API void
+libvlc_media_thumbnail_release( libvlc_media_thumbnail_t *p_thumbnail );
+
 /** @}*/
 
 # ifdef __cplusplus
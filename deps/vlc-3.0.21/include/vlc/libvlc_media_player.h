@@ -1426,6 +1426,43 @@ int libvlc_video_take_snapshot( libvlc_media_player_t *p_mi, unsigned num,
 LIBVLC_API void libvlc_video_set_deinterlace( libvlc_media_player_t *p_mi,
                                                   const char *psz_mode );
 
+/**
+ * Video decoding throttle levels
+ * \see libvlc_video_set_throttle()
+ */
+typedef enum libvlc_video_throttle_t {
+    libvlc_video_throttle_none = 0, /**< decode and display every picture */
+    libvlc_video_throttle_keyframes, /**< decode keyframes only, and display
+                                          at most one picture per second */
+    libvlc_video_throttle_hidden, /**< decode keyframes only, and display
+                                       nothing */
+} libvlc_video_throttle_t;
+
+/**
+ * Reduce the video decoding work while the video is not watched, e.g. when
+ * its window is occluded or when running on battery power.
+ *
+ * The playback clock, the audio and the subtitles are not affected. When the
+ * throttle is released, the decoding resumes at the next keyframe.
+ *
+ * \param p_mi libvlc media player
+ * \param throttle throttle level
+ * \return 0 on success, -1 on error
+ * \version LibVLC 3.0.22 and later.
+ */
+LIBVLC_API int libvlc_video_set_throttle( libvlc_media_player_t *p_mi,
+                                          libvlc_video_throttle_t throttle );
+
+/**
+ * Get the current video decoding throttle level.
+ *
+ * \param p_mi libvlc media player
+ * \return the throttle level
+ * \version LibVLC 3.0.22 and later.
+ */
+LIBVLC_API libvlc_video_throttle_t
+libvlc_video_get_throttle( libvlc_media_player_t *p_mi );
+
 /**
  * Get an integer marquee option value
  *
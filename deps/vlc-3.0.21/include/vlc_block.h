@@ -144,6 +144,34 @@ VLC_API block_t *block_Alloc(size_t size) VLC_USED VLC_MALLOC;
 
 VLC_API block_t *block_TryRealloc(block_t *, ssize_t pre, size_t body) VLC_USED;
 
+/**
+ * Block allocator statistics.
+ *
+ * Blocks up to 64 KiB are served from per-size recycling caches.
+ */
+typedef struct block_alloc_stats_t
+{
+    unsigned long long hits; /**< allocations served from the caches */
+    unsigned long long misses; /**< cacheable allocations from the heap */
+    unsigned long long oversized; /**< allocations too large to be cached */
+    unsigned long long cached; /**< bytes of free blocks in the shared cache
+                                    (at most 1 MiB) */
+} block_alloc_stats_t;
+
+/**
+ * Gets process-wide statistics of block_Alloc().
+ */
+VLC_API void block_GetAllocStats(block_alloc_stats_t *);
+
+/**
+ * Frees the blocks kept for recycling by the shared cache and by the cache of
+ * the calling thread.
+ *
+ * This is done when a LibVLC instance is released. The caches of the other
+ * threads go back to the shared cache when these threads exit.
+ */
+VLC_API void block_Trim(void);
+
 /**
  * Reallocates a block.
  *
@@ -298,6 +298,57 @@ VLC_API void filter_DeleteBlend( filter_t * );
         return p_outpic;                                                \
     }
 
+/**
+ * Slice threading
+ *
+ * A filter can split the processing of a picture into horizontal bands
+ * (slices) that are processed in parallel by a set of worker threads.
+ */
+
+typedef struct vlc_slices_t vlc_slices_t;
+
+/**
+ * Processes the lines [i_first, i_first + i_lines) of a picture.
+ *
+ * \param i_slice index of the slice, smaller than vlc_slices_Count()
+ */
+typedef void (*vlc_slice_cb)( void *opaque, unsigned i_slice,
+                              unsigned i_first, unsigned i_lines );
+
+/**
+ * It returns the number of slices a filter should use, from the
+ * "filter-threads" option (1 by default, 0 meaning one per CPU).
+ */
+VLC_API unsigned filter_GetSliceCount( filter_t * ) VLC_USED;
+
+/**
+ * It creates i_count - 1 worker threads, the last slice being processed by
+ * the thread calling vlc_slices_Run().
+ *
+ * \return NULL on error
+ */
+VLC_API vlc_slices_t *vlc_slices_New( unsigned i_count ) VLC_USED;
+
+/**
+ * It returns the number of slices, including the calling thread.
+ */
+VLC_API unsigned vlc_slices_Count( const vlc_slices_t * ) VLC_USED;
+
+/**
+ * It splits i_lines lines into bands of a multiple of i_align lines (except
+ * for the last one), and calls pf_slice for each of them in parallel.
+ *
+ * It returns once all the bands have been processed. It must not be called
+ * from more than one thread at a time.
+ */
+VLC_API void vlc_slices_Run( vlc_slices_t *, unsigned i_lines, unsigned i_align,
+                             vlc_slice_cb pf_slice, void *opaque );
+
+/**
+ * It joins the worker threads and destroys the slices.
+ */
+VLC_API void vlc_slices_Delete( vlc_slices_t * );
+
 /**
  * Filter chain management API
  * The filter chain management API is used to dynamically construct filters
@@ -365,7 +365,8 @@ typedef enum input_item_meta_request_option_t
     META_REQUEST_OPTION_SCOPE_LOCAL   = 0x01,
     META_REQUEST_OPTION_SCOPE_NETWORK = 0x02,
     META_REQUEST_OPTION_SCOPE_ANY     = 0x03,
-    META_REQUEST_OPTION_DO_INTERACT   = 0x04
+    META_REQUEST_OPTION_DO_INTERACT   = 0x04,
+    META_REQUEST_OPTION_PRIORITY      = 0x08, /**< before other requests */
 } input_item_meta_request_option_t;
 
 /* status of the vlc_InputItemPreparseEnded event */
@@ -199,6 +199,30 @@ VLC_API void picture_Copy( picture_t *p_dst, const picture_t *p_src );
  */
 VLC_API picture_t *picture_Clone(picture_t *pic);
 
+/**
+ * It initializes p_view as a view of the lines [i_first, i_first + i_lines)
+ * of p_pic, i_first and i_lines being counted in lines of the first plane.
+ *
+ * The view shares the pixels of p_pic: it must not be held nor released.
+ * It is meant for the slice threading of video filters (vlc_slices_Run()).
+ */
+static inline void picture_SliceView( picture_t *p_view, const picture_t *p_pic,
+                                      unsigned i_first, unsigned i_lines )
+{
+    *p_view = *p_pic;
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        const plane_t *p_src = &p_pic->p[i];
+        plane_t *p_dst = &p_view->p[i];
+        const unsigned i_num = p_src->i_lines, i_den = p_pic->p[0].i_lines;
+
+        p_dst->p_pixels += i_first * i_num / i_den * p_src->i_pitch;
+        p_dst->i_lines = p_dst->i_visible_lines = i_lines * i_num / i_den;
+    }
+    p_view->format.i_y_offset = 0;
+    p_view->format.i_height = p_view->format.i_visible_height = i_lines;
+}
+
 /**
  * This function will export a picture to an encoded bitstream.
  *
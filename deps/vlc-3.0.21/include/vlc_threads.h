@@ -887,6 +887,9 @@ vlc_tick_t impossible_deadline( vlc_tick_t deadline )
  * \return 0 on success, a system error code otherwise.
  *
  * \warning Asynchronous timers are processed from an unspecified thread.
+ * The callbacks of different timers may run concurrently, or one after the
+ * other on the same thread. A callback that blocks delays the others by a
+ * few milliseconds at most.
  * \note Multiple occurrences of a single interval timer are serialized:
  * they cannot run concurrently.
  */
@@ -0,0 +1,86 @@
+/*****************************************************************************
+ * vlc_thumbnailer.h: Thumbnailing API
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_THUMBNAILER_H
+#define VLC_THUMBNAILER_H 1
+
+#include <vlc_picture.h>
+
+/**
+ * \file
+ * This file defines the thumbnailer, which decodes a single picture of an
+ * input item without an input thread, clock, audio output nor video output.
+ */
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+typedef struct vlc_thumbnailer_t vlc_thumbnailer_t;
+
+/**
+ * Create a thumbnailer
+ *
+ * A thumbnailer keeps the conversion filters between requests. It processes
+ * one request at a time: use one thumbnailer per thread to run requests in
+ * parallel.
+ *
+ * \param p_parent the parent object
+ * \return a thumbnailer, or NULL on error
+ */
+VLC_API vlc_thumbnailer_t *vlc_thumbnailer_Create( vlc_object_t *p_parent )
+VLC_USED;
+#define vlc_thumbnailer_Create( a ) vlc_thumbnailer_Create( VLC_OBJECT( a ) )
+
+/**
+ * Decode a picture of an input item
+ *
+ * The item is opened and seeked to the given time or position without
+ * precision, so that the picture is the one of the nearest keyframe that
+ * the demuxer can seek to, or the first one if it cannot seek.
+ *
+ * \param p_thumbnailer the thumbnailer
+ * \param p_item the input item
+ * \param i_time the time to seek to, from VLC_TICK_0 (so that the start of
+ *               the item is not VLC_TICK_INVALID), or VLC_TICK_INVALID to use
+ *               f_pos
+ * \param f_pos the position to seek to, in [0.0, 1.0]
+ * \param p_fmt [in/out] the chroma and the size of the picture, 0 for the
+ *              ones of the decoded picture (if only one dimension is 0, it
+ *              is set so as to keep the aspect ratio)
+ * \param i_timeout the maximum duration of the request, 0 for none
+ * \return the picture, or NULL on error
+ */
+VLC_API picture_t *vlc_thumbnailer_Request( vlc_thumbnailer_t *p_thumbnailer,
+                                            input_item_t *p_item,
+                                            vlc_tick_t i_time, float f_pos,
+                                            video_format_t *p_fmt,
+                                            vlc_tick_t i_timeout ) VLC_USED;
+
+/**
+ * Release a thumbnailer
+ */
+VLC_API void vlc_thumbnailer_Release( vlc_thumbnailer_t *p_thumbnailer );
+
+# ifdef __cplusplus
+}
+# endif
+
+#endif
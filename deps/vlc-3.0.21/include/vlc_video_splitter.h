@@ -58,6 +58,15 @@ typedef struct
         int i_align;
     } window;
 
+    /* Position of the output inside the source picture, in pixels.
+     * It is only used by video_splitter_NewPictureShared().
+     */
+    struct
+    {
+        int i_x;
+        int i_y;
+    } source;
+
     /* Video output module
      * Use NULL for default
      */
@@ -102,6 +111,8 @@ struct video_splitter_t
     /* Buffer allocation */
     int  (*pf_picture_new) ( video_splitter_t *, picture_t *pp_picture[] );
     void (*pf_picture_del) ( video_splitter_t *, picture_t *pp_picture[] );
+    int  (*pf_picture_share)( video_splitter_t *, picture_t *pp_picture[],
+                              bool pb_shared[], picture_t *p_src );
     video_splitter_owner_t *p_owner;
 };
 
@@ -122,6 +133,34 @@ static inline int video_splitter_NewPicture( video_splitter_t *p_splitter,
     return i_ret;
 }
 
+/**
+ * It will create an array of pictures suitable as output, like
+ * video_splitter_NewPicture, but without copy where possible.
+ *
+ * The outputs that do not need a picture of their own (because they convert
+ * it before display anyway) receive a reference to the pixels of p_src,
+ * cropped at the output source position and flagged in pb_shared. Those
+ * pictures are read-only. The other ones must be filled by the splitter.
+ */
+static inline int video_splitter_NewPictureShared( video_splitter_t *p_splitter,
+                                                   picture_t *pp_picture[],
+                                                   bool pb_shared[],
+                                                   picture_t *p_src )
+{
+    if( p_splitter->pf_picture_share == NULL )
+    {
+        for( int i = 0; i < p_splitter->i_output; i++ )
+            pb_shared[i] = false;
+        return video_splitter_NewPicture( p_splitter, pp_picture );
+    }
+
+    int i_ret = p_splitter->pf_picture_share( p_splitter, pp_picture,
+                                              pb_shared, p_src );
+    if( i_ret )
+        msg_Warn( p_splitter, "can't get output pictures" );
+    return i_ret;
+}
+
 /**
  * It will release an array of pictures created by video_splitter_NewPicture.
  * Provided for convenience.
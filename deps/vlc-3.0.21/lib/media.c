@@ -34,9 +34,11 @@
 #include <vlc/libvlc_events.h>
 
 #include <vlc_common.h>
+#include <vlc_atomic.h>
 #include <vlc_input.h>
 #include <vlc_meta.h>
 #include <vlc_playlist.h> /* For the preparser */
+#include <vlc_thumbnailer.h>
 #include <vlc_url.h>
 
 #include "../src/libvlc.h"
@@ -799,6 +801,8 @@ static int media_parse(libvlc_media_t *media, bool b_async,
             parse_scope |= META_REQUEST_OPTION_SCOPE_NETWORK;
         if (parse_flag & libvlc_media_do_interact)
             parse_scope |= META_REQUEST_OPTION_DO_INTERACT;
+        if (parse_flag & libvlc_media_parse_priority)
+            parse_scope |= META_REQUEST_OPTION_PRIORITY;
         ret = libvlc_MetadataRequest(libvlc, item, parse_scope, timeout, media);
         if (ret != VLC_SUCCESS)
             return ret;
@@ -1285,3 +1289,186 @@ void libvlc_media_slaves_release( libvlc_media_slave_t **pp_slaves,
     }
     free( pp_slaves );
 }
+
+typedef struct
+{
+    libvlc_media_thumbnail_t thumbnail;
+    picture_t *p_picture;
+} media_thumbnail_t;
+
+static libvlc_media_thumbnail_t *
+media_thumbnail( vlc_thumbnailer_t *p_thumbnailer, libvlc_media_t *p_md,
+                 libvlc_time_t i_time, float f_pos, vlc_fourcc_t i_chroma,
+                 unsigned i_width, unsigned i_height, int i_timeout )
+{
+    media_thumbnail_t *p_thumb = malloc( sizeof( *p_thumb ) );
+    if( unlikely( p_thumb == NULL ) )
+        return NULL;
+
+    video_format_t fmt;
+    video_format_Init( &fmt, i_chroma );
+    fmt.i_width = i_width;
+    fmt.i_height = i_height;
+
+    picture_t *p_pic =
+        vlc_thumbnailer_Request( p_thumbnailer, p_md->p_input_item,
+                                 i_time >= 0 ? VLC_TICK_0 + i_time * 1000
+                                             : VLC_TICK_INVALID,
+                                 i_time >= 0 ? 0.f : f_pos, &fmt,
+                                 i_timeout > 0 ? i_timeout * INT64_C(1000)
+                                               : 0 );
+    video_format_Clean( &fmt );
+    if( p_pic == NULL )
+    {
+        free( p_thumb );
+        return NULL;
+    }
+
+    libvlc_media_thumbnail_t *p_public = &p_thumb->thumbnail;
+
+    p_thumb->p_picture = p_pic;
+    p_public->i_width = p_pic->format.i_visible_width;
+    p_public->i_height = p_pic->format.i_visible_height;
+    p_public->i_planes = p_pic->i_planes;
+    for( int i = 0; i < p_pic->i_planes; ++i )
+    {
+        p_public->planes[i].p_pixels = p_pic->p[i].p_pixels;
+        p_public->planes[i].i_pitch = p_pic->p[i].i_pitch;
+        p_public->planes[i].i_lines = p_pic->p[i].i_visible_lines;
+    }
+    p_public->i_time = p_pic->date != VLC_TICK_INVALID ? p_pic->date / 1000
+                                                       : -1;
+    return p_public;
+}
+
+static vlc_fourcc_t thumbnail_chroma( const char *psz_chroma )
+{
+    vlc_fourcc_t i_chroma = vlc_fourcc_GetCodecFromString( VIDEO_ES,
+                                                           psz_chroma );
+    if( i_chroma == 0 )
+        libvlc_printerr( "Unknown chroma: %s", psz_chroma );
+    return i_chroma;
+}
+
+libvlc_media_thumbnail_t *
+libvlc_media_thumbnail_request( libvlc_media_t *p_md,
+                                libvlc_time_t i_time, float f_pos,
+                                const char *psz_chroma,
+                                unsigned i_width, unsigned i_height,
+                                int i_timeout )
+{
+    vlc_fourcc_t i_chroma = thumbnail_chroma( psz_chroma );
+    if( i_chroma == 0 )
+        return NULL;
+
+    vlc_thumbnailer_t *p_thumbnailer =
+        vlc_thumbnailer_Create( p_md->p_libvlc_instance->p_libvlc_int );
+    if( unlikely( p_thumbnailer == NULL ) )
+        return NULL;
+
+    libvlc_media_thumbnail_t *p_thumb =
+        media_thumbnail( p_thumbnailer, p_md, i_time, f_pos, i_chroma,
+                         i_width, i_height, i_timeout );
+    vlc_thumbnailer_Release( p_thumbnailer );
+    return p_thumb;
+}
+
+struct thumbnail_batch
+{
+    libvlc_media_t *const *pp_md;
+    libvlc_media_thumbnail_t **pp_thumbnails;
+    unsigned i_count;
+    atomic_uint i_next; /**< index of the next media to process */
+
+    libvlc_time_t i_time;
+    float f_pos;
+    vlc_fourcc_t i_chroma;
+    unsigned i_width;
+    unsigned i_height;
+    int i_timeout;
+};
+
+static void *thumbnail_batch_thread( void *data )
+{
+    struct thumbnail_batch *p_batch = data;
+    vlc_thumbnailer_t *p_thumbnailer = vlc_thumbnailer_Create(
+        p_batch->pp_md[0]->p_libvlc_instance->p_libvlc_int );
+    unsigned i;
+
+    while( ( i = atomic_fetch_add( &p_batch->i_next, 1 ) ) < p_batch->i_count )
+    {
+        if( p_thumbnailer == NULL )
+            continue;
+        p_batch->pp_thumbnails[i] =
+            media_thumbnail( p_thumbnailer, p_batch->pp_md[i],
+                             p_batch->i_time, p_batch->f_pos,
+                             p_batch->i_chroma, p_batch->i_width,
+                             p_batch->i_height, p_batch->i_timeout );
+    }
+
+    if( p_thumbnailer != NULL )
+        vlc_thumbnailer_Release( p_thumbnailer );
+    return NULL;
+}
+
+unsigned
+libvlc_media_thumbnail_request_batch( libvlc_media_t *const *pp_md,
+                                      unsigned i_count,
+                                      libvlc_time_t i_time, float f_pos,
+                                      const char *psz_chroma,
+                                      unsigned i_width, unsigned i_height,
+                                      int i_timeout,
+                                      libvlc_media_thumbnail_t **pp_thumbnails )
+{
+    for( unsigned i = 0; i < i_count; ++i )
+        pp_thumbnails[i] = NULL;
+
+    vlc_fourcc_t i_chroma = thumbnail_chroma( psz_chroma );
+    if( i_chroma == 0 || i_count == 0 )
+        return 0;
+
+    struct thumbnail_batch batch = {
+        .pp_md = pp_md,
+        .pp_thumbnails = pp_thumbnails,
+        .i_count = i_count,
+        .i_time = i_time,
+        .f_pos = f_pos,
+        .i_chroma = i_chroma,
+        .i_width = i_width,
+        .i_height = i_height,
+        .i_timeout = i_timeout,
+    };
+    atomic_init( &batch.i_next, 0 );
+
+    /* The calling thread is one of the workers */
+    unsigned i_threads = __MIN( vlc_GetCPUCount(), i_count ) - 1;
+    vlc_thread_t *p_threads = vlc_alloc( i_threads, sizeof( *p_threads ) );
+    unsigned i_started = 0;
+
+    if( p_threads != NULL )
+        while( i_started < i_threads
+            && !vlc_clone( &p_threads[i_started], thumbnail_batch_thread,
+                           &batch, VLC_THREAD_PRIORITY_LOW ) )
+            i_started++;
+
+    thumbnail_batch_thread( &batch );
+
+    for( unsigned i = 0; i < i_started; ++i )
+        vlc_join( p_threads[i], NULL );
+    free( p_threads );
+
+    unsigned i_done = 0;
+    for( unsigned i = 0; i < i_count; ++i )
+        if( pp_thumbnails[i] != NULL )
+            i_done++;
+    return i_done;
+}
+
+void libvlc_media_thumbnail_release( libvlc_media_thumbnail_t *p_thumbnail )
+{
+    media_thumbnail_t *p_thumb =
+        container_of( p_thumbnail, media_thumbnail_t, thumbnail );
+
+    picture_Release( p_thumb->p_picture );
+    free( p_thumb );
+}
@@ -704,6 +704,36 @@ void libvlc_video_set_deinterlace( libvlc_media_player_t *p_mi,
     free (pp_vouts);
 }
 
+int libvlc_video_set_throttle( libvlc_media_player_t *p_mi,
+                               libvlc_video_throttle_t throttle )
+{
+    switch (throttle)
+    {
+        case libvlc_video_throttle_none:
+        case libvlc_video_throttle_keyframes:
+        case libvlc_video_throttle_hidden:
+            break;
+        default:
+            libvlc_printerr ("Invalid video throttle level");
+            return -1;
+    }
+
+    var_SetInteger (p_mi, "video-throttle", throttle);
+
+    input_thread_t *p_input_thread = libvlc_get_input_thread (p_mi);
+    if (p_input_thread != NULL)
+    {
+        var_SetInteger (p_input_thread, "video-throttle", throttle);
+        vlc_object_release (p_input_thread);
+    }
+    return 0;
+}
+
+libvlc_video_throttle_t libvlc_video_get_throttle( libvlc_media_player_t *p_mi )
+{
+    return var_GetInteger (p_mi, "video-throttle");
+}
+
 /* ************** */
 /* module helpers */
 /* ************** */
@@ -51,6 +51,9 @@
 #else
 #   include <unistd.h>
 #endif
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
 #include <dirent.h>
 
 #include <vlc_common.h>
@@ -63,12 +66,18 @@
 #include <vlc_fs.h>
 #include <vlc_url.h>
 #include <vlc_interrupt.h>
+#include <vlc_block.h>
 
 struct access_sys_t
 {
     int fd;
 
     bool b_pace_control;
+#ifdef HAVE_MMAP
+    uint64_t offset; /* next byte to map */
+    uint64_t size; /* file size, as of the last check */
+    size_t page_mask;
+#endif
 };
 
 #if !defined (_WIN32) && !defined (__OS2__)
@@ -138,9 +147,16 @@ static bool IsRemote (const char *path)
 #ifndef HAVE_POSIX_FADVISE
 # define posix_fadvise(fd, off, len, adv)
 #endif
+#ifndef HAVE_POSIX_MADVISE
+# define posix_madvise(addr, len, adv)
+#endif
 
 static ssize_t Read (stream_t *, void *, size_t);
 static int FileSeek (stream_t *, uint64_t);
+#ifdef HAVE_MMAP
+static block_t *MmapBlock (stream_t *, bool *);
+static int MmapSeek (stream_t *, uint64_t);
+#endif
 static int NoSeek (stream_t *, uint64_t);
 static int FileControl (stream_t *, int, va_list);
 
@@ -243,6 +259,21 @@ int FileOpen( vlc_object_t *p_this )
             fcntl (fd, F_RDAHEAD, 0);
         else
             fcntl (fd, F_RDAHEAD, 1);
+#endif
+#ifdef HAVE_MMAP
+        /* Local regular files can be mapped and handed out as blocks,
+         * saving a copy from the kernel. */
+        if (S_ISREG (st.st_mode) && !IsRemote(fd, p_access->psz_filepath)
+         && var_InheritBool (p_access, "file-mmap"))
+        {
+            p_access->pf_read = NULL;
+            p_access->pf_block = MmapBlock;
+            p_access->pf_seek = MmapSeek;
+            p_sys->offset = 0;
+            p_sys->size = st.st_size;
+            p_sys->page_mask = sysconf (_SC_PAGESIZE) - 1;
+            msg_Dbg (p_access, "memory mapping the file");
+        }
 #endif
     }
     else
@@ -265,7 +296,7 @@ void FileClose (vlc_object_t * p_this)
 {
     stream_t     *p_access = (stream_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_readdir != NULL)
     {
         DirClose (p_this);
         return;
@@ -311,6 +342,91 @@ static int FileSeek (stream_t *p_access, uint64_t i_pos)
     return VLC_SUCCESS;
 }
 
+#ifdef HAVE_MMAP
+/** Size of the file windows mapped by MmapBlock(). */
+#define MMAP_WINDOW (4 << 20)
+
+/*****************************************************************************
+ * MmapBlock: map the next window of the file
+ *****************************************************************************
+ * Each window is a separate mapping owned by the returned block, so it stays
+ * valid for as long as the block is in use downstream. The kernel is told
+ * that the window will be read sequentially, and read-ahead of the next
+ * window is requested from the current position.
+ * The window is clamped to the size of the file at the time it is mapped;
+ * truncating the file below a window that is still in use is not supported,
+ * as with any other mapping.
+ *****************************************************************************/
+static block_t *MmapBlock (stream_t *p_access, bool *restrict eof)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    uint64_t offset = p_sys->offset;
+    struct stat st;
+
+    /* The file may have grown or shrunk since the previous window: never map
+     * pages beyond its current end, touching them would raise SIGBUS. */
+    if (fstat (p_sys->fd, &st) == 0)
+        p_sys->size = st.st_size;
+    if (offset >= p_sys->size)
+    {
+        *eof = true;
+        return NULL;
+    }
+
+    size_t left = offset & p_sys->page_mask;
+    size_t length = MMAP_WINDOW - left;
+
+    if (length > p_sys->size - offset)
+        length = p_sys->size - offset;
+
+    block_t *block = NULL;
+    void *addr = mmap (NULL, left + length, PROT_READ, MAP_SHARED,
+                       p_sys->fd, offset - left);
+    if (addr != MAP_FAILED)
+    {
+        posix_madvise (addr, left + length, POSIX_MADV_SEQUENTIAL);
+        block = block_mmap_Alloc ((char *)addr + left, length);
+    }
+    else
+    {   /* Some file systems cannot be mapped: read the window instead. */
+        msg_Dbg (p_access, "cannot map window at %"PRIu64": %s", offset,
+                 vlc_strerror_c(errno));
+        block = block_Alloc (length);
+        if (block != NULL)
+        {
+            ssize_t val = pread (p_sys->fd, block->p_buffer, length, offset);
+            if (val <= 0)
+            {
+                if (val < 0)
+                    msg_Err (p_access, "read error: %s",
+                             vlc_strerror_c(errno));
+                block_Release (block);
+                *eof = true;
+                return NULL;
+            }
+            block->i_buffer = length = val;
+        }
+    }
+
+    if (unlikely(block == NULL))
+        return NULL;
+
+    p_sys->offset = offset + length;
+    posix_fadvise (p_sys->fd, p_sys->offset, MMAP_WINDOW,
+                   POSIX_FADV_WILLNEED);
+    return block;
+}
+
+static int MmapSeek (stream_t *p_access, uint64_t i_pos)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    p_sys->offset = i_pos;
+    posix_fadvise (p_sys->fd, i_pos, MMAP_WINDOW, POSIX_FADV_WILLNEED);
+    return VLC_SUCCESS;
+}
+#endif
+
 static int NoSeek (stream_t *p_access, uint64_t i_pos)
 {
     /* vlc_assert_unreachable(); ?? */
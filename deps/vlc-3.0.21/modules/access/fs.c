@@ -39,6 +39,12 @@ vlc_module_begin ()
     set_capability( "access", 50 )
     add_shortcut( "file", "fd", "stream" )
     set_callbacks( FileOpen, FileClose )
+#ifdef HAVE_MMAP
+    add_bool( "file-mmap", false, N_("Memory map local files"),
+              N_("Read local files through memory mappings rather than "
+                 "copying their content. Playback will crash if a file is "
+                 "truncated while it is being read."), true )
+#endif
 
     add_submodule()
     set_section( N_("Directory" ), NULL )
@@ -59,6 +59,13 @@ static void Close( vlc_object_t * );
 #define BUFFER_TEXT N_("Receive buffer")
 #define BUFFER_LONGTEXT N_("UDP receive buffer size (bytes)" )
 #define TIMEOUT_TEXT N_("UDP Source timeout (sec)")
+#define RCVBUF_TEXT N_("Socket receive buffer (bytes)")
+#define RCVBUF_LONGTEXT N_("Size of the kernel receive buffer of the socket. " \
+    "A larger buffer absorbs longer scheduling delays without dropping " \
+    "datagrams. Zero keeps the system default.")
+#define BATCH_TEXT N_("Datagrams per read")
+#define BATCH_LONGTEXT N_("Maximum number of datagrams received with a " \
+    "single system call.")
 
 vlc_module_begin ()
     set_shortname( N_("UDP" ) )
@@ -69,6 +76,9 @@ vlc_module_begin ()
     add_obsolete_integer( "server-port" ) /* since 2.0.0 */
     add_obsolete_integer( "udp-buffer" ) /* since 3.0.0 */
     add_integer( "udp-timeout", -1, TIMEOUT_TEXT, NULL, true )
+    add_integer( "udp-rcvbuf", 0, RCVBUF_TEXT, RCVBUF_LONGTEXT, true )
+    add_integer( "udp-batch", 64, BATCH_TEXT, BATCH_LONGTEXT, true )
+        change_integer_range( 1, 1024 )
 
     set_capability( "access", 0 )
     add_shortcut( "udp", "udpstream", "udp4", "udp6" )
@@ -76,11 +86,44 @@ vlc_module_begin ()
     set_callbacks( Open, Close )
 vlc_module_end ()
 
+#ifdef HAVE_RECVMMSG
+typedef struct mmsghdr udp_msg_t;
+#else
+typedef struct
+{
+    struct msghdr msg_hdr;
+    unsigned msg_len;
+} udp_msg_t;
+#endif
+
+#ifdef SO_RXQ_OVFL
+typedef char udp_control_t[CMSG_SPACE(sizeof (uint32_t))];
+#endif
+
 struct access_sys_t
 {
     int fd;
     int timeout;
     size_t mtu;
+
+    /* Blocks are allocated ahead of the datagrams. The slots handed out in
+     * a chain are refilled on the next call. */
+    unsigned batch;
+    block_t **slots;
+    struct iovec *iovs;
+    udp_msg_t *msgs;
+#ifdef SO_RXQ_OVFL
+    udp_control_t *controls;
+    uint32_t overflows;
+#endif
+
+    struct
+    {
+        uint64_t datagrams;
+        uint64_t calls;
+        uint64_t truncated;
+        uint64_t dropped;
+    } stats;
 };
 
 /*****************************************************************************
@@ -174,6 +217,58 @@ static int Open( vlc_object_t *p_this )
     if( sys->timeout > 0)
         sys->timeout *= 1000;
 
+    int rcvbuf = var_InheritInteger( p_access, "udp-rcvbuf" );
+    if( rcvbuf > 0 )
+    {
+#ifdef SO_RCVBUFFORCE
+        /* Exceeds the system maximum if privileged */
+        if( setsockopt( sys->fd, SOL_SOCKET, SO_RCVBUFFORCE,
+                        &rcvbuf, sizeof (rcvbuf) ) )
+#endif
+            setsockopt( sys->fd, SOL_SOCKET, SO_RCVBUF,
+                        (void *)&rcvbuf, sizeof (rcvbuf) );
+    }
+
+    int size;
+    socklen_t sizelen = sizeof (size);
+    if( getsockopt( sys->fd, SOL_SOCKET, SO_RCVBUF,
+                    (void *)&size, &sizelen ) == 0 )
+    {
+        if( size < rcvbuf )
+            msg_Warn( p_access, "receive buffer limited to %d bytes "
+                      "(%d requested)", size, rcvbuf );
+        else
+            msg_Dbg( p_access, "receive buffer is %d bytes", size );
+    }
+
+#ifdef SO_RXQ_OVFL
+    /* Counts the datagrams dropped by the kernel due to a full buffer */
+    setsockopt( sys->fd, SOL_SOCKET, SO_RXQ_OVFL, &(int){ 1 }, sizeof (int) );
+    sys->overflows = 0;
+#endif
+
+    sys->batch = var_InheritInteger( p_access, "udp-batch" );
+#if !defined(HAVE_RECVMMSG) && !defined(MSG_DONTWAIT)
+    sys->batch = 1;
+#endif
+    sys->slots = vlc_obj_calloc( p_this, sys->batch, sizeof (*sys->slots) );
+    sys->iovs = vlc_obj_calloc( p_this, sys->batch, sizeof (*sys->iovs) );
+    sys->msgs = vlc_obj_calloc( p_this, sys->batch, sizeof (*sys->msgs) );
+#ifdef SO_RXQ_OVFL
+    sys->controls = vlc_obj_calloc( p_this, sys->batch,
+                                    sizeof (*sys->controls) );
+#endif
+    if( unlikely(sys->slots == NULL || sys->iovs == NULL || sys->msgs == NULL
+#ifdef SO_RXQ_OVFL
+              || sys->controls == NULL
+#endif
+       ) )
+    {
+        net_Close( sys->fd );
+        return VLC_ENOMEM;
+    }
+
+    memset( &sys->stats, 0, sizeof (sys->stats) );
     return VLC_SUCCESS;
 }
 
@@ -185,6 +280,17 @@ static void Close( vlc_object_t *p_this )
     stream_t     *p_access = (stream_t*)p_this;
     access_sys_t *sys = p_access->p_sys;
 
+    for( unsigned i = 0; i < sys->batch; i++ )
+        if( sys->slots[i] != NULL )
+            block_Release( sys->slots[i] );
+
+    if( sys->stats.calls > 0 )
+        msg_Dbg( p_access, "%"PRIu64" datagrams in %"PRIu64" reads "
+                 "(%.1f per read), %"PRIu64" truncated, %"PRIu64" dropped",
+                 sys->stats.datagrams, sys->stats.calls,
+                 (double)sys->stats.datagrams / sys->stats.calls,
+                 sys->stats.truncated, sys->stats.dropped );
+
     net_Close( sys->fd );
 }
 
@@ -219,14 +325,71 @@ static int Control( stream_t *p_access, int i_query, va_list args )
 }
 
 /*****************************************************************************
- * BlockUDP:
+ * RecvBatch: receives up to count datagrams without blocking after the first
+ *****************************************************************************/
+static int RecvBatch(int fd, udp_msg_t *msgs, unsigned count, int flags)
+{
+#ifdef HAVE_RECVMMSG
+    return recvmmsg(fd, msgs, count, flags | MSG_WAITFORONE, NULL);
+#else
+    unsigned n = 0;
+
+    do
+    {
+        ssize_t len = recvmsg(fd, &msgs[n].msg_hdr, flags);
+        if (len < 0)
+            break;
+        msgs[n].msg_len = len;
+# ifdef MSG_DONTWAIT
+        flags |= MSG_DONTWAIT;
+# endif
+    }
+    while (++n < count);
+
+    return (n > 0) ? (int)n : -1;
+#endif
+}
+
+/*****************************************************************************
+ * BlockUDP: returns the available datagrams as a chain of blocks
  *****************************************************************************/
 static block_t *BlockUDP(stream_t *access, bool *restrict eof)
 {
     access_sys_t *sys = access->p_sys;
+    unsigned count;
+
+    for (count = 0; count < sys->batch; count++)
+    {
+        block_t *pkt = sys->slots[count];
+
+        /* Slots allocated before a truncation are too small */
+        if (pkt != NULL && pkt->i_buffer < sys->mtu)
+        {
+            block_Release(pkt);
+            pkt = NULL;
+        }
+        if (pkt == NULL)
+        {
+            pkt = block_Alloc(sys->mtu);
+            if (unlikely(pkt == NULL))
+                break;
+            sys->slots[count] = pkt;
+        }
+
+        struct msghdr *hdr = &sys->msgs[count].msg_hdr;
+
+        sys->iovs[count].iov_base = pkt->p_buffer;
+        sys->iovs[count].iov_len = pkt->i_buffer;
+        memset(hdr, 0, sizeof (*hdr));
+        hdr->msg_iov = &sys->iovs[count];
+        hdr->msg_iovlen = 1;
+#ifdef SO_RXQ_OVFL
+        hdr->msg_control = sys->controls[count];
+        hdr->msg_controllen = sizeof (sys->controls[count]);
+#endif
+    }
 
-    block_t *pkt = block_Alloc(sys->mtu);
-    if (unlikely(pkt == NULL))
+    if (unlikely(count == 0))
     {   /* OOM - dequeue and discard one packet */
         char dummy;
         recv(sys->fd, &dummy, 1, 0);
@@ -239,16 +402,6 @@ static block_t *BlockUDP(stream_t *access, bool *restrict eof)
     const int trunc_flag = 0;
 #endif
 
-    struct iovec iov = {
-        .iov_base = pkt->p_buffer,
-        .iov_len = sys->mtu,
-    };
-    struct msghdr msg = {
-        .msg_iov = &iov,
-        .msg_iovlen = 1,
-        .msg_flags = trunc_flag,
-    };
-
     struct pollfd ufd[1];
 
     ufd[0].fd = sys->fd;
@@ -261,27 +414,67 @@ static block_t *BlockUDP(stream_t *access, bool *restrict eof)
             *eof = true;
             /* fall through */
         case -1:
-            goto skip;
+            return NULL;
      }
 
-    ssize_t len = recvmsg(sys->fd, &msg, trunc_flag);
+    int n = RecvBatch(sys->fd, sys->msgs, count, trunc_flag);
+    if (n <= 0)
+        return NULL;
+
+    sys->stats.calls++;
+    sys->stats.datagrams += n;
+
+    block_t *chain = NULL, **pp = &chain;
 
-    if (len < 0)
+    for (int i = 0; i < n; i++)
     {
-skip:
-        block_Release(pkt);
-        return NULL;
+        block_t *pkt = sys->slots[i];
+        size_t len = sys->msgs[i].msg_len;
+
+        if (len == 0)
+            continue; /* Drop empty datagrams and keep the slot */
+
+        sys->slots[i] = NULL;
+
+        if (sys->msgs[i].msg_hdr.msg_flags & trunc_flag)
+        {
+            msg_Err(access, "%zu bytes packet truncated (MTU was %zu)",
+                    len, sys->mtu);
+            pkt->i_flags |= BLOCK_FLAG_CORRUPTED;
+            sys->stats.truncated++;
+            if (len > sys->mtu)
+                sys->mtu = len;
+        }
+        else
+            pkt->i_buffer = len;
+
+        *pp = pkt;
+        pp = &pkt->p_next;
     }
 
-    if (msg.msg_flags & trunc_flag)
+#ifdef SO_RXQ_OVFL
+    /* The kernel reports its running count of dropped datagrams */
+    struct msghdr *hdr = &sys->msgs[n - 1].msg_hdr;
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(hdr); cmsg != NULL;
+         cmsg = CMSG_NXTHDR(hdr, cmsg))
     {
-        msg_Err(access, "%zd bytes packet truncated (MTU was %zu)",
-                len, sys->mtu);
-        pkt->i_flags |= BLOCK_FLAG_CORRUPTED;
-        sys->mtu = len;
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SO_RXQ_OVFL)
+            continue;
+
+        uint32_t overflows;
+        memcpy(&overflows, CMSG_DATA(cmsg), sizeof (overflows));
+        if (overflows != sys->overflows)
+        {
+            /* Warn once, the total is printed when closing */
+            if (sys->stats.dropped == 0)
+                msg_Warn(access, "receive buffer overrun, datagrams dropped "
+                         "(consider increasing --udp-rcvbuf)");
+            sys->stats.dropped += overflows - sys->overflows;
+            sys->overflows = overflows;
+        }
     }
-    else
-        pkt->i_buffer = len;
+#endif
 
-    return pkt;
+    return chain;
 }
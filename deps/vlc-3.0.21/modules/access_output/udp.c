@@ -45,11 +45,20 @@
 #   include <ws2tcpip.h>
 #else
 #   include <sys/socket.h>
+#   include <netinet/in.h>
+#   include <netinet/udp.h>
+#endif
+
+#ifdef HAVE_SYS_UIO_H
+#   include <sys/uio.h>
 #endif
 
 #include <vlc_network.h>
 
 #define MAX_EMPTY_BLOCKS 200
+#define MAX_BATCH_PACKETS 64
+/* UDP payload limit of a segmentation offload send */
+#define MAX_GSO_SIZE 65000
 
 /*****************************************************************************
  * Module descriptor
@@ -71,6 +80,16 @@ static void Close( vlc_object_t * );
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
 
+#define WINDOW_TEXT N_("Pacing window (ms)")
+#define WINDOW_LONGTEXT N_("Packets due within this delay of each other " \
+                           "are sent together with a single system call, " \
+                           "at the date of the last one. Packets carrying " \
+                           "a clock reference are always sent on time." )
+
+#define GSO_TEXT N_("Segmentation offload")
+#define GSO_LONGTEXT N_("Let the kernel split packets sent together " \
+                        "(Linux only)." )
+
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
     set_shortname( "UDP" )
@@ -79,6 +98,10 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT,
                                  true )
+    add_integer( SOUT_CFG_PREFIX "window", 0, WINDOW_TEXT, WINDOW_LONGTEXT,
+                 true )
+        change_integer_range( 0, 100 )
+    add_bool( SOUT_CFG_PREFIX "gso", false, GSO_TEXT, GSO_LONGTEXT, true )
 
     set_capability( "sout access", 0 )
     add_shortcut( "udp" )
@@ -92,6 +115,8 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+    "window",
+    "gso",
     NULL
 };
 
@@ -121,6 +146,15 @@ struct sout_access_out_sys_t
     block_t      *p_buffer;
 
     vlc_thread_t  thread;
+
+    /* Owned by the thread */
+    vlc_tick_t    i_window;
+    bool          b_gso;
+    block_t      *pp_batch[MAX_BATCH_PACKETS];
+    unsigned      i_batch;
+    block_t      *p_pending; /* due after the current batch */
+    uint64_t      i_sent_packets;
+    uint64_t      i_sent_calls;
 };
 
 #define DEFAULT_PORT 1234
@@ -212,6 +246,13 @@ static int Open( vlc_object_t *p_this )
     p_sys->p_fifo = block_FifoNew();
     p_sys->p_empty_blocks = block_FifoNew();
     p_sys->p_buffer = NULL;
+    p_sys->i_window = UINT64_C(1000)
+                    * var_GetInteger( p_access, SOUT_CFG_PREFIX "window" );
+    p_sys->b_gso = var_GetBool( p_access, SOUT_CFG_PREFIX "gso" );
+    p_sys->i_batch = 0;
+    p_sys->p_pending = NULL;
+    p_sys->i_sent_packets = 0;
+    p_sys->i_sent_calls = 0;
 
     if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
                            VLC_THREAD_PRIORITY_HIGHEST ) )
@@ -240,6 +281,11 @@ static void Close( vlc_object_t * p_this )
 
     vlc_cancel( p_sys->thread );
     vlc_join( p_sys->thread, NULL );
+
+    if( p_sys->i_sent_calls > 0 )
+        msg_Dbg( p_access, "%"PRIu64" packets sent in %"PRIu64" system calls",
+                 p_sys->i_sent_packets, p_sys->i_sent_calls );
+
     block_FifoRelease( p_sys->p_fifo );
     block_FifoRelease( p_sys->p_empty_blocks );
 
@@ -380,6 +426,133 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, vlc_tick_t i_dts)
     return p_buffer;
 }
 
+#ifdef UDP_SEGMENT
+/*****************************************************************************
+ * SendSegmented: send packets of the same size as one buffer split by the
+ * kernel. Returns the number of packets sent, 0 if there are not enough
+ * packets of the same size, -1 on error.
+ *****************************************************************************/
+static int SendSegmented( int fd, struct iovec *iov, unsigned i_count )
+{
+    const size_t i_size = iov[0].iov_len;
+    size_t i_total = 0;
+    unsigned n = 0;
+
+    while( n < i_count && i_total + iov[n].iov_len <= MAX_GSO_SIZE )
+    {
+        i_total += iov[n].iov_len;
+        /* Only the last segment can be shorter */
+        if( iov[n++].iov_len != i_size )
+            break;
+    }
+    if( n < 2 )
+        return 0;
+
+    union
+    {
+        char buf[CMSG_SPACE(sizeof (uint16_t))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr hdr = {
+        .msg_iov = iov,
+        .msg_iovlen = n,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof (control.buf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR( &hdr );
+    uint16_t i_segment = i_size;
+
+    cmsg->cmsg_level = IPPROTO_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof (i_segment));
+    memcpy( CMSG_DATA(cmsg), &i_segment, sizeof (i_segment) );
+
+    return sendmsg( fd, &hdr, 0 ) == -1 ? -1 : (int)n;
+}
+#endif
+
+/*****************************************************************************
+ * SendBatch: send the gathered packets with as few system calls as possible
+ *****************************************************************************/
+static void SendBatch( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    const unsigned i_count = p_sys->i_batch;
+    struct iovec iov[MAX_BATCH_PACKETS];
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgs[MAX_BATCH_PACKETS];
+
+    memset( msgs, 0, i_count * sizeof (*msgs) );
+#endif
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        iov[i].iov_base = p_sys->pp_batch[i]->p_buffer;
+        iov[i].iov_len = p_sys->pp_batch[i]->i_buffer;
+#ifdef HAVE_SENDMMSG
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+#endif
+    }
+
+    for( unsigned i = 0; i < i_count; )
+    {
+        int n = 0;
+
+#ifdef UDP_SEGMENT
+        if( p_sys->b_gso && i_count - i > 1 )
+        {
+            n = SendSegmented( p_sys->i_handle, iov + i, i_count - i );
+            if( n == -1 && (errno == EIO || errno == EINVAL
+                         || errno == ENOPROTOOPT) )
+            {
+                msg_Warn( p_access, "segmentation offload not available: %s",
+                          vlc_strerror_c(errno) );
+                p_sys->b_gso = false;
+                n = 0;
+            }
+        }
+#endif
+        if( n == 0 )
+        {
+#ifdef HAVE_SENDMMSG
+            n = sendmmsg( p_sys->i_handle, msgs + i, i_count - i, 0 );
+#else
+            n = send( p_sys->i_handle, iov[i].iov_base, iov[i].iov_len, 0 );
+            if( n != -1 )
+                n = 1;
+#endif
+        }
+        p_sys->i_sent_calls++;
+
+        if( n == -1 )
+        {
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+            n = 1; /* skip the packet */
+        }
+        i += n;
+    }
+    p_sys->i_sent_packets += i_count;
+}
+
+/*****************************************************************************
+ * ReleaseBatch: thread cancellation cleanup
+ *****************************************************************************/
+static void ReleaseBatch( void *data )
+{
+    sout_access_out_sys_t *p_sys = data;
+
+    for( unsigned i = 0; i < p_sys->i_batch; i++ )
+        block_Release( p_sys->pp_batch[i] );
+    p_sys->i_batch = 0;
+
+    if( p_sys->p_pending != NULL )
+    {
+        block_Release( p_sys->p_pending );
+        p_sys->p_pending = NULL;
+    }
+}
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
  *****************************************************************************/
@@ -387,50 +560,84 @@ static void* ThreadWrite( void *data )
 {
     sout_access_out_t *p_access = data;
     sout_access_out_sys_t *p_sys = p_access->p_sys;
-    vlc_tick_t i_date_last = -1;
+    volatile vlc_tick_t i_date_last = -1; /* across vlc_cleanup_push() */
     const unsigned i_group = var_GetInteger( p_access,
                                              SOUT_CFG_PREFIX "group" );
-    vlc_tick_t i_to_send = i_group;
     unsigned i_dropped_packets = 0;
 
+    vlc_cleanup_push( ReleaseBatch, p_sys );
     for (;;)
     {
-        block_t *p_pk = block_FifoGet( p_sys->p_fifo );
-        vlc_tick_t    i_date, i_sent;
+        vlc_tick_t i_first = 0, i_date = 0, i_sent;
+        bool b_clock = false;
 
-        i_date = p_sys->i_caching + p_pk->i_dts;
-        if( i_date_last > 0 )
+        /* Gather the queued packets due within the pacing window of the
+         * first one, up to the next clock reference */
+        while( p_sys->i_batch < MAX_BATCH_PACKETS && !b_clock )
         {
-            if( i_date - i_date_last > 2000000 )
-            {
-                if( !i_dropped_packets )
-                    msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
-                             i_date - i_date_last );
+            block_t *p_pk = p_sys->p_pending;
 
-                block_FifoPut( p_sys->p_empty_blocks, p_pk );
+            if( p_pk != NULL )
+                p_sys->p_pending = NULL;
+            else
+            {
+                if( p_sys->i_batch == 0 )
+                    p_pk = block_FifoGet( p_sys->p_fifo );
+                else
+                {
+                    vlc_fifo_Lock( p_sys->p_fifo );
+                    p_pk = vlc_fifo_DequeueUnlocked( p_sys->p_fifo );
+                    vlc_fifo_Unlock( p_sys->p_fifo );
+                    if( p_pk == NULL )
+                        break;
+                }
 
-                i_date_last = i_date;
-                i_dropped_packets++;
-                continue;
+                vlc_tick_t i_pk_date = p_sys->i_caching + p_pk->i_dts;
+                if( i_date_last > 0 )
+                {
+                    if( i_pk_date - i_date_last > 2000000 )
+                    {
+                        if( !i_dropped_packets )
+                            msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
+                                     i_pk_date - i_date_last );
+
+                        block_FifoPut( p_sys->p_empty_blocks, p_pk );
+
+                        i_date_last = i_pk_date;
+                        i_dropped_packets++;
+                        continue;
+                    }
+                    else if( i_pk_date - i_date_last < -1000 )
+                    {
+                        if( !i_dropped_packets )
+                            msg_Dbg( p_access, "mmh, packets in the past (%"PRId64")",
+                                     i_date_last - i_pk_date );
+                    }
+                }
+                i_date_last = i_pk_date;
             }
-            else if( i_date - i_date_last < -1000 )
+
+            vlc_tick_t i_pk_date = p_sys->i_caching + p_pk->i_dts;
+            if( p_sys->i_batch == 0 )
+                i_first = i_pk_date;
+            else if( p_sys->i_batch >= i_group
+                  && i_pk_date > i_first + p_sys->i_window )
             {
-                if( !i_dropped_packets )
-                    msg_Dbg( p_access, "mmh, packets in the past (%"PRId64")",
-                             i_date_last - i_date );
+                p_sys->p_pending = p_pk;
+                break;
             }
-        }
 
-        block_cleanup_push( p_pk );
-        i_to_send--;
-        if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
-        {
-            mwait( i_date );
-            i_to_send = i_group;
+            p_sys->pp_batch[p_sys->i_batch++] = p_pk;
+            if( i_pk_date > i_date )
+                i_date = i_pk_date;
+            b_clock = p_pk->i_flags & BLOCK_FLAG_CLOCK;
         }
-        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
-            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
-        vlc_cleanup_pop();
+
+        if( p_sys->i_batch == 0 )
+            continue;
+
+        mwait( i_date );
+        SendBatch( p_access );
 
         if( i_dropped_packets )
         {
@@ -438,18 +645,17 @@ static void* ThreadWrite( void *data )
             i_dropped_packets = 0;
         }
 
-#if 1
         i_sent = mdate();
         if ( i_sent > i_date + 20000 )
         {
             msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
                      i_sent - i_date );
         }
-#endif
-
-        block_FifoPut( p_sys->p_empty_blocks, p_pk );
 
-        i_date_last = i_date;
+        for( unsigned i = 0; i < p_sys->i_batch; i++ )
+            block_FifoPut( p_sys->p_empty_blocks, p_sys->pp_batch[i] );
+        p_sys->i_batch = 0;
     }
+    vlc_cleanup_pop();
     return NULL;
 }
@@ -932,6 +932,7 @@ AbstractBufferingLogic *PlaylistManager::createBufferingLogic() const
         v = var_InheritInteger(p_demux, "adaptive-maxbuffer");
         if(v)
             bl->setUserMaxBuffering(CLOCK_FREQ / 1000 * v);
+        bl->setUserPrefetch(var_InheritInteger(p_demux, "adaptive-prefetch"));
     }
     return bl;
 }
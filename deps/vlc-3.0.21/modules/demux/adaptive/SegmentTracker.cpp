@@ -233,6 +233,7 @@ void SegmentTracker::reset()
 SegmentTracker::ChunkEntry::ChunkEntry()
 {
     chunk = nullptr;
+    prefetched = false;
 }
 
 SegmentTracker::ChunkEntry::ChunkEntry(SegmentChunk *c, Position p, vlc_tick_t s, vlc_tick_t d, vlc_tick_t dt)
@@ -242,6 +243,7 @@ SegmentTracker::ChunkEntry::ChunkEntry(SegmentChunk *c, Position p, vlc_tick_t s
     duration = d;
     starttime = s;
     displaytime = dt;
+    prefetched = false;
 }
 
 bool SegmentTracker::ChunkEntry::isValid() const
@@ -264,33 +266,8 @@ SegmentTracker::prepareChunk(bool switch_allowed, Position pos) const
     }
     else /* continuing, or seek */
     {
-        if(!adaptationSet->isSegmentAligned() || !pos.init_sent || !pos.index_sent)
-            switch_allowed = false;
-
         if(switch_allowed)
-        {
-            Position temp;
-            temp.rep = logic->getNextRepresentation(adaptationSet, pos.rep);
-            if(temp.rep && temp.rep != pos.rep)
-            {
-                /* Convert our segment number if we need to */
-                temp.number = temp.rep->translateSegmentNumber(pos.number, pos.rep);
-
-                /* Ensure ephemere content is updated/loaded */
-                if(temp.rep->needsUpdate(temp.number))
-                    temp.rep->scheduleNextUpdate(temp.number, temp.rep->runLocalUpdates(resources));
-
-                /* could have been std::numeric_limits<uint64_t>::max() if not found because not avail */
-                if(!temp.isValid()) /* try again */
-                    temp.number = temp.rep->translateSegmentNumber(pos.number, pos.rep);
-
-                /* cancel switch that would go past playlist */
-                if(temp.isValid() && temp.rep->getMinAheadTime(temp.number) == 0)
-                    temp = Position();
-            }
-            if(temp.isValid())
-                pos = temp;
-        }
+            pos = getSwitchPosition(pos);
     }
 
     bool b_gap = true;
@@ -335,6 +312,58 @@ SegmentTracker::prepareChunk(bool switch_allowed, Position pos) const
     return ChunkEntry(segmentChunk, pos, startTime, duration, displayTime);
 }
 
+SegmentTracker::Position
+SegmentTracker::getSwitchPosition(const Position &pos) const
+{
+    if(!adaptationSet->isSegmentAligned() || !pos.init_sent || !pos.index_sent)
+        return pos;
+
+    Position temp;
+    temp.rep = logic->getNextRepresentation(adaptationSet, pos.rep);
+    if(temp.rep && temp.rep != pos.rep)
+    {
+        /* Convert our segment number if we need to */
+        temp.number = temp.rep->translateSegmentNumber(pos.number, pos.rep);
+
+        /* Ensure ephemere content is updated/loaded */
+        if(temp.rep->needsUpdate(temp.number))
+            temp.rep->scheduleNextUpdate(temp.number, temp.rep->runLocalUpdates(resources));
+
+        /* could have been std::numeric_limits<uint64_t>::max() if not found because not avail */
+        if(!temp.isValid()) /* try again */
+            temp.number = temp.rep->translateSegmentNumber(pos.number, pos.rep);
+
+        /* cancel switch that would go past playlist */
+        if(temp.isValid() && temp.rep->getMinAheadTime(temp.number) == 0)
+            temp = Position();
+    }
+    return temp.isValid() ? temp : pos;
+}
+
+void SegmentTracker::prefetchChunks()
+{
+    /* Queue the following segments of the same representation, so that
+     * they download while the current one is demuxed */
+    const unsigned depth = bufferingLogic->getPrefetch();
+    while(chunkssequence.size() < depth)
+    {
+        Position pos = next;
+        if(!chunkssequence.empty())
+        {
+            pos = chunkssequence.back().pos;
+            ++pos;
+        }
+        ChunkEntry chunk = prepareChunk(false, pos);
+        if(!chunk.isValid())
+        {
+            delete chunk.chunk;
+            break;
+        }
+        chunk.prefetched = true;
+        chunkssequence.push_back(chunk);
+    }
+}
+
 void SegmentTracker::resetChunksSequence()
 {
     while(!chunkssequence.empty())
@@ -349,6 +378,18 @@ ChunkInterface * SegmentTracker::getNextChunk(bool switch_allowed)
     if(!adaptationSet || !next.isValid())
         return nullptr;
 
+    /* Lookahead segments were requested before the adaptation logic could
+     * switch: drop them if it now wants another representation */
+    if(!chunkssequence.empty() && chunkssequence.front().prefetched && switch_allowed)
+    {
+        Position pos = getSwitchPosition(next);
+        if(pos.rep != chunkssequence.front().pos.rep)
+        {
+            resetChunksSequence();
+            chunkssequence.push_back(prepareChunk(false, pos));
+        }
+    }
+
     if(chunkssequence.empty())
     {
         ChunkEntry chunk = prepareChunk(switch_allowed, next);
@@ -436,7 +477,10 @@ ChunkInterface * SegmentTracker::getNextChunk(bool switch_allowed)
                                chunk.starttime, chunk.duration, chunk.displaytime));
 
     if(!b_gap)
+    {
         ++next;
+        prefetchChunks();
+    }
 
     return returnedChunk;
 }
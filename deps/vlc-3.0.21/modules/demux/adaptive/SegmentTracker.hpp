@@ -250,9 +250,12 @@ namespace adaptive
                     vlc_tick_t displaytime;
                     vlc_tick_t starttime;
                     vlc_tick_t duration;
+                    bool prefetched;
             };
             std::list<ChunkEntry> chunkssequence;
             ChunkEntry prepareChunk(bool switch_allowed, Position pos) const;
+            Position getSwitchPosition(const Position &) const;
+            void prefetchChunks();
             void resetChunksSequence();
             void setAdaptationLogic(AbstractAdaptationLogic *);
             void notify(const TrackerEvent &) const;
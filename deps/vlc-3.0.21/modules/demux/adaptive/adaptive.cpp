@@ -77,6 +77,12 @@ static void Close   (vlc_object_t *);
 
 #define ADAPT_MAXBUFFER_TEXT N_("Max buffering (ms)")
 
+#define ADAPT_MAXDOWNLOADS_TEXT N_("Concurrent downloads")
+#define ADAPT_MAXDOWNLOADS_LONGTEXT N_("Maximum number of segments downloaded at once")
+
+#define ADAPT_PREFETCH_TEXT N_("Segments lookahead")
+#define ADAPT_PREFETCH_LONGTEXT N_("Number of segments requested ahead of the current one")
+
 #define ADAPT_LOGIC_TEXT N_("Adaptive Logic")
 
 #define ADAPT_ACCESS_TEXT N_("Use regular HTTP modules")
@@ -143,6 +149,10 @@ vlc_module_begin ()
         add_integer( "adaptive-maxbuffer",
                      AbstractBufferingLogic::DEFAULT_MAX_BUFFERING  / 1000,
                      ADAPT_MAXBUFFER_TEXT, nullptr, true );
+        add_integer_with_range( "adaptive-maxdownloads", 2, 1, 8,
+                     ADAPT_MAXDOWNLOADS_TEXT, ADAPT_MAXDOWNLOADS_LONGTEXT, true )
+        add_integer_with_range( "adaptive-prefetch", 0, 0, 8,
+                     ADAPT_PREFETCH_TEXT, ADAPT_PREFETCH_LONGTEXT, true )
         add_integer( "adaptive-lowlatency", -1, ADAPT_LOWLATENCY_TEXT, ADAPT_LOWLATENCY_LONGTEXT, true );
             change_integer_list(rgi_latency, ppsz_latency)
         set_callbacks( Open, Close )
@@ -343,6 +343,9 @@ HTTPChunkBufferedSource::HTTPChunkBufferedSource(const std::string& url, Abstrac
     done = false;
     eof = false;
     held = false;
+    wanted = false;
+    transfertime = 0;
+    ratereported = false;
     p_read = nullptr;
     inblockreadoffset = 0;
 }
@@ -376,6 +379,12 @@ bool HTTPChunkBufferedSource::isDone() const
     return done;
 }
 
+bool HTTPChunkBufferedSource::isWanted() const
+{
+    vlc_mutex_locker locker( &lock );
+    return wanted;
+}
+
 void HTTPChunkBufferedSource::hold()
 {
     vlc_mutex_locker locker( &lock );
@@ -416,13 +425,6 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         return;
     }
 
-    struct
-    {
-        size_t size;
-        vlc_tick_t time;
-        vlc_tick_t latency;
-    } rate = {0,0,0};
-
     ssize_t ret = connection->read(p_block->p_buffer, readsize);
     if(ret <= 0)
     {
@@ -431,9 +433,6 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         vlc_mutex_locker locker( &lock );
         done = true;
         downloadEndTime = mdate();
-        rate.size = buffered;
-        rate.time = downloadEndTime - requestStartTime;
-        rate.latency = responseTime - requestStartTime;
     }
     else
     {
@@ -450,19 +449,40 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         {
             done = true;
             downloadEndTime = mdate();
-            rate.size = buffered;
-            rate.time = downloadEndTime - requestStartTime;
-            rate.latency = responseTime - requestStartTime;
         }
     }
 
+    vlc_cond_signal(&avail);
+}
+
+void HTTPChunkBufferedSource::transferred(vlc_tick_t time)
+{
+    /* The downloader accounts for the time actually spent on our transfer,
+     * which is less than the wall clock time when other sources are being
+     * downloaded concurrently */
+    struct
+    {
+        size_t size;
+        vlc_tick_t time;
+        vlc_tick_t latency;
+    } rate = {0,0,0};
+
+    vlc_mutex_lock(&lock);
+    transfertime += time;
+    if(done && !ratereported)
+    {
+        ratereported = true;
+        rate.size = buffered;
+        rate.time = transfertime;
+        rate.latency = responseTime - requestStartTime;
+    }
+    vlc_mutex_unlock(&lock);
+
     if(rate.size && rate.time && type == ChunkType::Segment)
     {
         connManager->updateDownloadRate(sourceid, rate.size,
                                         rate.time, rate.latency);
     }
-
-    vlc_cond_signal(&avail);
 }
 
 bool HTTPChunkBufferedSource::hasMoreData() const
@@ -485,6 +505,7 @@ block_t * HTTPChunkBufferedSource::readBlock()
 
     vlc_mutex_locker locker(&lock);
 
+    wanted = true;
     while(!p_read && !done)
         vlc_cond_wait(&avail, &lock);
 
@@ -511,6 +532,7 @@ block_t * HTTPChunkBufferedSource::read(size_t readsize)
 {
     vlc_mutex_locker locker(&lock);
 
+    wanted = true;
     while(readsize > (buffered - consumed) && !done)
         vlc_cond_wait(&avail, &lock);
 
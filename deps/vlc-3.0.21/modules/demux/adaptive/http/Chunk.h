@@ -170,7 +170,9 @@ namespace adaptive
                                         const ID &, ChunkType, const BytesRange &,
                                         bool = false);
                 void               bufferize(size_t);
+                void               transferred(vlc_tick_t);
                 bool               isDone() const;
+                bool               isWanted() const;
                 void               hold();
                 void               release();
 
@@ -184,6 +186,9 @@ namespace adaptive
                 bool                eof;
                 vlc_cond_t          avail;
                 bool                held;
+                bool                wanted; /* a reader is waiting for data */
+                vlc_tick_t          transfertime;
+                bool                ratereported;
         };
 
         class HTTPChunk : public AbstractChunk
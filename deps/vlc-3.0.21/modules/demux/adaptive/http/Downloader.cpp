@@ -26,43 +26,48 @@
 #include <vlc_threads.h>
 #include <vlc_atomic.h>
 
+#include <algorithm>
+
 using namespace adaptive::http;
 
-Downloader::Downloader()
+Downloader::Downloader(unsigned workers)
 {
     vlc_mutex_init(&lock);
     vlc_cond_init(&waitcond);
     vlc_cond_init(&updatedcond);
     killed = false;
-    thread_handle_valid = false;
-    current = nullptr;
-    cancel_current = false;
+    maxthreads = workers ? workers : 1;
+    sharedtime = 0;
+    sharedtimeupdate = VLC_TICK_INVALID;
 }
 
 bool Downloader::start()
 {
-    if(!thread_handle_valid &&
-       vlc_clone(&thread_handle, downloaderThread,
-                 static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+    while(threads.size() < maxthreads)
     {
-        return false;
+        vlc_thread_t thread_handle;
+        if(vlc_clone(&thread_handle, downloaderThread,
+                     static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+            break;
+        threads.push_back(thread_handle);
     }
-    thread_handle_valid = true;
-    return true;
+    return !threads.empty();
 }
 
 Downloader::~Downloader()
 {
     vlc_mutex_lock( &lock );
     killed = true;
-    vlc_cond_signal(&waitcond);
+    vlc_cond_broadcast(&waitcond);
     vlc_mutex_unlock( &lock );
 
-    if(thread_handle_valid)
+    for(vlc_thread_t thread_handle : threads)
         vlc_join(thread_handle, nullptr);
     vlc_mutex_destroy(&lock);
     vlc_cond_destroy(&waitcond);
+    vlc_cond_destroy(&updatedcond);
 }
+
 void Downloader::schedule(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
@@ -75,18 +80,63 @@ void Downloader::schedule(HTTPChunkBufferedSource *source)
 void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
-    while (current == source)
+    auto it = std::find(chunks.begin(), chunks.end(), source);
+    if(it != chunks.end())
     {
-        cancel_current = true;
-        vlc_cond_wait(&updatedcond, &lock);
+        chunks.erase(it);
+        /* otherwise released by the worker when it is done with it */
+        if(!isActive(source))
+            source->release();
     }
 
-    if(!source->isDone())
+    while(isActive(source))
+        vlc_cond_wait(&updatedcond, &lock);
+    vlc_mutex_unlock(&lock);
+}
+
+bool Downloader::isActive(const HTTPChunkBufferedSource *source) const
+{
+    return std::find(current.begin(), current.end(), source) != current.end();
+}
+
+HTTPChunkBufferedSource * Downloader::getNextSource() const
+{
+    /* Segments someone is already waiting on first, then one
+     * download at a time per stream, then in scheduling order */
+    HTTPChunkBufferedSource *next = nullptr;
+    unsigned nextrank = 0;
+    for(HTTPChunkBufferedSource *source : chunks)
     {
-        chunks.remove(source);
-        source->release();
+        if(isActive(source))
+            continue;
+
+        unsigned rank = source->isWanted() ? 0 : 2;
+        for(const HTTPChunkBufferedSource *active : current)
+        {
+            if(active->sourceid == source->sourceid)
+            {
+                rank += 1;
+                break;
+            }
+        }
+
+        if(next == nullptr || rank < nextrank)
+        {
+            next = source;
+            nextrank = rank;
+            if(rank == 0)
+                break;
+        }
     }
-    vlc_mutex_unlock(&lock);
+    return next;
+}
+
+void Downloader::updateSharedTime()
+{
+    vlc_tick_t now = mdate();
+    if(!current.empty())
+        sharedtime += (now - sharedtimeupdate) / current.size();
+    sharedtimeupdate = now;
 }
 
 void * Downloader::downloaderThread(void *opaque)
@@ -101,24 +151,46 @@ void Downloader::Run()
     vlc_mutex_lock(&lock);
     while(1)
     {
-        while(chunks.empty() && !killed)
+        HTTPChunkBufferedSource *source;
+        while(!killed && (source = getNextSource()) == nullptr)
             vlc_cond_wait(&waitcond, &lock);
 
         if(killed)
             break;
 
-        current = chunks.front();
+        updateSharedTime();
+        current.push_back(source);
+        const vlc_tick_t starttime = sharedtime;
+        vlc_mutex_unlock(&lock);
+
+        source->bufferize(HTTPChunkSource::CHUNK_SIZE);
+
+        vlc_mutex_lock(&lock);
+        updateSharedTime();
+        const vlc_tick_t share = sharedtime - starttime;
         vlc_mutex_unlock(&lock);
-        current->bufferize(HTTPChunkSource::CHUNK_SIZE);
+
+        /* still active, so it can't be cancelled meanwhile */
+        source->transferred(share);
+
         vlc_mutex_lock(&lock);
-        if(current->isDone() || cancel_current)
+        current.remove(source);
+        auto it = std::find(chunks.begin(), chunks.end(), source);
+        if(it == chunks.end()) /* cancelled */
+        {
+            source->release();
+        }
+        else if(source->isDone())
+        {
+            chunks.erase(it);
+            source->release();
+        }
+        else
         {
-            chunks.pop_front();
-            current->release();
+            /* can now be picked up again by any worker */
+            vlc_cond_signal(&waitcond);
         }
-        cancel_current = false;
-        current = nullptr;
-        vlc_cond_signal(&updatedcond);
+        vlc_cond_broadcast(&updatedcond);
     }
     vlc_mutex_unlock(&lock);
 }
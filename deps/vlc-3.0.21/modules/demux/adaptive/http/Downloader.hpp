@@ -24,6 +24,7 @@
 
 #include <vlc_common.h>
 #include <list>
+#include <vector>
 
 namespace adaptive
 {
@@ -34,7 +35,7 @@ namespace adaptive
         class Downloader
         {
             public:
-                Downloader();
+                Downloader(unsigned = 1);
                 ~Downloader();
                 bool start();
                 void schedule(HTTPChunkBufferedSource *);
@@ -43,15 +44,21 @@ namespace adaptive
             private:
                 static void * downloaderThread(void *);
                 void Run();
-                vlc_thread_t thread_handle;
+                HTTPChunkBufferedSource * getNextSource() const;
+                bool isActive(const HTTPChunkBufferedSource *) const;
+                void updateSharedTime();
+                std::vector<vlc_thread_t> threads;
+                unsigned     maxthreads;
                 vlc_mutex_t  lock;
                 vlc_cond_t   waitcond;
                 vlc_cond_t   updatedcond;
-                bool         thread_handle_valid;
                 bool         killed;
-                bool         cancel_current;
                 std::list<HTTPChunkBufferedSource *> chunks;
-                HTTPChunkBufferedSource *current;
+                std::list<HTTPChunkBufferedSource *> current;
+                /* Each active download gets an equal share of the elapsed
+                 * time, so that concurrent transfers report their own rate */
+                vlc_tick_t   sharedtime;
+                vlc_tick_t   sharedtimeupdate;
         };
 
     }
@@ -75,7 +75,7 @@ HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_)
       localAllowed(false)
 {
     vlc_mutex_init(&lock);
-    downloader = new Downloader();
+    downloader = new Downloader(var_InheritInteger(p_object, "adaptive-maxdownloads"));
     downloaderhp = new Downloader();
     downloader->start();
     downloaderhp->start();
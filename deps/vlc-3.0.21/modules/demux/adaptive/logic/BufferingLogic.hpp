@@ -51,6 +51,8 @@ namespace adaptive
                 void setUserMaxBuffering(vlc_tick_t);
                 void setUserLiveDelay(vlc_tick_t);
                 void setLowDelay(bool);
+                void setUserPrefetch(unsigned);
+                unsigned getPrefetch() const;
                 static const vlc_tick_t BUFFERING_LOWEST_LIMIT;
                 static const vlc_tick_t DEFAULT_MIN_BUFFERING;
                 static const vlc_tick_t DEFAULT_MAX_BUFFERING;
@@ -60,6 +62,7 @@ namespace adaptive
                 vlc_tick_t userMinBuffering;
                 vlc_tick_t userMaxBuffering;
                 vlc_tick_t userLiveDelay;
+                unsigned userPrefetch;
                 Undef<bool> userLowLatency;
         };
 
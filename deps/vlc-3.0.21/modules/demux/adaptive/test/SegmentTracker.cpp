@@ -733,7 +733,7 @@ static int SegmentTracker_check_HLSseeks(BaseAdaptationSet *adaptSet,
 
 typedef decltype(SegmentTracker_check_formats) testfunc;
 
-static int Prepare_test(testfunc func)
+static int Prepare_test(testfunc func, unsigned prefetch = 0)
 {
     DummyConnectionManager *connManager = nullptr;
     try
@@ -747,6 +747,7 @@ static int Prepare_test(testfunc func)
 
     SharedResources sharedRes(nullptr, nullptr, connManager);
     DefaultBufferingLogic bufLogic;
+    bufLogic.setUserPrefetch(prefetch);
     SynchronizationReferences syncRefs;
 
     BaseAdaptationSet *adaptSet = CreatePlaylistPeriodAdaptationSet();
@@ -786,5 +787,9 @@ int SegmentTracker_test()
         Prepare_test(SegmentTracker_check_seeks) ||
         Prepare_test(SegmentTracker_check_switches) ||
         Prepare_test(SegmentTracker_check_HLSseeks) ||
+        /* same results with segments requested ahead */
+        Prepare_test(SegmentTracker_check_formats, 2) ||
+        Prepare_test(SegmentTracker_check_seeks, 2) ||
+        Prepare_test(SegmentTracker_check_switches, 2) ||
         0;
 }
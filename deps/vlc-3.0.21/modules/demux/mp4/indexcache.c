@@ -0,0 +1,492 @@
+/*****************************************************************************
+ * indexcache.c : MP4 samples index cache
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_configuration.h>
+
+#include "indexcache.h"
+
+#include <sys/stat.h>
+#include <errno.h>
+
+/*
+ * Cache file layout, in host byte order, all parts being 8 bytes aligned:
+ *  - mp4_index_header_t, followed by the path of the media file,
+ *  - for each track, mp4_index_track_t and if the track is valid,
+ *    mp4_index_chunk_t for each chunk.
+ * The samples tables themselves are still read from the stbl boxes.
+ */
+#define MP4_INDEX_MAGIC   "VLCMP4IX"
+#define MP4_INDEX_VERSION 3
+#define MP4_INDEX_ENDIAN  0x01020304
+
+typedef struct
+{
+    char     magic[8];
+    uint32_t i_version;
+    uint32_t i_endianness;
+    uint64_t i_file_size;
+    int64_t  i_file_mtime; /* in nanoseconds */
+    uint32_t i_tracks;
+    uint32_t i_path; /* length of the path, not padded */
+} mp4_index_header_t;
+
+typedef struct
+{
+    uint32_t i_track_ID;
+    uint32_t b_valid;
+    uint32_t i_chunk_count;
+    uint32_t i_sample_count;
+    uint32_t i_sample_size;
+    uint32_t i_entries_dts; /* stts entries */
+    uint32_t i_entries_pts; /* ctts entries */
+    uint32_t i_reserved;
+    int64_t  i_cts_shift;
+} mp4_index_track_t;
+
+typedef struct
+{
+    uint64_t i_offset;
+    uint64_t i_first_dts;
+    uint64_t i_duration;
+    uint32_t i_sample_description_index;
+    uint32_t i_sample_count;
+    uint32_t i_sample_first;
+    uint32_t i_dts_index;
+    uint32_t i_dts_skip;
+    uint32_t i_pts_index;
+    uint32_t i_pts_skip;
+    uint32_t i_reserved;
+} mp4_index_chunk_t;
+
+struct mp4_index_cache_t
+{
+    block_t *p_block; /* mapped cache file */
+    unsigned i_tracks;
+    const mp4_index_track_t **pp_tracks;
+};
+
+#define ALIGN8(x) (((x) + 7) & ~(size_t)7)
+
+static char *GetCachePath( demux_t *p_demux, bool b_create )
+{
+    char *psz_dir = config_GetUserDir( VLC_CACHE_DIR );
+    if( psz_dir == NULL )
+        return NULL;
+
+    /* FNV-1a hash of the media path */
+    uint64_t i_hash = UINT64_C(0xcbf29ce484222325);
+    for( const char *p = p_demux->psz_file; *p; p++ )
+        i_hash = ( i_hash ^ (uint8_t)*p ) * UINT64_C(0x100000001b3);
+
+    char *psz_path;
+    if( b_create )
+    {
+        if( vlc_mkdir( psz_dir, 0700 ) && errno != EEXIST )
+        {
+            free( psz_dir );
+            return NULL;
+        }
+        if( asprintf( &psz_path, "%s"DIR_SEP"mp4index", psz_dir ) == -1 )
+        {
+            free( psz_dir );
+            return NULL;
+        }
+        if( vlc_mkdir( psz_path, 0700 ) && errno != EEXIST )
+        {
+            free( psz_path );
+            free( psz_dir );
+            return NULL;
+        }
+        free( psz_path );
+    }
+
+    if( asprintf( &psz_path, "%s"DIR_SEP"mp4index"DIR_SEP"%016"PRIx64".idx",
+                  psz_dir, i_hash ) == -1 )
+        psz_path = NULL;
+    free( psz_dir );
+    return psz_path;
+}
+
+static bool GetFileIdentity( demux_t *p_demux, uint64_t *pi_size,
+                             int64_t *pi_mtime )
+{
+    struct stat st;
+
+    if( p_demux->psz_file == NULL || !var_InheritBool( p_demux, "mp4-index-cache" ) ||
+        vlc_stat( p_demux->psz_file, &st ) || !S_ISREG( st.st_mode ) )
+        return false;
+    *pi_size = st.st_size;
+    /* A file rewritten within the same second keeps its st_mtime */
+#if defined(HAVE_STRUCT_STAT_ST_MTIM)
+    *pi_mtime = st.st_mtim.tv_sec * INT64_C(1000000000) + st.st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    *pi_mtime = st.st_mtimespec.tv_sec * INT64_C(1000000000)
+              + st.st_mtimespec.tv_nsec;
+#else
+    *pi_mtime = st.st_mtime * INT64_C(1000000000);
+#endif
+    return true;
+}
+
+/* Returns the next i_size bytes of the cache, or NULL if truncated */
+static const void *Take( const block_t *p_block, size_t *pi_pos, size_t i_size )
+{
+    const size_t i_pos = *pi_pos;
+
+    if( i_size > p_block->i_buffer - i_pos )
+        return NULL;
+    *pi_pos = ALIGN8( i_pos + i_size );
+    if( *pi_pos > p_block->i_buffer )
+        *pi_pos = p_block->i_buffer;
+    return &p_block->p_buffer[i_pos];
+}
+
+static bool SkipTrack( const block_t *p_block, size_t *pi_pos,
+                       const mp4_index_track_t *p_track )
+{
+    return !p_track->b_valid ||
+           Take( p_block, pi_pos, (size_t)p_track->i_chunk_count *
+                                  sizeof(mp4_index_chunk_t) ) != NULL;
+}
+
+/* Checks a cached track against the stbl boxes of the same trak, so that
+ * the chunks never point outside of the tables they will index */
+static bool CheckTrack( const mp4_index_track_t *p_hdr, const MP4_Box_t *p_trak )
+{
+    if( !p_hdr->b_valid )
+        return true;
+
+    const MP4_Box_t *p_tkhd = MP4_BoxGet( p_trak, "tkhd" );
+    if( p_tkhd == NULL || BOXDATA(p_tkhd) == NULL ||
+        BOXDATA(p_tkhd)->i_track_ID != p_hdr->i_track_ID )
+        return false;
+
+    const MP4_Box_t *p_stbl = MP4_BoxGet( p_trak, "mdia/minf/stbl" );
+    if( p_stbl == NULL )
+        return false;
+    const MP4_Box_t *p_co64 = MP4_BoxGet( p_stbl, "stco" );
+    if( p_co64 == NULL )
+        p_co64 = MP4_BoxGet( p_stbl, "co64" );
+    const MP4_Box_t *p_stts = MP4_BoxGet( p_stbl, "stts" );
+    const MP4_Box_t *p_ctts = MP4_BoxGet( p_stbl, "ctts" );
+    const MP4_Box_t *p_stsz = MP4_BoxGet( p_stbl, "stsz" );
+    if( p_co64 == NULL || BOXDATA(p_co64) == NULL ||
+        BOXDATA(p_co64)->i_entry_count != p_hdr->i_chunk_count ||
+        p_stts == NULL || BOXDATA(p_stts) == NULL ||
+        BOXDATA(p_stts)->i_entry_count != p_hdr->i_entries_dts ||
+        ( p_ctts && BOXDATA(p_ctts) ? BOXDATA(p_ctts)->i_entry_count : 0 )
+            != p_hdr->i_entries_pts ||
+        p_stsz == NULL || BOXDATA(p_stsz) == NULL ||
+        BOXDATA(p_stsz)->i_sample_size != p_hdr->i_sample_size )
+        return false;
+
+    const uint32_t *pi_dts_count = BOXDATA(p_stts)->pi_sample_count;
+    const uint32_t *pi_pts_count = p_hdr->i_entries_pts
+                                 ? BOXDATA(p_ctts)->pi_sample_count : NULL;
+    const mp4_index_chunk_t *p_ck = (const void *)&p_hdr[1];
+    uint64_t i_sample_total = 0;
+    uint64_t i_next_dts = 0;
+
+    for( uint32_t i = 0; i < p_hdr->i_chunk_count; i++ )
+    {
+        const mp4_index_chunk_t *ck = &p_ck[i];
+
+        /* The chunks follow each other in the file tables */
+        if( ck->i_offset != BOXDATA(p_co64)->i_chunk_offset[i] ||
+            ck->i_sample_first != i_sample_total ||
+            ck->i_first_dts != i_next_dts )
+            return false;
+
+        /* Each chunk starts within the stts and ctts runs, or right at
+         * their end, and never before the previous chunk */
+        if( ck->i_dts_index > p_hdr->i_entries_dts ||
+            ( ck->i_dts_index < p_hdr->i_entries_dts &&
+              ck->i_dts_skip > pi_dts_count[ck->i_dts_index] ) ||
+            ( i > 0 && ( ck->i_dts_index < ck[-1].i_dts_index ||
+                         ( ck->i_dts_index == ck[-1].i_dts_index &&
+                           ck->i_dts_skip < ck[-1].i_dts_skip ) ) ) )
+            return false;
+        if( pi_pts_count != NULL &&
+            ( ck->i_pts_index > p_hdr->i_entries_pts ||
+              ( ck->i_pts_index < p_hdr->i_entries_pts &&
+                ck->i_pts_skip > pi_pts_count[ck->i_pts_index] ) ||
+              ( i > 0 && ( ck->i_pts_index < ck[-1].i_pts_index ||
+                           ( ck->i_pts_index == ck[-1].i_pts_index &&
+                             ck->i_pts_skip < ck[-1].i_pts_skip ) ) ) ) )
+            return false;
+
+        i_sample_total += ck->i_sample_count;
+        i_next_dts += ck->i_duration;
+    }
+
+    /* Same samples count as TrackCreateSamplesIndex() would compute */
+    if( i_sample_total > UINT32_MAX ||
+        p_hdr->i_sample_count != __MIN( i_sample_total,
+                                        BOXDATA(p_stsz)->i_sample_count ) )
+        return false;
+    if( p_hdr->i_chunk_count > 0 && p_hdr->i_sample_size == 0 &&
+        (uint64_t)p_ck[p_hdr->i_chunk_count - 1].i_sample_count +
+        p_hdr->i_chunk_count - 1 > BOXDATA(p_stsz)->i_sample_count )
+        return false;
+    return true;
+}
+
+void MP4_IndexCache_Close( mp4_index_cache_t *p_cache )
+{
+    if( p_cache )
+    {
+        free( p_cache->pp_tracks );
+        block_Release( p_cache->p_block );
+        free( p_cache );
+    }
+}
+
+mp4_index_cache_t * MP4_IndexCache_Open( demux_t *p_demux,
+                                         const MP4_Box_t *p_moov )
+{
+    uint64_t i_size;
+    int64_t i_mtime;
+
+    if( !GetFileIdentity( p_demux, &i_size, &i_mtime ) )
+        return NULL;
+
+    char *psz_path = GetCachePath( p_demux, false );
+    if( psz_path == NULL )
+        return NULL;
+    block_t *p_block = block_FilePath( psz_path, false );
+    free( psz_path );
+    if( p_block == NULL )
+        return NULL;
+
+    size_t i_pos = 0;
+    const mp4_index_header_t *p_hdr = Take( p_block, &i_pos, sizeof(*p_hdr) );
+    const size_t i_path = strlen( p_demux->psz_file );
+    const char *psz_file;
+    if( p_hdr == NULL || memcmp( p_hdr->magic, MP4_INDEX_MAGIC, 8 ) ||
+        p_hdr->i_version != MP4_INDEX_VERSION ||
+        p_hdr->i_endianness != MP4_INDEX_ENDIAN ||
+        p_hdr->i_file_size != i_size || p_hdr->i_file_mtime != i_mtime ||
+        p_hdr->i_path != i_path ||
+        p_hdr->i_tracks != MP4_BoxCount( p_moov, "trak" ) ||
+        !(psz_file = Take( p_block, &i_pos, i_path )) ||
+        memcmp( psz_file, p_demux->psz_file, i_path ) )
+    {
+        block_Release( p_block );
+        return NULL;
+    }
+
+    mp4_index_cache_t *p_cache = malloc( sizeof(*p_cache) );
+    if( p_cache == NULL )
+    {
+        block_Release( p_block );
+        return NULL;
+    }
+    p_cache->p_block = p_block;
+    p_cache->i_tracks = p_hdr->i_tracks;
+    p_cache->pp_tracks = vlc_alloc( p_hdr->i_tracks, sizeof(*p_cache->pp_tracks) );
+    if( p_cache->pp_tracks == NULL && p_hdr->i_tracks )
+    {
+        MP4_IndexCache_Close( p_cache );
+        return NULL;
+    }
+
+    /* Locate all tracks, check that nothing is truncated and that they
+     * match the moov: any mismatch discards the whole cache, which is then
+     * rebuilt from the stbl boxes */
+    for( unsigned i = 0; i < p_cache->i_tracks; i++ )
+    {
+        const mp4_index_track_t *p_track = Take( p_block, &i_pos, sizeof(*p_track) );
+        if( p_track == NULL || !SkipTrack( p_block, &i_pos, p_track ) ||
+            !CheckTrack( p_track, MP4_BoxGet( p_moov, "trak[%u]", i ) ) )
+        {
+            msg_Warn( p_demux, "ignoring corrupted index cache" );
+            MP4_IndexCache_Close( p_cache );
+            return NULL;
+        }
+        p_cache->pp_tracks[i] = p_track;
+    }
+
+    msg_Dbg( p_demux, "using index cache of %zu bytes", p_block->i_buffer );
+    return p_cache;
+}
+
+int MP4_IndexCache_LoadTrack( mp4_index_cache_t *p_cache, unsigned i_track,
+                              mp4_track_t *p_track )
+{
+    if( i_track >= p_cache->i_tracks )
+        return VLC_EGENERIC;
+
+    const mp4_index_track_t *p_hdr = p_cache->pp_tracks[i_track];
+    if( !p_hdr->b_valid || p_hdr->i_track_ID != p_track->i_track_ID )
+        return VLC_EGENERIC;
+
+    /* The tables were checked against the stbl when opening the cache */
+    const MP4_Box_t *p_stts = MP4_BoxGet( p_track->p_stbl, "stts" );
+    const MP4_Box_t *p_ctts = MP4_BoxGet( p_track->p_stbl, "ctts" );
+    const MP4_Box_t *p_stsz = MP4_BoxGet( p_track->p_stbl, "stsz" );
+
+    mp4_chunk_t *p_chunks = calloc( p_hdr->i_chunk_count, sizeof(*p_chunks) );
+    if( p_chunks == NULL && p_hdr->i_chunk_count )
+        return VLC_ENOMEM;
+
+    const mp4_index_chunk_t *p_ck = (const void *)&p_hdr[1];
+    for( uint32_t i = 0; i < p_hdr->i_chunk_count; i++ )
+    {
+        mp4_chunk_t *ck = &p_chunks[i];
+
+        ck->i_offset = p_ck[i].i_offset;
+        ck->i_first_dts = p_ck[i].i_first_dts;
+        ck->i_duration = p_ck[i].i_duration;
+        ck->i_sample_description_index = p_ck[i].i_sample_description_index;
+        ck->i_sample_count = p_ck[i].i_sample_count;
+        ck->i_sample_first = p_ck[i].i_sample_first;
+        ck->i_dts_index = p_ck[i].i_dts_index;
+        ck->i_dts_skip = p_ck[i].i_dts_skip;
+        ck->i_pts_index = p_ck[i].i_pts_index;
+        ck->i_pts_skip = p_ck[i].i_pts_skip;
+    }
+
+    p_track->chunk = p_chunks;
+    p_track->i_chunk_count = p_hdr->i_chunk_count;
+    p_track->i_sample_count = p_hdr->i_sample_count;
+    p_track->i_sample_size = p_hdr->i_sample_size;
+    p_track->p_sample_size = p_hdr->i_sample_size ? NULL
+                           : BOXDATA(p_stsz)->i_entry_size;
+
+    p_track->dts.i_entries = p_hdr->i_entries_dts;
+    p_track->dts.p_count = BOXDATA(p_stts)->pi_sample_count;
+    p_track->dts.p_value = (const uint32_t *) BOXDATA(p_stts)->pi_sample_delta;
+    if( p_hdr->i_entries_pts )
+    {
+        p_track->pts.i_entries = p_hdr->i_entries_pts;
+        p_track->pts.p_count = BOXDATA(p_ctts)->pi_sample_count;
+        p_track->pts.p_value = (const uint32_t *) BOXDATA(p_ctts)->pi_sample_offset;
+    }
+    p_track->i_cts_shift = p_hdr->i_cts_shift;
+    p_track->b_index_cached = true;
+    return VLC_SUCCESS;
+}
+
+static bool Write( FILE *p_file, const void *p_data, size_t i_size )
+{
+    static const uint8_t pad[8];
+
+    return fwrite( p_data, 1, i_size, p_file ) == i_size &&
+           fwrite( pad, 1, ALIGN8( i_size ) - i_size, p_file ) == ALIGN8( i_size ) - i_size;
+}
+
+void MP4_IndexCache_Store( demux_t *p_demux,
+                           const mp4_track_t *p_tracks, unsigned i_tracks )
+{
+    uint64_t i_size;
+    int64_t i_mtime;
+
+    if( !GetFileIdentity( p_demux, &i_size, &i_mtime ) )
+        return;
+
+    char *psz_path = GetCachePath( p_demux, true );
+    if( psz_path == NULL )
+        return;
+
+    char *psz_temp;
+    if( asprintf( &psz_temp, "%s.tmp", psz_path ) == -1 )
+    {
+        free( psz_path );
+        return;
+    }
+
+    FILE *p_file = vlc_fopen( psz_temp, "wb" );
+    if( p_file == NULL )
+    {
+        msg_Warn( p_demux, "cannot create index cache %s: %s", psz_temp,
+                  vlc_strerror_c( errno ) );
+        free( psz_temp );
+        free( psz_path );
+        return;
+    }
+
+    mp4_index_header_t hdr = {
+        .magic = MP4_INDEX_MAGIC,
+        .i_version = MP4_INDEX_VERSION,
+        .i_endianness = MP4_INDEX_ENDIAN,
+        .i_file_size = i_size,
+        .i_file_mtime = i_mtime,
+        .i_tracks = i_tracks,
+        .i_path = strlen( p_demux->psz_file ),
+    };
+    bool b_ok = Write( p_file, &hdr, sizeof(hdr) ) &&
+                Write( p_file, p_demux->psz_file, hdr.i_path );
+
+    for( unsigned i = 0; b_ok && i < i_tracks; i++ )
+    {
+        const mp4_track_t *p_track = &p_tracks[i];
+        mp4_index_track_t tk = {
+            .i_track_ID = p_track->i_track_ID,
+            .b_valid = p_track->b_ok && p_track->chunk != NULL,
+            .i_chunk_count = p_track->i_chunk_count,
+            .i_sample_count = p_track->i_sample_count,
+            .i_sample_size = p_track->i_sample_size,
+            .i_entries_dts = p_track->dts.i_entries,
+            .i_entries_pts = p_track->pts.i_entries,
+            .i_cts_shift = p_track->i_cts_shift,
+        };
+        b_ok = Write( p_file, &tk, sizeof(tk) );
+        if( !tk.b_valid )
+            continue;
+
+        for( uint32_t j = 0; b_ok && j < p_track->i_chunk_count; j++ )
+        {
+            const mp4_chunk_t *ck = &p_track->chunk[j];
+            const mp4_index_chunk_t chunk = {
+                .i_offset = ck->i_offset,
+                .i_first_dts = ck->i_first_dts,
+                .i_duration = ck->i_duration,
+                .i_sample_description_index = ck->i_sample_description_index,
+                .i_sample_count = ck->i_sample_count,
+                .i_sample_first = ck->i_sample_first,
+                .i_dts_index = ck->i_dts_index,
+                .i_dts_skip = ck->i_dts_skip,
+                .i_pts_index = ck->i_pts_index,
+                .i_pts_skip = ck->i_pts_skip,
+            };
+            b_ok = Write( p_file, &chunk, sizeof(chunk) );
+        }
+    }
+
+    if( fclose( p_file ) )
+        b_ok = false;
+    if( !b_ok || vlc_rename( psz_temp, psz_path ) )
+    {
+        msg_Warn( p_demux, "cannot write index cache %s", psz_path );
+        vlc_unlink( psz_temp );
+    }
+    else
+        msg_Dbg( p_demux, "stored index cache %s", psz_path );
+
+    free( psz_temp );
+    free( psz_path );
+}
@@ -0,0 +1,42 @@
+/*****************************************************************************
+ * indexcache.h : MP4 samples index cache
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_MP4_INDEXCACHE_H_
+#define VLC_MP4_INDEXCACHE_H_
+
+#include "mp4.h"
+
+/* Chunks tables of local files, as built from the stbl boxes, are saved
+ * in the user cache directory and mapped back on the next opening of the
+ * same file (same path, size and modification time) */
+typedef struct mp4_index_cache_t mp4_index_cache_t;
+
+/* returns NULL if the file has no cache, or if any of its tracks does not
+ * match the tables of the moov */
+mp4_index_cache_t * MP4_IndexCache_Open( demux_t *p_demux,
+                                         const MP4_Box_t *p_moov );
+void MP4_IndexCache_Close( mp4_index_cache_t *p_cache );
+
+int MP4_IndexCache_LoadTrack( mp4_index_cache_t *p_cache, unsigned i_track,
+                              mp4_track_t *p_track );
+
+void MP4_IndexCache_Store( demux_t *p_demux,
+                           const mp4_track_t *p_tracks, unsigned i_tracks );
+
+#endif
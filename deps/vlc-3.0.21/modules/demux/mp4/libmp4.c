@@ -108,6 +108,177 @@ static char *mp4_getstringz( uint8_t **restrict in, uint64_t *restrict size )
         (p_str) = mp4_getstringz( &p_peek, &i_read ); \
     while(0)
 
+/*****************************************************************************
+ * Boxes arena
+ *****************************************************************************
+ * A tree of boxes, their payloads and their tables are carved out of
+ * large blocks, and released at once with the box holding the arena.
+ * The read buffers are stacked in a scratch area, as the readers nest.
+ * The arena, the scratch area and the first block are a single allocation.
+ *****************************************************************************/
+#define MP4_ARENA_ALIGN      16
+#define MP4_ARENA_ROUND(n)   (((n) + MP4_ARENA_ALIGN - 1) & ~(size_t)(MP4_ARENA_ALIGN - 1))
+#define MP4_ARENA_SCRATCH    (16 * 1024)
+#define MP4_ARENA_BLOCK_MIN  (16 * 1024)
+#define MP4_ARENA_BLOCK_MAX  (256 * 1024)
+
+typedef struct mp4_arena_block_t mp4_arena_block_t;
+struct mp4_arena_block_t
+{
+    mp4_arena_block_t *p_next;
+    uint8_t           *p_cur;
+    uint8_t           *p_end;
+};
+
+struct mp4_box_arena_t
+{
+    unsigned           i_refs;
+    mp4_arena_block_t *p_blocks; /* current block first */
+    size_t             i_block_size;
+    uint8_t           *p_scratch;
+    size_t             i_scratch_used;
+};
+
+#define MP4_ARENA_HEADER     MP4_ARENA_ROUND(sizeof(mp4_box_arena_t))
+#define MP4_ARENA_BLOCK_HEADER MP4_ARENA_ROUND(sizeof(mp4_arena_block_t))
+
+static void MP4_ArenaInitBlock( mp4_arena_block_t *p_block, size_t i_size )
+{
+    p_block->p_next = NULL;
+    p_block->p_cur = (uint8_t *)p_block + MP4_ARENA_BLOCK_HEADER;
+    p_block->p_end = p_block->p_cur + i_size;
+}
+
+static mp4_box_arena_t *MP4_ArenaNew( void )
+{
+    mp4_box_arena_t *p_arena = malloc( MP4_ARENA_HEADER + MP4_ARENA_SCRATCH +
+                                       MP4_ARENA_BLOCK_HEADER + MP4_ARENA_BLOCK_MIN );
+    if( unlikely(p_arena == NULL) )
+        return NULL;
+
+    p_arena->i_refs = 1;
+    p_arena->p_scratch = (uint8_t *)p_arena + MP4_ARENA_HEADER;
+    p_arena->i_scratch_used = 0;
+    p_arena->p_blocks = (mp4_arena_block_t *)&p_arena->p_scratch[MP4_ARENA_SCRATCH];
+    MP4_ArenaInitBlock( p_arena->p_blocks, MP4_ARENA_BLOCK_MIN );
+    p_arena->i_block_size = 2 * MP4_ARENA_BLOCK_MIN;
+    return p_arena;
+}
+
+static void MP4_ArenaRelease( mp4_box_arena_t *p_arena )
+{
+    if( --p_arena->i_refs > 0 )
+        return;
+
+    const void *p_first = &p_arena->p_scratch[MP4_ARENA_SCRATCH];
+    for( mp4_arena_block_t *p_block = p_arena->p_blocks; p_block != NULL; )
+    {
+        mp4_arena_block_t *p_next = p_block->p_next;
+        if( p_block != p_first )
+            free( p_block );
+        p_block = p_next;
+    }
+    free( p_arena );
+}
+
+static void *MP4_ArenaAlloc( mp4_box_arena_t *p_arena, size_t i_size )
+{
+    if( unlikely(i_size > SIZE_MAX - MP4_ARENA_BLOCK_HEADER - MP4_ARENA_ALIGN) )
+        return NULL;
+    i_size = i_size ? MP4_ARENA_ROUND( i_size ) : MP4_ARENA_ALIGN;
+
+    mp4_arena_block_t *p_block = p_arena->p_blocks;
+    if( (size_t)(p_block->p_end - p_block->p_cur) < i_size )
+    {
+        /* Large tables get their own block, behind the current one */
+        const bool b_large = i_size > p_arena->i_block_size / 4;
+        const size_t i_block = b_large ? i_size : p_arena->i_block_size;
+
+        mp4_arena_block_t *p_new = malloc( MP4_ARENA_BLOCK_HEADER + i_block );
+        if( unlikely(p_new == NULL) )
+            return NULL;
+        MP4_ArenaInitBlock( p_new, i_block );
+
+        if( b_large )
+        {
+            p_new->p_next = p_block->p_next;
+            p_block->p_next = p_new;
+        }
+        else
+        {
+            p_new->p_next = p_block;
+            p_arena->p_blocks = p_new;
+            if( p_arena->i_block_size < MP4_ARENA_BLOCK_MAX )
+                p_arena->i_block_size *= 2;
+        }
+        p_block = p_new;
+    }
+
+    p_block->p_cur += i_size;
+    return p_block->p_cur - i_size;
+}
+
+static void *mp4_box_alloc( MP4_Box_t *p_box, size_t i_count, size_t i_size )
+{
+    size_t i_total;
+    if( mul_overflow( i_count, i_size, &i_total ) )
+        return NULL;
+    return MP4_ArenaAlloc( p_box->p_arena, i_total );
+}
+
+static void *mp4_box_calloc( MP4_Box_t *p_box, size_t i_count, size_t i_size )
+{
+    size_t i_total;
+    if( mul_overflow( i_count, i_size, &i_total ) )
+        return NULL;
+
+    void *p = MP4_ArenaAlloc( p_box->p_arena, i_total );
+    if( likely(p != NULL) )
+        memset( p, 0, i_total );
+    return p;
+}
+
+/* Allocates a box sharing the arena of its father, or a new one */
+static MP4_Box_t *MP4_BoxAlloc( const MP4_Box_t *p_father )
+{
+    mp4_box_arena_t *p_arena;
+    if( p_father != NULL )
+        p_arena = p_father->p_arena;
+    else if( (p_arena = MP4_ArenaNew()) == NULL )
+        return NULL;
+
+    MP4_Box_t *p_box = MP4_ArenaAlloc( p_arena, sizeof(*p_box) );
+    if( unlikely(p_box == NULL) )
+    {
+        if( p_father == NULL )
+            MP4_ArenaRelease( p_arena );
+        return NULL;
+    }
+    memset( p_box, 0, sizeof(*p_box) );
+    p_box->p_arena = p_arena;
+    p_box->b_arena_owner = p_father == NULL;
+    return p_box;
+}
+
+static uint8_t *MP4_ArenaScratchGet( mp4_box_arena_t *p_arena, size_t i_size )
+{
+    const size_t i_used = p_arena->i_scratch_used;
+    if( i_size > MP4_ARENA_SCRATCH - i_used )
+        return malloc( i_size );
+
+    p_arena->i_scratch_used += MP4_ARENA_ROUND( i_size );
+    return &p_arena->p_scratch[i_used];
+}
+
+static void MP4_ArenaScratchPut( mp4_box_arena_t *p_arena, uint8_t *p_buf )
+{
+    const uintptr_t i_offset = (uintptr_t)p_buf - (uintptr_t)p_arena->p_scratch;
+    if( i_offset < MP4_ARENA_SCRATCH )
+        p_arena->i_scratch_used = i_offset;
+    else
+        free( p_buf );
+}
+
 static uint8_t *mp4_readbox_enter_common( stream_t *s, MP4_Box_t *box,
                                           size_t typesize,
                                           void (*release)( MP4_Box_t * ),
@@ -118,7 +289,7 @@ static uint8_t *mp4_readbox_enter_common( stream_t *s, MP4_Box_t *box,
     if( unlikely(readsize < headersize) || unlikely(readsize > SSIZE_MAX) )
         return NULL;
 
-    uint8_t *buf = malloc( readsize );
+    uint8_t *buf = MP4_ArenaScratchGet( box->p_arena, readsize );
     if( unlikely(buf == NULL) )
         return NULL;
 
@@ -129,15 +300,14 @@ static uint8_t *mp4_readbox_enter_common( stream_t *s, MP4_Box_t *box,
         goto error;
     }
 
-    box->data.p_payload = malloc( typesize );
+    box->data.p_payload = mp4_box_calloc( box, 1, typesize );
     if( unlikely(box->data.p_payload == NULL) )
         goto error;
 
-    memset( box->data.p_payload, 0, typesize );
     box->pf_free = release;
     return buf;
 error:
-    free( buf );
+    MP4_ArenaScratchPut( box->p_arena, buf );
     return NULL;
 }
 
@@ -184,7 +354,7 @@ static uint8_t *mp4_readbox_enter( stream_t *s, MP4_Box_t *box,
 #define MP4_READBOX_EXIT( i_code ) \
     do \
     { \
-        free( p_buff ); \
+        MP4_ArenaScratchPut( p_box->p_arena, p_buff ); \
         return( i_code ); \
     } while (0)
 
@@ -241,6 +411,12 @@ MP4_Box_t * MP4_BoxExtract( MP4_Box_t **pp_chain, uint32_t i_type )
         {
             *pp_chain = p_box->p_next;
             p_box->p_next = NULL;
+            /* the box now keeps its tree storage alive on its own */
+            if( !p_box->b_arena_owner )
+            {
+                p_box->b_arena_owner = true;
+                p_box->p_arena->i_refs++;
+            }
             return p_box;
         }
         pp_chain = &p_box->p_next;
@@ -376,9 +552,11 @@ static MP4_Box_t *MP4_ReadBoxRestricted( stream_t *p_stream, MP4_Box_t *p_father
     }
 
     /* Everything seems OK */
-    MP4_Box_t *p_box = (MP4_Box_t *) malloc( sizeof(MP4_Box_t) );
+    MP4_Box_t *p_box = MP4_BoxAlloc( p_father );
     if( !p_box )
         return NULL;
+    peekbox.p_arena = p_box->p_arena;
+    peekbox.b_arena_owner = p_box->b_arena_owner;
     *p_box = peekbox;
 
     const uint64_t i_next = p_box->i_pos + p_box->i_size;
@@ -633,14 +811,9 @@ static int MP4_ReadBox_ilst( stream_t *p_stream, MP4_Box_t *p_box )
     }
 }
 
-static void MP4_FreeBox_ftyp( MP4_Box_t *p_box )
-{
-    FREENULL( p_box->data.p_ftyp->i_compatible_brands );
-}
-
 static int MP4_ReadBox_ftyp( stream_t *p_stream, MP4_Box_t *p_box )
 {
-    MP4_READBOX_ENTER( MP4_Box_data_ftyp_t, MP4_FreeBox_ftyp );
+    MP4_READBOX_ENTER( MP4_Box_data_ftyp_t, NULL );
 
     MP4_GETFOURCC( p_box->data.p_ftyp->i_major_brand );
     MP4_GET4BYTES( p_box->data.p_ftyp->i_minor_version );
@@ -649,8 +822,8 @@ static int MP4_ReadBox_ftyp( stream_t *p_stream, MP4_Box_t *p_box )
     if( p_box->data.p_ftyp->i_compatible_brands_count > 0 )
     {
         uint32_t *tab = p_box->data.p_ftyp->i_compatible_brands =
-            vlc_alloc( p_box->data.p_ftyp->i_compatible_brands_count,
-                       sizeof(uint32_t) );
+            mp4_box_alloc( p_box, p_box->data.p_ftyp->i_compatible_brands_count,
+                           sizeof(uint32_t) );
 
         if( unlikely( tab == NULL ) )
             MP4_READBOX_EXIT( 0 );
@@ -785,22 +958,17 @@ static int MP4_ReadBox_tfxd(  stream_t *p_stream, MP4_Box_t *p_box )
     MP4_READBOX_EXIT( 1 );
 }
 
-static void MP4_FreeBox_tfrf( MP4_Box_t *p_box )
-{
-    FREENULL( p_box->data.p_tfrf->p_tfrf_data_fields );
-}
-
 static int MP4_ReadBox_tfrf(  stream_t *p_stream, MP4_Box_t *p_box )
 {
-    MP4_READBOX_ENTER( MP4_Box_data_tfxd_t, MP4_FreeBox_tfrf );
+    MP4_READBOX_ENTER( MP4_Box_data_tfxd_t, NULL );
 
     MP4_Box_data_tfrf_t *p_tfrf_data = p_box->data.p_tfrf;
     MP4_GETVERSIONFLAGS( p_tfrf_data );
 
     MP4_GET1BYTE( p_tfrf_data->i_fragment_count );
 
-    p_tfrf_data->p_tfrf_data_fields = calloc( p_tfrf_data->i_fragment_count,
-                                              sizeof( TfrfBoxDataFields_t ) );
+    p_tfrf_data->p_tfrf_data_fields = mp4_box_calloc( p_box, p_tfrf_data->i_fragment_count,
+                                                      sizeof( TfrfBoxDataFields_t ) );
     if( !p_tfrf_data->p_tfrf_data_fields )
         MP4_READBOX_EXIT( 0 );
 
@@ -963,14 +1131,9 @@ static int MP4_ReadBox_cbmp( stream_t *p_stream, MP4_Box_t *p_box )
     MP4_READBOX_EXIT( 1 );
 }
 
-static void MP4_FreeBox_sidx( MP4_Box_t *p_box )
-{
-    FREENULL( p_box->data.p_sidx->p_items );
-}
-
 static int MP4_ReadBox_sidx(  stream_t *p_stream, MP4_Box_t *p_box )
 {
-    MP4_READBOX_ENTER( MP4_Box_data_sidx_t, MP4_FreeBox_sidx );
+    MP4_READBOX_ENTER( MP4_Box_data_sidx_t, NULL );
 
     MP4_Box_data_sidx_t *p_sidx_data = p_box->data.p_sidx;
     MP4_GETVERSIONFLAGS( p_sidx_data );
@@ -998,7 +1161,7 @@ static int MP4_ReadBox_sidx(  stream_t *p_stream, MP4_Box_t *p_box )
         MP4_READBOX_EXIT( 1 );
 
     p_sidx_data->i_reference_count = i_count;
-    p_sidx_data->p_items = vlc_alloc( i_count, sizeof( MP4_Box_sidx_item_t ) );
+    p_sidx_data->p_items = mp4_box_alloc( p_box, i_count, sizeof( MP4_Box_sidx_item_t ) );
     if( unlikely(p_sidx_data->p_items == NULL) )
         MP4_READBOX_EXIT( 0 );
 
@@ -1096,16 +1259,11 @@ static int MP4_ReadBox_tfhd(  stream_t *p_stream, MP4_Box_t *p_box )
     MP4_READBOX_EXIT( 1 );
 }
 
-static void MP4_FreeBox_trun( MP4_Box_t *p_box )
-{
-    FREENULL( p_box->data.p_trun->p_samples );
-}
-
 static int MP4_ReadBox_trun(  stream_t *p_stream, MP4_Box_t *p_box )
 {
     uint32_t count;
 
-    MP4_READBOX_ENTER( MP4_Box_data_trun_t, MP4_FreeBox_trun );
+    MP4_READBOX_ENTER( MP4_Box_data_trun_t, NULL );
     MP4_Box_data_trun_t *p_trun = p_box->data.p_trun;
     MP4_GETVERSIONFLAGS( p_trun );
     MP4_GET4BYTES( count );
@@ -1124,7 +1282,7 @@ static int MP4_ReadBox_trun(  stream_t *p_stream, MP4_Box_t *p_box )
     if( i_entry_size * 4 * count > i_read )
         MP4_READBOX_EXIT( 0 );
 
-    p_trun->p_samples = vlc_alloc( count, sizeof(MP4_descriptor_trun_sample_t) );
+    p_trun->p_samples = mp4_box_alloc( p_box, count, sizeof(MP4_descriptor_trun_sample_t) );
     if ( p_trun->p_samples == NULL )
         MP4_READBOX_EXIT( 0 );
     p_trun->i_sample_count = count;
@@ -1567,17 +1725,11 @@ static int MP4_ReadBox_dref( stream_t *p_stream, MP4_Box_t *p_box )
     return MP4_ReadBox_LtdContainer( p_stream, p_box, versions, 1 );
 }
 
-static void MP4_FreeBox_stts( MP4_Box_t *p_box )
-{
-    FREENULL( p_box->data.p_stts->pi_sample_count );
-    FREENULL( p_box->data.p_stts->pi_sample_delta );
-}
-
 static int MP4_ReadBox_stts( stream_t *p_stream, MP4_Box_t *p_box )
 {
     uint32_t count;
 
-    MP4_READBOX_ENTER( MP4_Box_data_stts_t, MP4_FreeBox_stts );
+    MP4_READBOX_ENTER( MP4_Box_data_stts_t, NULL );
 
     MP4_GETVERSIONFLAGS( p_box->data.p_stts );
     MP4_GET4BYTES( count );
@@ -1588,8 +1740,8 @@ static int MP4_ReadBox_stts( stream_t *p_stream, MP4_Box_t *p_box )
         MP4_READBOX_EXIT( 0 );
     }
 
-    p_box->data.p_stts->pi_sample_count = vlc_alloc( count, sizeof(uint32_t) );
-    p_box->data.p_stts->pi_sample_delta = vlc_alloc( count, sizeof(int32_t) );
+    p_box->data.p_stts->pi_sample_count = mp4_box_alloc( p_box, count, sizeof(uint32_t) );
+    p_box->data.p_stts->pi_sample_delta = mp4_box_alloc( p_box, count, sizeof(int32_t) );
     p_box->data.p_stts->i_entry_count = count;
 
     if( p_box->data.p_stts->pi_sample_count == NULL
@@ -1613,17 +1765,11 @@ static int MP4_ReadBox_stts( stream_t *p_stream, MP4_Box_t *p_box )
 }
 
 
-static void MP4_FreeBox_ctts( MP4_Box_t *p_box )
-{
-    FREENULL( p_box->data.p_ctts->pi_sample_count );
-    FREENULL( p_box->data.p_ctts->pi_sample_offset );
-}
-
 static int MP4_ReadBox_ctts( stream_t *p_stream, MP4_Box_t *p_box )
 {
     uint32_t count;
 
-    MP4_READBOX_ENTER( MP4_Box_data_ctts_t, MP4_FreeBox_ctts );
+    MP4_READBOX_ENTER( MP4_Box_data_ctts_t, NULL );
 
     MP4_GETVERSIONFLAGS( p_box->data.p_ctts );
     MP4_GET4BYTES( count );
@@ -1631,8 +1777,8 @@ static int MP4_ReadBox_ctts( stream_t *p_stream, MP4_Box_t *p_box )
     if( UINT64_C(8) * count > i_read )
         MP4_READBOX_EXIT( 0 );
 
-    p_box->data.p_ctts->pi_sample_count = vlc_alloc( count, sizeof(uint32_t) );
-    p_box->data.p_ctts->pi_sample_offset = vlc_alloc( count, sizeof(int32_t) );
+    p_box->data.p_ctts->pi_sample_count = mp4_box_alloc( p_box, count, sizeof(uint32_t) );
+    p_box->data.p_ctts->pi_sample_offset = mp4_box_alloc( p_box, count, sizeof(int32_t) );
     if( unlikely(p_box->data.p_ctts->pi_sample_count == NULL
               || p_box->data.p_ctts->pi_sample_offset == NULL) )
         MP4_READBOX_EXIT( 0 );
@@ -2208,16 +2354,9 @@ static int MP4_ReadBox_ASF( stream_t *p_stream, MP4_Box_t *p_box )
     MP4_READBOX_EXIT( 1 );
 }
 
-static void MP4_FreeBox_sbgp( MP4_Box_t *p_box )
-{
-    MP4_Box_data_sbgp_t *p_sbgp = p_box->data.p_sbgp;
-    free( p_sbgp->entries.pi_sample_count );
-    free( p_sbgp->entries.pi_group_description_index );
-}
-
 static int MP4_ReadBox_sbgp( stream_t *p_stream, MP4_Box_t *p_box )
 {
-    MP4_READBOX_ENTER( MP4_Box_data_sbgp_t, MP4_FreeBox_sbgp );
+    MP4_READBOX_ENTER( MP4_Box_data_sbgp_t, NULL );
     MP4_Box_data_sbgp_t *p_sbgp = p_box->data.p_sbgp;
     uint32_t i_flags;
 
@@ -2242,14 +2381,11 @@ static int MP4_ReadBox_sbgp( stream_t *p_stream, MP4_Box_t *p_box )
     if( p_sbgp->i_entry_count > i_read / (4 + 4) )
         p_sbgp->i_entry_count = i_read / (4 + 4);
 
-    p_sbgp->entries.pi_sample_count = vlc_alloc( p_sbgp->i_entry_count, sizeof(uint32_t) );
-    p_sbgp->entries.pi_group_description_index = vlc_alloc( p_sbgp->i_entry_count, sizeof(uint32_t) );
+    p_sbgp->entries.pi_sample_count = mp4_box_alloc( p_box, p_sbgp->i_entry_count, sizeof(uint32_t) );
+    p_sbgp->entries.pi_group_description_index = mp4_box_alloc( p_box, p_sbgp->i_entry_count, sizeof(uint32_t) );
 
     if( !p_sbgp->entries.pi_sample_count || !p_sbgp->entries.pi_group_description_index )
-    {
-        MP4_FreeBox_sbgp( p_box );
         MP4_READBOX_EXIT( 0 );
-    }
 
     for( uint32_t i=0; i<p_sbgp->i_entry_count; i++ )
     {
@@ -2271,15 +2407,9 @@ static int MP4_ReadBox_sbgp( stream_t *p_stream, MP4_Box_t *p_box )
     MP4_READBOX_EXIT( 1 );
 }
 
-static void MP4_FreeBox_sgpd( MP4_Box_t *p_box )
-{
-    MP4_Box_data_sgpd_t *p_sgpd = p_box->data.p_sgpd;
-    free( p_sgpd->p_entries );
-}
-
 static int MP4_ReadBox_sgpd( stream_t *p_stream, MP4_Box_t *p_box )
 {
-    MP4_READBOX_ENTER( MP4_Box_data_sgpd_t, MP4_FreeBox_sgpd );
+    MP4_READBOX_ENTER( MP4_Box_data_sgpd_t, NULL );
     MP4_Box_data_sgpd_t *p_sgpd = p_box->data.p_sgpd;
     uint32_t i_flags;
     uint32_t i_default_length = 0;
@@ -2322,7 +2452,7 @@ static int MP4_ReadBox_sgpd( stream_t *p_stream, MP4_Box_t *p_box )
 
     MP4_GET4BYTES( p_sgpd->i_entry_count );
 
-    p_sgpd->p_entries = vlc_alloc( p_sgpd->i_entry_count, sizeof(*p_sgpd->p_entries) );
+    p_sgpd->p_entries = mp4_box_alloc( p_box, p_sgpd->i_entry_count, sizeof(*p_sgpd->p_entries) );
     if( !p_sgpd->p_entries )
         MP4_READBOX_EXIT( 0 );
 
@@ -2346,7 +2476,6 @@ static int MP4_ReadBox_sgpd( stream_t *p_stream, MP4_Box_t *p_box )
                 {
                     if( i_read < 1 )
                     {
-                        free( p_sgpd->p_entries );
                         p_sgpd->i_entry_count = 0;
                         p_sgpd->p_entries = NULL;
                         MP4_READBOX_EXIT( 0 );
@@ -3012,16 +3141,11 @@ static void MP4_FreeBox_sample_text( MP4_Box_t *p_box )
 }
 #endif
 
-static void MP4_FreeBox_stsz( MP4_Box_t *p_box )
-{
-    FREENULL( p_box->data.p_stsz->i_entry_size );
-}
-
 static int MP4_ReadBox_stsz( stream_t *p_stream, MP4_Box_t *p_box )
 {
     uint32_t count;
 
-    MP4_READBOX_ENTER( MP4_Box_data_stsz_t, MP4_FreeBox_stsz );
+    MP4_READBOX_ENTER( MP4_Box_data_stsz_t, NULL );
 
     MP4_GETVERSIONFLAGS( p_box->data.p_stsz );
 
@@ -3035,7 +3159,7 @@ static int MP4_ReadBox_stsz( stream_t *p_stream, MP4_Box_t *p_box )
             MP4_READBOX_EXIT( 0 );
 
         p_box->data.p_stsz->i_entry_size =
-            vlc_alloc( count, sizeof(uint32_t) );
+            mp4_box_alloc( p_box, count, sizeof(uint32_t) );
         if( unlikely( !p_box->data.p_stsz->i_entry_size ) )
             MP4_READBOX_EXIT( 0 );
 
@@ -3056,18 +3180,11 @@ static int MP4_ReadBox_stsz( stream_t *p_stream, MP4_Box_t *p_box )
     MP4_READBOX_EXIT( 1 );
 }
 
-static void MP4_FreeBox_stsc( MP4_Box_t *p_box )
-{
-    FREENULL( p_box->data.p_stsc->i_first_chunk );
-    FREENULL( p_box->data.p_stsc->i_samples_per_chunk );
-    FREENULL( p_box->data.p_stsc->i_sample_description_index );
-}
-
 static int MP4_ReadBox_stsc( stream_t *p_stream, MP4_Box_t *p_box )
 {
     uint32_t count;
 
-    MP4_READBOX_ENTER( MP4_Box_data_stsc_t, MP4_FreeBox_stsc );
+    MP4_READBOX_ENTER( MP4_Box_data_stsc_t, NULL );
 
     MP4_GETVERSIONFLAGS( p_box->data.p_stsc );
     MP4_GET4BYTES( count );
@@ -3075,11 +3192,11 @@ static int MP4_ReadBox_stsc( stream_t *p_stream, MP4_Box_t *p_box )
     if( UINT64_C(12) * count > i_read )
         MP4_READBOX_EXIT( 0 );
 
-    p_box->data.p_stsc->i_first_chunk = vlc_alloc( count, sizeof(uint32_t) );
-    p_box->data.p_stsc->i_samples_per_chunk = vlc_alloc( count,
-                                                         sizeof(uint32_t) );
-    p_box->data.p_stsc->i_sample_description_index = vlc_alloc( count,
-                                                            sizeof(uint32_t) );
+    p_box->data.p_stsc->i_first_chunk = mp4_box_alloc( p_box, count, sizeof(uint32_t) );
+    p_box->data.p_stsc->i_samples_per_chunk = mp4_box_alloc( p_box, count,
+                                                             sizeof(uint32_t) );
+    p_box->data.p_stsc->i_sample_description_index = mp4_box_alloc( p_box, count,
+                                                                    sizeof(uint32_t) );
     if( unlikely( p_box->data.p_stsc->i_first_chunk == NULL
      || p_box->data.p_stsc->i_samples_per_chunk == NULL
      || p_box->data.p_stsc->i_sample_description_index == NULL ) )
@@ -3160,17 +3277,12 @@ static int MP4_ReadBox_tssy( stream_t *p_stream, MP4_Box_t *p_box )
     MP4_READBOX_EXIT( 1 );
 }
 
-static void MP4_FreeBox_stco_co64( MP4_Box_t *p_box )
-{
-    FREENULL( p_box->data.p_co64->i_chunk_offset );
-}
-
 static int MP4_ReadBox_stco_co64( stream_t *p_stream, MP4_Box_t *p_box )
 {
     const bool sixtyfour = p_box->i_type != ATOM_stco;
     uint32_t count;
 
-    MP4_READBOX_ENTER( MP4_Box_data_co64_t, MP4_FreeBox_stco_co64 );
+    MP4_READBOX_ENTER( MP4_Box_data_co64_t, NULL );
 
     MP4_GETVERSIONFLAGS( p_box->data.p_co64 );
     MP4_GET4BYTES( count );
@@ -3178,7 +3290,7 @@ static int MP4_ReadBox_stco_co64( stream_t *p_stream, MP4_Box_t *p_box )
     if( (sixtyfour ? UINT64_C(8) : UINT64_C(4)) * count > i_read )
         MP4_READBOX_EXIT( 0 );
 
-    p_box->data.p_co64->i_chunk_offset = vlc_alloc( count, sizeof(uint64_t) );
+    p_box->data.p_co64->i_chunk_offset = mp4_box_alloc( p_box, count, sizeof(uint64_t) );
     if( unlikely(p_box->data.p_co64->i_chunk_offset == NULL) )
         MP4_READBOX_EXIT( 0 );
     p_box->data.p_co64->i_entry_count = count;
@@ -3199,16 +3311,11 @@ static int MP4_ReadBox_stco_co64( stream_t *p_stream, MP4_Box_t *p_box )
     MP4_READBOX_EXIT( 1 );
 }
 
-static void MP4_FreeBox_stss( MP4_Box_t *p_box )
-{
-    FREENULL( p_box->data.p_stss->i_sample_number );
-}
-
 static int MP4_ReadBox_stss( stream_t *p_stream, MP4_Box_t *p_box )
 {
     uint32_t count;
 
-    MP4_READBOX_ENTER( MP4_Box_data_stss_t, MP4_FreeBox_stss );
+    MP4_READBOX_ENTER( MP4_Box_data_stss_t, NULL );
 
     MP4_GETVERSIONFLAGS( p_box->data.p_stss );
     MP4_GET4BYTES( count );
@@ -3216,7 +3323,7 @@ static int MP4_ReadBox_stss( stream_t *p_stream, MP4_Box_t *p_box )
     if( UINT64_C(4) * count > i_read )
         MP4_READBOX_EXIT( 0 );
 
-    p_box->data.p_stss->i_sample_number = vlc_alloc( count, sizeof(uint32_t) );
+    p_box->data.p_stss->i_sample_number = mp4_box_alloc( p_box, count, sizeof(uint32_t) );
     if( unlikely( p_box->data.p_stss->i_sample_number == NULL ) )
         MP4_READBOX_EXIT( 0 );
     p_box->data.p_stss->i_entry_count = count;
@@ -3236,17 +3343,11 @@ static int MP4_ReadBox_stss( stream_t *p_stream, MP4_Box_t *p_box )
     MP4_READBOX_EXIT( 1 );
 }
 
-static void MP4_FreeBox_stsh( MP4_Box_t *p_box )
-{
-    FREENULL( p_box->data.p_stsh->i_shadowed_sample_number );
-    FREENULL( p_box->data.p_stsh->i_sync_sample_number );
-}
-
 static int MP4_ReadBox_stsh( stream_t *p_stream, MP4_Box_t *p_box )
 {
     uint32_t count;
 
-    MP4_READBOX_ENTER( MP4_Box_data_stsh_t, MP4_FreeBox_stsh );
+    MP4_READBOX_ENTER( MP4_Box_data_stsh_t, NULL );
 
     MP4_GETVERSIONFLAGS( p_box->data.p_stsh );
     MP4_GET4BYTES( count );
@@ -3254,10 +3355,10 @@ static int MP4_ReadBox_stsh( stream_t *p_stream, MP4_Box_t *p_box )
     if( UINT64_C(8) * count > i_read )
         MP4_READBOX_EXIT( 0 );
 
-    p_box->data.p_stsh->i_shadowed_sample_number = vlc_alloc( count,
-                                                            sizeof(uint32_t) );
-    p_box->data.p_stsh->i_sync_sample_number = vlc_alloc( count,
-                                                          sizeof(uint32_t) );
+    p_box->data.p_stsh->i_shadowed_sample_number = mp4_box_alloc( p_box, count,
+                                                                  sizeof(uint32_t) );
+    p_box->data.p_stsh->i_sync_sample_number = mp4_box_alloc( p_box, count,
+                                                              sizeof(uint32_t) );
     if( p_box->data.p_stsh->i_shadowed_sample_number == NULL
      || p_box->data.p_stsh->i_sync_sample_number == NULL )
         MP4_READBOX_EXIT( 0 );
@@ -3276,19 +3377,14 @@ static int MP4_ReadBox_stsh( stream_t *p_stream, MP4_Box_t *p_box )
     MP4_READBOX_EXIT( 1 );
 }
 
-static void MP4_FreeBox_stdp( MP4_Box_t *p_box )
-{
-    FREENULL( p_box->data.p_stdp->i_priority );
-}
-
 static int MP4_ReadBox_stdp( stream_t *p_stream, MP4_Box_t *p_box )
 {
-    MP4_READBOX_ENTER( MP4_Box_data_stdp_t, MP4_FreeBox_stdp );
+    MP4_READBOX_ENTER( MP4_Box_data_stdp_t, NULL );
 
     MP4_GETVERSIONFLAGS( p_box->data.p_stdp );
 
     p_box->data.p_stdp->i_priority =
-        calloc( i_read / 2, sizeof(uint16_t) );
+        mp4_box_calloc( p_box, i_read / 2, sizeof(uint16_t) );
 
     if( unlikely( !p_box->data.p_stdp->i_priority ) )
         MP4_READBOX_EXIT( 0 );
@@ -3306,19 +3402,11 @@ static int MP4_ReadBox_stdp( stream_t *p_stream, MP4_Box_t *p_box )
     MP4_READBOX_EXIT( 1 );
 }
 
-static void MP4_FreeBox_elst( MP4_Box_t *p_box )
-{
-    FREENULL( p_box->data.p_elst->i_segment_duration );
-    FREENULL( p_box->data.p_elst->i_media_time );
-    FREENULL( p_box->data.p_elst->i_media_rate_integer );
-    FREENULL( p_box->data.p_elst->i_media_rate_fraction );
-}
-
 static int MP4_ReadBox_elst( stream_t *p_stream, MP4_Box_t *p_box )
 {
     uint32_t count;
 
-    MP4_READBOX_ENTER( MP4_Box_data_elst_t, MP4_FreeBox_elst );
+    MP4_READBOX_ENTER( MP4_Box_data_elst_t, NULL );
 
     MP4_GETVERSIONFLAGS( p_box->data.p_elst );
     MP4_GET4BYTES( count );
@@ -3330,13 +3418,13 @@ static int MP4_ReadBox_elst( stream_t *p_stream, MP4_Box_t *p_box )
     if( count > i_entries_max )
         count = i_entries_max;
 
-    p_box->data.p_elst->i_segment_duration = vlc_alloc( count,
-                                                        sizeof(uint64_t) );
-    p_box->data.p_elst->i_media_time = vlc_alloc( count, sizeof(int64_t) );
-    p_box->data.p_elst->i_media_rate_integer = vlc_alloc( count,
-                                                          sizeof(uint16_t) );
-    p_box->data.p_elst->i_media_rate_fraction = vlc_alloc( count,
-                                                           sizeof(uint16_t) );
+    p_box->data.p_elst->i_segment_duration = mp4_box_alloc( p_box, count,
+                                                            sizeof(uint64_t) );
+    p_box->data.p_elst->i_media_time = mp4_box_alloc( p_box, count, sizeof(int64_t) );
+    p_box->data.p_elst->i_media_rate_integer = mp4_box_alloc( p_box, count,
+                                                              sizeof(uint16_t) );
+    p_box->data.p_elst->i_media_rate_fraction = mp4_box_alloc( p_box, count,
+                                                               sizeof(uint16_t) );
     if( p_box->data.p_elst->i_segment_duration == NULL
      || p_box->data.p_elst->i_media_time == NULL
      || p_box->data.p_elst->i_media_rate_integer == NULL
@@ -3451,6 +3539,12 @@ static int MP4_ReadBox_cmvd( stream_t *p_stream, MP4_Box_t *p_box )
     MP4_READBOX_EXIT( 1 );
 }
 
+static void MP4_FreeBox_cmov( MP4_Box_t *p_box )
+{
+    /* the uncompressed moov has its own arena */
+    MP4_BoxFree( p_box->data.p_cmov->p_moov );
+}
+
 static int MP4_ReadBox_cmov( stream_t *p_stream, MP4_Box_t *p_box )
 {
     MP4_Box_t *p_dcom;
@@ -3463,8 +3557,9 @@ static int MP4_ReadBox_cmov( stream_t *p_stream, MP4_Box_t *p_box )
     int i_result;
 #endif
 
-    if( !( p_box->data.p_cmov = calloc(1, sizeof( MP4_Box_data_cmov_t ) ) ) )
+    if( !( p_box->data.p_cmov = mp4_box_calloc( p_box, 1, sizeof( MP4_Box_data_cmov_t ) ) ) )
         return 0;
+    p_box->pf_free = MP4_FreeBox_cmov;
 
     if( !p_box->p_father ||
         ( p_box->p_father->i_type != ATOM_moov &&
@@ -3863,17 +3958,12 @@ static int MP4_ReadBox_chpl( stream_t *p_stream, MP4_Box_t *p_box )
 }
 
 /* GoPro HiLight tags support */
-static void MP4_FreeBox_HMMT( MP4_Box_t *p_box )
-{
-    FREENULL( p_box->data.p_hmmt->pi_chapter_start );
-}
-
 static int MP4_ReadBox_HMMT( stream_t *p_stream, MP4_Box_t *p_box )
 {
 #define MAX_CHAPTER_COUNT 100
 
     MP4_Box_data_HMMT_t *p_hmmt;
-    MP4_READBOX_ENTER( MP4_Box_data_HMMT_t, MP4_FreeBox_HMMT );
+    MP4_READBOX_ENTER( MP4_Box_data_HMMT_t, NULL );
 
     if( i_read < 4 )
         MP4_READBOX_EXIT( 0 );
@@ -3895,7 +3985,7 @@ static int MP4_ReadBox_HMMT( stream_t *p_stream, MP4_Box_t *p_box )
     if( p_hmmt->i_chapter_count > MAX_CHAPTER_COUNT )
         p_hmmt->i_chapter_count = MAX_CHAPTER_COUNT;
 
-    p_hmmt->pi_chapter_start = vlc_alloc( p_hmmt->i_chapter_count, sizeof(uint32_t) );
+    p_hmmt->pi_chapter_start = mp4_box_alloc( p_box, p_hmmt->i_chapter_count, sizeof(uint32_t) );
     if( p_hmmt->pi_chapter_start == NULL )
         MP4_READBOX_EXIT( 0 );
 
@@ -3911,22 +4001,17 @@ static int MP4_ReadBox_HMMT( stream_t *p_stream, MP4_Box_t *p_box )
     MP4_READBOX_EXIT( 1 );
 }
 
-static void MP4_FreeBox_tref_generic( MP4_Box_t *p_box )
-{
-    FREENULL( p_box->data.p_tref_generic->i_track_ID );
-}
-
 static int MP4_ReadBox_tref_generic( stream_t *p_stream, MP4_Box_t *p_box )
 {
     uint32_t count;
 
-    MP4_READBOX_ENTER( MP4_Box_data_tref_generic_t, MP4_FreeBox_tref_generic );
+    MP4_READBOX_ENTER( MP4_Box_data_tref_generic_t, NULL );
 
     p_box->data.p_tref_generic->i_track_ID = NULL;
     count = i_read / sizeof(uint32_t);
     p_box->data.p_tref_generic->i_entry_count = count;
-    p_box->data.p_tref_generic->i_track_ID = vlc_alloc( count,
-                                                        sizeof(uint32_t) );
+    p_box->data.p_tref_generic->i_track_ID = mp4_box_alloc( p_box, count,
+                                                            sizeof(uint32_t) );
     if( p_box->data.p_tref_generic->i_track_ID == NULL )
         MP4_READBOX_EXIT( 0 );
 
@@ -4173,20 +4258,15 @@ static int MP4_ReadBox_trex( stream_t *p_stream, MP4_Box_t *p_box )
     MP4_READBOX_EXIT( 1 );
 }
 
-static void MP4_FreeBox_sdtp( MP4_Box_t *p_box )
-{
-    FREENULL( p_box->data.p_sdtp->p_sample_table );
-}
-
 static int MP4_ReadBox_sdtp( stream_t *p_stream, MP4_Box_t *p_box )
 {
     uint32_t i_sample_count;
-    MP4_READBOX_ENTER( MP4_Box_data_sdtp_t, MP4_FreeBox_sdtp );
+    MP4_READBOX_ENTER( MP4_Box_data_sdtp_t, NULL );
     MP4_Box_data_sdtp_t *p_sdtp = p_box->data.p_sdtp;
     MP4_GETVERSIONFLAGS( p_box->data.p_sdtp );
     i_sample_count = i_read;
 
-    p_sdtp->p_sample_table = malloc( i_sample_count );
+    p_sdtp->p_sample_table = mp4_box_alloc( p_box, 1, i_sample_count );
     if( unlikely(p_sdtp->p_sample_table == NULL) )
         MP4_READBOX_EXIT( 0 );
 
@@ -4235,15 +4315,6 @@ static int MP4_ReadBox_mfro( stream_t *p_stream, MP4_Box_t *p_box )
     MP4_READBOX_EXIT( 1 );
 }
 
-static void MP4_FreeBox_tfra( MP4_Box_t *p_box )
-{
-    FREENULL( p_box->data.p_tfra->p_time );
-    FREENULL( p_box->data.p_tfra->p_moof_offset );
-    FREENULL( p_box->data.p_tfra->p_traf_number );
-    FREENULL( p_box->data.p_tfra->p_trun_number );
-    FREENULL( p_box->data.p_tfra->p_sample_number );
-}
-
 static int MP4_ReadBox_tfra( stream_t *p_stream, MP4_Box_t *p_box )
 {
 #define READ_VARIABLE_LENGTH(lengthvar, p_array) switch (lengthvar)\
@@ -4266,7 +4337,7 @@ static int MP4_ReadBox_tfra( stream_t *p_stream, MP4_Box_t *p_box )
 #define FIX_VARIABLE_LENGTH(lengthvar) if ( lengthvar == 3 ) lengthvar = 4
 
     uint32_t i_number_of_entries;
-    MP4_READBOX_ENTER( MP4_Box_data_tfra_t, MP4_FreeBox_tfra );
+    MP4_READBOX_ENTER( MP4_Box_data_tfra_t, NULL );
     MP4_Box_data_tfra_t *p_tfra = p_box->data.p_tfra;
     MP4_GETVERSIONFLAGS( p_box->data.p_tfra );
     if ( p_tfra->i_version > 1 )
@@ -4281,18 +4352,18 @@ static int MP4_ReadBox_tfra( stream_t *p_stream, MP4_Box_t *p_box )
     p_tfra->i_length_size_of_sample_num = i_lengths & 0x03;
 
     size_t size = 4 + 4*p_tfra->i_version; /* size in {4, 8} */
-    p_tfra->p_time = calloc( i_number_of_entries, size );
-    p_tfra->p_moof_offset = calloc( i_number_of_entries, size );
+    p_tfra->p_time = mp4_box_calloc( p_box, i_number_of_entries, size );
+    p_tfra->p_moof_offset = mp4_box_calloc( p_box, i_number_of_entries, size );
 
     size = 1 + p_tfra->i_length_size_of_traf_num; /* size in [|1, 4|] */
     if ( size == 3 ) size++;
-    p_tfra->p_traf_number = calloc( i_number_of_entries, size );
+    p_tfra->p_traf_number = mp4_box_calloc( p_box, i_number_of_entries, size );
     size = 1 + p_tfra->i_length_size_of_trun_num;
     if ( size == 3 ) size++;
-    p_tfra->p_trun_number = calloc( i_number_of_entries, size );
+    p_tfra->p_trun_number = mp4_box_calloc( p_box, i_number_of_entries, size );
     size = 1 + p_tfra->i_length_size_of_sample_num;
     if ( size == 3 ) size++;
-    p_tfra->p_sample_number = calloc( i_number_of_entries, size );
+    p_tfra->p_sample_number = mp4_box_calloc( p_box, i_number_of_entries, size );
 
     if( !p_tfra->p_time || !p_tfra->p_moof_offset || !p_tfra->p_traf_number
                         || !p_tfra->p_trun_number || !p_tfra->p_sample_number )
@@ -4920,14 +4991,14 @@ static void MP4_Box_Clean_Specific( MP4_Box_t *p_box )
  *****************************************************************************/
 static MP4_Box_t *MP4_ReadBox( stream_t *p_stream, MP4_Box_t *p_father )
 {
-    MP4_Box_t *p_box = calloc( 1, sizeof( MP4_Box_t ) ); /* Needed to ensure simple on error handler */
+    MP4_Box_t *p_box = MP4_BoxAlloc( p_father ); /* zeroed, needed to ensure simple on error handler */
     if( p_box == NULL )
         return NULL;
 
     if( !MP4_PeekBoxHeader( p_stream, p_box ) )
     {
         msg_Warn( p_stream, "cannot read one box" );
-        free( p_box );
+        MP4_BoxFree( p_box );
         return NULL;
     }
 
@@ -4935,14 +5006,14 @@ static MP4_Box_t *MP4_ReadBox( stream_t *p_stream, MP4_Box_t *p_father )
         p_father->i_pos + p_father->i_size < p_box->i_pos + p_box->i_size )
     {
         msg_Dbg( p_stream, "out of bound child" );
-        free( p_box );
+        MP4_BoxFree( p_box );
         return NULL;
     }
 
     if( !p_box->i_size )
     {
         msg_Dbg( p_stream, "found an empty box (null size)" );
-        free( p_box );
+        MP4_BoxFree( p_box );
         return NULL;
     }
     p_box->p_father = p_father;
@@ -4963,7 +5034,7 @@ static MP4_Box_t *MP4_ReadBox( stream_t *p_stream, MP4_Box_t *p_father )
  *****************************************************************************/
 MP4_Box_t * MP4_BoxNew( uint32_t i_type )
 {
-    MP4_Box_t *p_box = calloc( 1, sizeof( MP4_Box_t ) );
+    MP4_Box_t *p_box = MP4_BoxAlloc( NULL );
     if( likely( p_box != NULL ) )
     {
         p_box->i_type = i_type;
@@ -4993,10 +5064,9 @@ void MP4_BoxFree( MP4_Box_t *p_box )
 
     MP4_Box_Clean_Specific( p_box );
 
-    if( p_box->data.p_payload )
-        free( p_box->data.p_payload );
-
-    free( p_box );
+    /* The box and its data are released along with the whole tree */
+    if( p_box->b_arena_owner )
+        MP4_ArenaRelease( p_box->p_arena );
 }
 
 MP4_Box_t *MP4_BoxGetNextChunk( stream_t *s )
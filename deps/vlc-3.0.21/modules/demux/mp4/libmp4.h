@@ -1789,6 +1789,7 @@ typedef union MP4_Box_data_s
 #define BOXDATA(type) type->data.type
 
 typedef struct MP4_Box_s MP4_Box_t;
+typedef struct mp4_box_arena_t mp4_box_arena_t;
 /* the most basic structure */
 struct MP4_Box_s
 {
@@ -1816,6 +1817,9 @@ struct MP4_Box_s
 
     void (*pf_free)( MP4_Box_t *p_box ); /* pointer to free function for this box */
 
+    mp4_box_arena_t *p_arena; /* storage of the whole tree */
+    bool         b_arena_owner; /* holds a reference on p_arena */
+
     MP4_Box_data_t   data;   /* union of pointers on extended data depending
                                 on i_type (or i_usertype) */
 };
@@ -1915,8 +1919,8 @@ MP4_Box_t * MP4_BoxNew( uint32_t i_type );
 /*****************************************************************************
  * MP4_FreeBox : free memory allocated after read with MP4_ReadBox
  *               or MP4_BoxGetRoot, this means also children boxes
- * XXX : all children have to be allocated by a malloc !! and
- *         p_box is freed
+ * XXX : boxes are allocated from the arena of their tree, which is released
+ *       with the root box (or with the last box taken by MP4_BoxExtract)
  *****************************************************************************/
 void MP4_BoxFree( MP4_Box_t *p_box );
 
@@ -1949,6 +1953,8 @@ MP4_Box_t *MP4_BoxGet( const MP4_Box_t *p_box, const char *psz_fmt, ... );
  *****************************************************************************/
 unsigned MP4_BoxCount( const MP4_Box_t *p_box, const char *psz_fmt, ... );
 
+/* Unlinks the first box of i_type from the chain, the returned box can
+ * outlive its former root and must be released with MP4_BoxFree */
 MP4_Box_t * MP4_BoxExtract( MP4_Box_t **pp_chain, uint32_t i_type );
 
 /* Internal functions exposed for demuxers */
@@ -27,6 +27,7 @@
  * Preamble
  *****************************************************************************/
 #include "mp4.h"
+#include "indexcache.h"
 
 #include <vlc_demux.h>
 #include <vlc_charset.h>                           /* EnsureUTF8 */
@@ -50,6 +51,10 @@ static void Close( vlc_object_t * );
 #define MP4_M4A_TEXT     N_("M4A audio only")
 #define MP4_M4A_LONGTEXT N_("Ignore non audio tracks from iTunes audio files")
 
+#define MP4_INDEX_CACHE_TEXT     N_("Cache samples index")
+#define MP4_INDEX_CACHE_LONGTEXT N_("Store the samples index of local files " \
+    "in the cache directory, to speed up their next opening and seeking")
+
 vlc_module_begin ()
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_DEMUX )
@@ -58,6 +63,9 @@ vlc_module_begin ()
     set_capability( "demux", 240 )
     set_callbacks( Open, Close )
 
+    add_bool( CFG_PREFIX"index-cache", false, MP4_INDEX_CACHE_TEXT,
+              MP4_INDEX_CACHE_LONGTEXT, true )
+
     add_category_hint("Hacks", NULL, true)
     add_bool( CFG_PREFIX"m4a-audioonly", false, MP4_M4A_TEXT, MP4_M4A_LONGTEXT, true )
 vlc_module_end ()
@@ -122,6 +130,7 @@ struct demux_sys_t
     } hacks;
 
     mp4_fragments_index_t *p_fragsindex;
+    mp4_index_cache_t     *p_indexcache;
 };
 
 #define DEMUX_INCREMENT (CLOCK_FREQ / 4) /* How far the pcr will go, each round */
@@ -305,90 +314,95 @@ static es_out_id_t * MP4_AddTrackES( es_out_t *out, mp4_track_t *p_track )
     return p_es;
 }
 
-static int MP4_ChunkAllocDtsEntries( mp4_chunk_t *ck )
+/* Walks the runs of a chunk, as a subset of the track stts or ctts runs */
+typedef struct
 {
-    size_t entries = ck->i_entries_dts;
-
-    if( entries <= ARRAY_SIZE(ck->small_dts_buf) / 2 )
-    {
-        ck->p_sample_count_dts = ck->small_dts_buf;
-        ck->p_sample_delta_dts = ck->small_dts_buf + entries;
-        return 0;
-    }
-
-    uint32_t *buf = calloc( entries, sizeof( buf[0] ) * 2 );
-    if( unlikely(buf == NULL) )
-        return VLC_ENOMEM;
-
-    ck->p_sample_count_dts = buf;
-    ck->p_sample_delta_dts = buf + entries;
-    return 0;
+    const mp4_sample_runs_t *p_runs;
+    uint32_t i_index; /* table entry of the current run */
+    uint32_t i_skip;  /* samples of that entry before the current run */
+    uint32_t i_left;  /* chunk samples from the current run */
+    uint32_t i_count; /* samples in the current run */
+    uint32_t i_value;
+} mp4_runs_iter_t;
+
+static void MP4_RunsIterInit( mp4_runs_iter_t *it, const mp4_sample_runs_t *p_runs,
+                              uint32_t i_index, uint32_t i_skip,
+                              uint32_t i_sample_count )
+{
+    it->p_runs = p_runs;
+    it->i_index = i_index;
+    it->i_skip = i_skip;
+    it->i_left = i_sample_count;
+    it->i_count = 0;
 }
 
-static int MP4_ChunkAllocPtsEntries( mp4_chunk_t *ck )
+static bool MP4_RunsIterNext( mp4_runs_iter_t *it )
 {
-    size_t entries = ck->i_entries_pts;
-
-    if( entries <= ARRAY_SIZE(ck->small_pts_buf) / 2 )
+    if( it->i_count )
     {
-        ck->p_sample_count_pts = ck->small_pts_buf;
-        ck->p_sample_offset_pts = ck->small_pts_buf + entries;
-        return 0;
+        it->i_left -= it->i_count;
+        it->i_index++;
+        it->i_skip = 0;
     }
 
-    uint32_t *buf = calloc( entries, sizeof( buf[0] ) * 2 );
-    if( unlikely(buf == NULL) )
-        return VLC_ENOMEM;
-
-    ck->p_sample_count_pts = buf;
-    ck->p_sample_offset_pts = buf + entries;
-    return 0;
-}
+    for( ; it->i_left && it->i_index < it->p_runs->i_entries; it->i_index++ )
+    {
+        const uint32_t i_count = it->p_runs->p_count[it->i_index];
+        if( i_count > it->i_skip )
+        {
+            it->i_count = __MIN( i_count - it->i_skip, it->i_left );
+            it->i_value = it->p_runs->p_value[it->i_index];
+            return true;
+        }
+        it->i_skip = 0;
+    }
 
-static void MP4_ChunkDestroy( mp4_chunk_t *ck )
-{
-    if( ck->p_sample_count_dts != ck->small_dts_buf )
-        free( ck->p_sample_count_dts );
-    if( ck->p_sample_count_pts != ck->small_pts_buf )
-        free( ck->p_sample_count_pts );
+    it->i_count = 0;
+    return false;
 }
 
-static stime_t MP4_ChunkGetSampleDTS( const mp4_chunk_t *p_chunk,
+static stime_t MP4_ChunkGetSampleDTS( const mp4_track_t *p_track,
+                                      const mp4_chunk_t *p_chunk,
                                       uint32_t i_sample )
 {
-    uint32_t i_index = 0;
     stime_t sdts = p_chunk->i_first_dts;
-    while( i_sample > 0 && i_index < p_chunk->i_entries_dts )
+    mp4_runs_iter_t it;
+
+    MP4_RunsIterInit( &it, &p_track->dts, p_chunk->i_dts_index,
+                      p_chunk->i_dts_skip, p_chunk->i_sample_count );
+    while( i_sample > 0 && MP4_RunsIterNext( &it ) )
     {
-        if( i_sample > p_chunk->p_sample_count_dts[i_index] )
+        if( i_sample > it.i_count )
         {
-            sdts += p_chunk->p_sample_count_dts[i_index] *
-                p_chunk->p_sample_delta_dts[i_index];
-            i_sample -= p_chunk->p_sample_count_dts[i_index++];
+            sdts += (uint64_t) it.i_count * it.i_value;
+            i_sample -= it.i_count;
         }
         else
         {
-            sdts += i_sample * p_chunk->p_sample_delta_dts[i_index];
+            sdts += (uint64_t) i_sample * it.i_value;
             break;
         }
     }
     return sdts;
 }
 
-static bool MP4_ChunkGetSampleCTSDelta( const mp4_chunk_t *p_chunk,
+static bool MP4_ChunkGetSampleCTSDelta( const mp4_track_t *p_track,
+                                        const mp4_chunk_t *p_chunk,
                                         uint32_t i_sample, stime_t *pi_delta )
 {
-    if( p_chunk->p_sample_count_pts && p_chunk->p_sample_offset_pts )
+    mp4_runs_iter_t it;
+
+    MP4_RunsIterInit( &it, &p_track->pts, p_chunk->i_pts_index,
+                      p_chunk->i_pts_skip, p_chunk->i_sample_count );
+    while( MP4_RunsIterNext( &it ) )
     {
-        for( uint32_t i_index = 0; i_index < p_chunk->i_entries_pts ; i_index++ )
+        if( i_sample < it.i_count )
         {
-            if( i_sample < p_chunk->p_sample_count_pts[i_index] )
-            {
-                *pi_delta = p_chunk->p_sample_offset_pts[i_index];
-                return true;
-            }
-            i_sample -= p_chunk->p_sample_count_pts[i_index];
+            int64_t i_ctsdelta = (int32_t) it.i_value + p_track->i_cts_shift;
+            *pi_delta = i_ctsdelta < 0 ? 0 : i_ctsdelta; /* should not */
+            return true;
         }
+        i_sample -= it.i_count;
     }
     return false;
 }
@@ -421,7 +435,7 @@ static inline vlc_tick_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track
     demux_sys_t *p_sys = p_demux->p_sys;
     const mp4_chunk_t *p_chunk = &p_track->chunk[p_track->i_chunk];
 
-    stime_t sdts = MP4_ChunkGetSampleDTS( p_chunk,
+    stime_t sdts = MP4_ChunkGetSampleDTS( p_track, p_chunk,
                                           p_track->i_sample - p_chunk->i_sample_first );
 
     /* now handle elst */
@@ -436,7 +450,8 @@ static inline bool MP4_TrackGetPTSDelta( demux_t *p_demux, const mp4_track_t *p_
     VLC_UNUSED( p_demux );
     const mp4_chunk_t *ck = &p_track->chunk[p_track->i_chunk];
     stime_t delta;
-    if( !MP4_ChunkGetSampleCTSDelta( ck, p_track->i_sample - ck->i_sample_first, &delta ) )
+    if( !MP4_ChunkGetSampleCTSDelta( p_track, ck, p_track->i_sample - ck->i_sample_first,
+                                     &delta ) )
         return false;
     *pi_delta = MP4_rescale_mtime( delta, p_track->i_timescale );
     return true;
@@ -450,40 +465,24 @@ static inline mtime_t MP4_GetSamplesDuration( demux_t *p_demux, mp4_track_t *p_t
     const mp4_chunk_t *p_chunk = &p_track->chunk[p_track->i_chunk];
     stime_t i_duration = 0;
 
-    /* Forward to right index, and set remaining count in that index */
-    unsigned i_index = 0;
-    unsigned i_remain = 0;
-    for( unsigned i = p_chunk->i_sample_first;
-         i<p_track->i_sample && i_index < p_chunk->i_entries_dts; )
-    {
-        if( p_track->i_sample - i >= p_chunk->p_sample_count_dts[i_index] )
-        {
-            i += p_chunk->p_sample_count_dts[i_index];
-            i_index++;
-        }
-        else
-        {
-            i_remain = p_track->i_sample - i;
-            break;
-        }
-    }
+    /* Forward to right run, and compute total duration from there */
+    uint32_t i_skip = p_track->i_sample - p_chunk->i_sample_first;
+    mp4_runs_iter_t it;
 
-    /* Compute total duration from all samples from index */
-    while( i_nb_samples > 0 && i_index < p_chunk->i_entries_dts )
+    MP4_RunsIterInit( &it, &p_track->dts, p_chunk->i_dts_index,
+                      p_chunk->i_dts_skip, p_chunk->i_sample_count );
+    while( i_nb_samples > 0 && MP4_RunsIterNext( &it ) )
     {
-        if( i_nb_samples >= p_chunk->p_sample_count_dts[i_index] - i_remain )
-        {
-            i_duration += (p_chunk->p_sample_count_dts[i_index] - i_remain) *
-                          (int64_t) p_chunk->p_sample_delta_dts[i_index];
-            i_nb_samples -= (p_chunk->p_sample_count_dts[i_index] - i_remain);
-            i_index++;
-            i_remain = 0;
-        }
-        else
+        if( i_skip >= it.i_count )
         {
-            i_duration += i_nb_samples * p_chunk->p_sample_delta_dts[i_index];
-            break;
+            i_skip -= it.i_count;
+            continue;
         }
+
+        const uint32_t i_count = __MIN( it.i_count - i_skip, i_nb_samples );
+        i_duration += (int64_t) i_count * it.i_value;
+        i_nb_samples -= i_count;
+        i_skip = 0;
     }
 
     return MP4_rescale_mtime( i_duration, p_track->i_timescale );
@@ -1027,11 +1026,16 @@ static int Open( vlc_object_t * p_this )
     if( (p_sys->p_meta = vlc_meta_New()) )
         MP4_LoadMeta( p_sys, p_sys->p_meta );
 
+    p_sys->p_indexcache = MP4_IndexCache_Open( p_demux, p_sys->p_moov );
+    bool b_index_cached = true;
+
     /* now process each track and extract all useful information */
     for( unsigned i = 0; i < p_sys->i_tracks; i++ )
     {
         MP4_Box_t *p_trak = MP4_BoxGet( p_sys->p_root, "/moov/trak[%u]", i );
         MP4_TrackSetup( p_demux, &p_sys->track[i], p_trak, true, !b_enabled_es );
+        if( p_sys->track[i].b_ok && !p_sys->track[i].b_index_cached )
+            b_index_cached = false;
 
         if( p_sys->track[i].b_ok && !p_sys->track[i].b_chapters_source )
         {
@@ -1073,6 +1077,9 @@ static int Open( vlc_object_t * p_this )
         }
     }
 
+    MP4_IndexCache_Close( p_sys->p_indexcache );
+    p_sys->p_indexcache = NULL;
+
     p_mvex = MP4_BoxGet( p_sys->p_moov, "mvex" );
     if( p_mvex != NULL )
     {
@@ -1133,6 +1140,9 @@ static int Open( vlc_object_t * p_this )
             msg_Warn( p_demux, "that media doesn't look properly interleaved, will need to seek");
     }
 
+    if( !b_index_cached && !p_sys->b_fragmented )
+        MP4_IndexCache_Store( p_demux, p_sys->track, p_sys->i_tracks );
+
     /* */
     LoadChapter( p_demux );
 
@@ -2257,6 +2267,8 @@ static void Close ( vlc_object_t * p_this )
         MP4_TrackClean( p_demux->out, &p_sys->track[i_track] );
     free( p_sys->track );
 
+    MP4_IndexCache_Close( p_sys->p_indexcache );
+
     free( p_sys );
 }
 
@@ -2446,12 +2458,6 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
         ck->i_offset = BOXDATA(p_co64)->i_chunk_offset[i_chunk];
 
         ck->i_first_dts = 0;
-        ck->i_entries_dts = 0;
-        ck->p_sample_count_dts = NULL;
-        ck->p_sample_delta_dts = NULL;
-        ck->i_entries_pts = 0;
-        ck->p_sample_count_pts = NULL;
-        ck->p_sample_offset_pts = NULL;
     }
 
     /* now we read index for SampleEntry( soun vide mp4a mp4v ...)
@@ -2513,54 +2519,6 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
     return VLC_SUCCESS;
 }
 
-static int xTTS_CountEntries( demux_t *p_demux, uint32_t *pi_entry /* out */,
-                              const uint32_t i_index,
-                              uint32_t i_index_samples_left,
-                              uint32_t i_sample_count,
-                              const uint32_t *pi_index_sample_count,
-                              const uint32_t i_table_count )
-{
-    uint32_t i_array_offset;
-    while( i_sample_count > 0 )
-    {
-        if ( likely((UINT32_MAX - i_index) >= *pi_entry) )
-            i_array_offset = i_index + *pi_entry;
-        else
-            return VLC_EGENERIC;
-
-        if ( i_array_offset >= i_table_count )
-        {
-            msg_Err( p_demux, "invalid index counting total samples %u %u", i_array_offset,  i_table_count );
-            return VLC_ENOVAR;
-        }
-
-        if ( i_index_samples_left )
-        {
-            if ( i_index_samples_left > i_sample_count )
-            {
-                i_index_samples_left -= i_sample_count;
-                i_sample_count = 0;
-                *pi_entry +=1; /* No samples left, go copy */
-                break;
-            }
-            else
-            {
-                i_sample_count -= i_index_samples_left;
-                i_index_samples_left = 0;
-                *pi_entry += 1;
-                continue;
-            }
-        }
-        else
-        {
-            i_sample_count -= __MIN( i_sample_count, pi_index_sample_count[i_array_offset] );
-            *pi_entry += 1;
-        }
-    }
-
-    return VLC_SUCCESS;
-}
-
 static int TrackCreateSamplesIndex( demux_t *p_demux,
                                     mp4_track_t *p_demux_track )
 {
@@ -2598,18 +2556,9 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     }
     else
     {
-        /* 2: each sample can have a different size */
+        /* 2: each sample can have a different size, use the stsz table */
         p_demux_track->i_sample_size = 0;
-        p_demux_track->p_sample_size =
-            calloc( p_demux_track->i_sample_count, sizeof( uint32_t ) );
-        if( p_demux_track->p_sample_size == NULL )
-            return VLC_ENOMEM;
-
-        for( uint32_t i_sample = 0; i_sample < p_demux_track->i_sample_count; i_sample++ )
-        {
-            p_demux_track->p_sample_size[i_sample] =
-                    stsz->i_entry_size[i_sample];
-        }
+        p_demux_track->p_sample_size = stsz->i_entry_size;
     }
 
     if ( p_demux_track->i_chunk_count && p_demux_track->i_sample_size == 0 )
@@ -2624,12 +2573,9 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
     /* Use stts table to create a sample number -> dts table.
      * XXX: if we don't want to waste too much memory, we can't expand
-     *  the box! so each chunk will contain an "extract" of this table
-     *  for fast research (problem with raw stream where a sample is sometime
-     *  just channels*bits_per_sample/8 */
-
-     /* FIXME: refactor STTS & CTTS, STTS having now only few extra lines and
-      *        differing in 2/2 fields and 1 signedness */
+     *  the box! so each chunk only references its first entry in the table,
+     *  and its runs are walked from there on demand (problem with raw stream
+     *  where a sample is sometime just channels*bits_per_sample/8 */
 
     vlc_tick_t i_next_dts = 0;
     /* Find stts
@@ -2647,93 +2593,36 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
         msg_Warn( p_demux, "STTS table of %"PRIu32" entries", stts->i_entry_count );
 
-        /* Create sample -> dts table per chunk */
+        p_demux_track->dts.i_entries = stts->i_entry_count;
+        p_demux_track->dts.p_count = stts->pi_sample_count;
+        p_demux_track->dts.p_value = (const uint32_t *) stts->pi_sample_delta;
+
+        /* Locate each chunk in the sample -> dts table */
         uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
+        uint32_t i_skip = 0;
 
         for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
         {
             mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
 
             /* save first dts */
             ck->i_first_dts = i_next_dts;
+            ck->i_dts_index = i_index;
+            ck->i_dts_skip = i_skip;
 
-            /* count how many entries are needed for this chunk
-             * for p_sample_delta_dts and p_sample_count_dts */
-            ck->i_entries_dts = 0;
-
-            int i_ret = xTTS_CountEntries( p_demux, &ck->i_entries_dts, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           stts->pi_sample_count,
-                                           stts->i_entry_count );
-            if ( i_ret == VLC_EGENERIC )
-                return i_ret;
-
-            /* allocate them */
-            i_ret = MP4_ChunkAllocDtsEntries( ck );
-            if( i_ret )
+            mp4_runs_iter_t it;
+            MP4_RunsIterInit( &it, &p_demux_track->dts, i_index, i_skip,
+                              ck->i_sample_count );
+            while( MP4_RunsIterNext( &it ) )
             {
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_dts );
-                ck->i_entries_dts = 0;
-                return i_ret;
-            }
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-
-            for( uint32_t i = 0; i < ck->i_entries_dts; i++ )
-            {
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_sample_count ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_dts[i] = i_current_index_samples_left;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_current_index_samples_left ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
-                {
-                    if ( stts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_sample_count ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_current_index_samples_left = stts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_dts[i] = stts->pi_sample_count[i_index];
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( stts->pi_sample_count[i_index] ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_sample_count -= stts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
+                i_next_dts += (uint64_t) it.i_count * it.i_value;
+                i_index = it.i_index;
+                i_skip = it.i_skip + it.i_count;
             }
+            if( it.i_left )
+                msg_Warn( p_demux, "invalid index counting total samples %u %u",
+                          it.i_index, stts->i_entry_count );
+            ck->i_duration = i_next_dts - ck->i_first_dts;
         }
     }
 
@@ -2763,84 +2652,29 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
             }
         }
 
-        /* Create pts-dts table per chunk */
+        p_demux_track->i_cts_shift = i_cts_shift;
+        p_demux_track->pts.i_entries = ctts->i_entry_count;
+        p_demux_track->pts.p_count = ctts->pi_sample_count;
+        p_demux_track->pts.p_value = (const uint32_t *) ctts->pi_sample_offset;
+
+        /* Locate each chunk in the pts-dts table */
         uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
+        uint32_t i_skip = 0;
 
         for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
         {
             mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_offset_pts and p_sample_count_pts */
-            ck->i_entries_pts = 0;
-            int i_ret = xTTS_CountEntries( p_demux, &ck->i_entries_pts, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           ctts->pi_sample_count,
-                                           ctts->i_entry_count );
-            if ( i_ret == VLC_EGENERIC )
-                return i_ret;
-
-            /* allocate them */
-            i_ret = MP4_ChunkAllocPtsEntries( ck );
-            if( i_ret )
-            {
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_pts );
-                ck->i_entries_pts = 0;
-                return i_ret;
-            }
 
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
+            ck->i_pts_index = i_index;
+            ck->i_pts_skip = i_skip;
 
-            for( uint32_t i = 0; i < ck->i_entries_pts; i++ )
+            mp4_runs_iter_t it;
+            MP4_RunsIterInit( &it, &p_demux_track->pts, i_index, i_skip,
+                              ck->i_sample_count );
+            while( MP4_RunsIterNext( &it ) )
             {
-                int64_t i_ctsdelta = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                if( i_ctsdelta < 0 ) /* should not */
-                    i_ctsdelta = 0;
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = i_ctsdelta;
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = i_current_index_samples_left;
-                        ck->p_sample_offset_pts[i] = i_ctsdelta;
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
-                {
-                    if ( ctts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = i_ctsdelta;
-                        i_current_index_samples_left = ctts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = ctts->pi_sample_count[i_index];
-                        ck->p_sample_offset_pts[i] = i_ctsdelta;
-                        i_sample_count -= ctts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
-
+                i_index = it.i_index;
+                i_skip = it.i_skip + it.i_count;
             }
         }
     }
@@ -3097,7 +2931,6 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
     uint64_t     i_dts;
     unsigned int i_sample;
     unsigned int i_chunk;
-    int          i_index;
 
     /* FIXME see if it's needed to check p_track->i_chunk_count */
     if( p_track->i_chunk_count == 0 )
@@ -3160,30 +2993,28 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
     }
 
     /* *** find sample in the chunk *** */
-    i_sample = p_track->chunk[i_chunk].i_sample_first;
-    i_dts    = p_track->chunk[i_chunk].i_first_dts;
-    for( i_index = 0;  i_index < p_track->chunk[i_chunk].i_entries_dts &&
-                       i_sample < p_track->chunk[i_chunk].i_sample_count; )
+    const mp4_chunk_t *ck = &p_track->chunk[i_chunk];
+    mp4_runs_iter_t it;
+
+    i_sample = ck->i_sample_first;
+    i_dts    = ck->i_first_dts;
+    MP4_RunsIterInit( &it, &p_track->dts, ck->i_dts_index, ck->i_dts_skip,
+                      ck->i_sample_count );
+    while( i_sample < ck->i_sample_count && MP4_RunsIterNext( &it ) )
     {
-        if( i_dts +
-            p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-            p_track->chunk[i_chunk].p_sample_delta_dts[i_index] < (uint64_t)i_start )
+        const uint64_t i_run = (uint64_t) it.i_count * it.i_value;
+        if( i_dts + i_run < (uint64_t)i_start )
         {
-            i_dts    +=
-                p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
-
-            i_sample += p_track->chunk[i_chunk].p_sample_count_dts[i_index];
-            i_index++;
+            i_dts    += i_run;
+            i_sample += it.i_count;
         }
         else
         {
-            if( p_track->chunk[i_chunk].p_sample_delta_dts[i_index] <= 0 )
+            if( it.i_value == 0 )
             {
                 break;
             }
-            i_sample += ( i_start - i_dts ) /
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+            i_sample += ( i_start - i_dts ) / it.i_value;
             break;
         }
     }
@@ -3516,8 +3347,13 @@ static void MP4_TrackSetup( demux_t *p_demux, mp4_track_t *p_track,
     }
 
     /* Create chunk index table and sample index table */
-    if( TrackCreateChunksIndex( p_demux,p_track  ) ||
-        TrackCreateSamplesIndex( p_demux, p_track ) )
+    if( p_sys->p_indexcache &&
+        MP4_IndexCache_LoadTrack( p_sys->p_indexcache, p_track - p_sys->track,
+                                  p_track ) == VLC_SUCCESS )
+        msg_Dbg( p_demux, "track[Id 0x%x] index loaded from cache",
+                 p_track->i_track_ID );
+    else if( TrackCreateChunksIndex( p_demux,p_track  ) ||
+             TrackCreateSamplesIndex( p_demux, p_track ) )
     {
         msg_Err( p_demux, "cannot create chunks index" );
         return; /* cannot create chunks index */
@@ -3625,16 +3461,9 @@ static void MP4_TrackClean( es_out_t *out, mp4_track_t *p_track )
     if( p_track->p_es )
         es_out_Del( out, p_track->p_es );
 
-    if( p_track->chunk )
-    {
-        for( unsigned int i_chunk = 0; i_chunk < p_track->i_chunk_count; i_chunk++ )
-            MP4_ChunkDestroy( &p_track->chunk[i_chunk] );
-    }
+    /* samples tables belong to the stbl boxes */
     free( p_track->chunk );
 
-    if( !p_track->i_sample_size )
-        free( p_track->p_sample_size );
-
     if ( p_track->asfinfo.p_frame )
         block_ChainRelease( p_track->asfinfo.p_frame );
 
@@ -30,6 +30,14 @@
 #include "fragments.h"
 #include "../asf/asfpacket.h"
 
+/* Run-length coded samples values, as stored in the stts and ctts boxes */
+typedef struct
+{
+    uint32_t        i_entries;
+    const uint32_t *p_count;
+    const uint32_t *p_value;
+} mp4_sample_runs_t;
+
 /* Contain all information about a chunk */
 typedef struct
 {
@@ -47,15 +55,12 @@ typedef struct
     uint64_t     i_first_dts;   /* DTS of the first sample */
     uint64_t     i_duration;    /* total duration of all samples */
 
-    uint32_t     i_entries_dts;
-    uint32_t     *p_sample_count_dts;
-    uint32_t     *p_sample_delta_dts;   /* dts delta */
-    uint32_t     small_dts_buf[4];
-
-    uint32_t     i_entries_pts;
-    uint32_t     *p_sample_count_pts;
-    uint32_t     *p_sample_offset_pts;  /* pts-dts */
-    uint32_t     small_pts_buf[4];
+    /* position of the first sample in the track stts and ctts runs,
+       the chunk runs are walked from there when needed */
+    uint32_t     i_dts_index;   /* first stts entry */
+    uint32_t     i_dts_skip;    /* samples of that entry in previous chunks */
+    uint32_t     i_pts_index;   /* first ctts entry */
+    uint32_t     i_pts_skip;
 
     /* TODO if needed add pts
         but quickly *add* support for edts and seeking */
@@ -121,8 +126,14 @@ typedef struct
     /* sample size, p_sample_size defined only if i_sample_size == 0
         else i_sample_size is size for all sample */
     uint32_t         i_sample_size;
-    uint32_t         *p_sample_size; /* XXX perhaps add file offset if take
+    const uint32_t   *p_sample_size; /* XXX perhaps add file offset if take
 //                                    too much time to do sumations each time*/
+    bool             b_index_cached; /* chunks are loaded from the index cache */
+
+    /* samples dts deltas and pts offsets, pointing to the stbl boxes */
+    mp4_sample_runs_t dts;
+    mp4_sample_runs_t pts;
+    int64_t          i_cts_shift;    /* added to the ctts offsets */
 
     uint32_t     i_sample_first; /* i_sample_first value
                                                    of the next chunk */
@@ -35,6 +35,7 @@
 #include <vlc_access.h>    /* DVB-specific things */
 #include <vlc_demux.h>
 #include <vlc_input.h>
+#include <vlc_atomic.h>
 
 #include "ts_pid.h"
 #include "ts_streams.h"
@@ -196,6 +197,9 @@ static bool GatherSectionsData( demux_t *p_demux, ts_pid_t *, block_t *, size_t
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_prg, vlc_tick_t i_pcr );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
+static void FlushTSBatch( demux_sys_t * );
+static uint64_t TellTS( demux_sys_t * );
+static int SeekTS( demux_sys_t *, uint64_t );
 static int SeekToTime( demux_t *p_demux, const ts_pmt_t *, int64_t time );
 static void ReadyQueuesPostSeek( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, vlc_tick_t );
@@ -404,6 +408,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_packet_size = i_packet_size;
     p_sys->i_packet_header_size = i_packet_header_size;
     p_sys->i_ts_read = 50;
+    p_sys->p_batch = NULL;
     p_sys->csa = NULL;
     p_sys->b_start_record = false;
 
@@ -562,6 +567,8 @@ static void Close( vlc_object_t *p_this )
 
     PIDRelease( p_demux, GetPID(p_sys, 0) );
 
+    FlushTSBatch( p_sys );
+
     vlc_mutex_lock( &p_sys->csa_lock );
     if( p_sys->csa )
     {
@@ -646,6 +653,8 @@ static int Demux( demux_t *p_demux )
 
         if( p_sys->b_start_record )
         {
+            /* Read again the packets read ahead, so that they get recorded */
+            TsRewindBatch( p_sys );
             /* Enable recording once synchronized */
             vlc_stream_Control( p_sys->stream, STREAM_SET_RECORD_STATE, true,
                                 "ts" );
@@ -947,7 +956,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         if( (i64 = stream_Size( p_sys->stream) ) > 0 )
         {
-            uint64_t offset = vlc_stream_Tell( p_sys->stream );
+            uint64_t offset = TellTS( p_sys );
             *pf = (double)offset / (double)i64;
             return VLC_SUCCESS;
         }
@@ -994,7 +1003,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         i64 = stream_Size( p_sys->stream );
         if( i64 > 0 &&
-            vlc_stream_Seek( p_sys->stream, (int64_t)(i64 * f) ) == VLC_SUCCESS )
+            SeekTS( p_sys, (int64_t)(i64 * f) ) == VLC_SUCCESS )
         {
             ReadyQueuesPostSeek( p_demux );
             return VLC_SUCCESS;
@@ -1717,20 +1726,185 @@ static bool PushPESBlock( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, bool
     return b_ret;
 }
 
+/*****************************************************************************
+ * Batched packets reading
+ *****************************************************************************
+ * On fast seekable streams, packets are read TS_BATCH_PACKETS at a time, and
+ * handed out as blocks pointing into the batch buffer. The batch is freed
+ * along with the last of its packets. Only packets starting with a sync byte
+ * are kept: the stream is moved back to the first bad one, and the usual
+ * resynchronization happens once the batch is consumed.
+ *****************************************************************************/
+#define TS_BATCH_PACKETS 64
+
+typedef struct
+{
+    block_t            self;
+    ts_packet_batch_t *p_batch;
+} ts_batch_packet_t;
+
+struct ts_packet_batch_t
+{
+    atomic_uint       i_refs; /* packets not released yet */
+    unsigned          i_count;
+    unsigned          i_next; /* next packet to hand out */
+    ts_batch_packet_t packets[TS_BATCH_PACKETS];
+    uint8_t           p_data[];
+};
+
+static void TSBatchRelease( ts_packet_batch_t *p_batch, unsigned i_refs )
+{
+    if( atomic_fetch_sub( &p_batch->i_refs, i_refs ) == i_refs )
+        free( p_batch );
+}
+
+static void TSBatchPacketRelease( block_t *p_block )
+{
+    TSBatchRelease( ((ts_batch_packet_t *)p_block)->p_batch, 1 );
+}
+
+/* Drops the packets read ahead and not handed out yet */
+static void FlushTSBatch( demux_sys_t *p_sys )
+{
+    ts_packet_batch_t *p_batch = p_sys->p_batch;
+
+    if( p_batch )
+    {
+        p_sys->p_batch = NULL;
+        TSBatchRelease( p_batch, p_batch->i_count - p_batch->i_next );
+    }
+}
+
+/* Stream position of the next packet to demux */
+static uint64_t TellTS( demux_sys_t *p_sys )
+{
+    uint64_t i_pos = vlc_stream_Tell( p_sys->stream );
+
+    if( p_sys->p_batch )
+        i_pos -= (uint64_t)( p_sys->p_batch->i_count - p_sys->p_batch->i_next )
+                 * p_sys->i_packet_size;
+    return i_pos;
+}
+
+static int SeekTS( demux_sys_t *p_sys, uint64_t i_pos )
+{
+    FlushTSBatch( p_sys );
+    return vlc_stream_Seek( p_sys->stream, i_pos );
+}
+
+void TsRewindBatch( demux_sys_t *p_sys )
+{
+    if( p_sys->p_batch )
+        SeekTS( p_sys, TellTS( p_sys ) );
+}
+
+static void FillTSBatch( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const unsigned i_size = p_sys->i_packet_size;
+
+    ts_packet_batch_t *p_batch = malloc( sizeof(*p_batch)
+                                         + TS_BATCH_PACKETS * i_size );
+    if( unlikely(p_batch == NULL) )
+        return;
+
+    ssize_t i_read = vlc_stream_Read( p_sys->stream, p_batch->p_data,
+                                      TS_BATCH_PACKETS * i_size );
+    unsigned i_count = 0;
+    if( i_read > 0 )
+    {
+        const uint8_t *p_sync = &p_batch->p_data[p_sys->i_packet_header_size];
+        while( i_count < (size_t)i_read / i_size
+            && p_sync[i_count * i_size] == 0x47 )
+            i_count++;
+
+        /* Give back the bad or truncated packets to the usual path */
+        if( (size_t)i_read != i_count * i_size &&
+            vlc_stream_Seek( p_sys->stream, vlc_stream_Tell( p_sys->stream )
+                                            - i_read + i_count * i_size ) )
+            i_count = 0;
+    }
+
+    if( i_count == 0 )
+    {
+        free( p_batch );
+        return;
+    }
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        block_t *p_pkt = &p_batch->packets[i].self;
+
+        block_Init( p_pkt, &p_batch->p_data[i * i_size], i_size );
+        p_pkt->pf_release = TSBatchPacketRelease;
+        p_batch->packets[i].p_batch = p_batch;
+    }
+
+    /* Descramble the whole batch at once rather than in ProcessTSPacket() */
+    if( p_sys->csa )
+    {
+        uint8_t *pp_scrambled[TS_BATCH_PACKETS];
+        unsigned i_scrambled = 0;
+
+        for( unsigned i = 0; i < i_count; i++ )
+        {
+            uint8_t *p = &p_batch->p_data[i * i_size
+                                          + p_sys->i_packet_header_size];
+
+            /* Skip the packets rejected before being descrambled */
+            if( (p[3]&0x80) && !(p[1]&0x80)
+             && ( ((p[1]&0x1f)<<8)|p[2] ) != 0x1FFF )
+                pp_scrambled[i_scrambled++] = p;
+        }
+
+        if( i_scrambled > 0 )
+        {
+            vlc_mutex_lock( &p_sys->csa_lock );
+            csa_DecryptBatch( p_sys->csa, pp_scrambled, i_scrambled,
+                              p_sys->i_csa_pkt_size );
+            vlc_mutex_unlock( &p_sys->csa_lock );
+        }
+    }
+
+    atomic_init( &p_batch->i_refs, i_count );
+    p_batch->i_count = i_count;
+    p_batch->i_next = 0;
+    p_sys->p_batch = p_batch;
+}
+
 static block_t* ReadTSPacket( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
     block_t     *p_pkt;
 
+    /* Recording starts from the next stream read: don't read ahead */
+    if( p_sys->p_batch == NULL && p_sys->b_canfastseek &&
+        !p_sys->b_start_record )
+        FillTSBatch( p_demux );
+
+    if( p_sys->p_batch )
+    {
+        ts_packet_batch_t *p_batch = p_sys->p_batch;
+
+        p_pkt = &p_batch->packets[p_batch->i_next++].self;
+        if( p_batch->i_next == p_batch->i_count )
+            p_sys->p_batch = NULL;
+
+        /* Skip header (BluRay streams), see below */
+        p_pkt->p_buffer += p_sys->i_packet_header_size;
+        p_pkt->i_buffer -= p_sys->i_packet_header_size;
+        return p_pkt;
+    }
+
     /* Get a new TS packet */
     if( !( p_pkt = vlc_stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
     {
         int64_t size = stream_Size( p_sys->stream );
-        if( size >= 0 && (uint64_t)size == vlc_stream_Tell( p_sys->stream ) )
-            msg_Dbg( p_demux, "EOF at %"PRIu64, vlc_stream_Tell( p_sys->stream ) );
+        if( size >= 0 && (uint64_t)size == TellTS( p_sys ) )
+            msg_Dbg( p_demux, "EOF at %"PRIu64, TellTS( p_sys ) );
         else
-            msg_Dbg( p_demux, "Can't read TS packet at %"PRIu64, vlc_stream_Tell(p_sys->stream) );
+            msg_Dbg( p_demux, "Can't read TS packet at %"PRIu64, TellTS( p_sys ) );
         return NULL;
     }
 
@@ -1776,7 +1950,7 @@ static block_t* ReadTSPacket( demux_t *p_demux )
                 i_skip++;
             }
             msg_Dbg( p_demux, "skipping %d bytes of garbage at %"PRIu64,
-                     i_skip, vlc_stream_Tell( p_sys->stream ) );
+                     i_skip, TellTS( p_sys ) );
             if (vlc_stream_Read( p_sys->stream, NULL, i_skip ) != i_skip)
                 return NULL;
 
@@ -1785,7 +1959,7 @@ static block_t* ReadTSPacket( demux_t *p_demux )
                 break;
             }
         }
-        msg_Dbg( p_demux, "resynced at %" PRIu64, vlc_stream_Tell( p_sys->stream ) );
+        msg_Dbg( p_demux, "resynced at %" PRIu64, TellTS( p_sys ) );
         if( !( p_pkt = vlc_stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
         {
             msg_Dbg( p_demux, "eof ?" );
@@ -1906,13 +2080,13 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
 
     /* Deal with common but worst binary search case */
     if( p_pmt->pcr.i_first == i_scaledtime && p_sys->b_canseek )
-        return vlc_stream_Seek( p_sys->stream, 0 );
+        return SeekTS( p_sys, 0 );
 
     const int64_t i_stream_size = stream_Size( p_sys->stream );
     if( !p_sys->b_canfastseek || i_stream_size < p_sys->i_packet_size )
         return VLC_EGENERIC;
 
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = TellTS( p_sys );
 
     /* Find the time position by using binary search algorithm. */
     uint64_t i_head_pos = 0;
@@ -1928,7 +2102,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
         uint64_t i_div = i_splitpos % p_sys->i_packet_size;
         i_splitpos -= i_div;
 
-        if ( vlc_stream_Seek( p_sys->stream, i_splitpos ) != VLC_SUCCESS )
+        if ( SeekTS( p_sys, i_splitpos ) != VLC_SUCCESS )
             break;
 
         uint64_t i_pos = i_splitpos;
@@ -1942,7 +2116,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
                 break;
             }
             else
-                i_pos = vlc_stream_Tell( p_sys->stream );
+                i_pos = TellTS( p_sys );
 
             int i_pid = PIDGet( p_pkt );
             ts_pid_t *p_pid = GetPID(p_sys, i_pid);
@@ -1999,7 +2173,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
     if( !b_found )
     {
         msg_Dbg( p_demux, "Seek():cannot find a time position." );
-        vlc_stream_Seek( p_sys->stream, i_initial_pos );
+        SeekTS( p_sys, i_initial_pos );
         return VLC_EGENERIC;
     }
     return VLC_SUCCESS;
@@ -2080,7 +2254,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
                         if( b_end )
                         {
                             p_pmt->i_last_dts = *pi_pcr;
-                            p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+                            p_pmt->i_last_dts_byte = TellTS( p_sys );
                         }
                         /* Start, only keep first */
                         else if( b_pcrresult && p_pmt->pcr.i_first == -1 )
@@ -2108,7 +2282,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
 int ProbeStart( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = TellTS( p_sys );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
     int i_probe_count = 0;
@@ -2121,7 +2295,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
         i_pos = p_sys->i_packet_size * i_probe_count;
         i_pos = __MIN( i_pos, i_stream_size );
 
-        if( vlc_stream_Seek( p_sys->stream, i_pos ) )
+        if( SeekTS( p_sys, i_pos ) )
             return VLC_EGENERIC;
 
         ProbeChunk( p_demux, i_program, false, &i_pcr, &b_found );
@@ -2131,7 +2305,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
     } while( i_pos < i_stream_size && !b_found &&
              i_probe_count < PROBE_MAX );
 
-    if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) )
+    if( SeekTS( p_sys, i_initial_pos ) )
         return VLC_EGENERIC;
 
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
@@ -2140,7 +2314,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
 int ProbeEnd( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = TellTS( p_sys );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
     int i_probe_count = PROBE_CHUNK_COUNT;
@@ -2153,7 +2327,7 @@ int ProbeEnd( demux_t *p_demux, int i_program )
         i_pos = i_stream_size - (p_sys->i_packet_size * i_probe_count);
         i_pos = __MAX( i_pos, 0 );
 
-        if( vlc_stream_Seek( p_sys->stream, i_pos ) )
+        if( SeekTS( p_sys, i_pos ) )
             return VLC_EGENERIC;
 
         ProbeChunk( p_demux, i_program, true, &i_pcr, &b_found );
@@ -2163,7 +2337,7 @@ int ProbeEnd( demux_t *p_demux, int i_program )
     } while( i_pos > 0 && !b_found &&
              i_probe_count < PROBE_MAX );
 
-    if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) )
+    if( SeekTS( p_sys, i_initial_pos ) )
         return VLC_EGENERIC;
 
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
@@ -2214,14 +2388,14 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, vlc_tick_t i_pcr )
         es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR, p_pmt->i_number, FROM_SCALE(i_pcr) );
         /* growing files/named fifo handling */
         if( p_sys->b_access_control == false &&
-            vlc_stream_Tell( p_sys->stream ) > p_pmt->i_last_dts_byte )
+            TellTS( p_sys ) > p_pmt->i_last_dts_byte )
         {
             if( p_pmt->i_last_dts_byte == 0 ) /* first run */
                 p_pmt->i_last_dts_byte = stream_Size( p_sys->stream );
             else
             {
                 p_pmt->i_last_dts = i_pcr;
-                p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+                p_pmt->i_last_dts_byte = TellTS( p_sys );
             }
         }
     }
@@ -24,6 +24,7 @@
     typedef struct arib_instance_t arib_instance_t;
 #endif
 typedef struct csa_t csa_t;
+typedef struct ts_packet_batch_t ts_packet_batch_t;
 
 #define TS_USER_PMT_NUMBER (0)
 
@@ -59,6 +60,8 @@ struct demux_sys_t
 
     /* how many TS packet we read at once */
     unsigned    i_ts_read;
+    /* packets read ahead, see ReadTSPacket() */
+    ts_packet_batch_t *p_batch;
 
     bool        b_cc_check;
     bool        b_ignore_time_for_positions;
@@ -134,6 +137,9 @@ struct demux_sys_t
 
 void TsChangeStandard( demux_sys_t *, ts_standards_e );
 
+/* moves the stream back to the first packet not demuxed yet */
+void TsRewindBatch( demux_sys_t * );
+
 bool ProgramIsSelected( demux_sys_t *, uint16_t i_pgrm );
 
 void UpdatePESFilters( demux_t *p_demux, bool b_all );
@@ -23,6 +23,7 @@
 
 #define MIN_ES_PID 4    /* Should be 32.. broken muxers */
 #define MAX_ES_PID 8190
+#define TS_PID_COUNT 8192
 
 #include "ts_streams.h"
 
@@ -87,14 +88,12 @@ struct ts_pid_list_t
     ts_pid_t   pat;
     ts_pid_t   dummy;
     ts_pid_t   base_si;
-    /* all non commons ones, dynamically allocated */
+    /* all non commons ones, dynamically allocated, sorted by PID */
     ts_pid_t **pp_all;
     int        i_all;
     int        i_all_alloc;
-    /* last recently used */
-    uint16_t   i_last_pid;
-    ts_pid_t  *p_last;
-
+    /* direct lookup of all pids, commons included */
+    ts_pid_t  *p_index[TS_PID_COUNT];
 };
 
 /* opacified pid list */
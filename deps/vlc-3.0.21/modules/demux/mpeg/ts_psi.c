@@ -1929,6 +1929,8 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_dvbpsipmt )
                 en50221_capmt_Delete( p_en );
                 if ( p_sys->standard == TS_STANDARD_ARIB && !p_sys->arib.b25stream )
                 {
+                    /* the packets read ahead must go through the CAM too */
+                    TsRewindBatch( p_sys );
                     p_sys->arib.b25stream = vlc_stream_FilterNew( p_demux->s, "aribcam" );
                     p_sys->stream = ( p_sys->arib.b25stream ) ? p_sys->arib.b25stream : p_demux->s;
                 }
@@ -27,6 +27,16 @@
 #endif
 
 #include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include <assert.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
 
 #include "csa.h"
 
@@ -610,3 +620,479 @@ static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] )
     }
 }
 
+
+/*****************************************************************************
+ * Batches
+ *****************************************************************************
+ * Once initialised with the first block of the payload, the stream cypher
+ * does not depend on the block cypher anymore: it is run bitsliced on many
+ * packets at once (see csa_bs.h), while the block cypher remains per packet.
+ *****************************************************************************/
+typedef struct
+{
+    uint8_t *pkt;
+    uint8_t *ck;
+    uint8_t *kk;
+    bool     b_odd;
+
+    int      i_hdr;
+    int      n;         /* complete blocks */
+    int      i_residue;
+    int      i_blocks;  /* stream blocks after the initialisation */
+} csa_lane_t;
+
+#define CSA_MAX_LANES 256
+/* Below this, the bitsliced stream cypher is slower than the plain one */
+#define CSA_MIN_LANES 8
+/* Independent blocks going through the block decypher together */
+#define CSA_INTERLEAVE 4
+
+/* Transposes a 64x64 bit matrix: bit l of a[k] becomes bit k of a[l] */
+static void csa_Transpose( uint64_t a[64] )
+{
+    uint64_t m = UINT64_C(0x00000000FFFFFFFF);
+
+    for( unsigned j = 32; j != 0; j >>= 1, m ^= m << j )
+    {
+        for( unsigned k = 0; k < 64; k = ( ( k | j ) + 1 ) & ~j )
+        {
+            const uint64_t t = ( ( a[k] >> j ) ^ a[k | j] ) & m;
+            a[k] ^= t << j;
+            a[k | j] ^= t;
+        }
+    }
+}
+
+/* Uses the output block g (from 1) of the stream cypher of a packet: in both
+ * directions, it is xored with the blocks 1 to n-1 and with the residue */
+static void csa_StreamLane( csa_lane_t *l, int g, const uint8_t stream[8] )
+{
+    uint8_t *p = &l->pkt[l->i_hdr];
+
+    if( g < l->n )
+        for( int j = 0; j < 8; j++ )
+            p[8*g+j] ^= stream[j];
+
+    if( l->i_residue > 0 && g == __MAX( l->n, 1 ) )
+        for( int j = 0; j < l->i_residue; j++ )
+            p[8*l->n+j] ^= stream[j];
+}
+
+/* Once the stream is xored, the block i holds the ib of csa_Decrypt() for
+ * the block i+1: the block decyphers do not depend on each other anymore */
+static void csa_BlockDecypherLane( csa_lane_t *l )
+{
+    uint8_t *p = &l->pkt[l->i_hdr];
+
+    for( int i = 0; i < l->n; i += CSA_INTERLEAVE )
+    {
+        const int m = __MIN( CSA_INTERLEAVE, l->n - i );
+        int R[CSA_INTERLEAVE][9];
+
+        for( int b = 0; b < m; b++ )
+            for( int j = 0; j < 8; j++ )
+                R[b][j+1] = p[8*(i+b)+j];
+
+        /* same rounds as csa_BlockDecypher() */
+        for( int k = 56; k > 0; k-- )
+        {
+            for( int b = 0; b < m; b++ )
+            {
+                const int sbox_out = block_sbox[ l->kk[k]^R[b][7] ];
+                const int perm_out = block_perm[sbox_out];
+                const int next_R8 = R[b][7];
+
+                R[b][7] = R[b][6] ^ perm_out;
+                R[b][6] = R[b][5];
+                R[b][5] = R[b][4] ^ R[b][8] ^ sbox_out;
+                R[b][4] = R[b][3] ^ R[b][8] ^ sbox_out;
+                R[b][3] = R[b][2] ^ R[b][8] ^ sbox_out;
+                R[b][2] = R[b][1];
+                R[b][1] = R[b][8] ^ sbox_out;
+                R[b][8] = next_R8;
+            }
+        }
+
+        /* xor with the ib of the next block, 0 after the last one */
+        for( int b = 0; b < m; b++ )
+            for( int j = 0; j < 8; j++ )
+                p[8*(i+b)+j] = R[b][j+1]
+                             ^ ( i + b + 1 < l->n ? p[8*(i+b+1)+j] : 0 );
+    }
+}
+
+static void csa_FinishLane( csa_lane_t *l, bool b_encrypt )
+{
+    /* the block cypher already ran before the stream cypher */
+    if( !b_encrypt )
+        csa_BlockDecypherLane( l );
+}
+
+#define RENAME(a) a ## _64
+#define BS_LANES 64
+#define BS_WORD uint64_t
+#define BS_AND(a, b) ((a) & (b))
+#define BS_OR(a, b) ((a) | (b))
+#define BS_XOR(a, b) ((a) ^ (b))
+#define BS_ANDNOT(a, b) (~(a) & (b))
+#define BS_NOT(a) (~(a))
+#define BS_ZERO UINT64_C(0)
+#define BS_ONES (~UINT64_C(0))
+#define VLC_BS_TARGET
+#include "csa_bs.h"
+#undef VLC_BS_TARGET
+#undef BS_ONES
+#undef BS_ZERO
+#undef BS_NOT
+#undef BS_ANDNOT
+#undef BS_XOR
+#undef BS_OR
+#undef BS_AND
+#undef BS_WORD
+#undef BS_LANES
+#undef RENAME
+
+#ifdef HAVE_SSE2_INTRINSICS
+# define RENAME(a) a ## _sse2
+# define BS_LANES 128
+# define BS_WORD __m128i
+# define BS_AND(a, b) _mm_and_si128(a, b)
+# define BS_OR(a, b) _mm_or_si128(a, b)
+# define BS_XOR(a, b) _mm_xor_si128(a, b)
+# define BS_ANDNOT(a, b) _mm_andnot_si128(a, b)
+# define BS_NOT(a) _mm_xor_si128(a, _mm_set1_epi32(-1))
+# define BS_ZERO _mm_setzero_si128()
+# define BS_ONES _mm_set1_epi32(-1)
+# define VLC_BS_TARGET __attribute__ ((__target__ ("sse2")))
+# include "csa_bs.h"
+# undef VLC_BS_TARGET
+# undef BS_ONES
+# undef BS_ZERO
+# undef BS_NOT
+# undef BS_ANDNOT
+# undef BS_XOR
+# undef BS_OR
+# undef BS_AND
+# undef BS_WORD
+# undef BS_LANES
+# undef RENAME
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+# define RENAME(a) a ## _avx2
+# define BS_LANES 256
+# define BS_WORD __m256i
+# define BS_AND(a, b) _mm256_and_si256(a, b)
+# define BS_OR(a, b) _mm256_or_si256(a, b)
+# define BS_XOR(a, b) _mm256_xor_si256(a, b)
+# define BS_ANDNOT(a, b) _mm256_andnot_si256(a, b)
+# define BS_NOT(a) _mm256_xor_si256(a, _mm256_set1_epi32(-1))
+# define BS_ZERO _mm256_setzero_si256()
+# define BS_ONES _mm256_set1_epi32(-1)
+# define VLC_BS_TARGET __attribute__ ((__target__ ("avx2")))
+# include "csa_bs.h"
+# undef VLC_BS_TARGET
+# undef BS_ONES
+# undef BS_ZERO
+# undef BS_NOT
+# undef BS_ANDNOT
+# undef BS_XOR
+# undef BS_OR
+# undef BS_AND
+# undef BS_WORD
+# undef BS_LANES
+# undef RENAME
+#endif
+
+static void csa_StreamBatch( csa_t *c, csa_lane_t *p_lanes, unsigned i_lanes,
+                             bool b_encrypt )
+{
+    while( i_lanes >= CSA_MIN_LANES )
+    {
+        unsigned i_done = __MIN( i_lanes, 64 );
+
+#ifdef HAVE_AVX2_INTRINSICS
+        if( i_lanes > 128 && vlc_CPU_AVX2() )
+        {
+            i_done = __MIN( i_lanes, 256 );
+            csa_StreamLanes_avx2( c, p_lanes, i_done, b_encrypt );
+        }
+        else
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+        if( i_lanes > 64 && vlc_CPU_SSE2() )
+        {
+            i_done = __MIN( i_lanes, 128 );
+            csa_StreamLanes_sse2( c, p_lanes, i_done, b_encrypt );
+        }
+        else
+#endif
+            csa_StreamLanes_64( c, p_lanes, i_done, b_encrypt );
+
+        p_lanes += i_done;
+        i_lanes -= i_done;
+    }
+
+    /* the few remaining packets, one at a time */
+    for( unsigned i = 0; i < i_lanes; i++ )
+    {
+        csa_lane_t *l = &p_lanes[i];
+        uint8_t stream[8];
+
+        csa_StreamCypher( c, 1, l->ck, &l->pkt[l->i_hdr], stream );
+        for( int g = 1; g <= l->i_blocks; g++ )
+        {
+            csa_StreamCypher( c, 0, l->ck, NULL, stream );
+            csa_StreamLane( l, g, stream );
+        }
+        csa_FinishLane( l, b_encrypt );
+    }
+}
+
+/*****************************************************************************
+ * csa_DecryptBatch:
+ *****************************************************************************/
+void csa_DecryptBatch( csa_t *c, uint8_t *const *pp_pkts, unsigned i_count,
+                       int i_pkt_size )
+{
+    csa_lane_t lanes[CSA_MAX_LANES];
+    unsigned i_lanes = 0;
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        uint8_t *pkt = pp_pkts[i];
+        csa_lane_t *l = &lanes[i_lanes];
+
+        /* transport scrambling control */
+        if( (pkt[3]&0x80) == 0 )
+            continue;
+        l->b_odd = pkt[3]&0x40;
+        l->ck = l->b_odd ? c->o_ck : c->e_ck;
+        l->kk = l->b_odd ? c->o_kk : c->e_kk;
+
+        /* clear transport scrambling control */
+        pkt[3] &= 0x3f;
+
+        l->i_hdr = 4;
+        if( pkt[3]&0x20 )
+        {
+            /* skip adaption field */
+            l->i_hdr += pkt[4] + 1;
+        }
+
+        if( 188 - l->i_hdr < 8 )
+            continue;
+
+        l->n = (i_pkt_size - l->i_hdr) / 8;
+        if( l->n < 0 )
+            continue;
+        l->i_residue = (i_pkt_size - l->i_hdr) % 8;
+        l->i_blocks = l->i_residue > 0 ? __MAX( l->n, 1 ) : __MAX( l->n - 1, 0 );
+
+        l->pkt = pkt;
+
+        if( ++i_lanes == CSA_MAX_LANES )
+        {
+            csa_StreamBatch( c, lanes, i_lanes, false );
+            i_lanes = 0;
+        }
+    }
+
+    csa_StreamBatch( c, lanes, i_lanes, false );
+}
+
+/*****************************************************************************
+ * csa_EncryptBatch:
+ *****************************************************************************/
+void csa_EncryptBatch( csa_t *c, uint8_t *const *pp_pkts, unsigned i_count,
+                       int i_pkt_size )
+{
+    csa_lane_t lanes[CSA_MAX_LANES];
+    unsigned i_lanes = 0;
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        uint8_t *pkt = pp_pkts[i];
+        csa_lane_t *l = &lanes[i_lanes];
+
+        /* set transport scrambling control */
+        pkt[3] |= 0x80;
+        if( c->use_odd )
+            pkt[3] |= 0x40;
+        l->b_odd = c->use_odd;
+        l->ck = l->b_odd ? c->o_ck : c->e_ck;
+        l->kk = l->b_odd ? c->o_kk : c->e_kk;
+
+        l->i_hdr = 4;
+        if( pkt[3]&0x20 )
+        {
+            /* skip adaption field */
+            l->i_hdr += pkt[4] + 1;
+        }
+        l->n = (i_pkt_size - l->i_hdr) / 8;
+        l->i_residue = (i_pkt_size - l->i_hdr) % 8;
+
+        if( l->n <= 0 )
+        {
+            pkt[3] &= 0x3f;
+            continue;
+        }
+        l->i_blocks = l->i_residue > 0 ? l->n : l->n - 1;
+        l->pkt = pkt;
+
+        /* block cypher from the last block, each ib replacing its input */
+        uint8_t *p = &pkt[l->i_hdr];
+        uint8_t ib[8] = { 0 }, block[8];
+
+        for( int k = l->n; k > 0; k-- )
+        {
+            for( int j = 0; j < 8; j++ )
+                block[j] = p[8*(k-1)+j] ^ ib[j];
+            csa_BlockCypher( l->kk, block, ib );
+            memcpy( &p[8*(k-1)], ib, 8 );
+        }
+
+        if( ++i_lanes == CSA_MAX_LANES )
+        {
+            csa_StreamBatch( c, lanes, i_lanes, true );
+            i_lanes = 0;
+        }
+    }
+
+    csa_StreamBatch( c, lanes, i_lanes, true );
+}
+
+#ifdef CSA_TEST
+#include <stdio.h>
+#include <stdlib.h>
+
+const char vlc_module_name[] = "csa";
+
+static void RandomPackets( uint8_t *p_pkts, unsigned i_count, bool b_scrambled )
+{
+    for( unsigned i = 0; i < i_count * 188; i++ )
+        p_pkts[i] = rand();
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        uint8_t *pkt = &p_pkts[188 * i];
+
+        pkt[0] = 0x47;
+        pkt[3] &= 0x3f | ( b_scrambled ? 0xc0 : 0x00 );
+        /* mostly full payloads, then all the adaptation field lengths */
+        if( pkt[3] & 0x20 && rand() % 2 )
+            pkt[4] = rand() % 184;
+        else
+            pkt[3] &= ~0x20;
+    }
+}
+
+static void TestBatch( csa_t *c, unsigned i_count, int i_pkt_size )
+{
+    uint8_t *p_ref = malloc( 188 * i_count );
+    uint8_t *p_bs = malloc( 188 * i_count );
+    uint8_t **pp_pkts = malloc( sizeof(*pp_pkts) * i_count );
+    assert( p_ref && p_bs && pp_pkts );
+
+    for( unsigned i = 0; i < i_count; i++ )
+        pp_pkts[i] = &p_bs[188 * i];
+
+    /* Decryption, of packets scrambled with either key or not at all */
+    RandomPackets( p_ref, i_count, true );
+    memcpy( p_bs, p_ref, 188 * i_count );
+    for( unsigned i = 0; i < i_count; i++ )
+        csa_Decrypt( c, &p_ref[188 * i], i_pkt_size );
+    csa_DecryptBatch( c, pp_pkts, i_count, i_pkt_size );
+    assert( !memcmp( p_ref, p_bs, 188 * i_count ) );
+
+    /* Encryption, and back */
+    for( int b_odd = 0; b_odd < 2; b_odd++ )
+    {
+        c->use_odd = b_odd;
+        RandomPackets( p_ref, i_count, false );
+        memcpy( p_bs, p_ref, 188 * i_count );
+        for( unsigned i = 0; i < i_count; i++ )
+            csa_Encrypt( c, &p_ref[188 * i], i_pkt_size );
+        csa_EncryptBatch( c, pp_pkts, i_count, i_pkt_size );
+        assert( !memcmp( p_ref, p_bs, 188 * i_count ) );
+
+        for( unsigned i = 0; i < i_count; i++ )
+            csa_Decrypt( c, &p_ref[188 * i], i_pkt_size );
+        csa_DecryptBatch( c, pp_pkts, i_count, i_pkt_size );
+        assert( !memcmp( p_ref, p_bs, 188 * i_count ) );
+    }
+
+    free( pp_pkts );
+    free( p_bs );
+    free( p_ref );
+}
+
+static void Bench( csa_t *c, unsigned i_batch )
+{
+    const unsigned i_count = 4096;
+    uint8_t *p_pkts = malloc( 188 * i_count );
+    uint8_t **pp_pkts = malloc( sizeof(*pp_pkts) * i_count );
+    assert( p_pkts && pp_pkts );
+
+    for( unsigned i = 0; i < i_count; i++ )
+        pp_pkts[i] = &p_pkts[188 * i];
+
+    RandomPackets( p_pkts, i_count, true );
+
+    uint64_t i_done = 0;
+    mtime_t i_start = mdate(), i_end;
+    do
+    {
+        /* full payloads, alternating keys */
+        for( unsigned i = 0; i < i_count; i++ )
+            p_pkts[188 * i + 3] = 0x90 | ( i & 1 ? 0x40 : 0x00 );
+
+        if( i_batch == 0 )
+            for( unsigned i = 0; i < i_count; i++ )
+                csa_Decrypt( c, pp_pkts[i], 188 );
+        else
+            for( unsigned i = 0; i < i_count; i += i_batch )
+                csa_DecryptBatch( c, &pp_pkts[i],
+                                  __MIN( i_batch, i_count - i ), 188 );
+        i_done += i_count;
+        i_end = mdate();
+    }
+    while( i_end - i_start < CLOCK_FREQ / 2 );
+
+    printf( "%4u packets per call: %9.0f packets/s\n", i_batch ? i_batch : 1,
+            i_done * (double)CLOCK_FREQ / ( i_end - i_start ) );
+
+    free( pp_pkts );
+    free( p_pkts );
+}
+
+int main( void )
+{
+    static const unsigned counts[] = { 1, 7, 8, 63, 64, 65, 127, 128, 129,
+                                       255, 256, 257, 1000 };
+    static const unsigned batches[] = { 0, 8, 64, 128, 256, 1024 };
+    csa_t *c = csa_New();
+    assert( c );
+
+    srand( 0 );
+    for( int i = 0; i < 8; i++ )
+    {
+        c->o_ck[i] = rand();
+        c->e_ck[i] = rand();
+    }
+    csa_ComputeKey( c->o_kk, c->o_ck );
+    csa_ComputeKey( c->e_kk, c->e_ck );
+
+    for( size_t i = 0; i < ARRAY_SIZE(counts); i++ )
+    {
+        TestBatch( c, counts[i], 188 );
+        TestBatch( c, counts[i], 184 );
+    }
+
+    for( size_t i = 0; i < ARRAY_SIZE(batches); i++ )
+        Bench( c, batches[i] );
+
+    csa_Delete( c );
+    return 0;
+}
+#endif
@@ -0,0 +1,545 @@
+/*****************************************************************************
+ * csa_bs.h: bitsliced CSA stream cypher template
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Included by csa.c, with:
+ *  - RENAME(a): the name of the functions and types,
+ *  - BS_WORD: the type holding one bit of BS_LANES packets,
+ *  - BS_AND, BS_OR, BS_XOR, BS_NOT and BS_ANDNOT(a, b) (~a & b),
+ *    BS_ZERO and BS_ONES: the operations on words,
+ *  - VLC_BS_TARGET: the attribute of the functions using them.
+ *
+ * Each register bit of csa_StreamCypher() becomes a word, where bit l of
+ * chunk m (as a uint64_t) belongs to the packet of lane 64 * m + l. The
+ * 8 bytes that go in or out of the cypher per block are 64 words, word
+ * 8 * i + k holding the bit k of byte i. */
+
+typedef union
+{
+    BS_WORD  w;
+    uint64_t q[BS_LANES / 64];
+} RENAME(csa_plane_t);
+
+typedef struct
+{
+    /* The shift registers move down the arrays: during the clock c of a
+     * block, A[k] (1 <= k <= 10) is at A[32 - c + k - 1] */
+    BS_WORD A[32 + 10][4];
+    BS_WORD B[32 + 10][4];
+
+    BS_WORD X[4], Y[4], Z[4];
+    BS_WORD D[4], E[4], F[4];
+    BS_WORD p, q, r;
+} RENAME(csa_bs_t);
+
+/* The s-boxes of csa_StreamCypher(), as boolean functions of the index bits
+ * x4 (most significant) to x0, giving the output bits o1 and o0 */
+VLC_BS_TARGET
+static inline void RENAME(sbox1)( BS_WORD x4, BS_WORD x3, BS_WORD x2,
+                                  BS_WORD x1, BS_WORD x0,
+                                  BS_WORD *p_o1, BS_WORD *p_o0 )
+{
+    BS_WORD t0, t1, t2, t3, t4, t5, t6, t7;
+    BS_WORD t8, t9, t10, t11, t12, t13, t14, t15;
+    BS_WORD t16, t17, t18, t19, t20, t21, t22, t23;
+    BS_WORD t24;
+    BS_WORD o1, o0;
+
+    t0 = BS_NOT( x0 );
+    t1 = BS_XOR( x4, t0 );
+    t2 = BS_OR( x2, t1 );
+    t3 = BS_AND( x4, t0 );
+    t4 = BS_ANDNOT( x4, t0 );
+    t5 = BS_AND( x2, t0 );
+    t6 = BS_XOR( t3, t5 );
+    t7 = BS_XOR( t2, t6 );
+    t8 = BS_AND( x1, t7 );
+    t9 = BS_XOR( t2, t8 );
+    t10 = BS_NOT( x2 );
+    t11 = BS_NOT( t1 );
+    t12 = BS_AND( x1, t11 );
+    t13 = BS_XOR( t10, t12 );
+    t14 = BS_XOR( t9, t13 );
+    t15 = BS_AND( x3, t14 );
+    o1 = BS_XOR( t9, t15 );
+    t16 = BS_AND( x4, x0 );
+    t17 = BS_AND( x2, x0 );
+    t18 = BS_XOR( t16, t17 );
+    t19 = BS_XOR( x1, t18 );
+    t20 = BS_OR( x2, t4 );
+    t21 = BS_AND( x1, t1 );
+    t22 = BS_XOR( t20, t21 );
+    t23 = BS_XOR( t19, t22 );
+    t24 = BS_AND( x3, t23 );
+    o0 = BS_XOR( t19, t24 );
+
+    *p_o1 = o1;
+    *p_o0 = o0;
+}
+
+VLC_BS_TARGET
+static inline void RENAME(sbox2)( BS_WORD x4, BS_WORD x3, BS_WORD x2,
+                                  BS_WORD x1, BS_WORD x0,
+                                  BS_WORD *p_o1, BS_WORD *p_o0 )
+{
+    BS_WORD t0, t1, t2, t3, t4, t5, t6, t7;
+    BS_WORD t8, t9, t10, t11, t12, t13, t14, t15;
+    BS_WORD t16, t17, t18, t19, t20, t21, t22, t23;
+    BS_WORD t24, t25, t26, t27;
+    BS_WORD o1, o0;
+
+    t0 = BS_NOT( x1 );
+    t1 = BS_OR( x2, t0 );
+    t2 = BS_XOR( x2, x1 );
+    t3 = BS_XOR( t1, t2 );
+    t4 = BS_AND( x0, t3 );
+    t5 = BS_XOR( t1, t4 );
+    t6 = BS_XOR( x3, t5 );
+    t7 = BS_OR( x2, x1 );
+    t8 = BS_XOR( t0, t4 );
+    t9 = BS_AND( x0, t7 );
+    t10 = BS_XOR( x2, t9 );
+    t11 = BS_XOR( t8, t10 );
+    t12 = BS_AND( x3, t11 );
+    t13 = BS_XOR( t8, t12 );
+    t14 = BS_XOR( t6, t13 );
+    t15 = BS_AND( x4, t14 );
+    o1 = BS_XOR( t6, t15 );
+    t16 = BS_NOT( t2 );
+    t17 = BS_AND( x0, x2 );
+    t18 = BS_XOR( t16, t17 );
+    t19 = BS_AND( x0, x1 );
+    t20 = BS_XOR( t16, t19 );
+    t21 = BS_XOR( t18, t20 );
+    t22 = BS_AND( x3, t21 );
+    t23 = BS_XOR( t18, t22 );
+    t24 = BS_XOR( t0, t21 );
+    t25 = BS_XOR( x3, t24 );
+    t26 = BS_XOR( t23, t25 );
+    t27 = BS_AND( x4, t26 );
+    o0 = BS_XOR( t23, t27 );
+
+    *p_o1 = o1;
+    *p_o0 = o0;
+}
+
+VLC_BS_TARGET
+static inline void RENAME(sbox3)( BS_WORD x4, BS_WORD x3, BS_WORD x2,
+                                  BS_WORD x1, BS_WORD x0,
+                                  BS_WORD *p_o1, BS_WORD *p_o0 )
+{
+    BS_WORD t0, t1, t2, t3, t4, t5, t6, t7;
+    BS_WORD t8, t9, t10, t11, t12, t13, t14, t15;
+    BS_WORD t16, t17, t18, t19, t20, t21;
+    BS_WORD o1, o0;
+
+    t0 = BS_NOT( x0 );
+    t1 = BS_OR( x2, t0 );
+    t2 = BS_XOR( x2, x0 );
+    t3 = BS_XOR( t1, t2 );
+    t4 = BS_AND( x4, t3 );
+    t5 = BS_XOR( t1, t4 );
+    t6 = BS_NOT( t3 );
+    t7 = BS_AND( x4, t1 );
+    t8 = BS_XOR( t6, t7 );
+    t9 = BS_XOR( t5, t8 );
+    t10 = BS_AND( x3, t9 );
+    t11 = BS_XOR( t5, t10 );
+    t12 = BS_AND( x4, x0 );
+    t13 = BS_XOR( t2, t12 );
+    t14 = BS_AND( x3, t12 );
+    t15 = BS_XOR( t13, t14 );
+    t16 = BS_XOR( t11, t15 );
+    t17 = BS_AND( x1, t16 );
+    o1 = BS_XOR( t11, t17 );
+    t18 = BS_AND( x2, x0 );
+    t19 = BS_XOR( x4, t18 );
+    t20 = BS_XOR( x3, t19 );
+    t21 = BS_AND( x1, t0 );
+    o0 = BS_XOR( t20, t21 );
+
+    *p_o1 = o1;
+    *p_o0 = o0;
+}
+
+VLC_BS_TARGET
+static inline void RENAME(sbox4)( BS_WORD x4, BS_WORD x3, BS_WORD x2,
+                                  BS_WORD x1, BS_WORD x0,
+                                  BS_WORD *p_o1, BS_WORD *p_o0 )
+{
+    BS_WORD t0, t1, t2, t3, t4, t5, t6, t7;
+    BS_WORD t8, t9, t10, t11, t12, t13, t14, t15;
+    BS_WORD t16, t17, t18;
+    BS_WORD o1, o0;
+
+    t0 = BS_NOT( x3 );
+    t1 = BS_NOT( x1 );
+    t2 = BS_AND( x0, t1 );
+    t3 = BS_XOR( t0, t2 );
+    t4 = BS_AND( x3, t1 );
+    t5 = BS_XOR( x0, t4 );
+    t6 = BS_XOR( t3, t5 );
+    t7 = BS_AND( x2, t6 );
+    t8 = BS_XOR( t3, t7 );
+    t9 = BS_XOR( x1, t4 );
+    t10 = BS_AND( x0, t9 );
+    t11 = BS_XOR( x1, t10 );
+    t12 = BS_AND( x2, t0 );
+    t13 = BS_XOR( t11, t12 );
+    t14 = BS_XOR( t8, t13 );
+    t15 = BS_AND( x4, t14 );
+    o1 = BS_XOR( t8, t15 );
+    t16 = BS_NOT( t13 );
+    t17 = BS_XOR( t16, t8 );
+    t18 = BS_AND( x4, t17 );
+    o0 = BS_XOR( t16, t18 );
+
+    *p_o1 = o1;
+    *p_o0 = o0;
+}
+
+VLC_BS_TARGET
+static inline void RENAME(sbox5)( BS_WORD x4, BS_WORD x3, BS_WORD x2,
+                                  BS_WORD x1, BS_WORD x0,
+                                  BS_WORD *p_o1, BS_WORD *p_o0 )
+{
+    BS_WORD t0, t1, t2, t3, t4, t5, t6, t7;
+    BS_WORD t8, t9, t10, t11, t12, t13, t14, t15;
+    BS_WORD t16, t17, t18, t19, t20, t21, t22, t23;
+    BS_WORD t24, t25, t26, t27, t28, t29, t30;
+    BS_WORD o1, o0;
+
+    t0 = BS_NOT( x3 );
+    t1 = BS_XOR( x2, t0 );
+    t2 = BS_AND( x4, x2 );
+    t3 = BS_XOR( t0, t2 );
+    t4 = BS_OR( x2, x3 );
+    t5 = BS_NOT( x2 );
+    t6 = BS_XOR( t4, t5 );
+    t7 = BS_AND( x4, t6 );
+    t8 = BS_XOR( t4, t7 );
+    t9 = BS_XOR( t3, t8 );
+    t10 = BS_AND( x1, t9 );
+    t11 = BS_XOR( t3, t10 );
+    t12 = BS_NOT( t9 );
+    t13 = BS_NOT( t1 );
+    t14 = BS_XOR( t13, t2 );
+    t15 = BS_XOR( t12, t14 );
+    t16 = BS_AND( x1, t15 );
+    t17 = BS_XOR( t12, t16 );
+    t18 = BS_XOR( t11, t17 );
+    t19 = BS_AND( x0, t18 );
+    o1 = BS_XOR( t11, t19 );
+    t20 = BS_AND( x4, t13 );
+    t21 = BS_XOR( x2, t20 );
+    t22 = BS_XOR( t21, t13 );
+    t23 = BS_AND( x1, t22 );
+    t24 = BS_XOR( t21, t23 );
+    t25 = BS_NOT( t6 );
+    t26 = BS_XOR( x4, t25 );
+    t27 = BS_AND( x1, t1 );
+    t28 = BS_XOR( t26, t27 );
+    t29 = BS_XOR( t24, t28 );
+    t30 = BS_AND( x0, t29 );
+    o0 = BS_XOR( t24, t30 );
+
+    *p_o1 = o1;
+    *p_o0 = o0;
+}
+
+VLC_BS_TARGET
+static inline void RENAME(sbox6)( BS_WORD x4, BS_WORD x3, BS_WORD x2,
+                                  BS_WORD x1, BS_WORD x0,
+                                  BS_WORD *p_o1, BS_WORD *p_o0 )
+{
+    BS_WORD t0, t1, t2, t3, t4, t5, t6, t7;
+    BS_WORD t8, t9, t10, t11, t12, t13, t14, t15;
+    BS_WORD t16, t17, t18, t19, t20, t21, t22, t23;
+    BS_WORD t24, t25;
+    BS_WORD o1, o0;
+
+    t0 = BS_XOR( x4, x1 );
+    t1 = BS_XOR( x3, x1 );
+    t2 = BS_NOT( t1 );
+    t3 = BS_AND( x2, x3 );
+    t4 = BS_XOR( t0, t3 );
+    t5 = BS_ANDNOT( x3, x1 );
+    t6 = BS_AND( x4, t2 );
+    t7 = BS_XOR( t5, t6 );
+    t8 = BS_XOR( x2, t7 );
+    t9 = BS_XOR( t4, t8 );
+    t10 = BS_AND( x0, t9 );
+    o1 = BS_XOR( t4, t10 );
+    t11 = BS_AND( x3, x1 );
+    t12 = BS_AND( x4, t5 );
+    t13 = BS_XOR( t2, t12 );
+    t14 = BS_XOR( t11, t13 );
+    t15 = BS_AND( x2, t14 );
+    t16 = BS_XOR( t11, t15 );
+    t17 = BS_NOT( t11 );
+    t18 = BS_XOR( t17, t12 );
+    t19 = BS_AND( x4, x1 );
+    t20 = BS_XOR( x3, t19 );
+    t21 = BS_XOR( t18, t20 );
+    t22 = BS_AND( x2, t21 );
+    t23 = BS_XOR( t18, t22 );
+    t24 = BS_XOR( t16, t23 );
+    t25 = BS_AND( x0, t24 );
+    o0 = BS_XOR( t16, t25 );
+
+    *p_o1 = o1;
+    *p_o0 = o0;
+}
+
+VLC_BS_TARGET
+static inline void RENAME(sbox7)( BS_WORD x4, BS_WORD x3, BS_WORD x2,
+                                  BS_WORD x1, BS_WORD x0,
+                                  BS_WORD *p_o1, BS_WORD *p_o0 )
+{
+    BS_WORD t0, t1, t2, t3, t4, t5, t6, t7;
+    BS_WORD t8, t9, t10, t11, t12, t13, t14, t15;
+    BS_WORD t16, t17, t18, t19, t20, t21, t22, t23;
+    BS_WORD t24;
+    BS_WORD o1, o0;
+
+    t0 = BS_NOT( x3 );
+    t1 = BS_XOR( x0, x3 );
+    t2 = BS_NOT( t1 );
+    t3 = BS_XOR( x2, t1 );
+    t4 = BS_XOR( t3, x3 );
+    t5 = BS_AND( x4, t4 );
+    t6 = BS_XOR( t3, t5 );
+    t7 = BS_OR( x0, t0 );
+    t8 = BS_XOR( x2, t7 );
+    t9 = BS_AND( x2, t2 );
+    t10 = BS_XOR( t0, t9 );
+    t11 = BS_XOR( t8, t10 );
+    t12 = BS_AND( x4, t11 );
+    t13 = BS_XOR( t8, t12 );
+    t14 = BS_XOR( t6, t13 );
+    t15 = BS_AND( x1, t14 );
+    o1 = BS_XOR( t6, t15 );
+    t16 = BS_AND( x2, t0 );
+    t17 = BS_XOR( t1, t16 );
+    t18 = BS_XOR( x4, t17 );
+    t19 = BS_AND( x2, t1 );
+    t20 = BS_XOR( x3, t19 );
+    t21 = BS_AND( x4, t7 );
+    t22 = BS_XOR( t20, t21 );
+    t23 = BS_XOR( t18, t22 );
+    t24 = BS_AND( x1, t23 );
+    o0 = BS_XOR( t18, t24 );
+
+    *p_o1 = o1;
+    *p_o0 = o0;
+}
+VLC_BS_TARGET
+static void RENAME(csa_StreamInit)( RENAME(csa_bs_t) *st, BS_WORD odd,
+                                    const uint8_t o_ck[8],
+                                    const uint8_t e_ck[8] )
+{
+    const BS_WORD even = BS_ANDNOT( odd, BS_ONES );
+
+    for( int i = 0; i < 8; i++ )
+    {
+        /* A[1..8] from the first 32 bits, B[1..8] from the last ones */
+        for( int k = 0; k < 4; k++ )
+        {
+            const int shift = 4 * (1 - (i & 1)) + k;
+
+            st->A[32 + i][k] = BS_OR(
+                ( o_ck[i / 2] >> shift ) & 1 ? odd : BS_ZERO,
+                ( e_ck[i / 2] >> shift ) & 1 ? even : BS_ZERO );
+            st->B[32 + i][k] = BS_OR(
+                ( o_ck[4 + i / 2] >> shift ) & 1 ? odd : BS_ZERO,
+                ( e_ck[4 + i / 2] >> shift ) & 1 ? even : BS_ZERO );
+        }
+    }
+
+    for( int k = 0; k < 4; k++ )
+    {
+        st->A[32 + 8][k] = st->A[32 + 9][k] = BS_ZERO;
+        st->B[32 + 8][k] = st->B[32 + 9][k] = BS_ZERO;
+        st->X[k] = st->Y[k] = st->Z[k] = BS_ZERO;
+        st->D[k] = st->E[k] = st->F[k] = BS_ZERO;
+    }
+    st->p = st->q = st->r = BS_ZERO;
+}
+
+/* One block of the stream cypher: with in (initialisation), the input bytes
+ * are cyphered in, otherwise the output bytes are written to out */
+VLC_BS_TARGET
+static void RENAME(csa_StreamBlock)( RENAME(csa_bs_t) *st,
+                                     const RENAME(csa_plane_t) *in,
+                                     RENAME(csa_plane_t) *out )
+{
+    for( int i = 0; i < 8; i++ )
+    {
+        for( int j = 0; j < 4; j++ )
+        {
+            const int b = 32 - 4 * i - j;
+#define A(k, bit) st->A[b + (k) - 1][bit]
+#define B(k, bit) st->B[b + (k) - 1][bit]
+            BS_WORD s1_1, s1_0, s2_1, s2_0, s3_1, s3_0, s4_1, s4_0;
+            BS_WORD s5_1, s5_0, s6_1, s6_0, s7_1, s7_0;
+            BS_WORD extra_B[4], next_A1[4], next_B1[4], D[4], F[4];
+
+            RENAME(sbox1)( A(4,0), A(1,2), A(6,1), A(7,3), A(9,0), &s1_1, &s1_0 );
+            RENAME(sbox2)( A(2,1), A(3,2), A(6,3), A(7,0), A(9,1), &s2_1, &s2_0 );
+            RENAME(sbox3)( A(1,3), A(2,0), A(5,1), A(5,3), A(6,2), &s3_1, &s3_0 );
+            RENAME(sbox4)( A(3,3), A(1,1), A(2,3), A(4,2), A(8,0), &s4_1, &s4_0 );
+            RENAME(sbox5)( A(5,2), A(4,3), A(6,0), A(8,1), A(9,2), &s5_1, &s5_0 );
+            RENAME(sbox6)( A(3,1), A(4,1), A(5,0), A(7,2), A(9,3), &s6_1, &s6_0 );
+            RENAME(sbox7)( A(2,2), A(3,0), A(7,1), A(8,2), A(8,3), &s7_1, &s7_0 );
+
+            extra_B[3] = BS_XOR( BS_XOR( B(3,0), B(6,1) ), BS_XOR( B(7,2), B(9,3) ) );
+            extra_B[2] = BS_XOR( BS_XOR( B(6,0), B(8,1) ), BS_XOR( B(3,3), B(4,2) ) );
+            extra_B[1] = BS_XOR( BS_XOR( B(5,3), B(8,2) ), BS_XOR( B(4,0), B(5,1) ) );
+            extra_B[0] = BS_XOR( BS_XOR( B(9,2), B(6,3) ), BS_XOR( B(3,1), B(8,0) ) );
+
+            for( int k = 0; k < 4; k++ )
+            {
+                next_A1[k] = BS_XOR( A(10,k), st->X[k] );
+                next_B1[k] = BS_XOR( BS_XOR( B(7,k), B(10,k) ), st->Y[k] );
+                if( in )
+                {
+                    /* in1 is the high nibble of the byte, in2 the low one */
+                    const BS_WORD in1 = in[8 * i + 4 + k].w;
+                    const BS_WORD in2 = in[8 * i + k].w;
+
+                    next_A1[k] = BS_XOR( BS_XOR( next_A1[k], st->D[k] ),
+                                         (j % 2) ? in2 : in1 );
+                    next_B1[k] = BS_XOR( next_B1[k], (j % 2) ? in1 : in2 );
+                }
+            }
+
+            /* shift the registers, rotating next_B1 left if p=1 */
+            for( int k = 0; k < 4; k++ )
+                A(0,k) = next_A1[k];
+            for( int k = 0; k < 4; k++ )
+                B(0,k) = BS_XOR( next_B1[k],
+                                 BS_AND( st->p, BS_XOR( next_B1[k],
+                                                        next_B1[(k + 3) % 4] ) ) );
+
+            for( int k = 0; k < 4; k++ )
+                D[k] = BS_XOR( BS_XOR( st->E[k], st->Z[k] ), extra_B[k] );
+
+            /* if q=1, F = Z + E + r and r is the carry, otherwise F = E */
+            BS_WORD carry = st->r;
+            for( int k = 0; k < 4; k++ )
+            {
+                const BS_WORD ze = BS_XOR( st->Z[k], st->E[k] );
+                const BS_WORD sum = BS_XOR( ze, carry );
+
+                carry = BS_OR( BS_AND( st->Z[k], st->E[k] ), BS_AND( carry, ze ) );
+                F[k] = BS_XOR( st->E[k],
+                               BS_AND( st->q, BS_XOR( sum, st->E[k] ) ) );
+            }
+            st->r = BS_XOR( st->r, BS_AND( st->q, BS_XOR( carry, st->r ) ) );
+
+            for( int k = 0; k < 4; k++ )
+            {
+                st->E[k] = st->F[k];
+                st->F[k] = F[k];
+                st->D[k] = D[k];
+            }
+
+            st->X[3] = s4_0; st->X[2] = s3_0; st->X[1] = s2_1; st->X[0] = s1_1;
+            st->Y[3] = s6_0; st->Y[2] = s5_0; st->Y[1] = s4_1; st->Y[0] = s3_1;
+            st->Z[3] = s2_0; st->Z[2] = s1_0; st->Z[1] = s6_1; st->Z[0] = s5_1;
+            st->p = s7_1;
+            st->q = s7_0;
+
+            /* 2 output bits are a function of the 4 bits of D */
+            if( !in )
+            {
+                out[8 * i + 7 - 2 * j].w = BS_XOR( D[2], D[3] );
+                out[8 * i + 6 - 2 * j].w = BS_XOR( D[0], D[1] );
+            }
+#undef B
+#undef A
+        }
+    }
+
+    /* Move the registers back up for the next block */
+    memcpy( &st->A[32], &st->A[0], sizeof(st->A[0]) * 10 );
+    memcpy( &st->B[32], &st->B[0], sizeof(st->B[0]) * 10 );
+}
+
+/* Runs the stream cypher of up to BS_LANES packets at once, initialised with
+ * the first block of their payload, and hands the output blocks to
+ * csa_StreamLane() */
+VLC_BS_TARGET
+static void RENAME(csa_StreamLanes)( const csa_t *c, csa_lane_t *p_lanes,
+                                     unsigned i_lanes, bool b_encrypt )
+{
+    RENAME(csa_bs_t) st;
+    RENAME(csa_plane_t) planes[64], odd;
+    uint64_t rows[64];
+    int i_blocks = 0;
+
+    assert( i_lanes <= BS_LANES );
+
+    for( unsigned m = 0; m < BS_LANES / 64; m++ )
+    {
+        odd.q[m] = 0;
+        for( unsigned l = 0; l < 64; l++ )
+        {
+            const csa_lane_t *p_lane = &p_lanes[64 * m + l];
+
+            if( 64 * m + l >= i_lanes )
+            {
+                rows[l] = 0;
+                continue;
+            }
+            rows[l] = GetQWLE( &p_lane->pkt[p_lane->i_hdr] );
+            if( p_lane->b_odd )
+                odd.q[m] |= UINT64_C(1) << l;
+            i_blocks = __MAX( i_blocks, p_lane->i_blocks );
+        }
+        csa_Transpose( rows );
+        for( unsigned k = 0; k < 64; k++ )
+            planes[k].q[m] = rows[k];
+    }
+
+    RENAME(csa_StreamInit)( &st, odd.w, c->o_ck, c->e_ck );
+    RENAME(csa_StreamBlock)( &st, planes, NULL );
+
+    for( int g = 1; g <= i_blocks; g++ )
+    {
+        RENAME(csa_StreamBlock)( &st, NULL, planes );
+
+        for( unsigned m = 0; m < BS_LANES / 64 && 64 * m < i_lanes; m++ )
+        {
+            uint8_t stream[8];
+
+            for( unsigned k = 0; k < 64; k++ )
+                rows[k] = planes[k].q[m];
+            csa_Transpose( rows );
+            for( unsigned l = 0; l < 64 && 64 * m + l < i_lanes; l++ )
+            {
+                SetQWLE( stream, rows[l] );
+                csa_StreamLane( &p_lanes[64 * m + l], g, stream );
+            }
+        }
+    }
+
+    for( unsigned l = 0; l < i_lanes; l++ )
+        csa_FinishLane( &p_lanes[l], b_encrypt );
+}
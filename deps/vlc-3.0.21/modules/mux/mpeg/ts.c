@@ -1787,6 +1787,31 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         i_pcr_length = i_packet_count;
     }
 
+    /* Scramble the whole chain at once. The adaptation field, where
+     * TSSetPCR() writes below, is left in clear */
+    if( p_sys->csa )
+    {
+        uint8_t *pp_scrambled[256];
+        unsigned i_scrambled = 0;
+
+        vlc_mutex_lock( &p_sys->csa_lock );
+        for( block_t *p_ts = p_chain_ts->p_first; p_ts; p_ts = p_ts->p_next )
+        {
+            if( !(p_ts->i_flags & BLOCK_FLAG_SCRAMBLED) )
+                continue;
+            pp_scrambled[i_scrambled++] = p_ts->p_buffer;
+            if( i_scrambled == ARRAY_SIZE(pp_scrambled) )
+            {
+                csa_EncryptBatch( p_sys->csa, pp_scrambled, i_scrambled,
+                                  p_sys->i_csa_pkt_size );
+                i_scrambled = 0;
+            }
+        }
+        csa_EncryptBatch( p_sys->csa, pp_scrambled, i_scrambled,
+                          p_sys->i_csa_pkt_size );
+        vlc_mutex_unlock( &p_sys->csa_lock );
+    }
+
     /* msg_Dbg( p_mux, "real pck=%d", i_packet_count ); */
     for (int i = 0; i < i_packet_count; i++ )
     {
@@ -1801,13 +1826,6 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
             /* msg_Dbg( p_mux, "pcr=%lld ms", p_ts->i_dts / 1000 ); */
             TSSetPCR( p_ts, p_ts->i_dts - p_sys->first_dts );
         }
-        if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
-        {
-            vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
-            vlc_mutex_unlock( &p_sys->csa_lock );
-        }
-
         /* latency */
         p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
 
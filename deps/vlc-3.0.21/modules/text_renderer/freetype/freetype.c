@@ -42,6 +42,7 @@
 #include <vlc_subpicture.h>
 #include <vlc_text_style.h>                                   /* text_style_t*/
 #include <vlc_charset.h>
+#include <vlc_memstream.h>
 
 /* apple stuff */
 #ifdef __APPLE__
@@ -70,6 +71,7 @@
 #include "platform_fonts.h"
 #include "freetype.h"
 #include "text_layout.h"
+#include "glyph_cache.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -125,6 +127,10 @@ static const char *const ppsz_sizes_text[] = {
 #define YUVP_TEXT N_("Use YUVP renderer")
 #define YUVP_LONGTEXT N_("This renders the font using \"paletized YUV\". " \
   "This option is only needed if you want to encode into DVB subtitles" )
+#define CACHE_SIZE_TEXT N_("Glyph cache size (kB)")
+#define CACHE_SIZE_LONGTEXT N_("Memory used to keep the rendered glyphs " \
+  "and the laid out text, so that redrawn text is not rendered again. " \
+  "0 disables the cache." )
 
 static const int pi_color_values[] = {
   0x00000000, 0x00808080, 0x00C0C0C0, 0x00FFFFFF, 0x00800000,
@@ -233,6 +239,9 @@ vlc_module_begin ()
     add_bool( "freetype-yuvp", false, YUVP_TEXT,
               YUVP_LONGTEXT, true )
 
+    add_integer_with_range( "freetype-cache-size", 4096, 0, 262144,
+                            CACHE_SIZE_TEXT, CACHE_SIZE_LONGTEXT, true )
+
 #ifdef HAVE_FRIBIDI
     add_integer_with_range( "freetype-text-direction", 0, 0, 2, TEXT_DIRECTION_TEXT,
                             TEXT_DIRECTION_LONGTEXT, false )
@@ -1162,6 +1171,135 @@ static uni_char_t* SegmentsToTextAndStyles( filter_t *p_filter, const text_segme
  * needed glyphs into memory. It is used as pf_add_string callback in
  * the vout method by this module
  */
+/*****************************************************************************
+ * Layout cache
+ *****************************************************************************/
+typedef struct
+{
+    line_desc_t   *p_lines;
+    text_style_t **pp_styles;   /* referenced by the lines */
+    size_t         i_styles;
+    FT_BBox        bbox;
+    int            i_max_face_height;
+} cached_layout_t;
+
+static void ReleaseCachedLayout( void *p_data )
+{
+    cached_layout_t *p_layout = p_data;
+
+    FreeLines( p_layout->p_lines );
+    FreeStylesArray( p_layout->pp_styles, p_layout->i_styles );
+    free( p_layout );
+}
+
+static void WriteLayoutKeyString( struct vlc_memstream *p_key, const char *psz )
+{
+    size_t i_len = psz ? strlen( psz ) + 1 : 0;
+    vlc_memstream_write( p_key, &i_len, sizeof( i_len ) );
+    vlc_memstream_write( p_key, psz, i_len );
+}
+
+static void WriteLayoutKeyStyle( struct vlc_memstream *p_key,
+                                 const text_style_t *p_style )
+{
+#define WRITE( field ) \
+    vlc_memstream_write( p_key, &p_style->field, sizeof( p_style->field ) )
+    WriteLayoutKeyString( p_key, p_style->psz_fontname );
+    WriteLayoutKeyString( p_key, p_style->psz_monofontname );
+    WRITE( i_features );
+    WRITE( i_style_flags );
+    WRITE( f_font_relsize );
+    WRITE( i_font_size );
+    WRITE( i_font_color );
+    WRITE( i_font_alpha );
+    WRITE( i_spacing );
+    WRITE( i_outline_color );
+    WRITE( i_outline_alpha );
+    WRITE( i_outline_width );
+    WRITE( i_shadow_color );
+    WRITE( i_shadow_alpha );
+    WRITE( i_shadow_width );
+    WRITE( i_background_color );
+    WRITE( i_background_alpha );
+    WRITE( i_karaoke_background_color );
+    WRITE( i_karaoke_background_alpha );
+    WRITE( e_wrapinfo );
+#undef WRITE
+}
+
+/**
+ * Serializes everything the layout of a text depends on.
+ */
+static int GetLayoutKey( filter_t *p_filter, struct vlc_memstream *p_key,
+                         const uni_char_t *psz_text, size_t i_text_length,
+                         text_style_t *const *pp_styles,
+                         bool b_grid, bool b_balance,
+                         unsigned i_max_width, unsigned i_max_height )
+{
+    const int pi_params[] = {
+        p_filter->p_sys->i_scale,
+        p_filter->fmt_out.video.i_height,
+        i_max_width,
+        i_max_height,
+        b_grid,
+        b_balance,
+        var_InheritInteger( p_filter, "freetype-outline-thickness" ),
+#ifdef HAVE_FRIBIDI
+        var_InheritInteger( p_filter, "freetype-text-direction" ),
+#endif
+    };
+
+    if( vlc_memstream_open( p_key ) )
+    {
+        p_key->ptr = NULL;
+        return VLC_ENOMEM;
+    }
+
+    vlc_memstream_write( p_key, pi_params, sizeof( pi_params ) );
+    vlc_memstream_write( p_key, &i_text_length, sizeof( i_text_length ) );
+    vlc_memstream_write( p_key, psz_text, i_text_length * sizeof( *psz_text ) );
+
+    for( size_t i = 0; i < i_text_length; )
+    {
+        size_t i_run = 1;
+        while( i + i_run < i_text_length && pp_styles[i + i_run] == pp_styles[i] )
+            i_run++;
+
+        vlc_memstream_write( p_key, &i_run, sizeof( i_run ) );
+        WriteLayoutKeyStyle( p_key, pp_styles[i] );
+        i += i_run;
+    }
+
+    if( vlc_memstream_close( p_key ) )
+    {
+        p_key->ptr = NULL;
+        return VLC_ENOMEM;
+    }
+    return VLC_SUCCESS;
+}
+
+static size_t GetLayoutSize( const line_desc_t *p_lines, size_t i_styles )
+{
+    size_t i_size = sizeof( cached_layout_t ) + i_styles * sizeof( text_style_t * );
+
+    for( const line_desc_t *p_line = p_lines; p_line != NULL; p_line = p_line->p_next )
+    {
+        i_size += sizeof( *p_line )
+                + p_line->i_character_count * sizeof( *p_line->p_character );
+
+        for( int i = 0; i < p_line->i_character_count; i++ )
+        {
+            const line_character_t *ch = &p_line->p_character[i];
+            i_size += GlyphCacheSizeOf( (FT_Glyph)ch->p_glyph );
+            if( ch->p_outline )
+                i_size += GlyphCacheSizeOf( (FT_Glyph)ch->p_outline );
+            if( ch->p_shadow && ch->p_shadow != ch->p_glyph )
+                i_size += GlyphCacheSizeOf( (FT_Glyph)ch->p_shadow );
+        }
+    }
+    return i_size;
+}
+
 static int Render( filter_t *p_filter, subpicture_region_t *p_region_out,
                          subpicture_region_t *p_region_in,
                          const vlc_fourcc_t *p_chroma_list )
@@ -1214,10 +1352,51 @@ static int Render( filter_t *p_filter, subpicture_region_t *p_region_out,
     else if( p_region_in->i_y > 0 && (unsigned)p_region_in->i_y < i_max_height )
         i_max_height -= p_region_in->i_y;
 
-    rv = LayoutText( p_filter,
-                     psz_text, pp_styles, pi_k_durations, i_text_length,
-                     p_region_in->b_gridmode, p_region_in->b_balanced_text,
-                     i_max_width, i_max_height, &p_lines, &bbox, &i_max_face_height );
+    /* Identical text with identical styles is laid out identically: reuse
+     * the lines from the cache, which owns them and the styles they use */
+    struct vlc_memstream key = { .ptr = NULL };
+    cached_layout_t *p_layout = NULL;
+    if( p_sys->p_cache && !pi_k_durations
+     && GetLayoutKey( p_filter, &key, psz_text, i_text_length, pp_styles,
+                      p_region_in->b_gridmode, p_region_in->b_balanced_text,
+                      i_max_width, i_max_height ) == VLC_SUCCESS )
+        p_layout = GlyphCacheGet( p_sys->p_cache, GLYPH_CACHE_LAYOUT,
+                                  key.ptr, key.length );
+
+    if( p_layout )
+    {
+        p_lines = p_layout->p_lines;
+        bbox = p_layout->bbox;
+        i_max_face_height = p_layout->i_max_face_height;
+    }
+    else
+    {
+        rv = LayoutText( p_filter,
+                         psz_text, pp_styles, pi_k_durations, i_text_length,
+                         p_region_in->b_gridmode, p_region_in->b_balanced_text,
+                         i_max_width, i_max_height, &p_lines, &bbox, &i_max_face_height );
+
+        if( !rv && key.ptr && ( p_layout = malloc( sizeof( *p_layout ) ) ) )
+        {
+            p_layout->p_lines = p_lines;
+            p_layout->pp_styles = pp_styles;
+            p_layout->i_styles = i_styles;
+            p_layout->bbox = bbox;
+            p_layout->i_max_face_height = i_max_face_height;
+
+            if( GlyphCachePut( p_sys->p_cache, GLYPH_CACHE_LAYOUT,
+                               key.ptr, key.length, p_layout,
+                               GetLayoutSize( p_lines, i_styles ),
+                               ReleaseCachedLayout ) )
+            {
+                free( p_layout );
+                p_layout = NULL;
+            }
+            else
+                pp_styles = NULL; /* owned by the cache */
+        }
+    }
+    free( key.ptr );
 
     uint8_t i_background_opacity = var_InheritInteger( p_filter, "freetype-background-opacity" );
     i_background_opacity = VLC_CLIP( i_background_opacity, 0, 255 );
@@ -1351,10 +1530,12 @@ static int Render( filter_t *p_filter, subpicture_region_t *p_region_out,
             var_SetBool( p_filter, "text-rerender", true );
     }
 
-    FreeLines( p_lines );
+    if( !p_layout )
+        FreeLines( p_lines );
 
     free( psz_text );
-    FreeStylesArray( pp_styles, i_styles );
+    if( pp_styles )
+        FreeStylesArray( pp_styles, i_styles );
     free( pi_k_durations );
 
     return rv;
@@ -1416,6 +1597,10 @@ static int Create( vlc_object_t *p_this )
     /* fills default and forced style */
     FillDefaultStyles( p_filter );
 
+    int64_t i_cache_size = var_InheritInteger( p_filter, "freetype-cache-size" );
+    if( i_cache_size > 0 )
+        p_sys->p_cache = GlyphCacheNew( i_cache_size * 1024 );
+
     /*
      * The following variables should not be cached, as they might be changed on-the-fly:
      * freetype-rel-fontsize, freetype-background-opacity, freetype-background-color,
@@ -1525,6 +1710,10 @@ static void Destroy( vlc_object_t *p_this )
     text_style_Delete( p_sys->p_default_style );
     text_style_Delete( p_sys->p_forced_style );
 
+    /* Cached glyphs and lines reference the faces */
+    if( p_sys->p_cache )
+        GlyphCacheDelete( p_this, p_sys->p_cache );
+
     /* Fonts dicts */
     vlc_dictionary_clear( &p_sys->fallback_map, FreeFamilies, p_filter );
     vlc_dictionary_clear( &p_sys->face_map, FreeFace, p_filter );
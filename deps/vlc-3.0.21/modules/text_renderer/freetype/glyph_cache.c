@@ -0,0 +1,273 @@
+/*****************************************************************************
+ * glyph_cache.c : Cache of glyphs and laid out text
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+
+#include "glyph_cache.h"
+
+#define GLYPH_CACHE_MIN_BUCKETS 256
+
+typedef struct glyph_cache_entry_t glyph_cache_entry_t;
+struct glyph_cache_entry_t
+{
+    glyph_cache_entry_t *p_hash_next;
+
+    /* Least recently used list, most recent first */
+    glyph_cache_entry_t *p_prev;
+    glyph_cache_entry_t *p_next;
+
+    uint32_t             i_hash;
+    int                  i_kind;
+    void                *p_value;
+    size_t               i_size;
+    void               (*pf_release)( void * );
+
+    size_t               i_key;
+    unsigned char        key[];
+};
+
+struct glyph_cache_t
+{
+    glyph_cache_entry_t **pp_buckets;
+    size_t                i_buckets;
+    size_t                i_entries;
+
+    glyph_cache_entry_t  *p_first;
+    glyph_cache_entry_t  *p_last;
+
+    size_t                i_size;
+    size_t                i_max_size;
+
+    struct
+    {
+        uint64_t i_hits;
+        uint64_t i_misses;
+        uint64_t i_evictions;
+    } stats[GLYPH_CACHE_KINDS];
+};
+
+static uint32_t Hash( int i_kind, const void *p_key, size_t i_key )
+{
+    /* FNV-1a */
+    const unsigned char *p = p_key;
+    uint32_t i_hash = 2166136261u ^ i_kind;
+
+    for( size_t i = 0; i < i_key; i++ )
+        i_hash = ( i_hash ^ p[i] ) * 16777619u;
+    return i_hash;
+}
+
+static void Unlink( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    if( p_entry->p_prev )
+        p_entry->p_prev->p_next = p_entry->p_next;
+    else
+        p_cache->p_first = p_entry->p_next;
+
+    if( p_entry->p_next )
+        p_entry->p_next->p_prev = p_entry->p_prev;
+    else
+        p_cache->p_last = p_entry->p_prev;
+}
+
+static void LinkFirst( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    p_entry->p_prev = NULL;
+    p_entry->p_next = p_cache->p_first;
+    if( p_cache->p_first )
+        p_cache->p_first->p_prev = p_entry;
+    else
+        p_cache->p_last = p_entry;
+    p_cache->p_first = p_entry;
+}
+
+static void Evict( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    glyph_cache_entry_t **pp = &p_cache->pp_buckets[p_entry->i_hash
+                                                    & (p_cache->i_buckets - 1)];
+    while( *pp != p_entry )
+        pp = &(*pp)->p_hash_next;
+    *pp = p_entry->p_hash_next;
+
+    Unlink( p_cache, p_entry );
+    p_cache->i_entries--;
+    p_cache->i_size -= p_entry->i_size;
+
+    p_entry->pf_release( p_entry->p_value );
+    free( p_entry );
+}
+
+static void Grow( glyph_cache_t *p_cache )
+{
+    size_t i_buckets = p_cache->i_buckets * 2;
+    glyph_cache_entry_t **pp_buckets = calloc( i_buckets, sizeof(*pp_buckets) );
+    if( !pp_buckets )
+        return; /* keep the longer chains */
+
+    for( size_t i = 0; i < p_cache->i_buckets; i++ )
+    {
+        glyph_cache_entry_t *p_entry = p_cache->pp_buckets[i];
+        while( p_entry )
+        {
+            glyph_cache_entry_t *p_next = p_entry->p_hash_next;
+            glyph_cache_entry_t **pp = &pp_buckets[p_entry->i_hash & (i_buckets - 1)];
+            p_entry->p_hash_next = *pp;
+            *pp = p_entry;
+            p_entry = p_next;
+        }
+    }
+
+    free( p_cache->pp_buckets );
+    p_cache->pp_buckets = pp_buckets;
+    p_cache->i_buckets = i_buckets;
+}
+
+glyph_cache_t *GlyphCacheNew( size_t i_max_size )
+{
+    glyph_cache_t *p_cache = calloc( 1, sizeof(*p_cache) );
+    if( !p_cache )
+        return NULL;
+
+    p_cache->i_buckets = GLYPH_CACHE_MIN_BUCKETS;
+    p_cache->pp_buckets = calloc( p_cache->i_buckets, sizeof(*p_cache->pp_buckets) );
+    if( !p_cache->pp_buckets )
+    {
+        free( p_cache );
+        return NULL;
+    }
+    p_cache->i_max_size = i_max_size;
+    return p_cache;
+}
+
+void GlyphCacheDelete( vlc_object_t *p_obj, glyph_cache_t *p_cache )
+{
+    static const char *const ppsz_kinds[GLYPH_CACHE_KINDS] = {
+        [GLYPH_CACHE_OUTLINE] = "outline",
+        [GLYPH_CACHE_BITMAP]  = "bitmap",
+        [GLYPH_CACHE_LAYOUT]  = "layout",
+    };
+
+    for( int i = 0; i < GLYPH_CACHE_KINDS; i++ )
+    {
+        uint64_t i_total = p_cache->stats[i].i_hits + p_cache->stats[i].i_misses;
+        if( i_total == 0 )
+            continue;
+        msg_Dbg( p_obj, "%s cache: %"PRIu64" hits, %"PRIu64" misses (%.1f%%), "
+                 "%"PRIu64" evictions", ppsz_kinds[i],
+                 p_cache->stats[i].i_hits, p_cache->stats[i].i_misses,
+                 100. * p_cache->stats[i].i_hits / i_total,
+                 p_cache->stats[i].i_evictions );
+    }
+
+    while( p_cache->p_last )
+        Evict( p_cache, p_cache->p_last );
+
+    free( p_cache->pp_buckets );
+    free( p_cache );
+}
+
+void *GlyphCacheGet( glyph_cache_t *p_cache, int i_kind,
+                     const void *p_key, size_t i_key )
+{
+    uint32_t i_hash = Hash( i_kind, p_key, i_key );
+
+    for( glyph_cache_entry_t *p_entry =
+            p_cache->pp_buckets[i_hash & (p_cache->i_buckets - 1)];
+         p_entry != NULL; p_entry = p_entry->p_hash_next )
+    {
+        if( p_entry->i_hash == i_hash && p_entry->i_kind == i_kind
+         && p_entry->i_key == i_key && !memcmp( p_entry->key, p_key, i_key ) )
+        {
+            if( p_cache->p_first != p_entry )
+            {
+                Unlink( p_cache, p_entry );
+                LinkFirst( p_cache, p_entry );
+            }
+            p_cache->stats[i_kind].i_hits++;
+            return p_entry->p_value;
+        }
+    }
+
+    p_cache->stats[i_kind].i_misses++;
+    return NULL;
+}
+
+int GlyphCachePut( glyph_cache_t *p_cache, int i_kind,
+                   const void *p_key, size_t i_key,
+                   void *p_value, size_t i_size,
+                   void (*pf_release)( void * ) )
+{
+    i_size += sizeof(glyph_cache_entry_t) + i_key;
+    if( i_size > p_cache->i_max_size )
+        return VLC_EGENERIC;
+
+    glyph_cache_entry_t *p_entry = malloc( sizeof(*p_entry) + i_key );
+    if( !p_entry )
+        return VLC_ENOMEM;
+
+    while( p_cache->i_size + i_size > p_cache->i_max_size )
+    {
+        p_cache->stats[p_cache->p_last->i_kind].i_evictions++;
+        Evict( p_cache, p_cache->p_last );
+    }
+
+    if( p_cache->i_entries >= p_cache->i_buckets * 2 )
+        Grow( p_cache );
+
+    p_entry->i_hash = Hash( i_kind, p_key, i_key );
+    p_entry->i_kind = i_kind;
+    p_entry->p_value = p_value;
+    p_entry->i_size = i_size;
+    p_entry->pf_release = pf_release;
+    p_entry->i_key = i_key;
+    memcpy( p_entry->key, p_key, i_key );
+
+    glyph_cache_entry_t **pp = &p_cache->pp_buckets[p_entry->i_hash
+                                                    & (p_cache->i_buckets - 1)];
+    p_entry->p_hash_next = *pp;
+    *pp = p_entry;
+    LinkFirst( p_cache, p_entry );
+
+    p_cache->i_entries++;
+    p_cache->i_size += i_size;
+    return VLC_SUCCESS;
+}
+
+size_t GlyphCacheSizeOf( FT_Glyph p_glyph )
+{
+    if( p_glyph->format == FT_GLYPH_FORMAT_BITMAP )
+    {
+        const FT_BitmapGlyph p_bitmap = (FT_BitmapGlyph) p_glyph;
+        return sizeof(FT_BitmapGlyphRec)
+             + (size_t) abs( p_bitmap->bitmap.pitch ) * p_bitmap->bitmap.rows;
+    }
+    if( p_glyph->format == FT_GLYPH_FORMAT_OUTLINE )
+    {
+        const FT_OutlineGlyph p_outline = (FT_OutlineGlyph) p_glyph;
+        return sizeof(FT_OutlineGlyphRec)
+             + p_outline->outline.n_points * (sizeof(FT_Vector) + sizeof(char))
+             + p_outline->outline.n_contours * sizeof(short);
+    }
+    return sizeof(FT_GlyphRec);
+}
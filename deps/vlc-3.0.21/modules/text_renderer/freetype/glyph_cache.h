@@ -0,0 +1,97 @@
+/*****************************************************************************
+ * glyph_cache.h : Cache of glyphs and laid out text
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_FREETYPE_GLYPH_CACHE_H
+#define VLC_FREETYPE_GLYPH_CACHE_H
+
+/** \ingroup freetype
+ * @{
+ * \file
+ * Least recently used cache of glyphs and laid out text
+ *
+ * Entries are looked up by an opaque binary key, and evicted once the total
+ * size of the cached values exceeds the memory budget. Values are owned by
+ * the cache: a value returned by GlyphCacheGet() remains valid until the
+ * next call to GlyphCachePut() or GlyphCacheDelete().
+ */
+
+#include "freetype.h"
+
+enum
+{
+    GLYPH_CACHE_OUTLINE,    /**< Loaded, emboldened, slanted and stroked glyphs */
+    GLYPH_CACHE_BITMAP,     /**< Rendered glyphs */
+    GLYPH_CACHE_LAYOUT,     /**< Shaped and laid out lines of text */
+    GLYPH_CACHE_KINDS
+};
+
+/**
+ * Identifies a glyph in the outline and bitmap caches. Faces are created
+ * for a given size and never released before the cache, so the face
+ * pointer identifies both the font and its size.
+ */
+typedef struct
+{
+    FT_Face   p_face;
+    FT_UInt   i_glyph_index;
+    FT_Fixed  i_stroke_radius;  /**< 0 if not outlined */
+    bool      b_embolden;
+    bool      b_oblique;
+} glyph_cache_key_t;
+
+/**
+ * Creates a cache holding at most \p i_max_size bytes of values.
+ */
+glyph_cache_t *GlyphCacheNew( size_t i_max_size );
+
+/**
+ * Releases all the cached values, and prints the hit rates.
+ */
+void GlyphCacheDelete( vlc_object_t *p_obj, glyph_cache_t *p_cache );
+
+/**
+ * Looks a value up, and marks it as most recently used.
+ *
+ * \return the value, or NULL if it is not cached
+ */
+void *GlyphCacheGet( glyph_cache_t *p_cache, int i_kind,
+                     const void *p_key, size_t i_key );
+
+/**
+ * Adds a value, evicting the least recently used ones as needed.
+ * On success, the cache takes ownership of the value, and releases it with
+ * \p pf_release once evicted.
+ *
+ * \param i_size approximate memory used by the value
+ * \return VLC_SUCCESS, or an error if the value could not be cached
+ */
+int GlyphCachePut( glyph_cache_t *p_cache, int i_kind,
+                   const void *p_key, size_t i_key,
+                   void *p_value, size_t i_size,
+                   void (*pf_release)( void * ) );
+
+/**
+ * Approximates the memory used by a glyph.
+ */
+size_t GlyphCacheSizeOf( FT_Glyph p_glyph );
+
+/** @} */
+
+#endif
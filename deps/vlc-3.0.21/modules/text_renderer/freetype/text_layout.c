@@ -65,6 +65,7 @@
 #include "freetype.h"
 #include "text_layout.h"
 #include "platform_fonts.h"
+#include "glyph_cache.h"
 
 #include <stdlib.h>
 
@@ -132,6 +133,7 @@ typedef struct glyph_bitmaps_t
     int      i_y_offset;
     int      i_x_advance;
     int      i_y_advance;
+    glyph_cache_key_t key;
 } glyph_bitmaps_t;
 
 typedef struct paragraph_t
@@ -929,6 +931,88 @@ static int ZeroNsmAdvance( paragraph_t *p_paragraph )
 #endif
 #endif
 
+typedef struct
+{
+    FT_Glyph  p_glyph;
+    FT_Glyph  p_outline;
+    FT_Vector advance;
+} cached_glyph_t;
+
+static void ReleaseCachedGlyph( void *p_data )
+{
+    cached_glyph_t *p_cached = p_data;
+
+    FT_Done_Glyph( p_cached->p_glyph );
+    if( p_cached->p_outline )
+        FT_Done_Glyph( p_cached->p_outline );
+    free( p_cached );
+}
+
+/**
+ * Copy the loaded glyph and its outline from the cache.
+ */
+static bool GetCachedGlyph( glyph_cache_t *p_cache, glyph_bitmaps_t *p_bitmaps,
+                            FT_Vector *p_advance )
+{
+    if( !p_cache )
+        return false;
+
+    const cached_glyph_t *p_cached =
+        GlyphCacheGet( p_cache, GLYPH_CACHE_OUTLINE,
+                       &p_bitmaps->key, sizeof( p_bitmaps->key ) );
+    if( !p_cached )
+        return false;
+
+    if( FT_Glyph_Copy( p_cached->p_glyph, &p_bitmaps->p_glyph ) )
+        return false;
+    if( p_cached->p_outline
+     && FT_Glyph_Copy( p_cached->p_outline, &p_bitmaps->p_outline ) )
+    {
+        FT_Done_Glyph( p_bitmaps->p_glyph );
+        p_bitmaps->p_glyph = 0;
+        return false;
+    }
+
+    *p_advance = p_cached->advance;
+    return true;
+}
+
+static void PutCachedGlyph( glyph_cache_t *p_cache,
+                            const glyph_bitmaps_t *p_bitmaps,
+                            const FT_Vector *p_advance )
+{
+    if( !p_cache )
+        return;
+
+    cached_glyph_t *p_cached = malloc( sizeof( *p_cached ) );
+    if( unlikely( !p_cached ) )
+        return;
+
+    if( FT_Glyph_Copy( p_bitmaps->p_glyph, &p_cached->p_glyph ) )
+    {
+        free( p_cached );
+        return;
+    }
+    p_cached->p_outline = 0;
+    if( p_bitmaps->p_outline
+     && FT_Glyph_Copy( p_bitmaps->p_outline, &p_cached->p_outline ) )
+    {
+        FT_Done_Glyph( p_cached->p_glyph );
+        free( p_cached );
+        return;
+    }
+    p_cached->advance = *p_advance;
+
+    size_t i_size = sizeof( *p_cached ) + GlyphCacheSizeOf( p_cached->p_glyph );
+    if( p_cached->p_outline )
+        i_size += GlyphCacheSizeOf( p_cached->p_outline );
+
+    if( GlyphCachePut( p_cache, GLYPH_CACHE_OUTLINE,
+                       &p_bitmaps->key, sizeof( p_bitmaps->key ),
+                       p_cached, i_size, ReleaseCachedGlyph ) )
+        ReleaseCachedGlyph( p_cached );
+}
+
 /**
  * Load the glyphs of a paragraph. When shaping with HarfBuzz the glyph indices
  * have already been determined at this point, as well as the advance values.
@@ -971,12 +1055,13 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
         else
             p_face = p_run->p_face;
 
+        int i_radius = 0;
         if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
         {
             double f_outline_thickness =
                 var_InheritInteger( p_filter, "freetype-outline-thickness" ) / 100.0;
             f_outline_thickness = VLC_CLIP( f_outline_thickness, 0.0, 0.5 );
-            int i_radius = ( i_live_size << 6 ) * f_outline_thickness;
+            i_radius = ( i_live_size << 6 ) * f_outline_thickness;
             FT_Stroker_Set( p_sys->p_stroker,
                             i_radius,
                             FT_STROKER_LINECAP_ROUND,
@@ -1033,39 +1118,54 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
                     SKIP_GLYPH( p_bitmaps )
             }
 
-            if( FT_Load_Glyph( p_face, i_glyph_index,
-                               FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
-             && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
-                SKIP_GLYPH( p_bitmaps )
+            glyph_cache_key_t *p_key = &p_bitmaps->key;
+            memset( p_key, 0, sizeof( *p_key ) );
+            p_key->p_face = p_face;
+            p_key->i_glyph_index = i_glyph_index;
+            p_key->i_stroke_radius = i_radius;
+            p_key->b_embolden = ( p_style->i_style_flags & STYLE_BOLD )
+                             && !( p_face->style_flags & FT_STYLE_FLAG_BOLD );
+            p_key->b_oblique = ( p_style->i_style_flags & STYLE_ITALIC )
+                            && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC );
+
+            FT_Vector advance;
+            if( !GetCachedGlyph( p_sys->p_cache, p_bitmaps, &advance ) )
+            {
+                if( FT_Load_Glyph( p_face, i_glyph_index,
+                                   FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
+                 && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
+                    SKIP_GLYPH( p_bitmaps )
 
-            if( ( p_style->i_style_flags & STYLE_BOLD )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
-                FT_GlyphSlot_Embolden( p_face->glyph );
-            if( ( p_style->i_style_flags & STYLE_ITALIC )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
-                FT_GlyphSlot_Oblique( p_face->glyph );
+                if( p_key->b_embolden )
+                    FT_GlyphSlot_Embolden( p_face->glyph );
+                if( p_key->b_oblique )
+                    FT_GlyphSlot_Oblique( p_face->glyph );
 
-            if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
-                SKIP_GLYPH( p_bitmaps )
+                if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
+                    SKIP_GLYPH( p_bitmaps )
 
-#undef SKIP_GLYPH
+                if( p_filter->p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
+                {
+                    p_bitmaps->p_outline = p_bitmaps->p_glyph;
+                    if( FT_Glyph_Stroke( &p_bitmaps->p_outline,
+                                          p_filter->p_sys->p_stroker, 0 ) )
+                        p_bitmaps->p_outline = 0;
+                }
 
-            if( p_filter->p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
-            {
-                p_bitmaps->p_outline = p_bitmaps->p_glyph;
-                if( FT_Glyph_Stroke( &p_bitmaps->p_outline,
-                                      p_filter->p_sys->p_stroker, 0 ) )
-                    p_bitmaps->p_outline = 0;
+                advance = p_face->glyph->advance;
+                PutCachedGlyph( p_sys->p_cache, p_bitmaps, &advance );
             }
 
+#undef SKIP_GLYPH
+
             if( p_style->i_shadow_alpha != STYLE_ALPHA_TRANSPARENT )
                 p_bitmaps->p_shadow = p_bitmaps->p_outline ?
                                       p_bitmaps->p_outline : p_bitmaps->p_glyph;
 
             if( b_overwrite_advance )
             {
-                p_bitmaps->i_x_advance = p_face->glyph->advance.x;
-                p_bitmaps->i_y_advance = p_face->glyph->advance.y;
+                p_bitmaps->i_x_advance = advance.x;
+                p_bitmaps->i_y_advance = advance.y;
             }
 
             unsigned i_x_advance = FT_FLOOR( abs( p_bitmaps->i_x_advance ) );
@@ -1076,6 +1176,75 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
     return VLC_SUCCESS;
 }
 
+typedef struct
+{
+    glyph_cache_key_t glyph;
+    bool              b_outline;  /**< rendered from the outline */
+    FT_Pos            i_phase_x;  /**< subpixel position, 26.6 */
+    FT_Pos            i_phase_y;
+} bitmap_cache_key_t;
+
+static void ReleaseGlyph( void *p_glyph )
+{
+    FT_Done_Glyph( (FT_Glyph) p_glyph );
+}
+
+/**
+ * Render a glyph at the pen position, like FT_Glyph_To_Bitmap().
+ * Only the subpixel part of the position changes the rasterization, so the
+ * bitmaps are cached at that phase and moved by whole pixels.
+ */
+static FT_Error RenderGlyph( glyph_cache_t *p_cache, FT_Glyph *pp_glyph,
+                             const glyph_cache_key_t *p_glyph_key, bool b_outline,
+                             FT_Vector pen, bool b_destroy )
+{
+    if( !p_cache || (*pp_glyph)->format != FT_GLYPH_FORMAT_OUTLINE )
+        return FT_Glyph_To_Bitmap( pp_glyph, FT_RENDER_MODE_NORMAL,
+                                   &pen, b_destroy );
+
+    bitmap_cache_key_t key;
+    memset( &key, 0, sizeof( key ) );
+    memcpy( &key.glyph, p_glyph_key, sizeof( key.glyph ) );
+    key.b_outline = b_outline;
+    key.i_phase_x = pen.x & 63;
+    key.i_phase_y = pen.y & 63;
+
+    FT_Glyph p_bitmap;
+    FT_Error error;
+    FT_Glyph p_cached = GlyphCacheGet( p_cache, GLYPH_CACHE_BITMAP,
+                                       &key, sizeof( key ) );
+    if( p_cached )
+    {
+        error = FT_Glyph_Copy( p_cached, &p_bitmap );
+        if( error )
+            return error;
+    }
+    else
+    {
+        FT_Vector phase = { .x = key.i_phase_x, .y = key.i_phase_y };
+        p_bitmap = *pp_glyph;
+        error = FT_Glyph_To_Bitmap( &p_bitmap, FT_RENDER_MODE_NORMAL,
+                                    &phase, 0 );
+        if( error )
+            return error;
+
+        if( !FT_Glyph_Copy( p_bitmap, &p_cached )
+         && GlyphCachePut( p_cache, GLYPH_CACHE_BITMAP, &key, sizeof( key ),
+                           p_cached, GlyphCacheSizeOf( p_cached ),
+                           ReleaseGlyph ) )
+            FT_Done_Glyph( p_cached );
+    }
+
+    FT_BitmapGlyph p_bitmap_glyph = (FT_BitmapGlyph) p_bitmap;
+    p_bitmap_glyph->left += ( pen.x - key.i_phase_x ) / 64;
+    p_bitmap_glyph->top  += ( pen.y - key.i_phase_y ) / 64;
+
+    if( b_destroy )
+        FT_Done_Glyph( *pp_glyph );
+    *pp_glyph = p_bitmap;
+    return 0;
+}
+
 static int LayoutLine( filter_t *p_filter,
                        paragraph_t *p_paragraph,
                        int i_first_char, int i_last_char,
@@ -1170,8 +1339,9 @@ static int LayoutLine( filter_t *p_filter,
 
         if( p_bitmaps->p_shadow )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_shadow, FT_RENDER_MODE_NORMAL,
-                                    &pen_shadow, 0 ) )
+            if( RenderGlyph( p_sys->p_cache, &p_bitmaps->p_shadow, &p_bitmaps->key,
+                             p_bitmaps->p_shadow == p_bitmaps->p_outline,
+                             pen_shadow, false ) )
                 p_bitmaps->p_shadow = 0;
             else
                 FT_Glyph_Get_CBox( p_bitmaps->p_shadow, ft_glyph_bbox_pixels,
@@ -1179,8 +1349,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_glyph )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_glyph, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( RenderGlyph( p_sys->p_cache, &p_bitmaps->p_glyph, &p_bitmaps->key,
+                             false, pen_new, true ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_glyph );
                 if( p_bitmaps->p_outline )
@@ -1196,8 +1366,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_outline )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_outline, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( RenderGlyph( p_sys->p_cache, &p_bitmaps->p_outline, &p_bitmaps->key,
+                             true, pen_new, true ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_outline );
                 p_bitmaps->p_outline = 0;
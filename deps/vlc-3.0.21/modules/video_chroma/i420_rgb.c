@@ -73,6 +73,8 @@ static picture_t *I420_A8B8G8R8_Filter( filter_t *, picture_t * );
  *****************************************************************************/
 static int  Activate   ( vlc_object_t * );
 static void Deactivate ( vlc_object_t * );
+static int  InitSlices ( filter_t *, size_t, size_t );
+static void CleanSlices( filter_sys_t * );
 
 vlc_module_begin ()
 #if defined (SSE2)
@@ -102,6 +104,7 @@ vlc_module_end ()
 static int Activate( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t *)p_this;
+    size_t i_buffer_size, i_offset_size;
 #ifdef PLAIN
     size_t i_tables_size;
 #endif
@@ -216,32 +219,34 @@ static int Activate( vlc_object_t *p_this )
     {
 #ifdef PLAIN
         case VLC_CODEC_RGB8:
-            p_filter->p_sys->p_buffer = malloc( VOUT_MAX_WIDTH );
+            i_buffer_size = VOUT_MAX_WIDTH;
             break;
 #endif
         case VLC_CODEC_RGB15:
         case VLC_CODEC_RGB16:
-            p_filter->p_sys->p_buffer = malloc( VOUT_MAX_WIDTH * 2 );
+            i_buffer_size = VOUT_MAX_WIDTH * 2;
             break;
         case VLC_CODEC_RGB24:
         case VLC_CODEC_RGB32:
-            p_filter->p_sys->p_buffer = malloc( VOUT_MAX_WIDTH * 4 );
+            i_buffer_size = VOUT_MAX_WIDTH * 4;
             break;
         default:
-            p_filter->p_sys->p_buffer = NULL;
+            i_buffer_size = 0;
             break;
     }
 
+    p_filter->p_sys->p_buffer = i_buffer_size ? malloc( i_buffer_size ) : NULL;
     if( p_filter->p_sys->p_buffer == NULL )
     {
         free( p_filter->p_sys );
         return VLC_EGENERIC;
     }
 
-    p_filter->p_sys->p_offset = malloc( p_filter->fmt_out.video.i_width
+    i_offset_size = p_filter->fmt_out.video.i_width
                     * ( ( p_filter->fmt_out.video.i_chroma
                            == VLC_CODEC_RGB8 ) ? 2 : 1 )
-                    * sizeof( int ) );
+                    * sizeof( int );
+    p_filter->p_sys->p_offset = malloc( i_offset_size );
     if( p_filter->p_sys->p_offset == NULL )
     {
         free( p_filter->p_sys->p_buffer );
@@ -276,9 +281,88 @@ static int Activate( vlc_object_t *p_this )
     SetYUV( p_filter );
 #endif
 
+    if( InitSlices( p_filter, i_buffer_size, i_offset_size ) )
+    {
+#ifdef PLAIN
+        free( p_filter->p_sys->p_base );
+#endif
+        free( p_filter->p_sys->p_offset );
+        free( p_filter->p_sys->p_buffer );
+        free( p_filter->p_sys );
+        return VLC_ENOMEM;
+    }
+
     return 0;
 }
 
+/*****************************************************************************
+ * InitSlices: prepare the slice threading
+ *****************************************************************************
+ * Each band gets its own line buffer and offset array, the conversion tables
+ * are shared.
+ *****************************************************************************/
+static int InitSlices( filter_t *p_filter, size_t i_buffer_size,
+                       size_t i_offset_size )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const video_format_t *p_in = &p_filter->fmt_in.video;
+    const video_format_t *p_out = &p_filter->fmt_out.video;
+
+    p_sys->slices.p_slices = NULL;
+    p_sys->p_bands = NULL;
+
+    /* Vertical scaling carries a state from one line to the next */
+    if( p_in->i_y_offset + p_in->i_visible_height
+     != p_out->i_y_offset + p_out->i_visible_height )
+        return VLC_SUCCESS;
+
+    if( chroma_slices_Init( &p_sys->slices, p_filter ) )
+        return VLC_ENOMEM;
+    if( p_sys->slices.p_slices == NULL )
+        return VLC_SUCCESS;
+
+    const unsigned i_count = vlc_slices_Count( p_sys->slices.p_slices );
+    p_sys->p_bands = calloc( i_count, sizeof(*p_sys->p_bands) );
+    if( p_sys->p_bands == NULL )
+    {
+        chroma_slices_Clean( &p_sys->slices );
+        return VLC_ENOMEM;
+    }
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        filter_sys_t *p_band = &p_sys->p_bands[i];
+
+        *p_band = *p_sys;
+        p_band->slices.p_slices = NULL;
+        p_band->p_bands = NULL;
+        p_band->p_buffer = malloc( i_buffer_size );
+        p_band->p_offset = malloc( i_offset_size );
+        if( p_band->p_buffer == NULL || p_band->p_offset == NULL )
+        {
+            CleanSlices( p_sys );
+            return VLC_ENOMEM;
+        }
+        p_sys->slices.pp_bands[i]->p_sys = p_band;
+    }
+    return VLC_SUCCESS;
+}
+
+static void CleanSlices( filter_sys_t *p_sys )
+{
+    if( p_sys->p_bands != NULL )
+    {
+        for( unsigned i = 0; i < vlc_slices_Count( p_sys->slices.p_slices ); i++ )
+        {
+            free( p_sys->p_bands[i].p_offset );
+            free( p_sys->p_bands[i].p_buffer );
+        }
+        free( p_sys->p_bands );
+        p_sys->p_bands = NULL;
+    }
+    chroma_slices_Clean( &p_sys->slices );
+}
+
 /*****************************************************************************
  * Deactivate: free the chroma function
  *****************************************************************************
@@ -288,6 +372,7 @@ static void Deactivate( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t *)p_this;
 
+    CleanSlices( p_filter->p_sys );
 #ifdef PLAIN
     free( p_filter->p_sys->p_base );
 #endif
@@ -297,16 +382,16 @@ static void Deactivate( vlc_object_t *p_this )
 }
 
 #ifndef PLAIN
-VIDEO_FILTER_WRAPPER( I420_R5G5B5 )
-VIDEO_FILTER_WRAPPER( I420_R5G6B5 )
-VIDEO_FILTER_WRAPPER( I420_A8R8G8B8 )
-VIDEO_FILTER_WRAPPER( I420_R8G8B8A8 )
-VIDEO_FILTER_WRAPPER( I420_B8G8R8A8 )
-VIDEO_FILTER_WRAPPER( I420_A8B8G8R8 )
+CHROMA_SLICES_WRAPPER( I420_R5G5B5, &p_filter->p_sys->slices, 4 )
+CHROMA_SLICES_WRAPPER( I420_R5G6B5, &p_filter->p_sys->slices, 4 )
+CHROMA_SLICES_WRAPPER( I420_A8R8G8B8, &p_filter->p_sys->slices, 4 )
+CHROMA_SLICES_WRAPPER( I420_R8G8B8A8, &p_filter->p_sys->slices, 4 )
+CHROMA_SLICES_WRAPPER( I420_B8G8R8A8, &p_filter->p_sys->slices, 4 )
+CHROMA_SLICES_WRAPPER( I420_A8B8G8R8, &p_filter->p_sys->slices, 4 )
 #else
-VIDEO_FILTER_WRAPPER( I420_RGB8 )
-VIDEO_FILTER_WRAPPER( I420_RGB16 )
-VIDEO_FILTER_WRAPPER( I420_RGB32 )
+CHROMA_SLICES_WRAPPER( I420_RGB8, &p_filter->p_sys->slices, 4 )
+CHROMA_SLICES_WRAPPER( I420_RGB16, &p_filter->p_sys->slices, 4 )
+CHROMA_SLICES_WRAPPER( I420_RGB32, &p_filter->p_sys->slices, 4 )
 
 /*****************************************************************************
  * SetGammaTable: return intensity table transformed by gamma curve.
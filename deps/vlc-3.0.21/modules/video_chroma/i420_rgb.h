@@ -25,6 +25,8 @@
 # define PLAIN
 #endif
 
+#include "slices.h"
+
 /** Number of entries in RGB palette/colormap */
 #define CMAP_RGB2_SIZE 256
 
@@ -39,6 +41,10 @@ struct filter_sys_t
     uint8_t  *p_buffer;
     int *p_offset;
 
+    /* Slice threading, if the height is not scaled */
+    chroma_slices_t slices;
+    filter_sys_t *p_bands;             /**< private data of each band */
+
 #ifdef PLAIN
     /**< Pre-calculated conversion tables */
     void *p_base;                      /**< base for all conversion tables */
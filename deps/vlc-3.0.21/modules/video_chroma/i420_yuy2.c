@@ -41,6 +41,7 @@
 #endif
 
 #include "i420_yuy2.h"
+#include "slices.h"
 
 #define SRC_FOURCC  "I420,IYUV,YV12"
 
@@ -62,6 +63,12 @@
  * Local and extern prototypes.
  *****************************************************************************/
 static int  Activate ( vlc_object_t * );
+static void Deactivate ( vlc_object_t * );
+
+struct filter_sys_t
+{
+    chroma_slices_t slices;
+};
 
 static void I420_YUY2           ( filter_t *, picture_t *, picture_t * );
 static void I420_YVYU           ( filter_t *, picture_t *, picture_t * );
@@ -100,7 +107,7 @@ vlc_module_begin ()
     set_capability( "video converter", 250 )
 # define vlc_CPU_capable() vlc_CPU_ALTIVEC()
 #endif
-    set_callbacks( Activate, NULL )
+    set_callbacks( Activate, Deactivate )
 vlc_module_end ()
 
 /*****************************************************************************
@@ -163,9 +170,27 @@ static int Activate( vlc_object_t *p_this )
             return -1;
     }
 
+    filter_sys_t *p_sys = malloc( sizeof( *p_sys ) );
+    if( p_sys == NULL )
+        return VLC_ENOMEM;
+    p_filter->p_sys = p_sys;
+    if( chroma_slices_Init( &p_sys->slices, p_filter ) )
+    {
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+
     return 0;
 }
 
+static void Deactivate( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    chroma_slices_Clean( &p_filter->p_sys->slices );
+    free( p_filter->p_sys );
+}
+
 #if 0
 static inline unsigned long long read_cycles(void)
 {
@@ -178,14 +203,14 @@ static inline unsigned long long read_cycles(void)
 
 /* Following functions are local */
 
-VIDEO_FILTER_WRAPPER( I420_YUY2 )
-VIDEO_FILTER_WRAPPER( I420_YVYU )
-VIDEO_FILTER_WRAPPER( I420_UYVY )
+CHROMA_SLICES_WRAPPER( I420_YUY2, &p_filter->p_sys->slices, 2 )
+CHROMA_SLICES_WRAPPER( I420_YVYU, &p_filter->p_sys->slices, 2 )
+CHROMA_SLICES_WRAPPER( I420_UYVY, &p_filter->p_sys->slices, 2 )
 #if !defined (MODULE_NAME_IS_i420_yuy2_altivec)
-VIDEO_FILTER_WRAPPER( I420_IUYV )
+CHROMA_SLICES_WRAPPER( I420_IUYV, &p_filter->p_sys->slices, 2 )
 #endif
 #if defined (MODULE_NAME_IS_i420_yuy2)
-VIDEO_FILTER_WRAPPER( I420_Y211 )
+CHROMA_SLICES_WRAPPER( I420_Y211, &p_filter->p_sys->slices, 2 )
 #endif
 
 /*****************************************************************************
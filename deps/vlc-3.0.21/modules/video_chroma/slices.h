@@ -0,0 +1,164 @@
+/*****************************************************************************
+ * slices.h: slice threading of the line based chroma converters
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_VIDEOCHROMA_SLICES_H_
+#define VLC_VIDEOCHROMA_SLICES_H_
+
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+/*
+ * The converters take their dimensions from the filter formats. Each slice
+ * thus gets its own filter object, a "band", whose height is the height of
+ * the slice. The bands share the private data of the converter unless it
+ * replaces their p_sys after chroma_slices_Init().
+ *
+ * Only converters that do not scale vertically can be sliced.
+ */
+typedef struct
+{
+    vlc_slices_t *p_slices; /* NULL if single threaded */
+    filter_t    **pp_bands;
+} chroma_slices_t;
+
+typedef void (*chroma_convert_t)( filter_t *, picture_t *, picture_t * );
+
+static inline void chroma_slices_Clean( chroma_slices_t *p_cs )
+{
+    if( p_cs->p_slices == NULL )
+        return;
+
+    for( unsigned i = 0; i < vlc_slices_Count( p_cs->p_slices ); i++ )
+        if( p_cs->pp_bands[i] != NULL )
+            vlc_object_release( p_cs->pp_bands[i] );
+    free( p_cs->pp_bands );
+    vlc_slices_Delete( p_cs->p_slices );
+    p_cs->p_slices = NULL;
+}
+
+static inline int chroma_slices_Init( chroma_slices_t *p_cs, filter_t *p_filter )
+{
+    const unsigned i_count = filter_GetSliceCount( p_filter );
+
+    p_cs->p_slices = NULL;
+    p_cs->pp_bands = NULL;
+    if( i_count <= 1 )
+        return VLC_SUCCESS;
+
+    p_cs->p_slices = vlc_slices_New( i_count );
+    if( p_cs->p_slices == NULL )
+        return VLC_ENOMEM;
+
+    const unsigned i_bands = vlc_slices_Count( p_cs->p_slices );
+    p_cs->pp_bands = calloc( i_bands, sizeof(*p_cs->pp_bands) );
+    if( p_cs->pp_bands == NULL )
+    {
+        vlc_slices_Delete( p_cs->p_slices );
+        p_cs->p_slices = NULL;
+        return VLC_ENOMEM;
+    }
+
+    for( unsigned i = 0; i < i_bands; i++ )
+    {
+        filter_t *p_band = vlc_object_create( p_filter, sizeof(*p_band) );
+        if( p_band == NULL )
+        {
+            chroma_slices_Clean( p_cs );
+            return VLC_ENOMEM;
+        }
+        /* Shallow copies: the bands never own the formats */
+        p_band->fmt_in = p_filter->fmt_in;
+        p_band->fmt_out = p_filter->fmt_out;
+        p_band->p_sys = p_filter->p_sys;
+        p_cs->pp_bands[i] = p_band;
+    }
+    msg_Dbg( p_filter, "using %u slices", i_bands );
+    return VLC_SUCCESS;
+}
+
+struct chroma_slices_job
+{
+    chroma_slices_t *p_cs;
+    chroma_convert_t pf_convert;
+    picture_t       *p_src;
+    picture_t       *p_dst;
+};
+
+static inline void chroma_slices_Band( void *opaque, unsigned i_slice,
+                                       unsigned i_first, unsigned i_lines )
+{
+    const struct chroma_slices_job *p_job = opaque;
+    filter_t *p_band = p_job->p_cs->pp_bands[i_slice];
+    picture_t src, dst;
+
+    p_band->fmt_in.video.i_y_offset = p_band->fmt_out.video.i_y_offset = 0;
+    p_band->fmt_in.video.i_height = p_band->fmt_in.video.i_visible_height =
+    p_band->fmt_out.video.i_height = p_band->fmt_out.video.i_visible_height =
+        i_lines;
+
+    picture_SliceView( &src, p_job->p_src, i_first, i_lines );
+    picture_SliceView( &dst, p_job->p_dst, i_first, i_lines );
+    p_job->pf_convert( p_band, &src, &dst );
+}
+
+/**
+ * Converts p_src into p_dst with pf_convert, in parallel bands of a multiple
+ * of i_align lines, or directly if slice threading is disabled.
+ */
+static inline void chroma_slices_Convert( chroma_slices_t *p_cs,
+                                          filter_t *p_filter,
+                                          chroma_convert_t pf_convert,
+                                          picture_t *p_src, picture_t *p_dst,
+                                          unsigned i_align )
+{
+    if( p_cs->p_slices == NULL )
+    {
+        pf_convert( p_filter, p_src, p_dst );
+        return;
+    }
+
+    struct chroma_slices_job job = {
+        .p_cs = p_cs, .pf_convert = pf_convert, .p_src = p_src, .p_dst = p_dst,
+    };
+    vlc_slices_Run( p_cs->p_slices, p_filter->fmt_in.video.i_y_offset
+                                    + p_filter->fmt_in.video.i_visible_height,
+                    i_align, chroma_slices_Band, &job );
+}
+
+/**
+ * Same as VIDEO_FILTER_WRAPPER(), with the conversion split in slices.
+ * slices is an expression giving the chroma_slices_t of p_filter.
+ */
+#define CHROMA_SLICES_WRAPPER( name, slices, align )                    \
+    static picture_t *name ## _Filter ( filter_t *p_filter,             \
+                                        picture_t *p_pic )              \
+    {                                                                   \
+        picture_t *p_outpic = filter_NewPicture( p_filter );            \
+        if( p_outpic )                                                  \
+        {                                                               \
+            chroma_slices_Convert( slices, p_filter, name,              \
+                                   p_pic, p_outpic, align );            \
+            picture_CopyProperties( p_outpic, p_pic );                  \
+        }                                                               \
+        picture_Release( p_pic );                                       \
+        return p_outpic;                                                \
+    }
+
+#endif
@@ -39,6 +39,13 @@
 #include <libswscale/swscale.h>
 #include <libswscale/version.h>
 
+/* Each slice is scaled by its own context, which only computes the lines of
+ * its slice, from the whole source picture */
+#if LIBSWSCALE_VERSION_INT >= AV_VERSION_INT(6, 1, 100)
+# include <libavutil/frame.h>
+# define SWS_SLICES 1
+#endif
+
 #ifdef __APPLE__
 # include <TargetConditionals.h>
 #endif
@@ -106,11 +113,21 @@ struct filter_sys_t
     bool b_copy;
     bool b_swap_uvi;
     bool b_swap_uvo;
+
+#ifdef SWS_SLICES
+    vlc_slices_t *p_slices;
+    struct SwsContext **pp_slice_ctx;
+    int i_slice_srcw, i_slice_srch, i_slice_srcf;
+    int i_slice_dstw, i_slice_dsth, i_slice_dstf;
+#endif
 };
 
 static picture_t *Filter( filter_t *, picture_t * );
 static int  Init( filter_t * );
 static void Clean( filter_t * );
+#ifdef SWS_SLICES
+static void CleanSlices( filter_sys_t * );
+#endif
 
 typedef struct
 {
@@ -184,8 +201,18 @@ static int OpenScaler( vlc_object_t *p_this )
     memset( &p_sys->fmt_in,  0, sizeof(p_sys->fmt_in) );
     memset( &p_sys->fmt_out, 0, sizeof(p_sys->fmt_out) );
 
+#ifdef SWS_SLICES
+    const unsigned i_slices = filter_GetSliceCount( p_filter );
+    if( i_slices > 1 )
+        p_sys->p_slices = vlc_slices_New( i_slices );
+#endif
+
     if( Init( p_filter ) )
     {
+#ifdef SWS_SLICES
+        if( p_sys->p_slices )
+            vlc_slices_Delete( p_sys->p_slices );
+#endif
         if( p_sys->p_filter )
             sws_freeFilter( p_sys->p_filter );
         free( p_sys );
@@ -216,6 +243,10 @@ static void CloseScaler( vlc_object_t *p_this )
     filter_sys_t *p_sys = p_filter->p_sys;
 
     Clean( p_filter );
+#ifdef SWS_SLICES
+    if( p_sys->p_slices )
+        vlc_slices_Delete( p_sys->p_slices );
+#endif
     if( p_sys->p_filter )
         sws_freeFilter( p_sys->p_filter );
     free( p_sys );
@@ -411,6 +442,36 @@ static int Init( filter_t *p_filter )
         else
             p_sys->ctxA = ctx;
     }
+#ifdef SWS_SLICES
+    if( p_sys->p_slices && p_sys->ctx )
+    {
+        const unsigned i_count = vlc_slices_Count( p_sys->p_slices );
+
+        p_sys->i_slice_srcw = i_fmti_visible_width;
+        p_sys->i_slice_srch = p_fmti->i_visible_height;
+        p_sys->i_slice_srcf = cfg.i_fmti;
+        p_sys->i_slice_dstw = i_fmto_visible_width;
+        p_sys->i_slice_dsth = p_fmto->i_visible_height;
+        p_sys->i_slice_dstf = cfg.i_fmto;
+        p_sys->pp_slice_ctx = calloc( i_count, sizeof(*p_sys->pp_slice_ctx) );
+        for( unsigned i = 0; p_sys->pp_slice_ctx && i < i_count; i++ )
+        {
+            p_sys->pp_slice_ctx[i] =
+                sws_getContext( i_fmti_visible_width, p_fmti->i_visible_height,
+                                cfg.i_fmti,
+                                i_fmto_visible_width, p_fmto->i_visible_height,
+                                cfg.i_fmto,
+                                cfg.i_sws_flags | p_sys->i_cpu_mask,
+                                p_sys->p_filter, NULL, 0 );
+            if( !p_sys->pp_slice_ctx[i] )
+            {
+                msg_Warn( p_filter, "slice threading disabled" );
+                CleanSlices( p_sys );
+                break;
+            }
+        }
+    }
+#endif
     if( p_sys->ctxA )
     {
         p_sys->p_src_a = picture_New( VLC_CODEC_GREY, i_fmti_visible_width, p_fmti->i_visible_height, 0, 1 );
@@ -466,10 +527,27 @@ static int Init( filter_t *p_filter )
     return VLC_SUCCESS;
 }
 
+#ifdef SWS_SLICES
+static void CleanSlices( filter_sys_t *p_sys )
+{
+    if( !p_sys->pp_slice_ctx )
+        return;
+    for( unsigned i = 0; i < vlc_slices_Count( p_sys->p_slices ); i++ )
+        if( p_sys->pp_slice_ctx[i] )
+            sws_freeContext( p_sys->pp_slice_ctx[i] );
+    free( p_sys->pp_slice_ctx );
+    p_sys->pp_slice_ctx = NULL;
+}
+#endif
+
 static void Clean( filter_t *p_filter )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
 
+#ifdef SWS_SLICES
+    CleanSlices( p_sys );
+#endif
+
     if( p_sys->p_src_e )
         picture_Release( p_sys->p_src_e );
     if( p_sys->p_dst_e )
@@ -582,6 +660,75 @@ static void SwapUV( picture_t *p_dst, const picture_t *p_src )
     picture_CopyPixels( p_dst, &tmp );
 }
 
+#ifdef SWS_SLICES
+struct sws_slices_job
+{
+    filter_sys_t *p_sys;
+    AVFrame *p_src;
+    AVFrame *p_dst;
+};
+
+static void ConvertSlice( void *opaque, unsigned i_slice,
+                          unsigned i_first, unsigned i_lines )
+{
+    const struct sws_slices_job *p_job = opaque;
+    struct SwsContext *ctx = p_job->p_sys->pp_slice_ctx[i_slice];
+
+    if( sws_frame_start( ctx, p_job->p_dst, p_job->p_src ) < 0 )
+        return;
+    if( sws_send_slice( ctx, 0, p_job->p_src->height ) >= 0 )
+        sws_receive_slice( ctx, i_first, i_lines );
+    sws_frame_end( ctx );
+}
+
+/* The pictures are owned by VLC: the frames only borrow their planes */
+static void NoFree( void *opaque, uint8_t *data )
+{
+    VLC_UNUSED( opaque ); VLC_UNUSED( data );
+}
+
+static int WrapFrame( AVFrame *p_frame, uint8_t *pp_data[4], int pi_stride[4],
+                      int i_width, int i_height, int i_format )
+{
+    p_frame->buf[0] = av_buffer_create( pp_data[0], 1, NoFree, NULL, 0 );
+    if( !p_frame->buf[0] )
+        return VLC_ENOMEM;
+    for( int i = 0; i < 4; i++ )
+    {
+        p_frame->data[i] = pp_data[i];
+        p_frame->linesize[i] = pi_stride[i];
+    }
+    p_frame->width = i_width;
+    p_frame->height = i_height;
+    p_frame->format = i_format;
+    return VLC_SUCCESS;
+}
+
+static void ConvertSlices( filter_sys_t *p_sys,
+                           uint8_t *src[4], int src_stride[4],
+                           uint8_t *dst[4], int dst_stride[4] )
+{
+    AVFrame *p_src = av_frame_alloc();
+    AVFrame *p_dst = av_frame_alloc();
+
+    if( p_src && p_dst
+     && !WrapFrame( p_src, src, src_stride, p_sys->i_slice_srcw,
+                    p_sys->i_slice_srch, p_sys->i_slice_srcf )
+     && !WrapFrame( p_dst, dst, dst_stride, p_sys->i_slice_dstw,
+                    p_sys->i_slice_dsth, p_sys->i_slice_dstf ) )
+    {
+        struct sws_slices_job job = {
+            .p_sys = p_sys, .p_src = p_src, .p_dst = p_dst,
+        };
+        vlc_slices_Run( p_sys->p_slices, p_dst->height,
+                        sws_receive_slice_alignment( p_sys->pp_slice_ctx[0] ),
+                        ConvertSlice, &job );
+    }
+    av_frame_free( &p_dst );
+    av_frame_free( &p_src );
+}
+#endif
+
 static void Convert( filter_t *p_filter, struct SwsContext *ctx,
                      picture_t *p_dst, picture_t *p_src, int i_height,
                      int i_plane_count, bool b_swap_uvi, bool b_swap_uvo )
@@ -610,6 +757,14 @@ static void Convert( filter_t *p_filter, struct SwsContext *ctx,
     for (size_t i = 0; i < ARRAY_SIZE(src); i++)
         csrc[i] = src[i];
 
+#ifdef SWS_SLICES
+    if( ctx == p_sys->ctx && p_sys->pp_slice_ctx )
+    {
+        ConvertSlices( p_sys, src, src_stride, dst, dst_stride );
+        return;
+    }
+#endif
+
 #if LIBSWSCALE_VERSION_INT  >= ((0<<16)+(5<<8)+0)
     sws_scale( ctx, csrc, src_stride, 0, i_height,
                dst, dst_stride );
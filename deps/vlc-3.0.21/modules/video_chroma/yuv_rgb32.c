@@ -0,0 +1,638 @@
+/*****************************************************************************
+ * yuv_rgb32.c : YUV 4:2:0 to 32 bits RGB conversions
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef YUV_RGB32_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_cpu.h>
+
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+#endif
+
+/*
+ * All the kernels share the same fixed point arithmetic, so that the
+ * vectorized ones give exactly the same result as the plain C ones:
+ *
+ *  - the samples, minus their black level (or 128 for the chroma), are scaled
+ *    to 14 bits (<< 6 for 8 bits, << 4 for 10 bits),
+ *  - they are multiplied by the matrix coefficients in Q13, keeping the upper
+ *    16 bits of the product (like pmulhw): the terms are in Q3,
+ *  - the terms are added, rounded, and saturated to 8 bits.
+ */
+typedef struct
+{
+    int16_t y_offset; /* black level */
+    int16_t c_offset; /* chroma zero */
+    int16_t shift;    /* to 14 bits */
+    int16_t ky;
+    int16_t kvr;
+    int16_t kug;
+    int16_t kvg;
+    int16_t kub;
+} yuv_rgb32_coeffs_t;
+
+typedef void (*yuv_rgb32_row_t)( uint8_t *, const uint8_t *, const uint8_t *,
+                                 const uint8_t *, unsigned,
+                                 const yuv_rgb32_coeffs_t *, bool );
+
+struct filter_sys_t
+{
+    yuv_rgb32_coeffs_t coeffs;
+    yuv_rgb32_row_t    row;
+    bool               b_swap_uv; /* YV12, NV21 */
+    bool               b_rgba;    /* R, G, B, A byte order, else B, G, R, A */
+};
+
+static void SetupCoeffs( yuv_rgb32_coeffs_t *c, video_color_space_t space,
+                         bool b_full_range, unsigned i_bits )
+{
+    double kr, kb;
+
+    switch( space )
+    {
+        case COLOR_SPACE_BT709:
+            kr = 0.2126; kb = 0.0722;
+            break;
+        case COLOR_SPACE_BT2020:
+            kr = 0.2627; kb = 0.0593;
+            break;
+        default:
+            kr = 0.299;  kb = 0.114;
+            break;
+    }
+    const double kg = 1. - kr - kb;
+    const double ys = b_full_range ? 1. : 255. / 219.;
+    const double cs = b_full_range ? 1. : 255. / 224.;
+    const double q = 1 << 13;
+
+    c->y_offset = b_full_range ? 0 : 16 << (i_bits - 8);
+    c->c_offset = 128 << (i_bits - 8);
+    c->shift    = 14 - i_bits;
+    c->ky  = lround( ys * q );
+    c->kvr = lround( 2. * (1. - kr) * cs * q );
+    c->kug = lround( 2. * (1. - kb) * kb / kg * cs * q );
+    c->kvg = lround( 2. * (1. - kr) * kr / kg * cs * q );
+    c->kub = lround( 2. * (1. - kb) * cs * q );
+}
+
+/*****************************************************************************
+ * Plain C kernels
+ *****************************************************************************/
+static inline int Term( int i_value, int i_coeff )
+{
+    return ( i_value * i_coeff ) >> 16;
+}
+
+static inline uint8_t Clip( int i_value )
+{
+    i_value = ( i_value + 4 ) >> 3;
+    return i_value < 0 ? 0 : i_value > 255 ? 255 : i_value;
+}
+
+static inline void Pixel( uint8_t *p_dst, int y, int u, int v,
+                          const yuv_rgb32_coeffs_t *c, bool b_rgba )
+{
+    y = ( y - c->y_offset ) << c->shift;
+    u = ( u - c->c_offset ) << c->shift;
+    v = ( v - c->c_offset ) << c->shift;
+
+    const int ty = Term( y, c->ky );
+    const uint8_t r = Clip( ty + Term( v, c->kvr ) );
+    const uint8_t g = Clip( ty - Term( u, c->kug ) - Term( v, c->kvg ) );
+    const uint8_t b = Clip( ty + Term( u, c->kub ) );
+
+    p_dst[0] = b_rgba ? r : b;
+    p_dst[1] = g;
+    p_dst[2] = b_rgba ? b : r;
+    p_dst[3] = 0xff;
+}
+
+static void RowPlanar8( uint8_t *p_dst, const uint8_t *p_y, const uint8_t *p_u,
+                        const uint8_t *p_v, unsigned i_width,
+                        const yuv_rgb32_coeffs_t *c, bool b_rgba )
+{
+    for( unsigned x = 0; x < i_width; x++ )
+        Pixel( &p_dst[4 * x], p_y[x], p_u[x / 2], p_v[x / 2], c, b_rgba );
+}
+
+/* p_u and p_v point to the first and second samples of the interleaved
+ * chroma plane */
+static void RowSemiPlanar8( uint8_t *p_dst, const uint8_t *p_y,
+                            const uint8_t *p_u, const uint8_t *p_v,
+                            unsigned i_width, const yuv_rgb32_coeffs_t *c,
+                            bool b_rgba )
+{
+    for( unsigned x = 0; x < i_width; x++ )
+        Pixel( &p_dst[4 * x], p_y[x], p_u[x & ~1], p_v[x & ~1], c, b_rgba );
+}
+
+/* 10 bits samples stored in the upper bits of 16 bits words (P010) */
+static void RowSemiPlanar16( uint8_t *p_dst, const uint8_t *p_y,
+                             const uint8_t *p_u, const uint8_t *p_v,
+                             unsigned i_width, const yuv_rgb32_coeffs_t *c,
+                             bool b_rgba )
+{
+    const uint16_t *p_y16 = (const uint16_t *)p_y;
+    const uint16_t *p_u16 = (const uint16_t *)p_u;
+    const uint16_t *p_v16 = (const uint16_t *)p_v;
+
+    for( unsigned x = 0; x < i_width; x++ )
+        Pixel( &p_dst[4 * x], p_y16[x] >> 6, p_u16[x & ~1] >> 6,
+               p_v16[x & ~1] >> 6, c, b_rgba );
+}
+
+/*****************************************************************************
+ * AVX2 kernels, 16 pixels at a time
+ *****************************************************************************/
+#ifdef HAVE_AVX2_INTRINSICS
+VLC_AVX2
+static inline void Store16( uint8_t *p_dst, __m256i y, __m256i u, __m256i v,
+                            const yuv_rgb32_coeffs_t *c, bool b_rgba )
+{
+    const __m128i shift = _mm_cvtsi32_si128( c->shift );
+    const __m256i round = _mm256_set1_epi16( 4 );
+
+    y = _mm256_sll_epi16( _mm256_sub_epi16( y, _mm256_set1_epi16( c->y_offset ) ),
+                          shift );
+    u = _mm256_sll_epi16( _mm256_sub_epi16( u, _mm256_set1_epi16( c->c_offset ) ),
+                          shift );
+    v = _mm256_sll_epi16( _mm256_sub_epi16( v, _mm256_set1_epi16( c->c_offset ) ),
+                          shift );
+
+    const __m256i ty = _mm256_mulhi_epi16( y, _mm256_set1_epi16( c->ky ) );
+    __m256i r = _mm256_add_epi16( ty,
+                    _mm256_mulhi_epi16( v, _mm256_set1_epi16( c->kvr ) ) );
+    __m256i g = _mm256_sub_epi16( ty,
+                    _mm256_mulhi_epi16( u, _mm256_set1_epi16( c->kug ) ) );
+    g = _mm256_sub_epi16( g, _mm256_mulhi_epi16( v, _mm256_set1_epi16( c->kvg ) ) );
+    __m256i b = _mm256_add_epi16( ty,
+                    _mm256_mulhi_epi16( u, _mm256_set1_epi16( c->kub ) ) );
+
+    r = _mm256_srai_epi16( _mm256_add_epi16( r, round ), 3 );
+    g = _mm256_srai_epi16( _mm256_add_epi16( g, round ), 3 );
+    b = _mm256_srai_epi16( _mm256_add_epi16( b, round ), 3 );
+    if( b_rgba )
+    {
+        __m256i t = r;
+        r = b;
+        b = t;
+    }
+
+    /* Each 128 bits lane holds pixels 0-7 and 8-15 respectively */
+    const __m256i br = _mm256_packus_epi16( b, r );
+    const __m256i ga = _mm256_packus_epi16( g, _mm256_set1_epi16( 0xff ) );
+    const __m256i bg = _mm256_unpacklo_epi8( br, ga );
+    const __m256i ra = _mm256_unpackhi_epi8( br, ga );
+    const __m256i lo = _mm256_unpacklo_epi16( bg, ra ); /* 0-3, 8-11 */
+    const __m256i hi = _mm256_unpackhi_epi16( bg, ra ); /* 4-7, 12-15 */
+
+    _mm256_storeu_si256( (__m256i *)p_dst,
+                         _mm256_permute2x128_si256( lo, hi, 0x20 ) );
+    _mm256_storeu_si256( (__m256i *)&p_dst[32],
+                         _mm256_permute2x128_si256( lo, hi, 0x31 ) );
+}
+
+VLC_AVX2
+static void RowPlanar8_AVX2( uint8_t *p_dst, const uint8_t *p_y,
+                             const uint8_t *p_u, const uint8_t *p_v,
+                             unsigned i_width, const yuv_rgb32_coeffs_t *c,
+                             bool b_rgba )
+{
+    unsigned x = 0;
+
+    for( ; x + 16 <= i_width; x += 16 )
+    {
+        const __m128i u8 = _mm_loadl_epi64( (const __m128i *)&p_u[x / 2] );
+        const __m128i v8 = _mm_loadl_epi64( (const __m128i *)&p_v[x / 2] );
+        const __m256i y = _mm256_cvtepu8_epi16(
+                            _mm_loadu_si128( (const __m128i *)&p_y[x] ) );
+        const __m256i u = _mm256_cvtepu8_epi16( _mm_unpacklo_epi8( u8, u8 ) );
+        const __m256i v = _mm256_cvtepu8_epi16( _mm_unpacklo_epi8( v8, v8 ) );
+
+        Store16( &p_dst[4 * x], y, u, v, c, b_rgba );
+    }
+    RowPlanar8( &p_dst[4 * x], &p_y[x], &p_u[x / 2], &p_v[x / 2],
+                i_width - x, c, b_rgba );
+}
+
+VLC_AVX2
+static void RowSemiPlanar8_AVX2( uint8_t *p_dst, const uint8_t *p_y,
+                                 const uint8_t *p_u, const uint8_t *p_v,
+                                 unsigned i_width, const yuv_rgb32_coeffs_t *c,
+                                 bool b_rgba )
+{
+    const __m128i first  = _mm_setr_epi8( 0, 0, 2, 2, 4, 4, 6, 6,
+                                          8, 8, 10, 10, 12, 12, 14, 14 );
+    const __m128i second = _mm_setr_epi8( 1, 1, 3, 3, 5, 5, 7, 7,
+                                          9, 9, 11, 11, 13, 13, 15, 15 );
+    /* p_u and p_v are adjacent, in either order */
+    const uint8_t *p_uv = __MIN( p_u, p_v );
+    const bool b_swap = p_v < p_u;
+    unsigned x = 0;
+
+    for( ; x + 16 <= i_width; x += 16 )
+    {
+        const __m128i uv = _mm_loadu_si128( (const __m128i *)&p_uv[x] );
+        const __m256i y = _mm256_cvtepu8_epi16(
+                            _mm_loadu_si128( (const __m128i *)&p_y[x] ) );
+        const __m256i c0 = _mm256_cvtepu8_epi16( _mm_shuffle_epi8( uv, first ) );
+        const __m256i c1 = _mm256_cvtepu8_epi16( _mm_shuffle_epi8( uv, second ) );
+
+        Store16( &p_dst[4 * x], y, b_swap ? c1 : c0, b_swap ? c0 : c1,
+                 c, b_rgba );
+    }
+    RowSemiPlanar8( &p_dst[4 * x], &p_y[x], &p_u[x], &p_v[x],
+                    i_width - x, c, b_rgba );
+}
+
+VLC_AVX2
+static void RowSemiPlanar16_AVX2( uint8_t *p_dst, const uint8_t *p_y,
+                                  const uint8_t *p_u, const uint8_t *p_v,
+                                  unsigned i_width,
+                                  const yuv_rgb32_coeffs_t *c, bool b_rgba )
+{
+    const uint8_t *p_uv = __MIN( p_u, p_v );
+    const bool b_swap = p_v < p_u;
+    const __m256i low = _mm256_set1_epi32( 0xffff );
+    unsigned x = 0;
+
+    for( ; x + 16 <= i_width; x += 16 )
+    {
+        const __m256i uv = _mm256_loadu_si256( (const __m256i *)&p_uv[2 * x] );
+        const __m256i y = _mm256_srli_epi16(
+                    _mm256_loadu_si256( (const __m256i *)&p_y[2 * x] ), 6 );
+
+        /* Duplicate each chroma sample over its 2 pixels */
+        __m256i c0 = _mm256_and_si256( uv, low );
+        __m256i c1 = _mm256_srli_epi32( uv, 16 );
+        c0 = _mm256_srli_epi16( _mm256_or_si256( c0, _mm256_slli_epi32( c0, 16 ) ), 6 );
+        c1 = _mm256_srli_epi16( _mm256_or_si256( c1, _mm256_slli_epi32( c1, 16 ) ), 6 );
+
+        Store16( &p_dst[4 * x], y, b_swap ? c1 : c0, b_swap ? c0 : c1,
+                 c, b_rgba );
+    }
+    RowSemiPlanar16( &p_dst[4 * x], &p_y[2 * x], &p_u[2 * x], &p_v[2 * x],
+                     i_width - x, c, b_rgba );
+}
+#endif
+
+/*****************************************************************************
+ * Filter
+ *****************************************************************************/
+static void Convert( filter_t *p_filter, picture_t *p_src, picture_t *p_dst )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const unsigned i_width = p_src->format.i_x_offset
+                           + p_src->format.i_visible_width;
+    const unsigned i_height = p_src->format.i_y_offset
+                            + p_src->format.i_visible_height;
+    const plane_t *p_y = &p_src->p[0];
+    const plane_t *p_u = &p_src->p[1];
+    const plane_t *p_v = &p_src->p[p_src->i_planes > 2 ? 2 : 1];
+    /* Offset of the second chroma sample of semi-planar pictures */
+    const size_t i_v = p_src->i_planes > 2 ? 0 : p_u->i_pixel_pitch / 2;
+
+    p_dst->format.i_x_offset = p_src->format.i_x_offset;
+    p_dst->format.i_y_offset = p_src->format.i_y_offset;
+
+    for( unsigned y = 0; y < i_height; y++ )
+    {
+        const uint8_t *p_u_line = &p_u->p_pixels[(y / 2) * p_u->i_pitch];
+        const uint8_t *p_v_line = &p_v->p_pixels[(y / 2) * p_v->i_pitch + i_v];
+
+        if( p_sys->b_swap_uv )
+        {
+            const uint8_t *p_tmp = p_u_line;
+            p_u_line = p_v_line;
+            p_v_line = p_tmp;
+        }
+        p_sys->row( &p_dst->p[0].p_pixels[y * p_dst->p[0].i_pitch],
+                    &p_y->p_pixels[y * p_y->i_pitch], p_u_line, p_v_line,
+                    i_width, &p_sys->coeffs, p_sys->b_rgba );
+    }
+}
+
+#ifndef YUV_RGB32_TEST
+VIDEO_FILTER_WRAPPER( Convert )
+
+static int Open( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    const video_format_t *p_in = &p_filter->fmt_in.video;
+    const video_format_t *p_out = &p_filter->fmt_out.video;
+
+    /* Without AVX2, the older SIMD converters are faster */
+    if( !vlc_CPU_AVX2() )
+        return VLC_EGENERIC;
+
+    /* resizing not supported */
+    if( p_in->i_x_offset + p_in->i_visible_width !=
+            p_out->i_x_offset + p_out->i_visible_width
+     || p_in->i_y_offset + p_in->i_visible_height !=
+            p_out->i_y_offset + p_out->i_visible_height
+     || p_in->orientation != p_out->orientation )
+        return VLC_EGENERIC;
+
+    bool b_rgba;
+    switch( p_out->i_chroma )
+    {
+        case VLC_CODEC_RGB32:
+            if( p_out->i_rmask == 0xff0000 && p_out->i_gmask == 0xff00
+             && p_out->i_bmask == 0xff )
+                b_rgba = false;
+            else if( p_out->i_rmask == 0xff && p_out->i_gmask == 0xff00
+                  && p_out->i_bmask == 0xff0000 )
+                b_rgba = true;
+            else
+                return VLC_EGENERIC;
+            break;
+        case VLC_CODEC_BGRA:
+            b_rgba = false;
+            break;
+        case VLC_CODEC_RGBA:
+            b_rgba = true;
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+
+    yuv_rgb32_row_t row;
+    unsigned i_bits = 8;
+    bool b_swap_uv = false;
+    switch( p_in->i_chroma )
+    {
+        case VLC_CODEC_YV12:
+            b_swap_uv = true;
+            /* fall through */
+        case VLC_CODEC_I420:
+        case VLC_CODEC_J420:
+            row = RowPlanar8_AVX2;
+            break;
+        case VLC_CODEC_NV21:
+            b_swap_uv = true;
+            /* fall through */
+        case VLC_CODEC_NV12:
+            row = RowSemiPlanar8_AVX2;
+            break;
+        case VLC_CODEC_P010:
+            row = RowSemiPlanar16_AVX2;
+            i_bits = 10;
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+
+    filter_sys_t *p_sys = vlc_obj_malloc( p_this, sizeof(*p_sys) );
+    if( unlikely(p_sys == NULL) )
+        return VLC_ENOMEM;
+
+    video_color_space_t space = p_in->space;
+    if( space == COLOR_SPACE_UNDEF )
+        space = p_in->i_visible_height > 576 ? COLOR_SPACE_BT709
+                                             : COLOR_SPACE_BT601;
+    SetupCoeffs( &p_sys->coeffs, space, p_in->b_color_range_full
+                 || p_in->i_chroma == VLC_CODEC_J420, i_bits );
+    p_sys->row = row;
+    p_sys->b_swap_uv = b_swap_uv;
+    p_sys->b_rgba = b_rgba;
+
+    p_filter->p_sys = p_sys;
+    p_filter->pf_video_filter = Convert_Filter;
+
+    msg_Dbg( p_filter, "%4.4s to %4.4s, BT.%s %s range",
+             (const char *)&p_in->i_chroma, (const char *)&p_out->i_chroma,
+             space == COLOR_SPACE_BT709 ? "709" :
+             space == COLOR_SPACE_BT2020 ? "2020" : "601",
+             p_sys->coeffs.y_offset ? "limited" : "full" );
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+vlc_module_begin ()
+    set_description( N_("AVX2 I420,YV12,NV12,NV21,P010 to "
+                        "RV32,BGRA,RGBA conversions") )
+    set_capability( "video converter", 200 )
+    set_callbacks( Open, NULL )
+vlc_module_end ()
+
+#else /* YUV_RGB32_TEST */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static const struct
+{
+    const char *psz_name;
+    unsigned    i_bits;
+    yuv_rgb32_row_t c;
+    yuv_rgb32_row_t avx2;
+    bool        b_semi;
+} kernels[] = {
+#ifdef HAVE_AVX2_INTRINSICS
+    { "I420", 8,  RowPlanar8,      RowPlanar8_AVX2,      false },
+    { "NV12", 8,  RowSemiPlanar8,  RowSemiPlanar8_AVX2,  true },
+    { "P010", 10, RowSemiPlanar16, RowSemiPlanar16_AVX2, true },
+#endif
+};
+
+/* Reference conversion in floating point */
+static void Reference( uint8_t *p_rgb, int y, int u, int v,
+                       video_color_space_t space, bool b_full, unsigned i_bits )
+{
+    double kr = 0.299, kb = 0.114;
+    if( space == COLOR_SPACE_BT709 )
+        kr = 0.2126, kb = 0.0722;
+    const double kg = 1. - kr - kb;
+    const double scale = 1 << (i_bits - 8);
+    double yf = y / scale, uf = u / scale - 128., vf = v / scale - 128.;
+
+    if( !b_full )
+    {
+        yf = ( yf - 16. ) * 255. / 219.;
+        uf *= 255. / 224.;
+        vf *= 255. / 224.;
+    }
+    const double r = yf + 2. * (1. - kr) * vf;
+    const double g = yf - 2. * (1. - kb) * kb / kg * uf
+                        - 2. * (1. - kr) * kr / kg * vf;
+    const double b = yf + 2. * (1. - kb) * uf;
+
+    p_rgb[0] = VLC_CLIP( lround( b ), 0, 255 );
+    p_rgb[1] = VLC_CLIP( lround( g ), 0, 255 );
+    p_rgb[2] = VLC_CLIP( lround( r ), 0, 255 );
+}
+
+static void TestAccuracy( void )
+{
+    static const video_color_space_t spaces[] = {
+        COLOR_SPACE_BT601, COLOR_SPACE_BT709,
+    };
+
+    for( size_t s = 0; s < ARRAY_SIZE(spaces); s++ )
+        for( int b_full = 0; b_full < 2; b_full++ )
+            for( unsigned i_bits = 8; i_bits <= 10; i_bits += 2 )
+            {
+                yuv_rgb32_coeffs_t c;
+                int i_max_error = 0;
+
+                SetupCoeffs( &c, spaces[s], b_full, i_bits );
+                for( int y = 0; y < 256; y += 3 )
+                    for( int u = 0; u < 256; u += 5 )
+                        for( int v = 0; v < 256; v += 7 )
+                        {
+                            const unsigned k = i_bits - 8;
+                            uint8_t out[4], ref[3];
+
+                            Pixel( out, y << k, u << k, v << k, &c, false );
+                            Reference( ref, y << k, u << k, v << k,
+                                       spaces[s], b_full, i_bits );
+                            for( int i = 0; i < 3; i++ )
+                                i_max_error = __MAX( i_max_error,
+                                                     abs( out[i] - ref[i] ) );
+                            assert( out[3] == 0xff );
+                        }
+                fprintf( stderr, "BT.%s %s range, %u bits: max error %d\n",
+                         spaces[s] == COLOR_SPACE_BT709 ? "709" : "601",
+                         b_full ? "full" : "limited", i_bits, i_max_error );
+                assert( i_max_error <= 1 );
+            }
+}
+
+static void TestKernels( void )
+{
+    /* Odd widths exercise the plain C tails of the vectorized kernels */
+    static const unsigned widths[] = { 1, 15, 16, 17, 33, 720, 1918, 1920 };
+    const unsigned i_max = 1920;
+    uint16_t *p_y = malloc( i_max * 2 );
+    uint16_t *p_uv = malloc( i_max * 2 );
+    uint8_t *p_c = malloc( i_max * 4 );
+    uint8_t *p_simd = malloc( i_max * 4 );
+    assert( p_y && p_uv && p_c && p_simd );
+
+    srand( 0 );
+    for( unsigned i = 0; i < i_max; i++ )
+    {
+        p_y[i] = rand();
+        p_uv[i] = rand();
+    }
+
+    for( size_t k = 0; k < ARRAY_SIZE(kernels); k++ )
+        for( size_t w = 0; w < ARRAY_SIZE(widths); w++ )
+            for( int b_rgba = 0; b_rgba < 2; b_rgba++ )
+            {
+                const uint8_t *p_u = (const uint8_t *)p_uv;
+                const size_t i_v = !kernels[k].b_semi ? i_max / 2
+                                 : kernels[k].i_bits > 8 ? 2 : 1;
+                yuv_rgb32_coeffs_t c;
+
+                SetupCoeffs( &c, COLOR_SPACE_BT709, false, kernels[k].i_bits );
+                kernels[k].c( p_c, (const uint8_t *)p_y, p_u, &p_u[i_v],
+                              widths[w], &c, b_rgba );
+                kernels[k].avx2( p_simd, (const uint8_t *)p_y, p_u, &p_u[i_v],
+                                 widths[w], &c, b_rgba );
+                assert( !memcmp( p_c, p_simd, 4 * widths[w] ) );
+
+                /* Swapped chroma */
+                kernels[k].c( p_c, (const uint8_t *)p_y, &p_u[i_v], p_u,
+                              widths[w], &c, b_rgba );
+                kernels[k].avx2( p_simd, (const uint8_t *)p_y, &p_u[i_v], p_u,
+                                 widths[w], &c, b_rgba );
+                assert( !memcmp( p_c, p_simd, 4 * widths[w] ) );
+            }
+
+    free( p_simd );
+    free( p_c );
+    free( p_uv );
+    free( p_y );
+}
+
+static double Bench( yuv_rgb32_row_t row, unsigned i_bits, bool b_semi )
+{
+    const unsigned i_width = 1920, i_height = 1080, i_frames = 20;
+    const size_t i_pixel = i_bits > 8 ? 2 : 1;
+    uint8_t *p_y = calloc( i_width * i_height, i_pixel );
+    uint8_t *p_uv = calloc( i_width * i_height / 2, i_pixel );
+    uint8_t *p_rgb = malloc( i_width * i_height * 4 );
+    const size_t i_v = b_semi ? i_pixel : i_width / 2;
+    const size_t i_cpitch = i_width * i_pixel / ( b_semi ? 1 : 2 );
+    yuv_rgb32_coeffs_t c;
+    struct timespec t0, t1;
+
+    assert( p_y && p_uv && p_rgb );
+    SetupCoeffs( &c, COLOR_SPACE_BT709, false, i_bits );
+
+    clock_gettime( CLOCK_MONOTONIC, &t0 );
+    for( unsigned f = 0; f < i_frames; f++ )
+        for( unsigned y = 0; y < i_height; y++ )
+        {
+            const uint8_t *p_u = &p_uv[(y / 2) * i_cpitch];
+            row( &p_rgb[y * i_width * 4], &p_y[y * i_width * i_pixel],
+                 p_u, &p_u[i_v], i_width, &c, false );
+        }
+    clock_gettime( CLOCK_MONOTONIC, &t1 );
+
+    free( p_rgb );
+    free( p_uv );
+    free( p_y );
+    return ( ( t1.tv_sec - t0.tv_sec ) * 1e3
+           + ( t1.tv_nsec - t0.tv_nsec ) / 1e6 ) / i_frames;
+}
+
+int main( void )
+{
+    alarm( 30 );
+
+    TestAccuracy();
+
+    if( !vlc_CPU_AVX2() || ARRAY_SIZE(kernels) == 0 )
+    {
+        fprintf( stderr, "WARNING: could not test AVX2\n" );
+        return 77;
+    }
+    TestKernels();
+
+    for( size_t k = 0; k < ARRAY_SIZE(kernels); k++ )
+        fprintf( stderr, "%s 1920x1080: C %.2f ms, AVX2 %.2f ms\n",
+                 kernels[k].psz_name,
+                 Bench( kernels[k].c, kernels[k].i_bits, kernels[k].b_semi ),
+                 Bench( kernels[k].avx2, kernels[k].i_bits,
+                        kernels[k].b_semi ) );
+    return 0;
+}
+#endif
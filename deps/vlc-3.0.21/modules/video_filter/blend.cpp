@@ -28,15 +28,32 @@
 # include "config.h"
 #endif
 
+#ifdef BLEND_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_cpu.h>
 #include "filter_picture.h"
 
+#ifdef HAVE_SSE4_1_INTRINSICS
+# include <smmintrin.h>
+# define VLC_SSE4_1 __attribute__ ((__target__ ("sse4.1")))
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
+#ifndef BLEND_TEST
 static int  Open (vlc_object_t *);
 static void Close(vlc_object_t *);
 
@@ -45,6 +62,7 @@ vlc_module_begin()
     set_capability("video blending", 100)
     set_callbacks(Open, Close)
 vlc_module_end()
+#endif
 
 static inline unsigned div255(unsigned v)
 {
@@ -79,6 +97,18 @@ public:
     {
         return fmt;
     }
+    const picture_t *getPicture() const
+    {
+        return picture;
+    }
+    unsigned getX() const
+    {
+        return x;
+    }
+    unsigned getY() const
+    {
+        return y;
+    }
     bool isFull(unsigned) const
     {
         return true;
@@ -551,6 +581,569 @@ void Blend(const CPicture &dst_data, const CPicture &src_data,
 typedef void (*blend_function_t)(const CPicture &dst_data, const CPicture &src_data,
                                  unsigned width, unsigned height, int alpha);
 
+/*****************************************************************************
+ * Row kernels for the most common pairs
+ *
+ * They give exactly the same results as the generic Blend(): the vectorized
+ * ones use the same integer arithmetic on 16 or 32-bit lanes, and the plain
+ * C ones below handle the end of the rows.
+ *****************************************************************************/
+#if defined(HAVE_SSE4_1_INTRINSICS) || defined(HAVE_AVX2_INTRINSICS)
+typedef void (*blend_luma_t)(uint8_t *dst, const uint8_t *src,
+                             const uint8_t *src_a, unsigned width,
+                             unsigned alpha);
+/* The sources are read every other pixel */
+typedef void (*blend_chroma_t)(uint8_t *dst_u, uint8_t *dst_v,
+                               const uint8_t *src_u, const uint8_t *src_v,
+                               const uint8_t *src_a, unsigned count,
+                               unsigned alpha);
+typedef void (*blend_yuva_rgb32_t)(uint8_t *dst, const uint8_t *src_y,
+                                   const uint8_t *src_u, const uint8_t *src_v,
+                                   const uint8_t *src_a, unsigned width,
+                                   unsigned alpha, const unsigned offsets[3]);
+typedef void (*blend_rgba_rgb32_t)(uint8_t *dst, const uint8_t *src,
+                                   unsigned width, unsigned alpha,
+                                   const unsigned offsets[3]);
+
+/* Same fixed point coefficients as yuv_to_rgb() */
+#define FIX(x) ((int) ((x) * (1 << 10) + 0.5))
+static const int yuv_rgb_y  = FIX(255.0/219.0);
+static const int yuv_rgb_rv = FIX(1.40200*255.0/224.0);
+static const int yuv_rgb_gu = FIX(0.34414*255.0/224.0);
+static const int yuv_rgb_gv = FIX(0.71414*255.0/224.0);
+static const int yuv_rgb_bu = FIX(1.77200*255.0/224.0);
+#undef FIX
+
+static void BlendLuma_C(uint8_t *dst, const uint8_t *src, const uint8_t *src_a,
+                        unsigned width, unsigned alpha)
+{
+    for (unsigned x = 0; x < width; x++)
+        merge(&dst[x], src[x], div255(alpha * src_a[x]));
+}
+
+static void BlendChroma_C(uint8_t *dst_u, uint8_t *dst_v,
+                          const uint8_t *src_u, const uint8_t *src_v,
+                          const uint8_t *src_a, unsigned count, unsigned alpha)
+{
+    for (unsigned i = 0; i < count; i++) {
+        unsigned a = div255(alpha * src_a[2 * i]);
+        merge(&dst_u[i], src_u[2 * i], a);
+        merge(&dst_v[i], src_v[2 * i], a);
+    }
+}
+
+static void BlendYUVARGB32_C(uint8_t *dst, const uint8_t *src_y,
+                             const uint8_t *src_u, const uint8_t *src_v,
+                             const uint8_t *src_a, unsigned width,
+                             unsigned alpha, const unsigned offsets[3])
+{
+    for (unsigned x = 0; x < width; x++) {
+        int r, g, b;
+        yuv_to_rgb(&r, &g, &b, src_y[x], src_u[x], src_v[x]);
+
+        unsigned a = div255(alpha * src_a[x]);
+        merge(&dst[4 * x + offsets[0]], r, a);
+        merge(&dst[4 * x + offsets[1]], g, a);
+        merge(&dst[4 * x + offsets[2]], b, a);
+    }
+}
+
+static void BlendRGBARGB32_C(uint8_t *dst, const uint8_t *src,
+                             unsigned width, unsigned alpha,
+                             const unsigned offsets[3])
+{
+    for (unsigned x = 0; x < width; x++) {
+        unsigned a = div255(alpha * src[4 * x + 3]);
+        merge(&dst[4 * x + offsets[0]], src[4 * x + 0], a);
+        merge(&dst[4 * x + offsets[1]], src[4 * x + 1], a);
+        merge(&dst[4 * x + offsets[2]], src[4 * x + 2], a);
+    }
+}
+
+#ifdef HAVE_SSE4_1_INTRINSICS
+/* div255() of 16-bit lanes */
+VLC_SSE4_1
+static inline __m128i Div255_SSE4_1(__m128i v)
+{
+    v = _mm_add_epi16(_mm_add_epi16(_mm_srli_epi16(v, 8), v),
+                      _mm_set1_epi16(1));
+    return _mm_srli_epi16(v, 8);
+}
+
+/* merge() of 16-bit lanes */
+VLC_SSE4_1
+static inline __m128i Merge_SSE4_1(__m128i dst, __m128i src, __m128i f)
+{
+    const __m128i nf = _mm_sub_epi16(_mm_set1_epi16(255), f);
+    return Div255_SSE4_1(_mm_add_epi16(_mm_mullo_epi16(dst, nf),
+                                       _mm_mullo_epi16(src, f)));
+}
+
+/* merge() of bytes */
+VLC_SSE4_1
+static inline __m128i MergeBytes_SSE4_1(__m128i dst, __m128i src, __m128i f)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = Merge_SSE4_1(_mm_unpacklo_epi8(dst, zero),
+                              _mm_unpacklo_epi8(src, zero),
+                              _mm_unpacklo_epi8(f, zero));
+    __m128i hi = Merge_SSE4_1(_mm_unpackhi_epi8(dst, zero),
+                              _mm_unpackhi_epi8(src, zero),
+                              _mm_unpackhi_epi8(f, zero));
+    return _mm_packus_epi16(lo, hi);
+}
+
+/* Places the components, in 32-bit lanes, at their offsets in RGB32 pixels */
+VLC_SSE4_1
+static inline __m128i PackRGB32_SSE4_1(__m128i r, __m128i g, __m128i b,
+                                       const __m128i shifts[3])
+{
+    return _mm_or_si128(_mm_or_si128(_mm_sll_epi32(r, shifts[0]),
+                                     _mm_sll_epi32(g, shifts[1])),
+                        _mm_sll_epi32(b, shifts[2]));
+}
+
+VLC_SSE4_1
+static void BlendLuma_SSE4_1(uint8_t *dst, const uint8_t *src,
+                             const uint8_t *src_a, unsigned width,
+                             unsigned alpha)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i va = _mm_set1_epi16(alpha);
+    unsigned x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)&src_a[x]);
+        __m128i f = _mm_packus_epi16(
+            Div255_SSE4_1(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), va)),
+            Div255_SSE4_1(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), va)));
+        __m128i d = _mm_loadu_si128((const __m128i *)&dst[x]);
+        __m128i s = _mm_loadu_si128((const __m128i *)&src[x]);
+        _mm_storeu_si128((__m128i *)&dst[x], MergeBytes_SSE4_1(d, s, f));
+    }
+    BlendLuma_C(&dst[x], &src[x], &src_a[x], width - x, alpha);
+}
+
+VLC_SSE4_1
+static void BlendChroma_SSE4_1(uint8_t *dst_u, uint8_t *dst_v,
+                               const uint8_t *src_u, const uint8_t *src_v,
+                               const uint8_t *src_a, unsigned count,
+                               unsigned alpha)
+{
+    const __m128i even = _mm_set1_epi16(0x00ff);
+    const __m128i va = _mm_set1_epi16(alpha);
+    unsigned i = 0;
+
+    /* The last sample is left to the C code, so as not to read past the
+     * end of the source rows */
+    for (; i + 8 < count; i += 8) {
+        __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i *)&src_a[2 * i]), even);
+        __m128i f = Div255_SSE4_1(_mm_mullo_epi16(a, va));
+
+        __m128i s = _mm_and_si128(_mm_loadu_si128((const __m128i *)&src_u[2 * i]), even);
+        __m128i d = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)&dst_u[i]));
+        d = Merge_SSE4_1(d, s, f);
+        _mm_storel_epi64((__m128i *)&dst_u[i], _mm_packus_epi16(d, d));
+
+        s = _mm_and_si128(_mm_loadu_si128((const __m128i *)&src_v[2 * i]), even);
+        d = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)&dst_v[i]));
+        d = Merge_SSE4_1(d, s, f);
+        _mm_storel_epi64((__m128i *)&dst_v[i], _mm_packus_epi16(d, d));
+    }
+    BlendChroma_C(&dst_u[i], &dst_v[i], &src_u[2 * i], &src_v[2 * i],
+                  &src_a[2 * i], count - i, alpha);
+}
+
+VLC_SSE4_1
+static void BlendYUVARGB32_SSE4_1(uint8_t *dst, const uint8_t *src_y,
+                                  const uint8_t *src_u, const uint8_t *src_v,
+                                  const uint8_t *src_a, unsigned width,
+                                  unsigned alpha, const unsigned offsets[3])
+{
+    const __m128i shifts[3] = {
+        _mm_cvtsi32_si128(8 * offsets[0]),
+        _mm_cvtsi32_si128(8 * offsets[1]),
+        _mm_cvtsi32_si128(8 * offsets[2]),
+    };
+    const __m128i va = _mm_set1_epi32(alpha);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi32(255);
+    unsigned x = 0;
+
+    for (; x + 4 <= width; x += 4) {
+        int32_t y4, u4, v4, a4;
+        memcpy(&y4, &src_y[x], 4);
+        memcpy(&u4, &src_u[x], 4);
+        memcpy(&v4, &src_v[x], 4);
+        memcpy(&a4, &src_a[x], 4);
+
+        __m128i cb = _mm_sub_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(u4)),
+                                   _mm_set1_epi32(128));
+        __m128i cr = _mm_sub_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(v4)),
+                                   _mm_set1_epi32(128));
+        __m128i y = _mm_sub_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(y4)),
+                                  _mm_set1_epi32(16));
+        y = _mm_add_epi32(_mm_mullo_epi32(y, _mm_set1_epi32(yuv_rgb_y)),
+                          _mm_set1_epi32(1 << 9));
+
+        __m128i r = _mm_add_epi32(y, _mm_mullo_epi32(cr, _mm_set1_epi32(yuv_rgb_rv)));
+        __m128i g = _mm_sub_epi32(y, _mm_add_epi32(
+                        _mm_mullo_epi32(cb, _mm_set1_epi32(yuv_rgb_gu)),
+                        _mm_mullo_epi32(cr, _mm_set1_epi32(yuv_rgb_gv))));
+        __m128i b = _mm_add_epi32(y, _mm_mullo_epi32(cb, _mm_set1_epi32(yuv_rgb_bu)));
+        r = _mm_min_epi32(_mm_max_epi32(_mm_srai_epi32(r, 10), zero), max);
+        g = _mm_min_epi32(_mm_max_epi32(_mm_srai_epi32(g, 10), zero), max);
+        b = _mm_min_epi32(_mm_max_epi32(_mm_srai_epi32(b, 10), zero), max);
+
+        /* The upper halves of the 32-bit lanes stay null */
+        __m128i a = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(a4));
+        a = Div255_SSE4_1(_mm_mullo_epi16(a, va));
+
+        __m128i d = _mm_loadu_si128((const __m128i *)&dst[4 * x]);
+        d = MergeBytes_SSE4_1(d, PackRGB32_SSE4_1(r, g, b, shifts),
+                              PackRGB32_SSE4_1(a, a, a, shifts));
+        _mm_storeu_si128((__m128i *)&dst[4 * x], d);
+    }
+    BlendYUVARGB32_C(&dst[4 * x], &src_y[x], &src_u[x], &src_v[x], &src_a[x],
+                     width - x, alpha, offsets);
+}
+
+VLC_SSE4_1
+static void BlendRGBARGB32_SSE4_1(uint8_t *dst, const uint8_t *src,
+                                  unsigned width, unsigned alpha,
+                                  const unsigned offsets[3])
+{
+    const __m128i shifts[3] = {
+        _mm_cvtsi32_si128(8 * offsets[0]),
+        _mm_cvtsi32_si128(8 * offsets[1]),
+        _mm_cvtsi32_si128(8 * offsets[2]),
+    };
+    const __m128i va = _mm_set1_epi32(alpha);
+    const __m128i mask = _mm_set1_epi32(0xff);
+    unsigned x = 0;
+
+    for (; x + 4 <= width; x += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)&src[4 * x]);
+        __m128i r = _mm_and_si128(s, mask);
+        __m128i g = _mm_and_si128(_mm_srli_epi32(s, 8), mask);
+        __m128i b = _mm_and_si128(_mm_srli_epi32(s, 16), mask);
+        __m128i a = Div255_SSE4_1(_mm_mullo_epi16(_mm_srli_epi32(s, 24), va));
+
+        __m128i d = _mm_loadu_si128((const __m128i *)&dst[4 * x]);
+        d = MergeBytes_SSE4_1(d, PackRGB32_SSE4_1(r, g, b, shifts),
+                              PackRGB32_SSE4_1(a, a, a, shifts));
+        _mm_storeu_si128((__m128i *)&dst[4 * x], d);
+    }
+    BlendRGBARGB32_C(&dst[4 * x], &src[4 * x], width - x, alpha, offsets);
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+VLC_AVX2
+static inline __m256i Div255_AVX2(__m256i v)
+{
+    v = _mm256_add_epi16(_mm256_add_epi16(_mm256_srli_epi16(v, 8), v),
+                         _mm256_set1_epi16(1));
+    return _mm256_srli_epi16(v, 8);
+}
+
+VLC_AVX2
+static inline __m256i Merge_AVX2(__m256i dst, __m256i src, __m256i f)
+{
+    const __m256i nf = _mm256_sub_epi16(_mm256_set1_epi16(255), f);
+    return Div255_AVX2(_mm256_add_epi16(_mm256_mullo_epi16(dst, nf),
+                                        _mm256_mullo_epi16(src, f)));
+}
+
+/* The unpacking and the packing both work within 128-bit lanes, so the
+ * bytes end up in their original order */
+VLC_AVX2
+static inline __m256i MergeBytes_AVX2(__m256i dst, __m256i src, __m256i f)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i lo = Merge_AVX2(_mm256_unpacklo_epi8(dst, zero),
+                            _mm256_unpacklo_epi8(src, zero),
+                            _mm256_unpacklo_epi8(f, zero));
+    __m256i hi = Merge_AVX2(_mm256_unpackhi_epi8(dst, zero),
+                            _mm256_unpackhi_epi8(src, zero),
+                            _mm256_unpackhi_epi8(f, zero));
+    return _mm256_packus_epi16(lo, hi);
+}
+
+VLC_AVX2
+static inline __m256i PackRGB32_AVX2(__m256i r, __m256i g, __m256i b,
+                                     const __m128i shifts[3])
+{
+    return _mm256_or_si256(_mm256_or_si256(_mm256_sll_epi32(r, shifts[0]),
+                                           _mm256_sll_epi32(g, shifts[1])),
+                           _mm256_sll_epi32(b, shifts[2]));
+}
+
+VLC_AVX2
+static void BlendLuma_AVX2(uint8_t *dst, const uint8_t *src,
+                           const uint8_t *src_a, unsigned width,
+                           unsigned alpha)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i va = _mm256_set1_epi16(alpha);
+    unsigned x = 0;
+
+    for (; x + 32 <= width; x += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)&src_a[x]);
+        __m256i f = _mm256_packus_epi16(
+            Div255_AVX2(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), va)),
+            Div255_AVX2(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), va)));
+        __m256i d = _mm256_loadu_si256((const __m256i *)&dst[x]);
+        __m256i s = _mm256_loadu_si256((const __m256i *)&src[x]);
+        _mm256_storeu_si256((__m256i *)&dst[x], MergeBytes_AVX2(d, s, f));
+    }
+    BlendLuma_C(&dst[x], &src[x], &src_a[x], width - x, alpha);
+}
+
+VLC_AVX2
+static void BlendChroma_AVX2(uint8_t *dst_u, uint8_t *dst_v,
+                             const uint8_t *src_u, const uint8_t *src_v,
+                             const uint8_t *src_a, unsigned count,
+                             unsigned alpha)
+{
+    const __m256i even = _mm256_set1_epi16(0x00ff);
+    const __m256i va = _mm256_set1_epi16(alpha);
+    unsigned i = 0;
+
+    for (; i + 16 < count; i += 16) {
+        __m256i a = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)&src_a[2 * i]), even);
+        __m256i f = Div255_AVX2(_mm256_mullo_epi16(a, va));
+
+        __m256i s = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)&src_u[2 * i]), even);
+        __m256i d = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)&dst_u[i]));
+        d = Merge_AVX2(d, s, f);
+        _mm_storeu_si128((__m128i *)&dst_u[i],
+                         _mm_packus_epi16(_mm256_castsi256_si128(d),
+                                          _mm256_extracti128_si256(d, 1)));
+
+        s = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)&src_v[2 * i]), even);
+        d = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)&dst_v[i]));
+        d = Merge_AVX2(d, s, f);
+        _mm_storeu_si128((__m128i *)&dst_v[i],
+                         _mm_packus_epi16(_mm256_castsi256_si128(d),
+                                          _mm256_extracti128_si256(d, 1)));
+    }
+    BlendChroma_C(&dst_u[i], &dst_v[i], &src_u[2 * i], &src_v[2 * i],
+                  &src_a[2 * i], count - i, alpha);
+}
+
+VLC_AVX2
+static void BlendYUVARGB32_AVX2(uint8_t *dst, const uint8_t *src_y,
+                                const uint8_t *src_u, const uint8_t *src_v,
+                                const uint8_t *src_a, unsigned width,
+                                unsigned alpha, const unsigned offsets[3])
+{
+    const __m128i shifts[3] = {
+        _mm_cvtsi32_si128(8 * offsets[0]),
+        _mm_cvtsi32_si128(8 * offsets[1]),
+        _mm_cvtsi32_si128(8 * offsets[2]),
+    };
+    const __m256i va = _mm256_set1_epi32(alpha);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi32(255);
+    unsigned x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i cb = _mm256_sub_epi32(
+            _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&src_u[x])),
+            _mm256_set1_epi32(128));
+        __m256i cr = _mm256_sub_epi32(
+            _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&src_v[x])),
+            _mm256_set1_epi32(128));
+        __m256i y = _mm256_sub_epi32(
+            _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&src_y[x])),
+            _mm256_set1_epi32(16));
+        y = _mm256_add_epi32(_mm256_mullo_epi32(y, _mm256_set1_epi32(yuv_rgb_y)),
+                             _mm256_set1_epi32(1 << 9));
+
+        __m256i r = _mm256_add_epi32(y, _mm256_mullo_epi32(cr, _mm256_set1_epi32(yuv_rgb_rv)));
+        __m256i g = _mm256_sub_epi32(y, _mm256_add_epi32(
+                        _mm256_mullo_epi32(cb, _mm256_set1_epi32(yuv_rgb_gu)),
+                        _mm256_mullo_epi32(cr, _mm256_set1_epi32(yuv_rgb_gv))));
+        __m256i b = _mm256_add_epi32(y, _mm256_mullo_epi32(cb, _mm256_set1_epi32(yuv_rgb_bu)));
+        r = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(r, 10), zero), max);
+        g = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(g, 10), zero), max);
+        b = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(b, 10), zero), max);
+
+        __m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&src_a[x]));
+        a = Div255_AVX2(_mm256_mullo_epi16(a, va));
+
+        __m256i d = _mm256_loadu_si256((const __m256i *)&dst[4 * x]);
+        d = MergeBytes_AVX2(d, PackRGB32_AVX2(r, g, b, shifts),
+                            PackRGB32_AVX2(a, a, a, shifts));
+        _mm256_storeu_si256((__m256i *)&dst[4 * x], d);
+    }
+    BlendYUVARGB32_C(&dst[4 * x], &src_y[x], &src_u[x], &src_v[x], &src_a[x],
+                     width - x, alpha, offsets);
+}
+
+VLC_AVX2
+static void BlendRGBARGB32_AVX2(uint8_t *dst, const uint8_t *src,
+                                unsigned width, unsigned alpha,
+                                const unsigned offsets[3])
+{
+    const __m128i shifts[3] = {
+        _mm_cvtsi32_si128(8 * offsets[0]),
+        _mm_cvtsi32_si128(8 * offsets[1]),
+        _mm_cvtsi32_si128(8 * offsets[2]),
+    };
+    const __m256i va = _mm256_set1_epi32(alpha);
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    unsigned x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i s = _mm256_loadu_si256((const __m256i *)&src[4 * x]);
+        __m256i r = _mm256_and_si256(s, mask);
+        __m256i g = _mm256_and_si256(_mm256_srli_epi32(s, 8), mask);
+        __m256i b = _mm256_and_si256(_mm256_srli_epi32(s, 16), mask);
+        __m256i a = Div255_AVX2(_mm256_mullo_epi16(_mm256_srli_epi32(s, 24), va));
+
+        __m256i d = _mm256_loadu_si256((const __m256i *)&dst[4 * x]);
+        d = MergeBytes_AVX2(d, PackRGB32_AVX2(r, g, b, shifts),
+                            PackRGB32_AVX2(a, a, a, shifts));
+        _mm256_storeu_si256((__m256i *)&dst[4 * x], d);
+    }
+    BlendRGBARGB32_C(&dst[4 * x], &src[4 * x], width - x, alpha, offsets);
+}
+#endif
+
+/*****************************************************************************
+ * Blending of whole pictures with the row kernels
+ *****************************************************************************/
+static uint8_t *GetPixels(const CPicture &data, unsigned plane,
+                          unsigned x, unsigned y, unsigned pixel_size = 1)
+{
+    const plane_t *p = &data.getPicture()->p[plane];
+    return &p->p_pixels[y * p->i_pitch + x * pixel_size];
+}
+
+template <blend_luma_t luma, blend_chroma_t chroma, bool swap_uv>
+void BlendYUVAToI420(const CPicture &dst_data, const CPicture &src_data,
+                     unsigned width, unsigned height, int alpha)
+{
+    const unsigned dx = dst_data.getX(), dy = dst_data.getY();
+    const unsigned sx = src_data.getX(), sy = src_data.getY();
+
+    /* The chroma is taken from the pixels at even destination columns */
+    const unsigned first = dx % 2;
+    const unsigned count = width > first ? (width - first + 1) / 2 : 0;
+
+    for (unsigned y = 0; y < height; y++) {
+        luma(GetPixels(dst_data, Y_PLANE, dx, dy + y),
+             GetPixels(src_data, Y_PLANE, sx, sy + y),
+             GetPixels(src_data, A_PLANE, sx, sy + y), width, alpha);
+
+        if ((dy + y) % 2 == 0)
+            chroma(GetPixels(dst_data, swap_uv ? V_PLANE : U_PLANE,
+                             (dx + first) / 2, (dy + y) / 2),
+                   GetPixels(dst_data, swap_uv ? U_PLANE : V_PLANE,
+                             (dx + first) / 2, (dy + y) / 2),
+                   GetPixels(src_data, U_PLANE, sx + first, sy + y),
+                   GetPixels(src_data, V_PLANE, sx + first, sy + y),
+                   GetPixels(src_data, A_PLANE, sx + first, sy + y),
+                   count, alpha);
+    }
+}
+
+/* Same byte offsets as CPictureRGB32 */
+static void GetRGB32Offsets(const video_format_t *fmt, unsigned offsets[3])
+{
+#ifdef WORDS_BIGENDIAN
+    offsets[0] = (32 - fmt->i_lrshift) / 8;
+    offsets[1] = (32 - fmt->i_lgshift) / 8;
+    offsets[2] = (32 - fmt->i_lbshift) / 8;
+#else
+    offsets[0] = fmt->i_lrshift / 8;
+    offsets[1] = fmt->i_lgshift / 8;
+    offsets[2] = fmt->i_lbshift / 8;
+#endif
+}
+
+template <blend_yuva_rgb32_t row>
+void BlendYUVAToRGB32(const CPicture &dst_data, const CPicture &src_data,
+                      unsigned width, unsigned height, int alpha)
+{
+    const unsigned dx = dst_data.getX(), dy = dst_data.getY();
+    const unsigned sx = src_data.getX(), sy = src_data.getY();
+    unsigned offsets[3];
+
+    GetRGB32Offsets(dst_data.getFormat(), offsets);
+    for (unsigned y = 0; y < height; y++)
+        row(GetPixels(dst_data, 0, dx, dy + y, 4),
+            GetPixels(src_data, Y_PLANE, sx, sy + y),
+            GetPixels(src_data, U_PLANE, sx, sy + y),
+            GetPixels(src_data, V_PLANE, sx, sy + y),
+            GetPixels(src_data, A_PLANE, sx, sy + y),
+            width, alpha, offsets);
+}
+
+template <blend_rgba_rgb32_t row>
+void BlendRGBAToRGB32(const CPicture &dst_data, const CPicture &src_data,
+                      unsigned width, unsigned height, int alpha)
+{
+    const unsigned dx = dst_data.getX(), dy = dst_data.getY();
+    const unsigned sx = src_data.getX(), sy = src_data.getY();
+    unsigned offsets[3];
+
+    GetRGB32Offsets(dst_data.getFormat(), offsets);
+    for (unsigned y = 0; y < height; y++)
+        row(GetPixels(dst_data, 0, dx, dy + y, 4),
+            GetPixels(src_data, 0, sx, sy + y, 4),
+            width, alpha, offsets);
+}
+
+#endif
+
+#ifdef HAVE_SSE4_1_INTRINSICS
+static bool HasSSE4_1(void)
+{
+    return vlc_CPU_SSE4_1();
+}
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+static bool HasAVX2(void)
+{
+    return vlc_CPU_AVX2();
+}
+#endif
+
+/* The first usable entry wins, so the widest vectors come first */
+static const struct {
+    vlc_fourcc_t     dst;
+    vlc_fourcc_t     src;
+    const char      *name;
+    bool           (*usable)(void);
+    blend_function_t blend;
+} simd_blends[] = {
+#undef SIMD
+#define SIMD(usable, isa) \
+    { VLC_CODEC_I420,  VLC_CODEC_YUVA, #isa, usable, \
+      BlendYUVAToI420<BlendLuma_##isa, BlendChroma_##isa, false> }, \
+    { VLC_CODEC_J420,  VLC_CODEC_YUVA, #isa, usable, \
+      BlendYUVAToI420<BlendLuma_##isa, BlendChroma_##isa, false> }, \
+    { VLC_CODEC_YV12,  VLC_CODEC_YUVA, #isa, usable, \
+      BlendYUVAToI420<BlendLuma_##isa, BlendChroma_##isa, true> }, \
+    { VLC_CODEC_RGB32, VLC_CODEC_YUVA, #isa, usable, \
+      BlendYUVAToRGB32<BlendYUVARGB32_##isa> }, \
+    { VLC_CODEC_RGB32, VLC_CODEC_RGBA, #isa, usable, \
+      BlendRGBAToRGB32<BlendRGBARGB32_##isa> }
+
+#ifdef HAVE_AVX2_INTRINSICS
+    SIMD(HasAVX2, AVX2),
+#endif
+#ifdef HAVE_SSE4_1_INTRINSICS
+    SIMD(HasSSE4_1, SSE4_1),
+#endif
+#undef SIMD
+    /* Not all compilers accept empty arrays */
+    { 0, 0, NULL, NULL, NULL },
+};
+
 static const struct {
     vlc_fourcc_t     dst;
     vlc_fourcc_t     src;
@@ -623,6 +1216,7 @@ static const struct {
 #undef YUV
 };
 
+#ifndef BLEND_TEST
 struct filter_sys_t {
     filter_sys_t() : blend(NULL)
     {
@@ -671,7 +1265,12 @@ static int Open(vlc_object_t *object)
     const vlc_fourcc_t dst = filter->fmt_out.video.i_chroma;
 
     filter_sys_t *sys = new filter_sys_t();
-    for (size_t i = 0; i < sizeof(blends) / sizeof(*blends); i++) {
+    for (size_t i = 0; i < ARRAY_SIZE(simd_blends) && !sys->blend; i++) {
+        if (simd_blends[i].src == src && simd_blends[i].dst == dst &&
+            simd_blends[i].usable())
+            sys->blend = simd_blends[i].blend;
+    }
+    for (size_t i = 0; i < sizeof(blends) / sizeof(*blends) && !sys->blend; i++) {
         if (blends[i].src == src && blends[i].dst == dst)
             sys->blend = blends[i].blend;
     }
@@ -693,4 +1292,155 @@ static void Close(vlc_object_t *object)
     filter_t *filter = (filter_t *)object;
     delete filter->p_sys;
 }
+#else /* BLEND_TEST */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static blend_function_t GetGenericBlend(vlc_fourcc_t dst, vlc_fourcc_t src)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(blends); i++)
+        if (blends[i].src == src && blends[i].dst == dst)
+            return blends[i].blend;
+    abort();
+}
+
+static void InitFormat(video_format_t *fmt, vlc_fourcc_t chroma,
+                       unsigned width, unsigned height)
+{
+    video_format_Init(fmt, chroma);
+    fmt->i_width  = fmt->i_visible_width  = width;
+    fmt->i_height = fmt->i_visible_height = height;
+    fmt->i_sar_num = fmt->i_sar_den = 1;
+    if (chroma == VLC_CODEC_RGB32) {
+        /* BGRX in memory */
+        fmt->i_rmask = 0x00ff0000;
+        fmt->i_gmask = 0x0000ff00;
+        fmt->i_bmask = 0x000000ff;
+    }
+    video_format_FixRgb(fmt);
+}
+
+static picture_t *NewPicture(const video_format_t *fmt)
+{
+    picture_t *pic = picture_NewFromFormat(fmt);
+    assert(pic != NULL);
+    for (int i = 0; i < pic->i_planes; i++)
+        for (int j = 0; j < pic->p[i].i_pitch * pic->p[i].i_lines; j++)
+            pic->p[i].p_pixels[j] = rand();
+    return pic;
+}
+
+static void CopyPicture(picture_t *dst, const picture_t *src)
+{
+    for (int i = 0; i < src->i_planes; i++)
+        memcpy(dst->p[i].p_pixels, src->p[i].p_pixels,
+               src->p[i].i_pitch * src->p[i].i_lines);
+}
+
+static bool ComparePictures(const picture_t *a, const picture_t *b)
+{
+    for (int i = 0; i < a->i_planes; i++)
+        if (memcmp(a->p[i].p_pixels, b->p[i].p_pixels,
+                   a->p[i].i_pitch * a->p[i].i_lines))
+            return false;
+    return true;
+}
+
+static void TestBlend(vlc_fourcc_t dst_chroma, vlc_fourcc_t src_chroma,
+                      blend_function_t simd)
+{
+    /* Odd sizes and offsets exercise the plain C tails and the chroma
+     * subsampling of the destination */
+    static const unsigned src_widths[] = { 1, 15, 16, 17, 33, 67, 720 };
+    static const int alphas[] = { 255, 128, 1 };
+    blend_function_t generic = GetGenericBlend(dst_chroma, src_chroma);
+    video_format_t dst_fmt, src_fmt;
+
+    InitFormat(&dst_fmt, dst_chroma, 736, 24);
+    picture_t *ref = NewPicture(&dst_fmt);
+    picture_t *out = NewPicture(&dst_fmt);
+    picture_t *init = NewPicture(&dst_fmt);
+
+    for (size_t w = 0; w < ARRAY_SIZE(src_widths); w++) {
+        InitFormat(&src_fmt, src_chroma, src_widths[w] + 1, 17);
+        picture_t *src = NewPicture(&src_fmt);
+
+        for (unsigned sx = 0; sx < 2; sx++)
+            for (unsigned x = 0; x < 4; x++)
+                for (unsigned y = 0; y < 2; y++)
+                    for (size_t a = 0; a < ARRAY_SIZE(alphas); a++) {
+                        const unsigned width = src_widths[w];
+                        const unsigned height = 17 - sx - y;
+
+                        CopyPicture(ref, init);
+                        CopyPicture(out, init);
+                        generic(CPicture(ref, &dst_fmt, x, y),
+                                CPicture(src, &src_fmt, sx, sx),
+                                width, height, alphas[a]);
+                        simd(CPicture(out, &dst_fmt, x, y),
+                             CPicture(src, &src_fmt, sx, sx),
+                             width, height, alphas[a]);
+                        assert(ComparePictures(ref, out));
+                    }
+        picture_Release(src);
+    }
+
+    picture_Release(init);
+    picture_Release(out);
+    picture_Release(ref);
+}
+
+static double Bench(vlc_fourcc_t dst_chroma, vlc_fourcc_t src_chroma,
+                    blend_function_t blend)
+{
+    const unsigned width = 1920, height = 1080, frames = 20;
+    video_format_t dst_fmt, src_fmt;
+    struct timespec t0, t1;
+
+    InitFormat(&dst_fmt, dst_chroma, width, height);
+    InitFormat(&src_fmt, src_chroma, width, height);
+    picture_t *dst = NewPicture(&dst_fmt);
+    picture_t *src = NewPicture(&src_fmt);
 
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (unsigned f = 0; f < frames; f++)
+        blend(CPicture(dst, &dst_fmt, 0, 0), CPicture(src, &src_fmt, 0, 0),
+              width, height, 255);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    picture_Release(src);
+    picture_Release(dst);
+    return ((t1.tv_sec - t0.tv_sec) * 1e3
+          + (t1.tv_nsec - t0.tv_nsec) / 1e6) / frames;
+}
+
+int main(void)
+{
+    bool tested = false;
+
+    alarm(60);
+    srand(0);
+
+    /* The last entry is a terminator */
+    for (size_t i = 0; i + 1 < ARRAY_SIZE(simd_blends); i++) {
+        const vlc_fourcc_t dst = simd_blends[i].dst;
+        const vlc_fourcc_t src = simd_blends[i].src;
+
+        if (!simd_blends[i].usable())
+            continue;
+        TestBlend(dst, src, simd_blends[i].blend);
+        fprintf(stderr, "%4.4s -> %4.4s 1920x1080: C %.2f ms, %s %.2f ms\n",
+                (const char *)&src, (const char *)&dst,
+                Bench(dst, src, GetGenericBlend(dst, src)), simd_blends[i].name,
+                Bench(dst, src, simd_blends[i].blend));
+        tested = true;
+    }
+
+    if (!tested) {
+        fprintf(stderr, "WARNING: could not test SIMD blending\n");
+        return 77;
+    }
+    return 0;
+}
+#endif
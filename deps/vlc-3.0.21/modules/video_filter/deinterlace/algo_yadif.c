@@ -26,6 +26,10 @@
 #   include "config.h"
 #endif
 
+#ifdef YADIF_TEST
+#   undef NDEBUG
+#endif
+
 #include <stdint.h>
 #include <assert.h>
 
@@ -47,6 +51,73 @@
    Necessary preprocessor macros are defined in common.h. */
 #include "yadif.h"
 
+#ifndef YADIF_TEST
+struct yadif_job
+{
+    picture_t *p_dst;
+    const picture_t *p_prev;
+    const picture_t *p_cur;
+    const picture_t *p_next;
+    int i_plane;
+    int i_field;
+    int i_parity;
+    int i_pixel_size;
+    void (*pf_filter)( uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
+                       int w, int prefs, int mrefs, int parity, int mode );
+};
+
+/* Renders the lines [i_first, i_first + i_count) of a plane. The lines of
+ * different bands can be rendered in parallel. */
+static void YadifBand( void *opaque, unsigned i_slice,
+                       unsigned i_first, unsigned i_count )
+{
+    const struct yadif_job *p_job = opaque;
+    const int n = p_job->i_plane;
+    const plane_t *prevp = &p_job->p_prev->p[n];
+    const plane_t *curp  = &p_job->p_cur->p[n];
+    const plane_t *nextp = &p_job->p_next->p[n];
+    plane_t *dstp        = &p_job->p_dst->p[n];
+    const int i_end = __MIN( (int)(i_first + i_count), dstp->i_visible_lines - 1 );
+
+    VLC_UNUSED(i_slice);
+    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+
+    for( int y = __MAX( (int)i_first, 1 ); y < i_end; y++ )
+    {
+        if( (y % 2) == p_job->i_field  ||  p_job->i_parity == 2 )
+        {
+            memcpy( &dstp->p_pixels[y * dstp->i_pitch],
+                        &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
+        }
+        else
+        {
+            int mode;
+            /* Spatial checks only when enough data */
+            mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
+
+            p_job->pf_filter( &dstp->p_pixels[y * dstp->i_pitch],
+                              &prevp->p_pixels[y * prevp->i_pitch],
+                              &curp->p_pixels[y * curp->i_pitch],
+                              &nextp->p_pixels[y * nextp->i_pitch],
+                              dstp->i_visible_pitch / p_job->i_pixel_size,
+                              y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
+                              y  - 1  ?  -curp->i_pitch : curp->i_pitch,
+                              p_job->i_parity,
+                              mode );
+        }
+
+        /* We duplicate the first and last lines */
+        if( y == 1 )
+            memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
+                       &dstp->p_pixels[ y    * dstp->i_pitch],
+                       dstp->i_pitch);
+        else if( y == dstp->i_visible_lines - 2 )
+            memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
+                       &dstp->p_pixels[ y    * dstp->i_pitch],
+                       dstp->i_pitch);
+    }
+}
+
 int RenderYadifSingle( filter_t *p_filter, picture_t *p_dst, picture_t *p_src )
 {
     return RenderYadif( p_filter, p_dst, p_src, 0, 0 );
@@ -109,75 +180,56 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
     /* Filter if we have all the pictures we need */
     if( p_prev && p_cur && p_next )
     {
-        /* */
-        void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
-                       int w, int prefs, int mrefs, int parity, int mode);
+        struct yadif_job job = {
+            .p_dst = p_dst, .p_prev = p_prev, .p_cur = p_cur, .p_next = p_next,
+            .i_field = i_field, .i_parity = yadif_parity,
+            .i_pixel_size = p_sys->chroma->pixel_size,
+        };
 
 /* android clang build for x86 fails as not enough registers are available */
 #if !defined(__ANDROID__)
+# if defined(HAVE_YADIF_AVX2)
+        if( vlc_CPU_AVX2() )
+            job.pf_filter = yadif_filter_line_avx2;
+        else
+# endif
 # if defined(HAVE_YADIF_SSSE3)
         if( vlc_CPU_SSSE3() )
-            filter = yadif_filter_line_ssse3;
+            job.pf_filter = yadif_filter_line_ssse3;
         else
 # endif
 # if defined(HAVE_YADIF_SSE2)
         if( vlc_CPU_SSE2() )
-            filter = yadif_filter_line_sse2;
+            job.pf_filter = yadif_filter_line_sse2;
         else
 # endif
 # if defined(HAVE_YADIF_MMX)
         if( vlc_CPU_MMX() )
-            filter = yadif_filter_line_mmx;
+            job.pf_filter = yadif_filter_line_mmx;
         else
 # endif
 #endif
-            filter = yadif_filter_line_c;
+            job.pf_filter = yadif_filter_line_c;
 
-        if( p_sys->chroma->pixel_size == 2 )
-            filter = yadif_filter_line_c_16bit;
+        if( job.i_pixel_size == 2 )
+        {
+#if defined(HAVE_YADIF_AVX2)
+            if( vlc_CPU_AVX2() )
+                job.pf_filter = yadif_filter_line_16bit_avx2;
+            else
+#endif
+                job.pf_filter = yadif_filter_line_c_16bit;
+        }
 
-        for( int n = 0; n < p_dst->i_planes; n++ )
+        for( job.i_plane = 0; job.i_plane < p_dst->i_planes; job.i_plane++ )
         {
-            const plane_t *prevp = &p_prev->p[n];
-            const plane_t *curp  = &p_cur->p[n];
-            const plane_t *nextp = &p_next->p[n];
-            plane_t *dstp        = &p_dst->p[n];
-
-            for( int y = 1; y < dstp->i_visible_lines - 1; y++ )
-            {
-                if( (y % 2) == i_field  ||  yadif_parity == 2 )
-                {
-                    memcpy( &dstp->p_pixels[y * dstp->i_pitch],
-                                &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
-                }
-                else
-                {
-                    int mode;
-                    /* Spatial checks only when enough data */
-                    mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
-
-                    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
-                    filter( &dstp->p_pixels[y * dstp->i_pitch],
-                            &prevp->p_pixels[y * prevp->i_pitch],
-                            &curp->p_pixels[y * curp->i_pitch],
-                            &nextp->p_pixels[y * nextp->i_pitch],
-                            dstp->i_visible_pitch,
-                            y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
-                            y  - 1  ?  -curp->i_pitch : curp->i_pitch,
-                            yadif_parity,
-                            mode );
-                }
+            const unsigned i_lines = p_dst->p[job.i_plane].i_visible_lines;
 
-                /* We duplicate the first and last lines */
-                if( y == 1 )
-                    memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-                else if( y == dstp->i_visible_lines - 2 )
-                    memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-            }
+            /* Bands of an even number of lines keep the same field parity */
+            if( p_sys->p_slices != NULL )
+                vlc_slices_Run( p_sys->p_slices, i_lines, 2, YadifBand, &job );
+            else
+                YadifBand( &job, 0, 0, i_lines );
         }
 
         p_sys->context.i_frame_offset = 1; /* p_cur will be rendered at next frame, too */
@@ -200,3 +252,137 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
         return VLC_EGENERIC;
     }
 }
+#else /* YADIF_TEST */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef void (*yadif_line_t)( uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                              uint8_t *next, int w, int prefs, int mrefs,
+                              int parity, int mode );
+
+static const struct
+{
+    const char  *psz_name;
+    unsigned     i_pixel_size;
+    yadif_line_t c;
+    yadif_line_t avx2;
+} kernels[] = {
+#ifdef HAVE_YADIF_AVX2
+    { "8 bits",  1, yadif_filter_line_c,       yadif_filter_line_avx2 },
+    { "16 bits", 2, yadif_filter_line_c_16bit, yadif_filter_line_16bit_avx2 },
+#endif
+};
+
+#define TEST_MAX_WIDTH 1920
+/* Lines around the filtered one, and samples around each line */
+#define TEST_LINES     5
+#define TEST_MARGIN    8
+#define TEST_PITCH     (2 * (TEST_MAX_WIDTH + 2 * TEST_MARGIN))
+
+static void Fill( uint8_t *p, size_t i_size )
+{
+    for( size_t i = 0; i < i_size; i++ )
+        p[i] = rand();
+}
+
+static void TestKernels( void )
+{
+    /* Odd widths exercise the plain C tails of the vectorized kernels */
+    static const int widths[] = { 1, 7, 8, 9, 15, 16, 17, 33, 720, 1918, 1920 };
+    const size_t i_size = TEST_LINES * TEST_PITCH;
+    uint8_t *p_prev = malloc( i_size ), *p_cur = malloc( i_size );
+    uint8_t *p_next = malloc( i_size );
+    uint8_t *p_c = malloc( TEST_PITCH ), *p_simd = malloc( TEST_PITCH );
+    assert( p_prev && p_cur && p_next && p_c && p_simd );
+
+    srand( 0 );
+    for( size_t k = 0; k < ARRAY_SIZE(kernels); k++ )
+        for( size_t w = 0; w < ARRAY_SIZE(widths); w++ )
+            for( int i_parity = 0; i_parity < 2; i_parity++ )
+                for( int i_mode = 0; i_mode <= 2; i_mode += 2 )
+                {
+                    const size_t i_offset = 2 * TEST_PITCH
+                                          + TEST_MARGIN * kernels[k].i_pixel_size;
+
+                    Fill( p_prev, i_size );
+                    Fill( p_cur, i_size );
+                    Fill( p_next, i_size );
+                    /* Static areas, where the spatial prediction wins */
+                    if( w % 2 )
+                    {
+                        memcpy( p_prev, p_cur, i_size );
+                        memcpy( p_next, p_cur, i_size );
+                    }
+                    Fill( p_c, TEST_PITCH );
+                    memcpy( p_simd, p_c, TEST_PITCH );
+
+                    kernels[k].c( &p_c[TEST_MARGIN * kernels[k].i_pixel_size],
+                                  &p_prev[i_offset], &p_cur[i_offset],
+                                  &p_next[i_offset], widths[w],
+                                  TEST_PITCH, -TEST_PITCH, i_parity, i_mode );
+                    kernels[k].avx2( &p_simd[TEST_MARGIN * kernels[k].i_pixel_size],
+                                     &p_prev[i_offset], &p_cur[i_offset],
+                                     &p_next[i_offset], widths[w],
+                                     TEST_PITCH, -TEST_PITCH, i_parity, i_mode );
+                    /* Also checks that nothing is written past the width */
+                    assert( !memcmp( p_c, p_simd, TEST_PITCH ) );
+                }
+
+    free( p_simd );
+    free( p_c );
+    free( p_next );
+    free( p_cur );
+    free( p_prev );
+}
+
+static double Bench( yadif_line_t filter, unsigned i_pixel_size )
+{
+    const unsigned i_width = 1920, i_height = 1080, i_frames = 20;
+    const size_t i_pitch = i_width * i_pixel_size;
+    uint8_t *p_prev = malloc( i_pitch * i_height );
+    uint8_t *p_cur = malloc( i_pitch * i_height );
+    uint8_t *p_next = malloc( i_pitch * i_height );
+    uint8_t *p_dst = malloc( i_pitch * i_height );
+    struct timespec t0, t1;
+
+    assert( p_prev && p_cur && p_next && p_dst );
+    Fill( p_prev, i_pitch * i_height );
+    Fill( p_cur, i_pitch * i_height );
+    Fill( p_next, i_pitch * i_height );
+
+    clock_gettime( CLOCK_MONOTONIC, &t0 );
+    for( unsigned f = 0; f < i_frames; f++ )
+        for( unsigned y = 3; y < i_height - 3; y += 2 )
+            filter( &p_dst[y * i_pitch], &p_prev[y * i_pitch],
+                    &p_cur[y * i_pitch], &p_next[y * i_pitch],
+                    i_width - 8, i_pitch, -(int)i_pitch, f % 2, 0 );
+    clock_gettime( CLOCK_MONOTONIC, &t1 );
+
+    free( p_dst );
+    free( p_next );
+    free( p_cur );
+    free( p_prev );
+    return ( ( t1.tv_sec - t0.tv_sec ) * 1e3
+           + ( t1.tv_nsec - t0.tv_nsec ) / 1e6 ) / i_frames;
+}
+
+int main( void )
+{
+    alarm( 30 );
+
+    if( !vlc_CPU_AVX2() || ARRAY_SIZE(kernels) == 0 )
+    {
+        fprintf( stderr, "WARNING: could not test AVX2\n" );
+        return 77;
+    }
+    TestKernels();
+
+    for( size_t k = 0; k < ARRAY_SIZE(kernels); k++ )
+        fprintf( stderr, "%s 1920x1080 field: C %.2f ms, AVX2 %.2f ms\n",
+                 kernels[k].psz_name,
+                 Bench( kernels[k].c, kernels[k].i_pixel_size ),
+                 Bench( kernels[k].avx2, kernels[k].i_pixel_size ) );
+    return 0;
+}
+#endif
@@ -519,6 +519,7 @@ notsupp:
         return VLC_ENOMEM;
 
     p_sys->chroma = chroma;
+    p_sys->p_slices = NULL;
 
     InitDeinterlacingContext( &p_sys->context );
 
@@ -529,6 +530,20 @@ notsupp:
 
     IVTCClearState( p_filter );
 
+    /* Yadif processes the lines independently from each other */
+    if( p_sys->context.pf_render_ordered == RenderYadif ||
+        p_sys->context.pf_render_single_pic == RenderYadifSingle )
+    {
+        const unsigned i_slices = filter_GetSliceCount( p_filter );
+        if( i_slices > 1 )
+        {
+            p_sys->p_slices = vlc_slices_New( i_slices );
+            if( p_sys->p_slices != NULL )
+                msg_Dbg( p_filter, "using %u slices",
+                         vlc_slices_Count( p_sys->p_slices ) );
+        }
+    }
+
 #if defined(CAN_COMPILE_C_ALTIVEC)
     if( pixel_size == 1 && vlc_CPU_ALTIVEC() )
         p_sys->pf_merge = MergeAltivec;
@@ -650,5 +665,7 @@ void Close( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t*)p_this;
 
     Flush( p_filter );
+    if( p_filter->p_sys->p_slices != NULL )
+        vlc_slices_Delete( p_filter->p_sys->p_slices );
     free( p_filter->p_sys );
 }
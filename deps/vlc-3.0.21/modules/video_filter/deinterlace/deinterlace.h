@@ -78,6 +78,9 @@ struct filter_sys_t
 
     struct deinterlace_ctx   context;
 
+    /** Slice threading of Yadif, NULL if single threaded */
+    struct vlc_slices_t *p_slices;
+
     /* Algorithm-specific substructures */
     union {
         phosphor_sys_t phosphor; /**< Phosphor algorithm state. */
@@ -151,3 +151,48 @@ static void yadif_filter_line_c_16bit(uint8_t *dst8, uint8_t *prev8, uint8_t *cu
     prefs /= 2;
     FILTER
 }
+
+#ifdef HAVE_AVX2_INTRINSICS
+#include <immintrin.h>
+#define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+// ================= AVX2 =================
+#define HAVE_YADIF_AVX2
+#define RENAME(a) a ## _avx2
+#define pixel uint8_t
+#define STEP 16
+#define OP(op) _mm256_ ## op ## _epi16
+#define LOAD(p) _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p)))
+#define STORE(p, v) \
+    _mm_storeu_si128((__m128i *)(p), \
+                     _mm_packus_epi16(_mm256_castsi256_si128(v), \
+                                      _mm256_extracti128_si256(v, 1)))
+#define TAIL yadif_filter_line_c
+#include "yadif_avx2.h"
+#undef TAIL
+#undef STORE
+#undef LOAD
+#undef OP
+#undef STEP
+#undef pixel
+#undef RENAME
+
+/* 32-bit lanes, as the sums of 16-bit samples overflow 16 bits */
+#define RENAME(a) a ## _16bit_avx2
+#define pixel uint16_t
+#define STEP 8
+#define OP(op) _mm256_ ## op ## _epi32
+#define LOAD(p) _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(p)))
+#define STORE(p, v) \
+    _mm_storeu_si128((__m128i *)(p), \
+                     _mm_packus_epi32(_mm256_castsi256_si128(v), \
+                                      _mm256_extracti128_si256(v, 1)))
+#define TAIL yadif_filter_line_c_16bit
+#include "yadif_avx2.h"
+#undef TAIL
+#undef STORE
+#undef LOAD
+#undef OP
+#undef STEP
+#undef pixel
+#undef RENAME
+#endif
@@ -0,0 +1,130 @@
+/*****************************************************************************
+ * yadif_avx2.h : AVX2 Yadif line filter template
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Included by yadif.h, with:
+ *  - RENAME(a): the name of the line filter,
+ *  - pixel: the type of the samples,
+ *  - STEP: the number of samples per vector,
+ *  - OP(op): the AVX2 operation on lanes wide enough for the sums of samples,
+ *  - LOAD(p) and STORE(p, v): the conversions between samples and lanes,
+ *  - TAIL: the C line filter for the remaining samples.
+ *
+ * It computes exactly the same thing as the FILTER macro of yadif.h. */
+
+#define VSCORE(j) \
+    OP(add)(OP(add)( \
+        OP(abs)(OP(sub)(LOAD(&cur[x + mrefs - 1 + (j)]), \
+                        LOAD(&cur[x + prefs - 1 - (j)]))), \
+        OP(abs)(OP(sub)(LOAD(&cur[x + mrefs + (j)]), \
+                        LOAD(&cur[x + prefs - (j)])))), \
+        OP(abs)(OP(sub)(LOAD(&cur[x + mrefs + 1 + (j)]), \
+                        LOAD(&cur[x + prefs + 1 - (j)]))))
+
+#define VPRED(j) \
+    OP(srai)(OP(add)(LOAD(&cur[x + mrefs + (j)]), \
+                     LOAD(&cur[x + prefs - (j)])), 1)
+
+/* The check at 2*j is only done if the check at j was better,
+ * as in the C version */
+#define VCHECK(j) \
+    score = VSCORE(j); \
+    better = OP(cmpgt)(spatial_score, score); \
+    spatial_score = OP(min)(spatial_score, score); \
+    spatial_pred = _mm256_blendv_epi8(spatial_pred, VPRED(j), better); \
+    score = VSCORE(2 * (j)); \
+    better = _mm256_and_si256(better, OP(cmpgt)(spatial_score, score)); \
+    spatial_score = _mm256_blendv_epi8(spatial_score, score, better); \
+    spatial_pred = _mm256_blendv_epi8(spatial_pred, VPRED(2 * (j)), better);
+
+VLC_AVX2
+static void RENAME(yadif_filter_line)(uint8_t *dst8, uint8_t *prev8,
+                                      uint8_t *cur8, uint8_t *next8,
+                                      int w, int prefs8, int mrefs8,
+                                      int parity, int mode)
+{
+    pixel *dst = (pixel *)dst8;
+    const pixel *prev = (const pixel *)prev8;
+    const pixel *cur = (const pixel *)cur8;
+    const pixel *next = (const pixel *)next8;
+    const pixel *prev2 = parity ? prev : cur;
+    const pixel *next2 = parity ? cur : next;
+    const int prefs = prefs8 / (int)sizeof(pixel);
+    const int mrefs = mrefs8 / (int)sizeof(pixel);
+    const __m256i one = OP(set1)(1);
+    const __m256i zero = _mm256_setzero_si256();
+    int x;
+
+    for (x = 0; x + STEP <= w; x += STEP) {
+        __m256i c = LOAD(&cur[x + mrefs]);
+        __m256i e = LOAD(&cur[x + prefs]);
+        __m256i p2 = LOAD(&prev2[x]);
+        __m256i n2 = LOAD(&next2[x]);
+        __m256i d = OP(srai)(OP(add)(p2, n2), 1);
+
+        __m256i temporal_diff0 = OP(abs)(OP(sub)(p2, n2));
+        __m256i temporal_diff1 = OP(srai)(OP(add)(
+            OP(abs)(OP(sub)(LOAD(&prev[x + mrefs]), c)),
+            OP(abs)(OP(sub)(LOAD(&prev[x + prefs]), e))), 1);
+        __m256i temporal_diff2 = OP(srai)(OP(add)(
+            OP(abs)(OP(sub)(LOAD(&next[x + mrefs]), c)),
+            OP(abs)(OP(sub)(LOAD(&next[x + prefs]), e))), 1);
+        __m256i diff = OP(max)(OP(max)(OP(srai)(temporal_diff0, 1),
+                                       temporal_diff1), temporal_diff2);
+
+        __m256i spatial_pred = OP(srai)(OP(add)(c, e), 1);
+        __m256i spatial_score = OP(sub)(OP(add)(OP(add)(
+            OP(abs)(OP(sub)(LOAD(&cur[x + mrefs - 1]),
+                            LOAD(&cur[x + prefs - 1]))),
+            OP(abs)(OP(sub)(c, e))),
+            OP(abs)(OP(sub)(LOAD(&cur[x + mrefs + 1]),
+                            LOAD(&cur[x + prefs + 1])))), one);
+        __m256i score, better;
+
+        VCHECK(-1)
+        VCHECK(1)
+
+        if (mode < 2) {
+            __m256i b = OP(srai)(OP(add)(LOAD(&prev2[x + 2 * mrefs]),
+                                         LOAD(&next2[x + 2 * mrefs])), 1);
+            __m256i f = OP(srai)(OP(add)(LOAD(&prev2[x + 2 * prefs]),
+                                         LOAD(&next2[x + 2 * prefs])), 1);
+            __m256i de = OP(sub)(d, e), dc = OP(sub)(d, c);
+            __m256i bc = OP(sub)(b, c), fe = OP(sub)(f, e);
+            __m256i max = OP(max)(OP(max)(de, dc), OP(min)(bc, fe));
+            __m256i min = OP(min)(OP(min)(de, dc), OP(max)(bc, fe));
+
+            diff = OP(max)(OP(max)(diff, min), OP(sub)(zero, max));
+        }
+
+        /* diff is never negative, so this is the clipping of the C version */
+        spatial_pred = OP(min)(OP(max)(spatial_pred, OP(sub)(d, diff)),
+                               OP(add)(d, diff));
+        STORE(&dst[x], spatial_pred);
+    }
+
+    if (x < w)
+        TAIL(&dst8[x * sizeof(pixel)], &prev8[x * sizeof(pixel)],
+             &cur8[x * sizeof(pixel)], &next8[x * sizeof(pixel)],
+             w - x, prefs8, mrefs8, parity, mode);
+}
+
+#undef VCHECK
+#undef VPRED
+#undef VSCORE
@@ -39,6 +39,7 @@
  * Local prototypes
  ****************************************************************************/
 static int  OpenFilter ( vlc_object_t * );
+static void CloseFilter( vlc_object_t * );
 static picture_t *Filter( filter_t *, picture_t * );
 
 /*****************************************************************************
@@ -47,9 +48,14 @@ static picture_t *Filter( filter_t *, picture_t * );
 vlc_module_begin ()
     set_description( N_("Video scaling filter") )
     set_capability( "video converter", 10 )
-    set_callbacks( OpenFilter, NULL )
+    set_callbacks( OpenFilter, CloseFilter )
 vlc_module_end ()
 
+struct filter_sys_t
+{
+    vlc_slices_t *p_slices; /* NULL if single threaded */
+};
+
 /*****************************************************************************
  * OpenFilter: probe the filter and return score
  *****************************************************************************/
@@ -72,8 +78,18 @@ static int OpenFilter( vlc_object_t *p_this )
     if( p_filter->fmt_in.video.orientation != p_filter->fmt_out.video.orientation )
         return VLC_EGENERIC;
 
+    filter_sys_t *p_sys = malloc( sizeof( *p_sys ) );
+    if( !p_sys )
+        return VLC_ENOMEM;
+
+    p_sys->p_slices = NULL;
+    const unsigned i_slices = filter_GetSliceCount( p_filter );
+    if( i_slices > 1 )
+        p_sys->p_slices = vlc_slices_New( i_slices );
+
 #warning Converter cannot (really) change output format.
     video_format_ScaleCropAr( &p_filter->fmt_out.video, &p_filter->fmt_in.video );
+    p_filter->p_sys = p_sys;
     p_filter->pf_video_filter = Filter;
 
     msg_Dbg( p_filter, "%ix%i -> %ix%i", p_filter->fmt_in.video.i_width,
@@ -83,11 +99,108 @@ static int OpenFilter( vlc_object_t *p_this )
     return VLC_SUCCESS;
 }
 
+static void CloseFilter( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t*)p_this;
+
+    if( p_filter->p_sys->p_slices )
+        vlc_slices_Delete( p_filter->p_sys->p_slices );
+    free( p_filter->p_sys );
+}
+
+/****************************************************************************
+ * ScaleLines: scale the lines [i_first, i_last) of a plane
+ ****************************************************************************/
+#define SHIFT_SIZE 16
+
+static void ScaleLines( filter_t *p_filter, const plane_t *p_srcp,
+                        plane_t *p_dstp, int i_first, int i_last )
+{
+    const int i_src_pitch    = p_srcp->i_pitch;
+    const int i_dst_pitch    = p_dstp->i_pitch;
+    const int i_src_height   = p_filter->fmt_in.video.i_height;
+    const int i_src_width    = p_filter->fmt_in.video.i_width;
+    const int i_dst_height   = p_filter->fmt_out.video.i_height;
+    const int i_dst_width    = p_filter->fmt_out.video.i_width;
+    const int i_dst_visible_pitch = p_dstp->i_visible_pitch;
+    const int i_height_coef  = ( i_src_height << SHIFT_SIZE )
+                               / i_dst_height;
+    const int i_width_coef   = ( i_src_width << SHIFT_SIZE )
+                               / i_dst_width;
+    const int i_src_height_1 = i_src_height - 1;
+    const int i_src_width_1  = i_src_width - 1;
+
+    const int i_shift_height = i_dst_height / i_src_height;
+    const int i_shift_width = i_dst_width / i_src_width;
+
+    int l = (1<<(SHIFT_SIZE-i_shift_height)) + i_first * i_height_coef;
+
+    if( p_filter->fmt_in.video.i_chroma != VLC_CODEC_RGBA &&
+        p_filter->fmt_in.video.i_chroma != VLC_CODEC_ARGB &&
+        p_filter->fmt_in.video.i_chroma != VLC_CODEC_RGB32 )
+    {
+        const uint8_t *p_src = p_srcp->p_pixels;
+
+        for( int y = i_first; y < i_last; y++, l += i_height_coef )
+        {
+            uint8_t *p_dst = &p_dstp->p_pixels[y * i_dst_pitch];
+            const uint8_t *p_srcl = p_src
+                   + (__MIN( i_src_height_1, l >> SHIFT_SIZE )*i_src_pitch);
+            int k = 1<<(SHIFT_SIZE-i_shift_width);
+
+            for( int x = 0; x < i_dst_visible_pitch; x++, k += i_width_coef )
+                p_dst[x] = p_srcl[__MIN( i_src_width_1, k >> SHIFT_SIZE )];
+        }
+    }
+    else /* RGBA */
+    {
+        const uint32_t *p_src = (const uint32_t*)p_srcp->p_pixels;
+
+        for( int y = i_first; y < i_last; y++, l += i_height_coef )
+        {
+            uint32_t *p_dst = (uint32_t*)&p_dstp->p_pixels[y * i_dst_pitch];
+            const uint32_t *p_srcl = p_src
+                    + (__MIN( i_src_height_1, l >> SHIFT_SIZE )*(i_src_pitch>>2));
+            int k = 1<<(SHIFT_SIZE-i_shift_width);
+
+            for( int x = 0; x < (i_dst_visible_pitch>>2); x++, k += i_width_coef )
+                p_dst[x] = p_srcl[__MIN( i_src_width_1, k >> SHIFT_SIZE )];
+        }
+    }
+}
+
+struct scale_job
+{
+    filter_t        *p_filter;
+    const picture_t *p_src;
+    picture_t       *p_dst;
+};
+
+/* i_first and i_lines count visible lines of the first output plane */
+static void ScaleSlice( void *opaque, unsigned i_slice,
+                        unsigned i_first, unsigned i_lines )
+{
+    const struct scale_job *p_job = opaque;
+    picture_t *p_dst = p_job->p_dst;
+    const unsigned i_luma = p_dst->p[0].i_visible_lines;
+
+    VLC_UNUSED( i_slice );
+    for( int i_plane = 0; i_plane < p_dst->i_planes; i_plane++ )
+    {
+        const unsigned i_plane_lines = p_dst->p[i_plane].i_visible_lines;
+
+        ScaleLines( p_job->p_filter, &p_job->p_src->p[i_plane],
+                    &p_dst->p[i_plane], i_first * i_plane_lines / i_luma,
+                    ( i_first + i_lines ) * i_plane_lines / i_luma );
+    }
+}
+
 /****************************************************************************
  * Filter: the whole thing
  ****************************************************************************/
 static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 {
+    filter_sys_t *p_sys = p_filter->p_sys;
     picture_t *p_pic_dst;
 
     if( !p_pic ) return NULL;
@@ -103,98 +216,15 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         return NULL;
     }
 
-    if( p_filter->fmt_in.video.i_chroma != VLC_CODEC_RGBA &&
-        p_filter->fmt_in.video.i_chroma != VLC_CODEC_ARGB &&
-        p_filter->fmt_in.video.i_chroma != VLC_CODEC_RGB32 )
-    {
-        for( int i_plane = 0; i_plane < p_pic_dst->i_planes; i_plane++ )
-        {
-            const int i_src_pitch    = p_pic->p[i_plane].i_pitch;
-            const int i_dst_pitch    = p_pic_dst->p[i_plane].i_pitch;
-            const int i_src_height   = p_filter->fmt_in.video.i_height;
-            const int i_src_width    = p_filter->fmt_in.video.i_width;
-            const int i_dst_height   = p_filter->fmt_out.video.i_height;
-            const int i_dst_width    = p_filter->fmt_out.video.i_width;
-            const int i_dst_visible_lines =
-                                       p_pic_dst->p[i_plane].i_visible_lines;
-            const int i_dst_visible_pitch =
-                                       p_pic_dst->p[i_plane].i_visible_pitch;
-            const int i_dst_hidden_pitch  = i_dst_pitch - i_dst_visible_pitch;
-#define SHIFT_SIZE 16
-            const int i_height_coef  = ( i_src_height << SHIFT_SIZE )
-                                       / i_dst_height;
-            const int i_width_coef   = ( i_src_width << SHIFT_SIZE )
-                                       / i_dst_width;
-            const int i_src_height_1 = i_src_height - 1;
-            const int i_src_width_1  = i_src_width - 1;
-
-            uint8_t *p_src = p_pic->p[i_plane].p_pixels;
-            uint8_t *p_dst = p_pic_dst->p[i_plane].p_pixels;
-            uint8_t *p_dstendline = p_dst + i_dst_visible_pitch;
-            const uint8_t *p_dstend = p_dst + i_dst_visible_lines*i_dst_pitch;
-
-            const int i_shift_height = i_dst_height / i_src_height;
-            const int i_shift_width = i_dst_width / i_src_width;
-
-            int l = 1<<(SHIFT_SIZE-i_shift_height);
-            for( ; p_dst < p_dstend;
-                 p_dst += i_dst_hidden_pitch,
-                 p_dstendline += i_dst_pitch, l += i_height_coef )
-            {
-                int k = 1<<(SHIFT_SIZE-i_shift_width);
-                uint8_t *p_srcl = p_src
-                       + (__MIN( i_src_height_1, l >> SHIFT_SIZE )*i_src_pitch);
-
-                for( ; p_dst < p_dstendline; p_dst++, k += i_width_coef )
-                {
-                    *p_dst = p_srcl[__MIN( i_src_width_1, k >> SHIFT_SIZE )];
-                }
-            }
-        }
-    }
-    else /* RGBA */
-    {
-        const int i_src_pitch = p_pic->p->i_pitch;
-        const int i_dst_pitch = p_pic_dst->p->i_pitch;
-        const int i_src_height   = p_filter->fmt_in.video.i_height;
-        const int i_src_width    = p_filter->fmt_in.video.i_width;
-        const int i_dst_height   = p_filter->fmt_out.video.i_height;
-        const int i_dst_width    = p_filter->fmt_out.video.i_width;
-        const int i_dst_visible_lines =
-                                   p_pic_dst->p->i_visible_lines;
-        const int i_dst_visible_pitch =
-                                   p_pic_dst->p->i_visible_pitch;
-        const int i_dst_hidden_pitch  = i_dst_pitch - i_dst_visible_pitch;
-        const int i_height_coef  = ( i_src_height << SHIFT_SIZE )
-                                   / i_dst_height;
-        const int i_width_coef   = ( i_src_width << SHIFT_SIZE )
-                                   / i_dst_width;
-        const int i_src_height_1 = i_src_height - 1;
-        const int i_src_width_1  = i_src_width - 1;
-
-        uint32_t *p_src = (uint32_t*)p_pic->p->p_pixels;
-        uint32_t *p_dst = (uint32_t*)p_pic_dst->p->p_pixels;
-        uint32_t *p_dstendline = p_dst + (i_dst_visible_pitch>>2);
-        const uint32_t *p_dstend = p_dst + i_dst_visible_lines*(i_dst_pitch>>2);
-
-        const int i_shift_height = i_dst_height / i_src_height;
-        const int i_shift_width = i_dst_width / i_src_width;
-
-        int l = 1<<(SHIFT_SIZE-i_shift_height);
-        for( ; p_dst < p_dstend;
-             p_dst += (i_dst_hidden_pitch>>2),
-             p_dstendline += (i_dst_pitch>>2),
-             l += i_height_coef )
-        {
-            int k = 1<<(SHIFT_SIZE-i_shift_width);
-            uint32_t *p_srcl = p_src
-                    + (__MIN( i_src_height_1, l >> SHIFT_SIZE )*(i_src_pitch>>2));
-            for( ; p_dst < p_dstendline; p_dst++, k += i_width_coef )
-            {
-                *p_dst = p_srcl[__MIN( i_src_width_1, k >> SHIFT_SIZE )];
-            }
-        }
-    }
+    struct scale_job job = {
+        .p_filter = p_filter, .p_src = p_pic, .p_dst = p_pic_dst,
+    };
+    const unsigned i_lines = p_pic_dst->p[0].i_visible_lines;
+
+    if( p_sys->p_slices )
+        vlc_slices_Run( p_sys->p_slices, i_lines, 2, ScaleSlice, &job );
+    else
+        ScaleSlice( &job, 0, 0, i_lines );
 
     picture_CopyProperties( p_pic_dst, p_pic );
     picture_Release( p_pic );
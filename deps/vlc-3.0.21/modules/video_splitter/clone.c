@@ -40,6 +40,11 @@
 #define COUNT_LONGTEXT N_("Number of video windows in which to "\
     "clone the video.")
 
+#define CROP_TEXT N_("Clone regions")
+#define CROP_LONGTEXT N_("Comma-separated list of the regions of the video " \
+    "shown by each clone, as <width>x<height>+<left>+<top>. Empty entries " \
+    "show the whole video.")
+
 #define VOUTLIST_TEXT N_("Video output modules")
 #define VOUTLIST_LONGTEXT N_("You can use specific video output modules " \
         "for the clones. Use a comma-separated list of modules." )
@@ -60,6 +65,7 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_VIDEO_SPLITTER )
 
     add_integer( CFG_PREFIX "count", 2, COUNT_TEXT, COUNT_LONGTEXT, false )
+    add_string( CFG_PREFIX "crop", NULL, CROP_TEXT, CROP_LONGTEXT, true )
     add_module_list( CFG_PREFIX "vout-list", "vout display", NULL,
                      VOUTLIST_TEXT, VOUTLIST_LONGTEXT, true )
 
@@ -71,13 +77,63 @@ vlc_module_end ()
  * Local prototypes
  *****************************************************************************/
 static const char *const ppsz_filter_options[] = {
-    "count", "vout-list", NULL
+    "count", "vout-list", "crop", NULL
 };
 
 #define VOUTSEPARATOR ':'
+#define CROPSEPARATOR ','
 
 static int Filter( video_splitter_t *, picture_t *pp_dst[], picture_t * );
 
+/**
+ * Restricts an output to a region of the video
+ */
+static void Crop( video_splitter_t *p_splitter, video_splitter_output_t *p_cfg,
+                  const char *psz_crop )
+{
+    const video_format_t *p_fmt = &p_splitter->fmt;
+    const vlc_chroma_description_t *p_chroma =
+        vlc_fourcc_GetChromaDescription( p_fmt->i_chroma );
+    unsigned i_width, i_height, i_left, i_top;
+
+    if( sscanf( psz_crop, "%ux%u+%u+%u",
+                &i_width, &i_height, &i_left, &i_top ) != 4 )
+    {
+        msg_Warn( p_splitter, "invalid region \"%s\"", psz_crop );
+        return;
+    }
+    if( p_chroma == NULL || p_chroma->plane_count == 0 )
+        return;
+
+    /* Keep the region aligned on the chroma subsampling */
+    unsigned i_hmask = 0, i_vmask = 0;
+    for( unsigned i = 0; i < p_chroma->plane_count; i++ )
+    {
+        i_hmask |= p_chroma->p[i].w.den - 1;
+        i_vmask |= p_chroma->p[i].h.den - 1;
+    }
+    i_left &= ~i_hmask;
+    i_top &= ~i_vmask;
+    if( i_left >= p_fmt->i_visible_width || i_top >= p_fmt->i_visible_height )
+    {
+        msg_Warn( p_splitter, "region \"%s\" out of the video", psz_crop );
+        return;
+    }
+    i_width = __MIN( i_width, p_fmt->i_visible_width - i_left ) & ~i_hmask;
+    i_height = __MIN( i_height, p_fmt->i_visible_height - i_top ) & ~i_vmask;
+    if( i_width == 0 || i_height == 0 )
+        return;
+
+    p_cfg->fmt.i_x_offset       = 0;
+    p_cfg->fmt.i_y_offset       = 0;
+    p_cfg->fmt.i_visible_width  =
+    p_cfg->fmt.i_width          = i_width;
+    p_cfg->fmt.i_visible_height =
+    p_cfg->fmt.i_height         = i_height;
+    p_cfg->source.i_x = p_fmt->i_x_offset + i_left;
+    p_cfg->source.i_y = p_fmt->i_y_offset + i_top;
+}
+
 /**
  * This function allocates and initializes a Clone splitter module
  */
@@ -143,6 +199,10 @@ static int Open( vlc_object_t *p_this )
     }
 
     /* */
+    char *psz_croplist = var_CreateGetNonEmptyString( p_splitter,
+                                                      CFG_PREFIX "crop" );
+    char *psz_crop = psz_croplist;
+
     for( int i = 0; i < p_splitter->i_output; i++ )
     {
         video_splitter_output_t *p_cfg = &p_splitter->p_output[i];
@@ -150,7 +210,22 @@ static int Open( vlc_object_t *p_this )
         p_cfg->window.i_x = 0;
         p_cfg->window.i_y = 0;
         p_cfg->window.i_align = 0;
+        p_cfg->source.i_x = 0;
+        p_cfg->source.i_y = 0;
+
+        if( psz_crop != NULL )
+        {
+            char *psz_next = strchr( psz_crop, CROPSEPARATOR );
+            if( psz_next )
+                *psz_next++ = '\0';
+
+            if( *psz_crop )
+                Crop( p_splitter, p_cfg, psz_crop );
+
+            psz_crop = psz_next;
+        }
     }
+    free( psz_croplist );
 
     /* */
     p_splitter->pf_filter = Filter;
@@ -184,14 +259,44 @@ static void Close( vlc_object_t *p_this )
 static int Filter( video_splitter_t *p_splitter,
                    picture_t *pp_dst[], picture_t *p_src )
 {
-    if( video_splitter_NewPicture( p_splitter, pp_dst ) )
+    bool pb_shared[p_splitter->i_output];
+
+    if( video_splitter_NewPictureShared( p_splitter, pp_dst, pb_shared, p_src ) )
     {
         picture_Release( p_src );
         return VLC_EGENERIC;
     }
 
+    const vlc_chroma_description_t *p_chroma =
+        vlc_fourcc_GetChromaDescription( p_src->format.i_chroma );
+
     for( int i = 0; i < p_splitter->i_output; i++ )
-        picture_Copy( pp_dst[i], p_src );
+    {
+        const video_splitter_output_t *p_cfg = &p_splitter->p_output[i];
+
+        if( pb_shared[i] )
+            continue;
+        if( p_cfg->source.i_x == 0 && p_cfg->source.i_y == 0 )
+        {
+            picture_Copy( pp_dst[i], p_src );
+            continue;
+        }
+
+        /* Only copy the region of the output */
+        picture_t tmp = *p_src;
+        for( int j = 0; j < tmp.i_planes && p_chroma != NULL; j++ )
+        {
+            plane_t *p = &tmp.p[j];
+            const int i_x = p_cfg->source.i_x / p_chroma->p[j].w.den
+                                              * p_chroma->p[j].w.num;
+            const int i_y = p_cfg->source.i_y / p_chroma->p[j].h.den
+                                              * p_chroma->p[j].h.num;
+
+            p->p_pixels += i_y * p->i_pitch + i_x * p->i_pixel_pitch;
+            p->i_lines -= i_y;
+        }
+        picture_Copy( pp_dst[i], &tmp );
+    }
 
     picture_Release( p_src );
     return VLC_SUCCESS;
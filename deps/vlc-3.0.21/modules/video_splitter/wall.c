@@ -364,6 +364,8 @@ static int Open( vlc_object_t *p_this )
             p_cfg->window.i_x     = p_output->i_left;
             p_cfg->window.i_y     = p_output->i_top;
             p_cfg->window.i_align = p_output->i_align;
+            p_cfg->source.i_x     = p_output->i_left;
+            p_cfg->source.i_y     = p_output->i_top;
             p_cfg->psz_module = NULL;
         }
     }
@@ -390,8 +392,9 @@ static void Close( vlc_object_t *p_this )
 static int Filter( video_splitter_t *p_splitter, picture_t *pp_dst[], picture_t *p_src )
 {
     video_splitter_sys_t *p_sys = p_splitter->p_sys;
+    bool pb_shared[p_splitter->i_output];
 
-    if( video_splitter_NewPicture( p_splitter, pp_dst ) )
+    if( video_splitter_NewPictureShared( p_splitter, pp_dst, pb_shared, p_src ) )
     {
         picture_Release( p_src );
         return VLC_EGENERIC;
@@ -402,7 +405,7 @@ static int Filter( video_splitter_t *p_splitter, picture_t *pp_dst[], picture_t
         for( int x = 0; x < p_sys->i_col; x++ )
         {
             wall_output_t *p_output = &p_sys->pp_output[x][y];
-            if( !p_output->b_active )
+            if( !p_output->b_active || pb_shared[p_output->i_output] )
                 continue;
 
             picture_t *p_dst = pp_dst[p_output->i_output];
@@ -43,14 +43,17 @@
 #include <vlc_meta.h>
 #include <vlc_dialog.h>
 #include <vlc_modules.h>
+#include <vlc_picture_fifo.h>
 
 #include "audio_output/aout_internal.h"
 #include "stream_output/stream_output.h"
 #include "input_internal.h"
 #include "clock.h"
 #include "decoder.h"
+#include "decoder_pool.h"
 #include "event.h"
 #include "resource.h"
+#include "../libvlc.h"
 
 #include "../video_output/vout_control.h"
 
@@ -80,6 +83,11 @@ struct decoder_owner_sys_t
 
     vlc_thread_t     thread;
 
+    /* Shared decoder threads (NULL if the decoder has its own thread) */
+    decoder_pool_t  *p_pool;
+    decoder_task_t   task;
+    bool             b_closing;
+
     void (*pf_update_stat)( decoder_owner_sys_t *, unsigned decoded, unsigned lost );
 
     /* Some decoders require already packetized data (ie. not truncated) */
@@ -116,6 +124,7 @@ struct decoder_owner_sys_t
     vlc_tick_t pause_date;
     unsigned frames_countdown;
     bool paused;
+    bool output_paused; /* only used by the decoder thread */
 
     bool error;
 
@@ -141,16 +150,67 @@ struct decoder_owner_sys_t
 
     /* Delay */
     vlc_tick_t i_ts_delay;
+
+    /* Loop cache: decoded pictures of the first pass, replayed on repeat */
+    struct
+    {
+        picture_fifo_t *p_fifo; /* NULL if disabled */
+        size_t      i_size;     /* bytes used by the cached pictures */
+        size_t      i_max;      /* memory budget */
+        unsigned    i_count;    /* number of cached pictures */
+        unsigned    i_pos;      /* replay position in the current pass */
+        vlc_tick_t  i_first;    /* stream date of the first cached picture */
+        vlc_tick_t  i_frame;    /* estimated duration of a picture */
+        vlc_tick_t  i_offset;   /* date offset of the current replay pass */
+        vlc_tick_t  i_last;     /* stream date of the last queued picture */
+        bool        b_complete;
+
+        /* These variables need the fifo lock */
+        unsigned    i_passes;   /* replay passes requested by the input */
+        unsigned    i_replayed; /* passes replayed since last query */
+    } loop;
+
+    /* Throttle (video only) */
+    atomic_int  throttle;       /* enum input_decoder_throttle */
+    bool        b_throttle_resync; /* waiting for a keyframe to resume */
+    vlc_tick_t  i_throttle_last; /* date of the last picture displayed */
 };
 
 /* Pictures which are DECODER_BOGUS_VIDEO_DELAY or more in advance probably have
  * a bogus PTS and won't be displayed */
 #define DECODER_BOGUS_VIDEO_DELAY                ((vlc_tick_t)(DEFAULT_PTS_DELAY * 30))
 
+/* Interval between pictures displayed at INPUT_DECODER_THROTTLE_KEYFRAMES */
+#define DECODER_THROTTLE_INTERVAL (CLOCK_FREQ)
+
 /* */
 #define DECODER_SPU_VOUT_WAIT_DURATION ((int)(0.200*CLOCK_FREQ))
 #define BLOCK_FLAG_CORE_PRIVATE_RELOADED (1 << BLOCK_FLAG_CORE_PRIVATE_SHIFT)
 
+/* Loop iterations of a decoder before the shared threads run other ones */
+#define DECODER_POOL_STEPS 16
+
+/* The shared decoder threads run other decoders while this one blocks */
+static inline void DecoderBlockingEnter( decoder_owner_sys_t *p_owner )
+{
+    if( p_owner->p_pool != NULL )
+        decoder_pool_BlockingEnter( p_owner->p_pool );
+}
+
+static inline void DecoderBlockingLeave( decoder_owner_sys_t *p_owner )
+{
+    if( p_owner->p_pool != NULL )
+        decoder_pool_BlockingLeave( p_owner->p_pool );
+}
+
+/* Wakes the decoder up, the fifo lock must be held */
+static void DecoderSignal( decoder_owner_sys_t *p_owner )
+{
+    vlc_fifo_Signal( p_owner->p_fifo );
+    if( p_owner->p_pool != NULL )
+        decoder_pool_Schedule( p_owner->p_pool, &p_owner->task );
+}
+
 /**
  * Load a decoder module
  */
@@ -567,7 +627,10 @@ static picture_t *vout_new_buffer( decoder_t *p_dec )
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
     assert( p_owner->p_vout );
 
-    return vout_GetPicture( p_owner->p_vout );
+    DecoderBlockingEnter( p_owner );
+    picture_t *p_pic = vout_GetPicture( p_owner->p_vout );
+    DecoderBlockingLeave( p_owner );
+    return p_pic;
 }
 
 static subpicture_t *spu_new_buffer( decoder_t *p_dec,
@@ -587,7 +650,9 @@ static subpicture_t *spu_new_buffer( decoder_t *p_dec,
         if( p_vout )
             break;
 
+        DecoderBlockingEnter( p_owner );
         msleep( DECODER_SPU_VOUT_WAIT_DURATION );
+        DecoderBlockingLeave( p_owner );
     }
 
     if( !p_vout )
@@ -739,12 +804,14 @@ static void DecoderWaitUnblock( decoder_t *p_dec )
 
     vlc_assert_locked( &p_owner->lock );
 
-    for( ;; )
-    {
-        if( !p_owner->b_waiting || !p_owner->b_has_data )
-            break;
+    if( !p_owner->b_waiting || !p_owner->b_has_data )
+        return;
+
+    DecoderBlockingEnter( p_owner );
+    do
         vlc_cond_wait( &p_owner->wait_request, &p_owner->lock );
-    }
+    while( p_owner->b_waiting && p_owner->b_has_data );
+    DecoderBlockingLeave( p_owner );
 }
 
 /* DecoderTimedWait: Interruptible wait
@@ -756,12 +823,14 @@ static int DecoderTimedWait( decoder_t *p_dec, vlc_tick_t deadline )
     if (deadline - mdate() <= 0)
         return VLC_SUCCESS;
 
+    DecoderBlockingEnter( p_owner );
     vlc_fifo_Lock( p_owner->p_fifo );
     while( !p_owner->flushing
         && vlc_fifo_TimedWaitCond( p_owner->p_fifo, &p_owner->wait_timed,
                                    deadline ) == 0 );
     int ret = p_owner->flushing ? VLC_EGENERIC : VLC_SUCCESS;
     vlc_fifo_Unlock( p_owner->p_fifo );
+    DecoderBlockingLeave( p_owner );
     return ret;
 }
 
@@ -997,6 +1066,144 @@ static int DecoderQueueCc( decoder_t *p_videodec, block_t *p_cc,
     return 0;
 }
 
+static void DecoderLoopCacheRelease( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( p_owner->loop.p_fifo == NULL )
+        return;
+
+    picture_fifo_Delete( p_owner->loop.p_fifo );
+    p_owner->loop.p_fifo = NULL;
+    p_owner->loop.i_size = 0;
+    p_owner->loop.i_count = 0;
+    p_owner->loop.b_complete = false;
+
+    if( p_owner->p_input != NULL )
+        var_SetInteger( p_owner->p_input, "loop-cache-size", 0 );
+}
+
+/**
+ * Keeps a copy of a decoded picture in the loop cache.
+ *
+ * The picture date is still expressed in stream time at this point.
+ */
+static void DecoderLoopCacheRecord( decoder_t *p_dec, const picture_t *p_pic )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    const vlc_tick_t i_prev = p_owner->loop.i_last;
+
+    p_owner->loop.i_last = p_pic->date;
+
+    if( p_owner->loop.p_fifo == NULL || p_owner->loop.b_complete )
+        return;
+
+    const vlc_chroma_description_t *dsc =
+        vlc_fourcc_GetChromaDescription( p_pic->format.i_chroma );
+    if( dsc == NULL || dsc->plane_count == 0 || p_pic->context != NULL )
+    {
+        msg_Dbg( p_dec, "loop cache disabled: opaque pictures" );
+        DecoderLoopCacheRelease( p_dec );
+        return;
+    }
+
+    picture_t *p_copy = picture_NewFromFormat( &p_pic->format );
+    if( unlikely(p_copy == NULL) )
+    {
+        DecoderLoopCacheRelease( p_dec );
+        return;
+    }
+
+    size_t i_size = 0;
+    for( int i = 0; i < p_copy->i_planes; i++ )
+        i_size += (size_t)p_copy->p[i].i_pitch * p_copy->p[i].i_lines;
+
+    if( p_owner->loop.i_size + i_size > p_owner->loop.i_max )
+    {
+        msg_Dbg( p_dec, "loop cache disabled: stream does not fit in %zu "
+                 "bytes", p_owner->loop.i_max );
+        picture_Release( p_copy );
+        DecoderLoopCacheRelease( p_dec );
+        return;
+    }
+
+    picture_Copy( p_copy, p_pic );
+    picture_fifo_Push( p_owner->loop.p_fifo, p_copy );
+
+    if( p_owner->loop.i_count == 0 )
+        p_owner->loop.i_first = p_pic->date;
+    else if( p_pic->date > i_prev )
+        p_owner->loop.i_frame = p_pic->date - i_prev;
+    p_owner->loop.i_size += i_size;
+    p_owner->loop.i_count++;
+}
+
+/**
+ * Tells whether a decoded video block must be dropped before decoding because
+ * of the throttle level.
+ *
+ * Only blocks flagged as predicted are dropped, so that streams whose
+ * packetizer does not set the frame type are still decoded. Once the throttle
+ * is released, predicted blocks are still dropped until the next keyframe, as
+ * their references were not decoded.
+ */
+static bool DecoderThrottleDrop( decoder_t *p_dec, const block_t *p_block )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    const int i_throttle = atomic_load_explicit( &p_owner->throttle,
+                                                 memory_order_relaxed );
+    const bool b_typed = p_block->i_flags & BLOCK_FLAG_TYPE_MASK;
+    const bool b_key = p_block->i_flags & BLOCK_FLAG_TYPE_I;
+
+    if( i_throttle != INPUT_DECODER_THROTTLE_NONE )
+    {
+        /* The first pass cannot be cached while pictures are skipped */
+        if( p_owner->loop.p_fifo != NULL && !p_owner->loop.b_complete )
+        {
+            msg_Dbg( p_dec, "loop cache disabled: throttled while filling" );
+            DecoderLoopCacheRelease( p_dec );
+        }
+        p_owner->b_throttle_resync = true;
+        return b_typed && !b_key;
+    }
+
+    if( !p_owner->b_throttle_resync )
+        return false;
+    if( b_typed && !b_key )
+        return true;
+
+    msg_Dbg( p_dec, "throttle released, resuming at keyframe" );
+    p_owner->b_throttle_resync = false;
+    return false;
+}
+
+/**
+ * Tells whether a picture may reach the video output at the current throttle
+ * level.
+ *
+ * A forced picture is always shown unless the output is hidden.
+ */
+static bool DecoderThrottleDisplay( decoder_t *p_dec, const picture_t *p_pic )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    const vlc_tick_t i_date = p_pic->date;
+
+    switch( atomic_load_explicit( &p_owner->throttle, memory_order_relaxed ) )
+    {
+        case INPUT_DECODER_THROTTLE_HIDDEN:
+            return false;
+        case INPUT_DECODER_THROTTLE_KEYFRAMES:
+            if( !p_pic->b_force
+             && p_owner->i_throttle_last != VLC_TICK_INVALID
+             && i_date >= p_owner->i_throttle_last
+             && i_date - p_owner->i_throttle_last < DECODER_THROTTLE_INTERVAL )
+                return false;
+            break;
+    }
+    p_owner->i_throttle_last = i_date;
+    return true;
+}
+
 static int DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
                              unsigned *restrict pi_lost_sum )
 {
@@ -1030,6 +1237,10 @@ static int DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
         goto discard;
     }
 
+    /* Only cache the pictures that passed the preroll, so that a replayed
+     * pass starts at the first picture that was displayed */
+    DecoderLoopCacheRecord( p_dec, p_picture );
+
     /* */
     vlc_mutex_lock( &p_owner->lock );
 
@@ -1057,6 +1268,12 @@ static int DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
 
     vlc_mutex_unlock( &p_owner->lock );
 
+    if( !DecoderThrottleDisplay( p_dec, p_picture ) )
+    {
+        picture_Release( p_picture );
+        return 0;
+    }
+
     /* FIXME: The *input* FIFO should not be locked here. This will not work
      * properly if/when pictures are queued asynchronously. */
     vlc_fifo_Lock( p_owner->p_fifo );
@@ -1132,6 +1349,173 @@ static int DecoderQueueVideo( decoder_t *p_dec, picture_t *p_pic )
     return ret;
 }
 
+/**
+ * Sends the next picture of the loop cache to the video output.
+ *
+ * The pictures are redated so that each pass directly follows the last
+ * picture that was queued, whether it was decoded or replayed.
+ *
+ * \return false if the video output did not provide a picture, i.e. its pool
+ * is canceled because of a pending flush or stop: the decoder must then wait
+ * for that request instead of retrying
+ */
+static bool DecoderLoopCacheReplay( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    vout_thread_t *p_vout = p_owner->p_vout;
+
+    if( p_owner->loop.i_pos == 0 )
+        p_owner->loop.i_offset = p_owner->loop.i_last
+                               + p_owner->loop.i_frame - p_owner->loop.i_first;
+
+    /* Nothing is displayed: do not even copy the picture */
+    const bool b_hidden = p_vout == NULL
+                       || atomic_load_explicit( &p_owner->throttle,
+                    memory_order_relaxed ) == INPUT_DECODER_THROTTLE_HIDDEN;
+
+    picture_t *p_pic = NULL;
+    if( !b_hidden )
+    {
+        p_pic = vout_new_buffer( p_dec );
+        if( p_pic == NULL )
+            return false;
+    }
+
+    picture_t *p_cached = picture_fifo_Peek( p_owner->loop.p_fifo );
+    assert( p_cached != NULL );
+
+    if( b_hidden )
+    {   /* Keep the replay running at the stream pace, without output */
+        vlc_tick_t i_date = p_cached->date + p_owner->loop.i_offset;
+        const vlc_tick_t i_last = i_date;
+
+        vlc_mutex_lock( &p_owner->lock );
+        DecoderFixTs( p_dec, &i_date, NULL, NULL, NULL, INT64_MAX );
+        vlc_mutex_unlock( &p_owner->lock );
+        if( i_date > VLC_TICK_INVALID
+         && DecoderTimedWait( p_dec, i_date ) != VLC_SUCCESS )
+        {   /* Flushing: the cache is rewound by the flush */
+            picture_Release( p_cached );
+            return true;
+        }
+        p_owner->loop.i_last = i_last;
+    }
+    else if( p_pic->format.i_chroma != p_cached->format.i_chroma
+     || p_pic->format.i_width != p_cached->format.i_width
+     || p_pic->format.i_height != p_cached->format.i_height )
+    {
+        msg_Warn( p_dec, "loop cache disabled: video output changed" );
+        picture_Release( p_pic );
+        picture_Release( p_cached );
+
+        vlc_fifo_Lock( p_owner->p_fifo );
+        p_owner->loop.i_passes = 0;
+        vlc_fifo_Unlock( p_owner->p_fifo );
+        DecoderLoopCacheRelease( p_dec );
+        return true;
+    }
+    else
+    {
+        picture_Copy( p_pic, p_cached );
+        p_pic->date += p_owner->loop.i_offset;
+
+        unsigned i_lost = 0;
+        DecoderPlayVideo( p_dec, p_pic, &i_lost );
+        p_owner->pf_update_stat( p_owner, 0, i_lost );
+    }
+    picture_Release( p_cached );
+
+    /* Rotate the cache so that it can be replayed again */
+    picture_fifo_Push( p_owner->loop.p_fifo,
+                       picture_fifo_Pop( p_owner->loop.p_fifo ) );
+    if( ++p_owner->loop.i_pos < p_owner->loop.i_count )
+        return true;
+
+    /* End of pass */
+    p_owner->loop.i_pos = 0;
+
+    vlc_fifo_Lock( p_owner->p_fifo );
+    if( p_owner->loop.i_passes > 0 )
+    {
+        p_owner->loop.i_passes--;
+        p_owner->loop.i_replayed++;
+    }
+    vlc_fifo_Unlock( p_owner->p_fifo );
+
+    if( p_owner->p_input != NULL )
+        var_IncInteger( p_owner->p_input, "loop-cache-hits" );
+    return true;
+}
+
+/**
+ * Rotates the loop cache back to its first picture, so that the next replay
+ * starts a new pass.
+ */
+static void DecoderLoopCacheRewind( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( p_owner->loop.p_fifo != NULL && p_owner->loop.i_pos > 0 )
+    {
+        assert( p_owner->loop.b_complete );
+        for( unsigned i = p_owner->loop.i_pos; i < p_owner->loop.i_count; i++ )
+            picture_fifo_Push( p_owner->loop.p_fifo,
+                               picture_fifo_Pop( p_owner->loop.p_fifo ) );
+    }
+    p_owner->loop.i_pos = 0;
+}
+
+/**
+ * Called once the decoder is drained: the first pass is then entirely in the
+ * loop cache, unless it was disabled meanwhile.
+ *
+ * The fifo lock must be held.
+ */
+static void DecoderLoopCacheDrained( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( p_owner->loop.p_fifo != NULL && !p_owner->loop.b_complete
+     && p_owner->loop.i_count > 0 )
+    {
+        const video_format_t *p_fmt = &p_owner->fmt.video;
+
+        if( p_fmt->i_frame_rate > 0 && p_fmt->i_frame_rate_base > 0 )
+            p_owner->loop.i_frame = CLOCK_FREQ * p_fmt->i_frame_rate_base
+                                  / p_fmt->i_frame_rate;
+        else if( p_owner->loop.i_frame <= 0 )
+            p_owner->loop.i_frame = CLOCK_FREQ / 25;
+
+        p_owner->loop.b_complete = true;
+        msg_Dbg( p_dec, "loop cache filled with %u pictures (%zu bytes)",
+                 p_owner->loop.i_count, p_owner->loop.i_size );
+        if( p_owner->p_input != NULL )
+            var_SetInteger( p_owner->p_input, "loop-cache-size",
+                            p_owner->loop.i_size );
+    }
+
+    if( p_owner->loop.p_fifo == NULL || !p_owner->loop.b_complete )
+        p_owner->loop.i_passes = 0;
+    DecoderLoopCacheRewind( p_dec );
+}
+
+static void DecoderLoopCacheFlush( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    /* The pending passes were dropped by input_DecoderFlush(): passes
+     * requested since then are for the stream after the flush */
+    DecoderLoopCacheRewind( p_dec );
+    p_owner->loop.i_last = VLC_TICK_INVALID;
+
+    /* A partial first pass cannot be completed anymore */
+    if( !p_owner->loop.b_complete && p_owner->loop.i_count > 0 )
+    {
+        msg_Dbg( p_dec, "loop cache disabled: flushed while filling" );
+        DecoderLoopCacheRelease( p_dec );
+    }
+}
+
 static int DecoderPlayAudio( decoder_t *p_dec, block_t *p_audio,
                              unsigned *restrict pi_lost_sum )
 {
@@ -1342,6 +1726,13 @@ static void DecoderDecode( decoder_t *p_dec, block_t *p_block )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
+    if( p_block != NULL && p_dec->fmt_in.i_cat == VIDEO_ES
+     && DecoderThrottleDrop( p_dec, p_block ) )
+    {
+        block_Release( p_block );
+        return;
+    }
+
     int ret = p_dec->pf_decode( p_dec, p_block );
     switch( ret )
     {
@@ -1528,124 +1919,189 @@ static void DecoderProcessFlush( decoder_t *p_dec )
         }
     }
 
+    if( p_dec->fmt_out.i_cat == VIDEO_ES )
+        DecoderLoopCacheFlush( p_dec );
+
     vlc_mutex_lock( &p_owner->lock );
     p_owner->i_preroll_end = INT64_MIN;
     vlc_mutex_unlock( &p_owner->lock );
 }
 
 /**
- * The decoding main loop
+ * Runs one iteration of the decoding loop
+ *
+ * The fifo lock must be held.
  *
  * \param p_dec the decoder
+ * \return false if the decoder has to wait for more data or a request
  */
-static void *DecoderThread( void *p_data )
+static bool DecoderStep( decoder_t *p_dec )
 {
-    decoder_t *p_dec = (decoder_t *)p_data;
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
-    bool paused = false;
 
-    /* The decoder's main loop */
-    vlc_fifo_Lock( p_owner->p_fifo );
-    vlc_fifo_CleanupPush( p_owner->p_fifo );
+    if( p_owner->flushing )
+    {   /* Flush before/regardless of pause. We do not want to resume just
+         * for the sake of flushing (glitches could otherwise happen). */
+        int canc = vlc_savecancel();
 
-    for( ;; )
-    {
-        if( p_owner->flushing )
-        {   /* Flush before/regardless of pause. We do not want to resume just
-             * for the sake of flushing (glitches could otherwise happen). */
-            int canc = vlc_savecancel();
+        vlc_fifo_Unlock( p_owner->p_fifo );
 
-            vlc_fifo_Unlock( p_owner->p_fifo );
+        /* Flush the decoder (and the output) */
+        DecoderProcessFlush( p_dec );
 
-            /* Flush the decoder (and the output) */
-            DecoderProcessFlush( p_dec );
+        vlc_fifo_Lock( p_owner->p_fifo );
+        vlc_restorecancel( canc );
 
-            vlc_fifo_Lock( p_owner->p_fifo );
-            vlc_restorecancel( canc );
+        /* Reset flushing after DecoderProcess in case input_DecoderFlush
+         * is called again. This will avoid a second useless flush (but
+         * harmless). */
+        p_owner->flushing = false;
 
-            /* Reset flushing after DecoderProcess in case input_DecoderFlush
-             * is called again. This will avoid a second useless flush (but
-             * harmless). */
-            p_owner->flushing = false;
+        return true;
+    }
 
-            continue;
-        }
+    if( p_owner->output_paused != p_owner->paused )
+    {   /* Update playing/paused status of the output */
+        int canc = vlc_savecancel();
+        vlc_tick_t date = p_owner->pause_date;
+        bool paused = p_owner->paused;
 
-        if( paused != p_owner->paused )
-        {   /* Update playing/paused status of the output */
-            int canc = vlc_savecancel();
-            vlc_tick_t date = p_owner->pause_date;
+        p_owner->output_paused = paused;
+        vlc_fifo_Unlock( p_owner->p_fifo );
 
-            paused = p_owner->paused;
-            vlc_fifo_Unlock( p_owner->p_fifo );
+        /* NOTE: Only the audio and video outputs care about pause. */
+        msg_Dbg( p_dec, "toggling %s", paused ? "resume" : "pause" );
+        if( p_owner->p_vout != NULL )
+            vout_ChangePause( p_owner->p_vout, paused, date );
+        if( p_owner->p_aout != NULL )
+            aout_DecChangePause( p_owner->p_aout, paused, date );
 
-            /* NOTE: Only the audio and video outputs care about pause. */
-            msg_Dbg( p_dec, "toggling %s", paused ? "resume" : "pause" );
-            if( p_owner->p_vout != NULL )
-                vout_ChangePause( p_owner->p_vout, paused, date );
-            if( p_owner->p_aout != NULL )
-                aout_DecChangePause( p_owner->p_aout, paused, date );
+        vlc_restorecancel( canc );
+        vlc_fifo_Lock( p_owner->p_fifo );
+        return true;
+    }
 
-            vlc_restorecancel( canc );
-            vlc_fifo_Lock( p_owner->p_fifo );
-            continue;
-        }
+    if( p_owner->paused && p_owner->frames_countdown == 0 )
+    {   /* Wait for resumption from pause */
+        p_owner->b_idle = true;
+        vlc_cond_signal( &p_owner->wait_acknowledge );
+        return false;
+    }
+
+    vlc_cond_signal( &p_owner->wait_fifo );
+    vlc_testcancel(); /* forced expedited cancellation in case of stop */
 
-        if( p_owner->paused && p_owner->frames_countdown == 0 )
-        {   /* Wait for resumption from pause */
+    block_t *p_block = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
+    if( p_block == NULL && p_owner->loop.i_passes > 0
+     && p_owner->loop.b_complete && !p_owner->b_draining )
+    {   /* Replay from the loop cache instead of waiting for blocks */
+        vlc_fifo_Unlock( p_owner->p_fifo );
+
+        int canc = vlc_savecancel();
+        bool b_replayed = DecoderLoopCacheReplay( p_dec );
+        vlc_restorecancel( canc );
+
+        vlc_fifo_Lock( p_owner->p_fifo );
+        if( !b_replayed && !p_owner->flushing )
+        {   /* Wait for the flush or stop that canceled the picture pool */
             p_owner->b_idle = true;
             vlc_cond_signal( &p_owner->wait_acknowledge );
-            vlc_fifo_Wait( p_owner->p_fifo );
-            p_owner->b_idle = false;
-            continue;
+            return false;
         }
+        return true;
+    }
+    if( p_block == NULL )
+    {
+        if( likely(!p_owner->b_draining) )
+        {   /* Wait for a block to decode (or a request to drain) */
+            p_owner->b_idle = true;
+            vlc_cond_signal( &p_owner->wait_acknowledge );
+            return false;
+        }
+        /* We have emptied the FIFO and there is a pending request to
+         * drain. Pass p_block = NULL to decoder just once. */
+    }
 
-        vlc_cond_signal( &p_owner->wait_fifo );
-        vlc_testcancel(); /* forced expedited cancellation in case of stop */
+    vlc_fifo_Unlock( p_owner->p_fifo );
 
-        block_t *p_block = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
-        if( p_block == NULL )
-        {
-            if( likely(!p_owner->b_draining) )
-            {   /* Wait for a block to decode (or a request to drain) */
-                p_owner->b_idle = true;
-                vlc_cond_signal( &p_owner->wait_acknowledge );
-                vlc_fifo_Wait( p_owner->p_fifo );
-                p_owner->b_idle = false;
-                continue;
-            }
-            /* We have emptied the FIFO and there is a pending request to
-             * drain. Pass p_block = NULL to decoder just once. */
-        }
+    int canc = vlc_savecancel();
+    DecoderProcess( p_dec, p_block );
 
-        vlc_fifo_Unlock( p_owner->p_fifo );
+    if( p_block == NULL )
+    {   /* Draining: the decoder is drained and all decoded buffers are
+         * queued to the output at this point. Now drain the output. */
+        if( p_owner->p_aout != NULL )
+            aout_DecFlush( p_owner->p_aout, true );
+    }
+    vlc_restorecancel( canc );
 
-        int canc = vlc_savecancel();
-        DecoderProcess( p_dec, p_block );
+    /* TODO? Wait for draining instead of polling. */
+    vlc_mutex_lock( &p_owner->lock );
+    if( p_owner->b_draining && (p_block == NULL) )
+    {
+        p_owner->b_draining = false;
+        p_owner->drained = true;
+    }
+    vlc_fifo_Lock( p_owner->p_fifo );
+    if( p_block == NULL && p_dec->fmt_out.i_cat == VIDEO_ES )
+        DecoderLoopCacheDrained( p_dec );
+    vlc_cond_signal( &p_owner->wait_acknowledge );
+    vlc_mutex_unlock( &p_owner->lock );
+    return true;
+}
 
-        if( p_block == NULL )
-        {   /* Draining: the decoder is drained and all decoded buffers are
-             * queued to the output at this point. Now drain the output. */
-            if( p_owner->p_aout != NULL )
-                aout_DecFlush( p_owner->p_aout, true );
-        }
-        vlc_restorecancel( canc );
+/**
+ * The decoding main loop
+ *
+ * \param p_dec the decoder
+ */
+static void *DecoderThread( void *p_data )
+{
+    decoder_t *p_dec = (decoder_t *)p_data;
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
-        /* TODO? Wait for draining instead of polling. */
-        vlc_mutex_lock( &p_owner->lock );
-        if( p_owner->b_draining && (p_block == NULL) )
+    /* The decoder's main loop */
+    vlc_fifo_Lock( p_owner->p_fifo );
+    vlc_fifo_CleanupPush( p_owner->p_fifo );
+
+    for( ;; )
+    {
+        if( !DecoderStep( p_dec ) )
         {
-            p_owner->b_draining = false;
-            p_owner->drained = true;
+            vlc_fifo_Wait( p_owner->p_fifo );
+            p_owner->b_idle = false;
         }
-        vlc_fifo_Lock( p_owner->p_fifo );
-        vlc_cond_signal( &p_owner->wait_acknowledge );
-        vlc_mutex_unlock( &p_owner->lock );
     }
     vlc_cleanup_pop();
     vlc_assert_unreachable();
 }
 
+/**
+ * The decoding loop of the decoders run by the shared decoder threads
+ *
+ * It returns instead of waiting, and is scheduled again by DecoderSignal().
+ * After a few iterations, it is queued again behind the other decoders.
+ */
+static void DecoderTask( void *p_data )
+{
+    decoder_t *p_dec = p_data;
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_fifo_Lock( p_owner->p_fifo );
+    p_owner->b_idle = false;
+    for( unsigned i = 0; !p_owner->b_closing; i++ )
+    {
+        if( i == DECODER_POOL_STEPS )
+        {
+            decoder_pool_Schedule( p_owner->p_pool, &p_owner->task );
+            break;
+        }
+        if( !DecoderStep( p_dec ) )
+            break;
+    }
+    vlc_fifo_Unlock( p_owner->p_fifo );
+}
+
 /**
  * Create a decoder object
  *
@@ -1686,11 +2142,14 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_owner->p_sout = p_sout;
     p_owner->p_sout_input = NULL;
     p_owner->p_packetizer = NULL;
+    p_owner->p_pool = NULL;
+    p_owner->b_closing = false;
 
     p_owner->b_fmt_description = false;
     p_owner->p_description = NULL;
 
     p_owner->paused = false;
+    p_owner->output_paused = false;
     p_owner->pause_date = VLC_TICK_INVALID;
     p_owner->frames_countdown = 0;
 
@@ -1706,8 +2165,25 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     atomic_init( &p_owner->reload, RELOAD_NO_REQUEST );
     p_owner->b_idle = false;
 
+    atomic_init( &p_owner->throttle, INPUT_DECODER_THROTTLE_NONE );
+    p_owner->b_throttle_resync = false;
+    p_owner->i_throttle_last = VLC_TICK_INVALID;
+
     es_format_Init( &p_owner->fmt, fmt->i_cat, 0 );
 
+    p_owner->loop.p_fifo = NULL;
+    p_owner->loop.i_size = 0;
+    p_owner->loop.i_max = 0;
+    p_owner->loop.i_count = 0;
+    p_owner->loop.i_pos = 0;
+    p_owner->loop.i_first = VLC_TICK_INVALID;
+    p_owner->loop.i_frame = 0;
+    p_owner->loop.i_offset = 0;
+    p_owner->loop.i_last = VLC_TICK_INVALID;
+    p_owner->loop.b_complete = false;
+    p_owner->loop.i_passes = 0;
+    p_owner->loop.i_replayed = 0;
+
     /* decoder fifo */
     p_owner->p_fifo = block_FifoNew();
     if( unlikely(p_owner->p_fifo == NULL) )
@@ -1803,6 +2279,17 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     for( unsigned i = 0; i < MAX_CC_DECODERS; i++ )
         p_owner->cc.pp_decoder[i] = NULL;
     p_owner->i_ts_delay = 0;
+
+    /* Loop cache */
+    if( p_dec->fmt_out.i_cat == VIDEO_ES && p_sout == NULL && p_input != NULL )
+    {
+        int64_t i_max = var_InheritInteger( p_dec, "input-loop-cache" );
+        if( i_max > 0 )
+        {
+            p_owner->loop.i_max = (size_t)i_max << 20;
+            p_owner->loop.p_fifo = picture_fifo_New();
+        }
+    }
     return p_dec;
 }
 
@@ -1869,6 +2356,8 @@ static void DeleteDecoder( decoder_t * p_dec )
     if( p_owner->p_description )
         vlc_meta_Delete( p_owner->p_description );
 
+    DecoderLoopCacheRelease( p_dec );
+
     if( p_owner->p_packetizer )
     {
         UnloadDecoder( p_owner->p_packetizer );
@@ -1935,6 +2424,21 @@ static decoder_t *decoder_New( vlc_object_t *p_parent, input_thread_t *p_input,
     p_dec->p_owner->p_clock = p_clock;
     assert( p_dec->fmt_out.i_cat != UNKNOWN_ES );
 
+    /* Audio decoders keep their own thread: they wait for the audio output
+     * most of the time, and are sensitive to scheduling latency. */
+    if( p_dec->fmt_out.i_cat != AUDIO_ES )
+    {
+        decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+        p_owner->p_pool = libvlc_priv( p_dec->obj.libvlc )->decoder_pool;
+        if( p_owner->p_pool != NULL )
+        {   /* Run on the shared decoder threads */
+            decoder_task_Init( &p_owner->task, DecoderTask, p_dec );
+            p_owner->b_idle = true;
+            return p_dec;
+        }
+    }
+
     if( p_dec->fmt_out.i_cat == AUDIO_ES )
         i_priority = VLC_THREAD_PRIORITY_AUDIO;
     else
@@ -1988,9 +2492,11 @@ void input_DecoderDelete( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
-    vlc_cancel( p_owner->thread );
+    if( p_owner->p_pool == NULL )
+        vlc_cancel( p_owner->thread );
 
     vlc_fifo_Lock( p_owner->p_fifo );
+    p_owner->b_closing = true;
     /* Signal DecoderTimedWait */
     p_owner->flushing = true;
     vlc_cond_signal( &p_owner->wait_timed );
@@ -2012,7 +2518,10 @@ void input_DecoderDelete( decoder_t *p_dec )
         vout_Cancel( p_owner->p_vout, true );
     vlc_mutex_unlock( &p_owner->lock );
 
-    vlc_join( p_owner->thread, NULL );
+    if( p_owner->p_pool != NULL )
+        decoder_pool_Cancel( p_owner->p_pool, &p_owner->task );
+    else
+        vlc_join( p_owner->thread, NULL );
 
     /* */
     if( p_dec->p_owner->cc.b_supported )
@@ -2060,6 +2569,8 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
     }
 
     vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_block );
+    if( p_owner->p_pool != NULL )
+        decoder_pool_Schedule( p_owner->p_pool, &p_owner->task );
     vlc_fifo_Unlock( p_owner->p_fifo );
 }
 
@@ -2070,7 +2581,8 @@ bool input_DecoderIsEmpty( decoder_t * p_dec )
     assert( !p_owner->b_waiting );
 
     vlc_fifo_Lock( p_owner->p_fifo );
-    if( !vlc_fifo_IsEmpty( p_dec->p_owner->p_fifo ) || p_owner->b_draining )
+    if( !vlc_fifo_IsEmpty( p_dec->p_owner->p_fifo ) || p_owner->b_draining
+     || p_owner->loop.i_passes > 0 )
     {
         vlc_fifo_Unlock( p_owner->p_fifo );
         return false;
@@ -2110,8 +2622,47 @@ void input_DecoderDrain( decoder_t *p_dec )
 
     vlc_fifo_Lock( p_owner->p_fifo );
     p_owner->b_draining = true;
-    vlc_fifo_Signal( p_owner->p_fifo );
+    DecoderSignal( p_owner );
+    vlc_fifo_Unlock( p_owner->p_fifo );
+}
+
+bool input_DecoderHasLoopCache( decoder_t *p_dec )
+{
+    return p_dec->p_owner->loop.i_max > 0;
+}
+
+void input_DecoderSetLoopReplay( decoder_t *p_dec, unsigned i_passes )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_fifo_Lock( p_owner->p_fifo );
+    p_owner->loop.i_passes = i_passes;
+    DecoderSignal( p_owner );
+    vlc_fifo_Unlock( p_owner->p_fifo );
+}
+
+unsigned input_DecoderGetLoopReplayed( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_fifo_Lock( p_owner->p_fifo );
+    unsigned i_replayed = p_owner->loop.i_replayed;
+    p_owner->loop.i_replayed = 0;
     vlc_fifo_Unlock( p_owner->p_fifo );
+
+    return i_replayed;
+}
+
+/**
+ * Lowers the decoding and display work of a video decoder, e.g. while its
+ * output is occluded or on battery power.
+ */
+void input_DecoderSetThrottle( decoder_t *p_dec, int i_throttle )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( atomic_exchange( &p_owner->throttle, i_throttle ) != i_throttle )
+        msg_Dbg( p_dec, "throttle level set to %d", i_throttle );
 }
 
 /**
@@ -2132,6 +2683,7 @@ void input_DecoderFlush( decoder_t *p_dec )
      * dequeued by DecoderThread and there is no need to flush a second time in
      * a row. */
     p_owner->flushing = true;
+    p_owner->loop.i_passes = 0;
 
     /* Flush video/spu decoder when paused: increment frames_countdown in order
      * to display one frame/subtitle */
@@ -2140,7 +2692,7 @@ void input_DecoderFlush( decoder_t *p_dec )
      && p_owner->frames_countdown == 0 )
         p_owner->frames_countdown++;
 
-    vlc_fifo_Signal( p_owner->p_fifo );
+    DecoderSignal( p_owner );
     vlc_cond_signal( &p_owner->wait_timed );
 
     vlc_fifo_Unlock( p_owner->p_fifo );
@@ -2258,7 +2810,7 @@ void input_DecoderChangePause( decoder_t *p_dec, bool b_paused, vlc_tick_t i_dat
     p_owner->paused = b_paused;
     p_owner->pause_date = i_date;
     p_owner->frames_countdown = 0;
-    vlc_fifo_Signal( p_owner->p_fifo );
+    DecoderSignal( p_owner );
     vlc_fifo_Unlock( p_owner->p_fifo );
 }
 
@@ -2332,7 +2884,7 @@ void input_DecoderFrameNext( decoder_t *p_dec, vlc_tick_t *pi_duration )
 
     vlc_fifo_Lock( p_owner->p_fifo );
     p_owner->frames_countdown++;
-    vlc_fifo_Signal( p_owner->p_fifo );
+    DecoderSignal( p_owner );
     vlc_fifo_Unlock( p_owner->p_fifo );
 
     vlc_mutex_lock( &p_owner->lock );
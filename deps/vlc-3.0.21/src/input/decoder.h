@@ -63,6 +63,43 @@ void input_DecoderStopWait( decoder_t * );
  */
 bool input_DecoderIsEmpty( decoder_t * );
 
+/**
+ * This function returns true if the decoder keeps its decoded pictures in a
+ * loop cache (see "input-loop-cache").
+ */
+bool input_DecoderHasLoopCache( decoder_t * );
+
+/**
+ * This function requests the decoder to replay its loop cache i_passes times
+ * once it is drained. The request is silently dropped if the whole stream
+ * could not be cached.
+ */
+void input_DecoderSetLoopReplay( decoder_t *, unsigned i_passes );
+
+/**
+ * This function returns the number of passes replayed from the loop cache
+ * since the last call.
+ */
+unsigned input_DecoderGetLoopReplayed( decoder_t * );
+
+/**
+ * Video decoding throttle levels (see "video-throttle").
+ */
+enum input_decoder_throttle
+{
+    INPUT_DECODER_THROTTLE_NONE,      /* decode and display every picture */
+    INPUT_DECODER_THROTTLE_KEYFRAMES, /* decode keyframes, display about one
+                                         picture per second */
+    INPUT_DECODER_THROTTLE_HIDDEN,    /* decode keyframes, display nothing */
+};
+
+/**
+ * This function changes the throttle level of a video decoder.
+ * When it goes back to INPUT_DECODER_THROTTLE_NONE, the decoder resumes at
+ * the next keyframe.
+ */
+void input_DecoderSetThrottle( decoder_t *, int i_throttle );
+
 /**
  * This function activates the request closed caption channel.
  */
@@ -0,0 +1,441 @@
+/*****************************************************************************
+ * decoder_pool.c: shared decoder threads
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <limits.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+
+#include "decoder_pool.h"
+
+/* Each pool thread has its own queue of tasks. Tasks scheduled from outside
+ * the pool are spread among the queues, and threads without work steal from
+ * the queues of the others. Spare threads, started while tasks block, have
+ * no queue and only steal. They stop after some idle time once the blocked
+ * tasks are back. */
+#define SPARE_IDLE_TIME (5 * CLOCK_FREQ)
+
+enum
+{
+    TASK_IDLE,
+    TASK_QUEUED,
+    TASK_RUNNING,
+    TASK_RESCHEDULED, /* running, and to be queued again */
+    TASK_CANCELLED,
+};
+#define TASK_WAITED 0x8 /* decoder_pool_Cancel() waits for the task */
+
+struct decoder_pool_queue
+{
+    vlc_mutex_t lock;
+    decoder_task_t *p_first;
+    decoder_task_t **pp_last;
+};
+
+struct decoder_pool_worker
+{
+    decoder_pool_t *p_pool;
+    vlc_thread_t thread;
+    unsigned i_queue; /* UINT_MAX for spare threads */
+    bool b_done;      /* spare thread exited, to be joined */
+    struct decoder_pool_worker *p_next;
+};
+
+struct decoder_pool_t
+{
+    vlc_object_t *p_obj;
+
+    unsigned i_queues; /* one per CPU */
+    struct decoder_pool_queue *p_queues;
+    struct decoder_pool_worker *p_workers;
+    atomic_uint i_next;    /* queue for the next scheduled task */
+    atomic_uint i_pending; /* queued tasks */
+    atomic_uint i_idle;    /* threads waiting for tasks */
+
+    vlc_mutex_t lock;
+    vlc_cond_t  wait_work;
+    vlc_cond_t  wait_task;
+    unsigned    i_threads; /* spare threads included */
+    unsigned    i_blocked; /* threads running a blocked task */
+    struct decoder_pool_worker *p_spares;
+    bool        b_exit;
+};
+
+static void QueuePush( decoder_pool_t *p_pool, struct decoder_pool_queue *p_queue,
+                       decoder_task_t *p_task )
+{
+    p_task->p_next = NULL;
+
+    vlc_mutex_lock( &p_queue->lock );
+    *p_queue->pp_last = p_task;
+    p_queue->pp_last = &p_task->p_next;
+    atomic_fetch_add( &p_pool->i_pending, 1 );
+    vlc_mutex_unlock( &p_queue->lock );
+}
+
+static decoder_task_t *QueuePop( decoder_pool_t *p_pool,
+                                 struct decoder_pool_queue *p_queue )
+{
+    vlc_mutex_lock( &p_queue->lock );
+    decoder_task_t *p_task = p_queue->p_first;
+    if( p_task != NULL )
+    {
+        p_queue->p_first = p_task->p_next;
+        if( p_queue->p_first == NULL )
+            p_queue->pp_last = &p_queue->p_first;
+        atomic_fetch_sub( &p_pool->i_pending, 1 );
+    }
+    vlc_mutex_unlock( &p_queue->lock );
+    return p_task;
+}
+
+/* Takes a task from the own queue of the thread, else from the others */
+static decoder_task_t *PoolPop( decoder_pool_t *p_pool, unsigned i_queue )
+{
+    if( i_queue == UINT_MAX )
+        i_queue = atomic_load_explicit( &p_pool->i_next, memory_order_relaxed );
+
+    for( unsigned i = 0; i < p_pool->i_queues; i++ )
+    {
+        if( atomic_load( &p_pool->i_pending ) == 0 )
+            break;
+
+        struct decoder_pool_queue *p_queue =
+            &p_pool->p_queues[(i_queue + i) % p_pool->i_queues];
+        decoder_task_t *p_task = QueuePop( p_pool, p_queue );
+        if( p_task != NULL )
+            return p_task;
+    }
+    return NULL;
+}
+
+/* Queues a task, the task must be in the queued state */
+static void PoolPush( decoder_pool_t *p_pool, decoder_task_t *p_task )
+{
+    unsigned i_queue = atomic_fetch_add_explicit( &p_pool->i_next, 1,
+                                                  memory_order_relaxed );
+    QueuePush( p_pool, &p_pool->p_queues[i_queue % p_pool->i_queues], p_task );
+
+    if( atomic_load( &p_pool->i_idle ) > 0 )
+    {
+        vlc_mutex_lock( &p_pool->lock );
+        vlc_cond_signal( &p_pool->wait_work );
+        vlc_mutex_unlock( &p_pool->lock );
+    }
+}
+
+static void TaskRun( decoder_pool_t *p_pool, decoder_task_t *p_task )
+{
+    unsigned state = atomic_load( &p_task->state );
+    do
+        assert( (state & ~TASK_WAITED) == TASK_QUEUED );
+    while( !atomic_compare_exchange_weak( &p_task->state, &state,
+                                    TASK_RUNNING | (state & TASK_WAITED) ) );
+
+    p_task->pf_run( p_task->p_data );
+
+    unsigned next;
+    state = atomic_load( &p_task->state );
+    do
+    {
+        if( state & TASK_WAITED )
+            break;
+        next = state == TASK_RESCHEDULED ? TASK_QUEUED : TASK_IDLE;
+    }
+    while( !atomic_compare_exchange_weak( &p_task->state, &state, next ) );
+
+    if( state & TASK_WAITED )
+    {   /* The task is being cancelled: it may be freed as soon as it is
+         * idle, so signal under the lock */
+        vlc_mutex_lock( &p_pool->lock );
+        atomic_store( &p_task->state, TASK_IDLE );
+        vlc_cond_broadcast( &p_pool->wait_task );
+        vlc_mutex_unlock( &p_pool->lock );
+    }
+    else if( next == TASK_QUEUED ) /* run the other queued tasks first */
+        PoolPush( p_pool, p_task );
+}
+
+static void *Worker( void *data )
+{
+    struct decoder_pool_worker *p_worker = data;
+    decoder_pool_t *p_pool = p_worker->p_pool;
+    const bool b_spare = p_worker->i_queue == UINT_MAX;
+
+    for( ;; )
+    {
+        decoder_task_t *p_task = PoolPop( p_pool, p_worker->i_queue );
+        if( p_task != NULL )
+        {
+            TaskRun( p_pool, p_task );
+            continue;
+        }
+
+        vlc_mutex_lock( &p_pool->lock );
+        atomic_fetch_add( &p_pool->i_idle, 1 );
+
+        vlc_tick_t deadline = mdate() + SPARE_IDLE_TIME;
+        bool b_timeout = false;
+        while( atomic_load( &p_pool->i_pending ) == 0 && !p_pool->b_exit
+            && !b_timeout )
+        {
+            if( b_spare )
+                b_timeout = vlc_cond_timedwait( &p_pool->wait_work,
+                                                &p_pool->lock, deadline ) != 0;
+            else
+                vlc_cond_wait( &p_pool->wait_work, &p_pool->lock );
+        }
+
+        atomic_fetch_sub( &p_pool->i_idle, 1 );
+        if( p_pool->b_exit || ( b_timeout
+         && p_pool->i_threads - p_pool->i_blocked > p_pool->i_queues ) )
+        {
+            p_pool->i_threads--;
+            p_worker->b_done = true;
+            vlc_mutex_unlock( &p_pool->lock );
+            break;
+        }
+        vlc_mutex_unlock( &p_pool->lock );
+    }
+    return NULL;
+}
+
+/* Joins the exited spare threads, the pool lock must be held */
+static void PoolReapSpares( decoder_pool_t *p_pool )
+{
+    for( struct decoder_pool_worker **pp = &p_pool->p_spares; *pp != NULL; )
+    {
+        struct decoder_pool_worker *p_worker = *pp;
+
+        if( p_worker->b_done )
+        {
+            *pp = p_worker->p_next;
+            vlc_join( p_worker->thread, NULL );
+            free( p_worker );
+        }
+        else
+            pp = &p_worker->p_next;
+    }
+}
+
+static void PoolStartSpare( decoder_pool_t *p_pool )
+{
+    PoolReapSpares( p_pool );
+
+    struct decoder_pool_worker *p_worker = malloc( sizeof( *p_worker ) );
+    if( unlikely(p_worker == NULL) )
+        return;
+
+    p_worker->p_pool = p_pool;
+    p_worker->i_queue = UINT_MAX;
+    p_worker->b_done = false;
+
+    if( vlc_clone( &p_worker->thread, Worker, p_worker,
+                   VLC_THREAD_PRIORITY_VIDEO ) )
+    {
+        msg_Warn( p_pool->p_obj, "cannot spawn spare decoder thread" );
+        free( p_worker );
+        return;
+    }
+
+    p_worker->p_next = p_pool->p_spares;
+    p_pool->p_spares = p_worker;
+    p_pool->i_threads++;
+}
+
+decoder_pool_t *decoder_pool_New( vlc_object_t *p_obj )
+{
+    decoder_pool_t *p_pool = malloc( sizeof( *p_pool ) );
+    if( unlikely(p_pool == NULL) )
+        return NULL;
+
+    unsigned i_count = vlc_GetCPUCount();
+    if( i_count == 0 )
+        i_count = 1;
+
+    p_pool->p_obj = p_obj;
+    p_pool->i_queues = i_count;
+    p_pool->p_queues = vlc_alloc( i_count, sizeof( *p_pool->p_queues ) );
+    p_pool->p_workers = vlc_alloc( i_count, sizeof( *p_pool->p_workers ) );
+    if( unlikely(p_pool->p_queues == NULL || p_pool->p_workers == NULL) )
+    {
+        free( p_pool->p_workers );
+        free( p_pool->p_queues );
+        free( p_pool );
+        return NULL;
+    }
+    atomic_init( &p_pool->i_next, 0 );
+    atomic_init( &p_pool->i_pending, 0 );
+    atomic_init( &p_pool->i_idle, 0 );
+
+    vlc_mutex_init( &p_pool->lock );
+    vlc_cond_init( &p_pool->wait_work );
+    vlc_cond_init( &p_pool->wait_task );
+    p_pool->i_threads = 0;
+    p_pool->i_blocked = 0;
+    p_pool->p_spares = NULL;
+    p_pool->b_exit = false;
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        struct decoder_pool_queue *p_queue = &p_pool->p_queues[i];
+
+        vlc_mutex_init( &p_queue->lock );
+        p_queue->p_first = NULL;
+        p_queue->pp_last = &p_queue->p_first;
+    }
+
+    vlc_mutex_lock( &p_pool->lock );
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        struct decoder_pool_worker *p_worker = &p_pool->p_workers[i];
+
+        p_worker->p_pool = p_pool;
+        p_worker->i_queue = i;
+        p_worker->b_done = false;
+        if( vlc_clone( &p_worker->thread, Worker, p_worker,
+                       VLC_THREAD_PRIORITY_VIDEO ) )
+        {
+            msg_Err( p_obj, "cannot spawn decoder thread" );
+            for( unsigned j = i; j < i_count; j++ )
+                vlc_mutex_destroy( &p_pool->p_queues[j].lock );
+            p_pool->i_queues = i; /* threads to join */
+            vlc_mutex_unlock( &p_pool->lock );
+            decoder_pool_Delete( p_pool );
+            return NULL;
+        }
+        p_pool->i_threads++;
+    }
+    vlc_mutex_unlock( &p_pool->lock );
+
+    msg_Dbg( p_obj, "using %u shared decoder threads", i_count );
+    return p_pool;
+}
+
+void decoder_pool_Delete( decoder_pool_t *p_pool )
+{
+    vlc_mutex_lock( &p_pool->lock );
+    assert( atomic_load( &p_pool->i_pending ) == 0 );
+    assert( p_pool->i_blocked == 0 );
+    p_pool->b_exit = true;
+    vlc_cond_broadcast( &p_pool->wait_work );
+    vlc_mutex_unlock( &p_pool->lock );
+
+    for( unsigned i = 0; i < p_pool->i_queues; i++ )
+        vlc_join( p_pool->p_workers[i].thread, NULL );
+
+    /* Spare threads exit too, and cannot be started anymore */
+    while( p_pool->p_spares != NULL )
+    {
+        struct decoder_pool_worker *p_worker = p_pool->p_spares;
+
+        p_pool->p_spares = p_worker->p_next;
+        vlc_join( p_worker->thread, NULL );
+        free( p_worker );
+    }
+
+    for( unsigned i = 0; i < p_pool->i_queues; i++ )
+        vlc_mutex_destroy( &p_pool->p_queues[i].lock );
+    vlc_cond_destroy( &p_pool->wait_task );
+    vlc_cond_destroy( &p_pool->wait_work );
+    vlc_mutex_destroy( &p_pool->lock );
+    free( p_pool->p_workers );
+    free( p_pool->p_queues );
+    free( p_pool );
+}
+
+void decoder_task_Init( decoder_task_t *p_task, void (*pf_run)( void * ),
+                        void *p_data )
+{
+    p_task->pf_run = pf_run;
+    p_task->p_data = p_data;
+    p_task->p_next = NULL;
+    atomic_init( &p_task->state, TASK_IDLE );
+}
+
+void decoder_pool_Schedule( decoder_pool_t *p_pool, decoder_task_t *p_task )
+{
+    unsigned state = atomic_load( &p_task->state );
+    unsigned next;
+
+    do
+    {
+        switch( state )
+        {
+            case TASK_IDLE:
+                next = TASK_QUEUED;
+                break;
+            case TASK_RUNNING:
+                next = TASK_RESCHEDULED;
+                break;
+            default: /* already queued or rescheduled, or being cancelled */
+                return;
+        }
+    }
+    while( !atomic_compare_exchange_weak( &p_task->state, &state, next ) );
+
+    if( next == TASK_QUEUED )
+        PoolPush( p_pool, p_task );
+}
+
+void decoder_pool_Cancel( decoder_pool_t *p_pool, decoder_task_t *p_task )
+{
+    vlc_mutex_lock( &p_pool->lock );
+    for( ;; )
+    {
+        unsigned state = TASK_IDLE;
+
+        if( atomic_compare_exchange_strong( &p_task->state, &state,
+                                            TASK_CANCELLED ) )
+            break;
+        assert( (state & ~TASK_WAITED) != TASK_CANCELLED );
+
+        if( !(state & TASK_WAITED)
+         && !atomic_compare_exchange_strong( &p_task->state, &state,
+                                             state | TASK_WAITED ) )
+            continue;
+
+        vlc_cond_wait( &p_pool->wait_task, &p_pool->lock );
+    }
+    vlc_mutex_unlock( &p_pool->lock );
+}
+
+void decoder_pool_BlockingEnter( decoder_pool_t *p_pool )
+{
+    vlc_mutex_lock( &p_pool->lock );
+    p_pool->i_blocked++;
+    /* Keep as many threads able to run tasks as CPUs */
+    if( p_pool->i_threads - p_pool->i_blocked < p_pool->i_queues )
+        PoolStartSpare( p_pool );
+    vlc_mutex_unlock( &p_pool->lock );
+}
+
+void decoder_pool_BlockingLeave( decoder_pool_t *p_pool )
+{
+    vlc_mutex_lock( &p_pool->lock );
+    assert( p_pool->i_blocked > 0 );
+    p_pool->i_blocked--;
+    vlc_mutex_unlock( &p_pool->lock );
+}
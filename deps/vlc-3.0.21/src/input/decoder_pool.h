@@ -0,0 +1,78 @@
+/*****************************************************************************
+ * decoder_pool.h: shared decoder threads
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_INPUT_DECODER_POOL_H
+#define LIBVLC_INPUT_DECODER_POOL_H 1
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+
+/**
+ * Pool of threads running the decoders of all the inputs of an instance.
+ *
+ * Each decoder is a task, scheduled whenever it has something to do. A task
+ * is never run by two threads at once, so each decoder still processes its
+ * blocks in order. The pool keeps one thread per CPU available: while a task
+ * waits for something else than work (e.g. for a free picture), a spare
+ * thread takes its place.
+ */
+typedef struct decoder_pool_t decoder_pool_t;
+
+typedef struct decoder_task_t decoder_task_t;
+struct decoder_task_t
+{
+    void (*pf_run)( void * );
+    void *p_data;
+
+    /* Private */
+    decoder_task_t *p_next;
+    atomic_uint state;
+};
+
+decoder_pool_t *decoder_pool_New( vlc_object_t * );
+
+/**
+ * Destroys the pool. All the tasks must have been cancelled.
+ */
+void decoder_pool_Delete( decoder_pool_t * );
+
+void decoder_task_Init( decoder_task_t *, void (*pf_run)( void * ),
+                        void *p_data );
+
+/**
+ * Requests the task to run. If the task is already running, it is queued
+ * again when it returns.
+ */
+void decoder_pool_Schedule( decoder_pool_t *, decoder_task_t * );
+
+/**
+ * Waits until the task is neither queued nor running, and prevents it from
+ * being scheduled again.
+ */
+void decoder_pool_Cancel( decoder_pool_t *, decoder_task_t * );
+
+/**
+ * Tells the pool that the calling task is about to block, or is done
+ * blocking, so that other tasks do not wait for it.
+ */
+void decoder_pool_BlockingEnter( decoder_pool_t * );
+void decoder_pool_BlockingLeave( decoder_pool_t * );
+
+#endif
@@ -30,6 +30,7 @@
 #endif
 
 #include <stdio.h>
+#include <limits.h>
 #include <assert.h>
 #include <vlc_common.h>
 
@@ -96,6 +97,10 @@ struct es_out_id_t
 
     vlc_tick_t  i_pts_level;
 
+    /* Gapless loop */
+    vlc_tick_t  i_loop_last;   /* last timestamp received */
+    bool        b_loop_splice; /* first block after a splice */
+
     /* Fields for Video with CC */
     struct
     {
@@ -178,6 +183,18 @@ struct es_out_sys_t
     /* Record */
     sout_instance_t *p_sout_record;
 
+    /* Gapless loop */
+    struct
+    {
+        vlc_tick_t i_offset; /* added to every timestamp of the current pass */
+        vlc_tick_t i_start;  /* first timestamp of the current pass */
+        vlc_tick_t i_end;    /* end of the last block of the current pass */
+        bool       b_rewinding; /* demuxer rewound, next pass not started */
+    } loop;
+
+    /* enum input_decoder_throttle of the video decoders */
+    int         i_video_throttle;
+
     /* Used only to limit debugging output */
     int         i_prev_stream_level;
 };
@@ -340,6 +357,13 @@ es_out_t *input_EsOutNew( input_thread_t *p_input, int i_rate )
     p_sys->i_preroll_end = -1;
     p_sys->i_prev_stream_level = -1;
 
+    p_sys->loop.i_offset = 0;
+    p_sys->loop.i_start = VLC_TICK_INVALID;
+    p_sys->loop.i_end = VLC_TICK_INVALID;
+    p_sys->loop.b_rewinding = false;
+
+    p_sys->i_video_throttle = var_InheritInteger( p_input, "video-throttle" );
+
     return out;
 }
 
@@ -639,6 +663,8 @@ static void EsOutChangePosition( es_out_t *out )
             }
         }
         p_es->i_pts_level = VLC_TICK_INVALID;
+        p_es->i_loop_last = VLC_TICK_INVALID;
+        p_es->b_loop_splice = false;
     }
 
     for( int i = 0; i < p_sys->i_pgrm; i++ ) {
@@ -646,6 +672,12 @@ static void EsOutChangePosition( es_out_t *out )
         p_sys->pgrm[i]->i_last_pcr = VLC_TICK_INVALID;
     }
 
+    /* The clocks are reset: timestamps do not need to be spliced anymore */
+    p_sys->loop.i_offset = 0;
+    p_sys->loop.i_start = VLC_TICK_INVALID;
+    p_sys->loop.i_end = VLC_TICK_INVALID;
+    p_sys->loop.b_rewinding = false;
+
     p_sys->b_buffering = true;
     p_sys->i_buffering_extra_initial = 0;
     p_sys->i_buffering_extra_stream = 0;
@@ -1629,6 +1661,8 @@ static es_out_id_t *EsOutAddSlave( es_out_t *out, const es_format_t *fmt, es_out
     es->cc.i_bitmap = 0;
     es->p_master = p_master;
     es->i_pts_level = VLC_TICK_INVALID;
+    es->i_loop_last = VLC_TICK_INVALID;
+    es->b_loop_splice = false;
 
     TAB_APPEND( p_sys->i_es, p_sys->es, es );
 
@@ -1683,6 +1717,9 @@ static void EsCreateDecoder( es_out_t *out, es_out_id_t *p_es )
         if( p_sys->b_buffering )
             input_DecoderStartWait( p_es->p_dec );
 
+        if( p_es->fmt.i_cat == VIDEO_ES )
+            input_DecoderSetThrottle( p_es->p_dec, p_sys->i_video_throttle );
+
         if( !p_es->p_master && p_sys->p_sout_record )
         {
             p_es->p_dec_record = input_DecoderNew( p_input, &p_es->fmt, p_es->p_pgrm->p_clock, p_sys->p_sout_record );
@@ -2029,6 +2066,49 @@ static void EsOutCreateCCChannels( es_out_t *out, vlc_fourcc_t codec, uint64_t i
     }
 }
 
+/**
+ * Tracks the boundaries of the current pass and shifts the block timestamps
+ * so that the passes of a gapless loop follow each other.
+ */
+static void EsOutLoopSplice( es_out_t *out, es_out_id_t *es, block_t *p_block )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+    const vlc_tick_t i_ts = p_block->i_dts > VLC_TICK_INVALID ? p_block->i_dts
+                                                             : p_block->i_pts;
+
+    if( i_ts > VLC_TICK_INVALID )
+    {
+        p_sys->loop.b_rewinding = false;
+
+        vlc_tick_t i_length = p_block->i_length;
+        if( i_length <= 0 && es->i_loop_last > VLC_TICK_INVALID
+         && i_ts > es->i_loop_last )
+            i_length = i_ts - es->i_loop_last;
+        es->i_loop_last = i_ts;
+
+        const vlc_tick_t i_end = __MAX( p_block->i_pts, i_ts ) + i_length;
+        if( p_sys->loop.i_start <= VLC_TICK_INVALID || i_ts < p_sys->loop.i_start )
+            p_sys->loop.i_start = i_ts;
+        if( p_sys->loop.i_end <= VLC_TICK_INVALID || i_end > p_sys->loop.i_end )
+            p_sys->loop.i_end = i_end;
+    }
+
+    if( p_sys->loop.i_offset != 0 )
+    {
+        if( p_block->i_dts > VLC_TICK_INVALID )
+            p_block->i_dts += p_sys->loop.i_offset;
+        if( p_block->i_pts > VLC_TICK_INVALID )
+            p_block->i_pts += p_sys->loop.i_offset;
+    }
+
+    if( es->b_loop_splice )
+    {
+        /* Let the packetizers resynchronize on the new pass */
+        p_block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+        es->b_loop_splice = false;
+    }
+}
+
 /**
  * Send a block for the given es_out
  *
@@ -2067,6 +2147,8 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
 
     vlc_mutex_lock( &p_sys->lock );
 
+    EsOutLoopSplice( out, es, p_block );
+
     /* Drop all ESes except the video one in case of next-frame */
     if( p_sys->p_next_frame_es != NULL && p_sys->p_next_frame_es != es )
     {
@@ -2509,6 +2591,8 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
             msg_Err( p_sys->p_input, "Invalid PCR value in ES_OUT_SET_(GROUP_)PCR !" );
             return VLC_EGENERIC;
         }
+        i_pcr += p_sys->loop.i_offset;
+        p_sys->loop.b_rewinding = false;
 
         p_pgrm->i_last_pcr = i_pcr;
 
@@ -2573,6 +2657,11 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
 
     case ES_OUT_RESET_PCR:
         msg_Dbg( p_sys->p_input, "ES_OUT_RESET_PCR called" );
+        /* Demuxers reset the PCR when they are rewound for a gapless loop:
+         * the timestamps of the next pass are spliced, so the decoders and
+         * the clocks must go on */
+        if( p_sys->loop.b_rewinding )
+            return VLC_SUCCESS;
         EsOutChangePosition( out );
         return VLC_SUCCESS;
 
@@ -2632,7 +2721,7 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
         if( i_date < 0 )
             return VLC_EGENERIC;
 
-        p_sys->i_preroll_end = i_date;
+        p_sys->i_preroll_end = i_date + p_sys->loop.i_offset;
 
         return VLC_SUCCESS;
     }
@@ -2925,6 +3014,93 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
         return VLC_SUCCESS;
     }
 
+    case ES_OUT_SET_LOOP_REPLAY:
+    {
+        unsigned i_passes = va_arg( args, unsigned );
+        bool b_cached = false;
+
+        /* Only video can be replayed: do not loop with missing streams */
+        for( int i = 0; i < p_sys->i_es; i++ )
+        {
+            es_out_id_t *es = p_sys->es[i];
+
+            if( es->p_dec_record != NULL )
+                return VLC_EGENERIC;
+            if( es->p_dec == NULL )
+                continue;
+            if( es->fmt.i_cat != VIDEO_ES
+             || !input_DecoderHasLoopCache( es->p_dec ) )
+                return VLC_EGENERIC;
+            b_cached = true;
+        }
+        if( !b_cached )
+            return VLC_EGENERIC;
+
+        for( int i = 0; i < p_sys->i_es; i++ )
+        {
+            es_out_id_t *es = p_sys->es[i];
+            if( es->p_dec != NULL )
+                input_DecoderSetLoopReplay( es->p_dec, i_passes );
+        }
+        return VLC_SUCCESS;
+    }
+
+    case ES_OUT_SET_LOOP_SPLICE:
+    {
+        if( p_sys->loop.i_start <= VLC_TICK_INVALID
+         || p_sys->loop.i_end <= p_sys->loop.i_start )
+            return VLC_EGENERIC;
+
+        /* The next pass starts where the current one ends */
+        p_sys->loop.i_offset += p_sys->loop.i_end - p_sys->loop.i_start;
+        p_sys->loop.i_start = VLC_TICK_INVALID;
+        p_sys->loop.i_end = VLC_TICK_INVALID;
+        p_sys->loop.b_rewinding = true;
+
+        for( int i = 0; i < p_sys->i_es; i++ )
+        {
+            es_out_id_t *es = p_sys->es[i];
+
+            es->i_loop_last = VLC_TICK_INVALID;
+            es->b_loop_splice = true;
+        }
+        msg_Dbg( p_sys->p_input, "splicing loop, timestamp offset %"PRId64,
+                 p_sys->loop.i_offset );
+        return VLC_SUCCESS;
+    }
+
+    case ES_OUT_SET_VIDEO_THROTTLE:
+    {
+        p_sys->i_video_throttle = va_arg( args, int );
+
+        for( int i = 0; i < p_sys->i_es; i++ )
+        {
+            es_out_id_t *es = p_sys->es[i];
+            if( es->p_dec != NULL && es->fmt.i_cat == VIDEO_ES )
+                input_DecoderSetThrottle( es->p_dec, p_sys->i_video_throttle );
+        }
+        return VLC_SUCCESS;
+    }
+
+    case ES_OUT_GET_LOOP_REPLAYED:
+    {
+        unsigned *pi_replayed = va_arg( args, unsigned * );
+        unsigned i_replayed = UINT_MAX;
+
+        /* The slowest decoder defines how far the input went */
+        for( int i = 0; i < p_sys->i_es; i++ )
+        {
+            es_out_id_t *es = p_sys->es[i];
+            if( es->p_dec != NULL && input_DecoderHasLoopCache( es->p_dec ) )
+            {   /* Read once: reading resets the count */
+                unsigned i_count = input_DecoderGetLoopReplayed( es->p_dec );
+                i_replayed = __MIN( i_replayed, i_count );
+            }
+        }
+        *pi_replayed = i_replayed != UINT_MAX ? i_replayed : 0;
+        return VLC_SUCCESS;
+    }
+
     default:
         msg_Err( p_sys->p_input, "unknown query 0x%x in %s", i_query,
                  __func__  );
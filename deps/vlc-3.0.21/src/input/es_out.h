@@ -88,6 +88,17 @@ enum es_out_query_private_e
 
     /* Set End Of Stream */
     ES_OUT_SET_EOS,                                 /* res=cannot fail */
+
+    /* Replay the loop cache of the decoders once drained */
+    ES_OUT_SET_LOOP_REPLAY,                         /* arg1=unsigned i_passes res=can fail */
+    /* Get the number of passes replayed from the loop cache */
+    ES_OUT_GET_LOOP_REPLAYED,                       /* arg1=unsigned * res=can fail */
+
+    /* Shift the timestamps of the next pass after the current one */
+    ES_OUT_SET_LOOP_SPLICE,                         /* res=can fail */
+
+    /* Set the throttle level of the video decoders */
+    ES_OUT_SET_VIDEO_THROTTLE,                      /* arg1=int res=cannot fail */
 };
 
 static inline void es_out_SetMode( es_out_t *p_out, int i_mode )
@@ -174,6 +185,27 @@ static inline void es_out_Eos( es_out_t *p_out )
     assert( !i_ret );
 }
 
+static inline int es_out_SetLoopReplay( es_out_t *p_out, unsigned i_passes )
+{
+    return es_out_Control( p_out, ES_OUT_SET_LOOP_REPLAY, i_passes );
+}
+static inline unsigned es_out_GetLoopReplayed( es_out_t *p_out )
+{
+    unsigned i_replayed;
+    if( es_out_Control( p_out, ES_OUT_GET_LOOP_REPLAYED, &i_replayed ) )
+        return 0;
+    return i_replayed;
+}
+static inline int es_out_SetLoopSplice( es_out_t *p_out )
+{
+    return es_out_Control( p_out, ES_OUT_SET_LOOP_SPLICE );
+}
+static inline void es_out_SetVideoThrottle( es_out_t *p_out, int i_throttle )
+{
+    int i_ret = es_out_Control( p_out, ES_OUT_SET_VIDEO_THROTTLE, i_throttle );
+    assert( !i_ret );
+}
+
 es_out_t  *input_EsOutNew( input_thread_t *, int i_rate );
 
 #endif
@@ -720,6 +720,9 @@ static int ControlLocked( es_out_t *p_out, int i_query, va_list args )
     }
 
     case ES_OUT_GET_PCR_SYSTEM:
+    case ES_OUT_SET_LOOP_REPLAY:
+    case ES_OUT_GET_LOOP_REPLAYED:
+    case ES_OUT_SET_LOOP_SPLICE:
         if( p_sys->b_delayed )
             return VLC_EGENERIC;
         /* fall through */
@@ -747,6 +750,7 @@ static int ControlLocked( es_out_t *p_out, int i_query, va_list args )
     case ES_OUT_START_ALL_ES:
     case ES_OUT_SET_DELAY:
     case ES_OUT_SET_RECORD_STATE:
+    case ES_OUT_SET_VIDEO_THROTTLE:
     default:
         vlc_assert_unreachable();
         return VLC_EGENERIC;
@@ -553,6 +553,85 @@ bool input_Stopped( input_thread_t *input )
  * Main loop: Fill buffers from access, and demux
  *****************************************************************************/
 
+/**
+ * Accounts for the passes replayed by the decoders from their loop cache.
+ */
+static int MainLoopUpdateRepeat( input_thread_t *p_input )
+{
+    int i_repeat = var_GetInteger( p_input, "input-repeat" );
+    unsigned i_replayed = es_out_GetLoopReplayed( input_priv(p_input)->p_es_out );
+
+    if( i_replayed > 0 )
+    {
+        msg_Dbg( p_input, "replayed %u time(s) from the loop cache",
+                 i_replayed );
+        i_repeat = i_replayed < (unsigned)i_repeat ? i_repeat - i_replayed : 0;
+        var_SetInteger( p_input, "input-repeat", i_repeat );
+    }
+    return i_repeat;
+}
+
+/**
+ * Asks the decoders to replay their loop cache instead of restarting the
+ * demuxer once they have drained.
+ */
+static void MainLoopArmLoopCache( input_thread_t *p_input )
+{
+    if( var_GetInteger( p_input, "input-loop-cache" ) <= 0 )
+        return;
+
+    int i_repeat = MainLoopUpdateRepeat( p_input );
+    if( i_repeat <= 0 )
+        return;
+
+    if( es_out_SetLoopReplay( input_priv(p_input)->p_es_out, i_repeat ) )
+        msg_Dbg( p_input, "loop cache unavailable for this input" );
+}
+
+/**
+ * Rewinds the demuxer at EOF without flushing the decoders, so that the
+ * next repetition is demuxed while the current one is still being played.
+ */
+static int MainLoopTrySplice( input_thread_t *p_input )
+{
+    input_thread_private_t *p_priv = input_priv(p_input);
+    demux_t *p_demux = p_priv->master->p_demux;
+
+    if( !var_GetBool( p_input, "input-gapless-loop" )
+     || var_GetInteger( p_input, "input-loop-cache" ) > 0 )
+        return VLC_EGENERIC;
+
+    /* Only rewind a plain stream: titles, chapters and slaves would need a
+     * real seek */
+    if( p_priv->i_slave > 0 || p_priv->b_recording
+     || p_priv->master->i_title_start - p_priv->master->i_title_offset > 0
+     || p_priv->master->i_seekpoint_start - p_priv->master->i_seekpoint_offset > 0
+     || !var_GetBool( p_input, "can-seek" ) )
+        return VLC_EGENERIC;
+
+    int i_repeat = MainLoopUpdateRepeat( p_input );
+    if( i_repeat <= 0 )
+        return VLC_EGENERIC;
+
+    if( es_out_SetLoopSplice( p_priv->p_es_out ) )
+        return VLC_EGENERIC;
+
+    int i_ret;
+    if( p_priv->i_start > 0 )
+        i_ret = demux_Control( p_demux, DEMUX_SET_TIME, p_priv->i_start, true );
+    else
+        i_ret = demux_Control( p_demux, DEMUX_SET_POSITION, 0., true );
+    if( i_ret )
+    {
+        msg_Warn( p_input, "cannot rewind for a gapless repetition" );
+        return VLC_EGENERIC;
+    }
+
+    msg_Dbg( p_input, "repeating the same input gaplessly (%d)", i_repeat );
+    var_SetInteger( p_input, "input-repeat", i_repeat - 1 );
+    return VLC_SUCCESS;
+}
+
 /**
  * MainLoopDemux
  * It asks the demuxer to demux some data
@@ -593,10 +672,14 @@ static void MainLoopDemux( input_thread_t *p_input, bool *pb_changed )
         UpdateGenericFromDemux( p_input );
     }
 
+    if( i_ret == VLC_DEMUXER_EOF && MainLoopTrySplice( p_input ) == VLC_SUCCESS )
+        i_ret = VLC_DEMUXER_SUCCESS;
+
     if( i_ret == VLC_DEMUXER_EOF )
     {
         msg_Dbg( p_input, "EOF reached" );
         p_priv->master->b_eof = true;
+        MainLoopArmLoopCache( p_input );
         es_out_Eos(p_priv->p_es_out);
     }
     else if( i_ret == VLC_DEMUXER_EGENERIC )
@@ -609,10 +692,13 @@ static void MainLoopDemux( input_thread_t *p_input, bool *pb_changed )
 
 static int MainLoopTryRepeat( input_thread_t *p_input )
 {
-    int i_repeat = var_GetInteger( p_input, "input-repeat" );
+    int i_repeat = MainLoopUpdateRepeat( p_input );
     if( i_repeat <= 0 )
         return VLC_EGENERIC;
 
+    if( var_GetInteger( p_input, "input-loop-cache" ) > 0 )
+        var_IncInteger( p_input, "loop-cache-misses" );
+
     vlc_value_t val;
 
     msg_Dbg( p_input, "repeating the same input (%d)", i_repeat );
@@ -2374,6 +2460,11 @@ static bool Control( input_thread_t *p_input,
             }
             break;
 
+        case INPUT_CONTROL_SET_VIDEO_THROTTLE:
+            es_out_SetVideoThrottle( input_priv(p_input)->p_es_out_display,
+                                     val.i_int );
+            break;
+
         case INPUT_CONTROL_SET_FRAME_NEXT:
             if( input_priv(p_input)->i_state == PAUSE_S )
             {
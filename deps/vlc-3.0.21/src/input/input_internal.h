@@ -231,6 +231,8 @@ enum input_control_e
 
     INPUT_CONTROL_SET_RECORD_STATE,
 
+    INPUT_CONTROL_SET_VIDEO_THROTTLE,
+
     INPUT_CONTROL_SET_FRAME_NEXT,
 
     INPUT_CONTROL_SET_RENDERER,
@@ -108,7 +108,7 @@ void stream_CommonDelete(stream_t *s)
     if (priv->peek != NULL)
         block_Release(priv->peek);
     if (priv->block != NULL)
-        block_Release(priv->block);
+        block_ChainRelease(priv->block);
 
     free(s->psz_url);
     vlc_object_release(s);
@@ -377,8 +377,8 @@ static ssize_t vlc_stream_CopyBlock(block_t **restrict pp,
 
     if (block->i_buffer == 0)
     {
+        *pp = block->p_next;
         block_Release(block);
-        *pp = NULL;
     }
 
     return likely(len > 0) ? (ssize_t)len : -1;
@@ -410,18 +410,28 @@ static ssize_t vlc_stream_ReadRaw(stream_t *s, void *buf, size_t len)
         return ret;
     }
 
-    ret = vlc_stream_CopyBlock(&priv->block, buf, len);
-    if (ret >= 0)
-        return ret;
+    if (unlikely(len == 0))
+        return 0;
+
+    /* Skip the empty blocks of the chain, if any */
+    while (priv->block != NULL)
+    {
+        ret = vlc_stream_CopyBlock(&priv->block, buf, len);
+        if (ret >= 0)
+            return ret;
+    }
 
     if (s->pf_block != NULL)
     {
         bool eof = false;
 
         priv->block = s->pf_block(s, &eof);
-        ret = vlc_stream_CopyBlock(&priv->block, buf, len);
-        if (ret >= 0)
-            return ret;
+        while (priv->block != NULL)
+        {
+            ret = vlc_stream_CopyBlock(&priv->block, buf, len);
+            if (ret >= 0)
+                return ret;
+        }
         return eof ? 0 : -1;
     }
 
@@ -481,8 +491,12 @@ ssize_t vlc_stream_Peek(stream_t *s, const uint8_t **restrict bufp, size_t len)
     if (peek == NULL)
     {
         peek = priv->block;
+        if (peek != NULL)
+        {
+            priv->block = peek->p_next;
+            peek->p_next = NULL;
+        }
         priv->peek = peek;
-        priv->block = NULL;
     }
 
     if (peek == NULL)
@@ -545,12 +559,18 @@ block_t *vlc_stream_ReadBlock(stream_t *s)
     else if (priv->block != NULL)
     {
         block = priv->block;
-        priv->block = NULL;
+        priv->block = block->p_next;
+        block->p_next = NULL;
     }
     else if (s->pf_block != NULL)
     {
         priv->eof = false;
         block = s->pf_block(s, &priv->eof);
+        if (block != NULL)
+        {   /* Keep the rest of a chain for the next reads */
+            priv->block = block->p_next;
+            block->p_next = NULL;
+        }
     }
     else
     {
@@ -640,7 +660,7 @@ int vlc_stream_Seek(stream_t *s, uint64_t offset)
 
     if (priv->block != NULL)
     {
-        block_Release(priv->block);
+        block_ChainRelease(priv->block);
         priv->block = NULL;
     }
 
@@ -675,7 +695,7 @@ int vlc_stream_vaControl(stream_t *s, int cmd, va_list args)
 
             if (priv->block != NULL)
             {
-                block_Release(priv->block);
+                block_ChainRelease(priv->block);
                 priv->block = NULL;
             }
 
@@ -0,0 +1,459 @@
+/*****************************************************************************
+ * thumbnailer.c: decoding of a single picture of an input item
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_codec.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_image.h>
+#include <vlc_input_item.h>
+#include <vlc_meta.h>
+#include <vlc_modules.h>
+#include <vlc_stream_extractor.h>
+#include <vlc_thumbnailer.h>
+
+#include "../libvlc.h"
+
+/*
+ * The demuxer is driven from the calling thread, and the first video ES is
+ * decoded until it outputs a picture. There is no clock: the decoder never
+ * waits nor drops a late picture, and the other ES are neither selected nor
+ * decoded.
+ */
+
+struct vlc_thumbnailer_t
+{
+    VLC_COMMON_MEMBERS
+    image_handler_t *p_image;
+};
+
+struct es_out_id_t
+{
+    es_out_id_t *p_next;
+    bool b_video; /**< true for the decoded ES */
+};
+
+typedef struct
+{
+    es_out_t out;
+    vlc_thumbnailer_t *p_thumbnailer;
+    es_out_id_t *p_ids;
+
+    es_out_id_t *p_video; /**< the decoded ES, if any */
+    decoder_t *p_packetizer; /**< NULL if the ES is packetized */
+    decoder_t *p_decoder; /**< NULL until the first packetized block */
+    picture_t *p_picture; /**< the first decoded picture */
+    bool b_error;
+} thumbnailer_out_t;
+
+/*****************************************************************************
+ * Decoder
+ *****************************************************************************/
+static int VideoFormatUpdate( decoder_t *p_dec )
+{
+    video_format_t *p_fmt = &p_dec->fmt_out.video;
+
+    p_fmt->i_chroma = p_dec->fmt_out.i_codec;
+    if( !p_fmt->i_visible_width || !p_fmt->i_visible_height )
+    {
+        p_fmt->i_visible_width = p_fmt->i_width;
+        p_fmt->i_visible_height = p_fmt->i_height;
+        p_fmt->i_x_offset = p_fmt->i_y_offset = 0;
+    }
+    if( !p_fmt->i_sar_num || !p_fmt->i_sar_den )
+        p_fmt->i_sar_num = p_fmt->i_sar_den = 1;
+
+    return p_fmt->i_width && p_fmt->i_height ? 0 : -1;
+}
+
+static picture_t *VideoBufferNew( decoder_t *p_dec )
+{
+    return picture_NewFromFormat( &p_dec->fmt_out.video );
+}
+
+static int QueueVideo( decoder_t *p_dec, picture_t *p_pic )
+{
+    thumbnailer_out_t *p_out = p_dec->p_queue_ctx;
+
+    if( p_out->p_picture == NULL )
+        p_out->p_picture = p_pic;
+    else
+        picture_Release( p_pic );
+    return 0;
+}
+
+static decoder_t *CreateDecoder( thumbnailer_out_t *p_out,
+                                 const es_format_t *p_fmt, bool b_packetizer )
+{
+    decoder_t *p_dec = vlc_custom_create( p_out->p_thumbnailer,
+                                          sizeof( *p_dec ), b_packetizer
+                                          ? "packetizer" : "decoder" );
+    if( unlikely( p_dec == NULL ) )
+        return NULL;
+
+    es_format_Copy( &p_dec->fmt_in, p_fmt );
+    es_format_Init( &p_dec->fmt_out, VIDEO_ES, 0 );
+    p_dec->b_frame_drop_allowed = false;
+
+    if( !b_packetizer )
+    {
+        p_dec->pf_vout_format_update = VideoFormatUpdate;
+        p_dec->pf_vout_buffer_new = VideoBufferNew;
+        p_dec->pf_queue_video = QueueVideo;
+        p_dec->p_queue_ctx = p_out;
+    }
+
+    if( b_packetizer )
+        p_dec->p_module = module_need( p_dec, "packetizer", "$packetizer",
+                                       false );
+    else
+        p_dec->p_module = module_need( p_dec, "video decoder", "$codec",
+                                       false );
+    if( p_dec->p_module == NULL )
+    {
+        es_format_Clean( &p_dec->fmt_in );
+        vlc_object_release( p_dec );
+        return NULL;
+    }
+    return p_dec;
+}
+
+static void DeleteDecoder( decoder_t *p_dec )
+{
+    module_unneed( p_dec, p_dec->p_module );
+    es_format_Clean( &p_dec->fmt_in );
+    es_format_Clean( &p_dec->fmt_out );
+    if( p_dec->p_description )
+        vlc_meta_Delete( p_dec->p_description );
+    vlc_object_release( p_dec );
+}
+
+static void DecodeBlock( thumbnailer_out_t *p_out, block_t *p_block )
+{
+    decoder_t *p_pack = p_out->p_packetizer;
+
+    /* (Re)start the decoder with the format found by the packetizer */
+    if( p_pack != NULL && ( p_out->p_decoder == NULL
+     || !es_format_IsSimilar( &p_out->p_decoder->fmt_in, &p_pack->fmt_out ) ) )
+    {
+        if( p_out->p_decoder != NULL )
+            DeleteDecoder( p_out->p_decoder );
+        p_out->p_decoder = CreateDecoder( p_out, &p_pack->fmt_out, false );
+    }
+
+    decoder_t *p_dec = p_out->p_decoder;
+    if( p_dec == NULL )
+    {
+        if( p_block != NULL )
+            block_Release( p_block );
+        p_out->b_error = true;
+        return;
+    }
+
+    if( p_dec->pf_decode( p_dec, p_block ) == VLCDEC_ECRITICAL )
+        p_out->b_error = true;
+}
+
+/* Decodes a block of the video ES, or drains the decoder if NULL */
+static void Decode( thumbnailer_out_t *p_out, block_t *p_block )
+{
+    decoder_t *p_pack = p_out->p_packetizer;
+
+    if( p_pack == NULL )
+    {
+        DecodeBlock( p_out, p_block );
+        return;
+    }
+
+    block_t **pp_block = p_block != NULL ? &p_block : NULL;
+    block_t *p_packetized;
+
+    while( !p_out->b_error
+        && ( p_packetized = p_pack->pf_packetize( p_pack, pp_block ) ) )
+    {
+        while( p_packetized != NULL )
+        {
+            block_t *p_next = p_packetized->p_next;
+
+            p_packetized->p_next = NULL;
+            if( p_out->p_picture == NULL && !p_out->b_error )
+                DecodeBlock( p_out, p_packetized );
+            else
+                block_Release( p_packetized );
+            p_packetized = p_next;
+        }
+    }
+
+    if( p_block == NULL && p_out->p_decoder != NULL && !p_out->b_error )
+        DecodeBlock( p_out, NULL );
+}
+
+static void StopVideo( thumbnailer_out_t *p_out )
+{
+    if( p_out->p_decoder != NULL )
+        DeleteDecoder( p_out->p_decoder );
+    if( p_out->p_packetizer != NULL )
+        DeleteDecoder( p_out->p_packetizer );
+    p_out->p_decoder = p_out->p_packetizer = NULL;
+}
+
+/*****************************************************************************
+ * ES output
+ *****************************************************************************/
+static es_out_id_t *EsOutAdd( es_out_t *out, const es_format_t *p_fmt )
+{
+    thumbnailer_out_t *p_out = (thumbnailer_out_t *)out;
+    es_out_id_t *p_id = malloc( sizeof( *p_id ) );
+
+    if( unlikely( p_id == NULL ) )
+        return NULL;
+
+    p_id->b_video = false;
+    p_id->p_next = p_out->p_ids;
+    p_out->p_ids = p_id;
+
+    if( p_out->p_video != NULL || p_fmt->i_cat != VIDEO_ES )
+        return p_id;
+
+    if( p_fmt->b_packetized )
+        p_out->p_decoder = CreateDecoder( p_out, p_fmt, false );
+    else
+        p_out->p_packetizer = CreateDecoder( p_out, p_fmt, true );
+
+    if( p_out->p_decoder != NULL || p_out->p_packetizer != NULL )
+    {
+        p_id->b_video = true;
+        p_out->p_video = p_id;
+    }
+    return p_id;
+}
+
+static int EsOutSend( es_out_t *out, es_out_id_t *p_id, block_t *p_block )
+{
+    thumbnailer_out_t *p_out = (thumbnailer_out_t *)out;
+
+    if( p_id->b_video && p_out->p_picture == NULL && !p_out->b_error )
+        Decode( p_out, p_block );
+    else
+        block_Release( p_block );
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel( es_out_t *out, es_out_id_t *p_id )
+{
+    thumbnailer_out_t *p_out = (thumbnailer_out_t *)out;
+    es_out_id_t **pp_id = &p_out->p_ids;
+
+    while( *pp_id != p_id )
+        pp_id = &(*pp_id)->p_next;
+    *pp_id = p_id->p_next;
+
+    if( p_id->b_video )
+    {
+        StopVideo( p_out );
+        p_out->p_video = NULL;
+    }
+    free( p_id );
+}
+
+static int EsOutControl( es_out_t *out, int i_query, va_list args )
+{
+    VLC_UNUSED( out );
+    switch( i_query )
+    {
+        case ES_OUT_GET_ES_STATE:
+        {
+            es_out_id_t *p_id = va_arg( args, es_out_id_t * );
+            *va_arg( args, bool * ) = p_id->b_video;
+            return VLC_SUCCESS;
+        }
+        case ES_OUT_GET_EMPTY:
+            *va_arg( args, bool * ) = true;
+            return VLC_SUCCESS;
+
+        case ES_OUT_GET_PCR_SYSTEM:
+        case ES_OUT_MODIFY_PCR_SYSTEM:
+            return VLC_EGENERIC;
+
+        case ES_OUT_SET_ES:
+        case ES_OUT_RESTART_ES:
+        case ES_OUT_SET_ES_DEFAULT:
+        case ES_OUT_SET_ES_STATE:
+        case ES_OUT_SET_ES_CAT_POLICY:
+        case ES_OUT_SET_GROUP:
+        case ES_OUT_SET_PCR:
+        case ES_OUT_SET_GROUP_PCR:
+        case ES_OUT_RESET_PCR:
+        case ES_OUT_SET_ES_FMT:
+        case ES_OUT_SET_NEXT_DISPLAY_TIME:
+        case ES_OUT_SET_GROUP_META:
+        case ES_OUT_SET_GROUP_EPG:
+        case ES_OUT_DEL_GROUP:
+        case ES_OUT_SET_ES_SCRAMBLED_STATE:
+        case ES_OUT_SET_META:
+            return VLC_SUCCESS;
+
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+static void EsOutDestroy( es_out_t *out )
+{
+    VLC_UNUSED( out );
+}
+
+/*****************************************************************************
+ * Thumbnailer
+ *****************************************************************************/
+#undef vlc_thumbnailer_Create
+vlc_thumbnailer_t *vlc_thumbnailer_Create( vlc_object_t *p_parent )
+{
+    vlc_thumbnailer_t *p_thumbnailer =
+        vlc_custom_create( p_parent, sizeof( *p_thumbnailer ), "thumbnailer" );
+    if( unlikely( p_thumbnailer == NULL ) )
+        return NULL;
+
+    p_thumbnailer->p_image = image_HandlerCreate( p_thumbnailer );
+    if( unlikely( p_thumbnailer->p_image == NULL ) )
+    {
+        vlc_object_release( p_thumbnailer );
+        return NULL;
+    }
+
+    /* The pictures must be in memory to be converted */
+    var_Create( p_thumbnailer, "avcodec-hw", VLC_VAR_STRING );
+    var_SetString( p_thumbnailer, "avcodec-hw", "none" );
+    return p_thumbnailer;
+}
+
+void vlc_thumbnailer_Release( vlc_thumbnailer_t *p_thumbnailer )
+{
+    image_HandlerDelete( p_thumbnailer->p_image );
+    vlc_object_release( p_thumbnailer );
+}
+
+/* Sets the missing dimensions of the output, keeping the aspect ratio */
+static void FitSize( const video_format_t *p_in, video_format_t *p_fmt )
+{
+    uint64_t i_dar_num = (uint64_t)p_in->i_visible_width * p_in->i_sar_num;
+    uint64_t i_dar_den = (uint64_t)p_in->i_visible_height * p_in->i_sar_den;
+
+    if( !p_fmt->i_width && !p_fmt->i_height )
+        p_fmt->i_height = p_in->i_visible_height;
+    if( !p_fmt->i_width )
+        p_fmt->i_width = ( p_fmt->i_height * i_dar_num + i_dar_den / 2 )
+                       / i_dar_den;
+    else if( !p_fmt->i_height )
+        p_fmt->i_height = ( p_fmt->i_width * i_dar_den + i_dar_num / 2 )
+                        / i_dar_num;
+
+    p_fmt->i_width = __MAX( p_fmt->i_width, 1 );
+    p_fmt->i_height = __MAX( p_fmt->i_height, 1 );
+    p_fmt->i_visible_width = p_fmt->i_width;
+    p_fmt->i_visible_height = p_fmt->i_height;
+    p_fmt->i_x_offset = p_fmt->i_y_offset = 0;
+    p_fmt->i_sar_num = p_fmt->i_sar_den = 1;
+    if( !p_fmt->i_chroma )
+        p_fmt->i_chroma = p_in->i_chroma;
+    video_format_FixRgb( p_fmt );
+}
+
+picture_t *vlc_thumbnailer_Request( vlc_thumbnailer_t *p_thumbnailer,
+                                    input_item_t *p_item,
+                                    vlc_tick_t i_time, float f_pos,
+                                    video_format_t *p_fmt,
+                                    vlc_tick_t i_timeout )
+{
+    char *psz_uri = input_item_GetURI( p_item );
+    if( psz_uri == NULL )
+        return NULL;
+
+    const vlc_tick_t i_deadline = i_timeout > 0 ? mdate() + i_timeout
+                                                : INT64_MAX;
+    thumbnailer_out_t out = {
+        .out = {
+            .pf_add = EsOutAdd,
+            .pf_send = EsOutSend,
+            .pf_del = EsOutDel,
+            .pf_control = EsOutControl,
+            .pf_destroy = EsOutDestroy,
+        },
+        .p_thumbnailer = p_thumbnailer,
+    };
+    picture_t *p_pic = NULL;
+
+    stream_t *p_stream = vlc_stream_NewMRL( p_thumbnailer, psz_uri );
+    if( p_stream == NULL )
+    {
+        msg_Warn( p_thumbnailer, "cannot open %s", psz_uri );
+        goto end;
+    }
+
+    const char *psz_location = strstr( psz_uri, "://" );
+    demux_t *p_demux = demux_New( VLC_OBJECT( p_thumbnailer ), "any",
+                                  psz_location ? psz_location + 3 : psz_uri,
+                                  p_stream, &out.out );
+    if( p_demux == NULL )
+    {
+        msg_Warn( p_thumbnailer, "cannot demux %s", psz_uri );
+        vlc_stream_Delete( p_stream );
+        goto end;
+    }
+
+    /* Imprecise seeks land on a keyframe */
+    if( i_time != VLC_TICK_INVALID )
+        demux_Control( p_demux, DEMUX_SET_TIME, i_time - VLC_TICK_0, false );
+    else if( f_pos > 0.f )
+        demux_Control( p_demux, DEMUX_SET_POSITION, (double)f_pos, false );
+
+    int i_ret = VLC_DEMUXER_SUCCESS;
+    while( out.p_picture == NULL && !out.b_error && mdate() < i_deadline
+        && ( i_ret = demux_Demux( p_demux ) ) == VLC_DEMUXER_SUCCESS );
+
+    if( out.p_picture == NULL && out.p_video != NULL && !out.b_error
+     && i_ret != VLC_DEMUXER_SUCCESS )
+        Decode( &out, NULL );
+
+    demux_Delete( p_demux );
+
+    while( out.p_ids != NULL )
+        EsOutDel( &out.out, out.p_ids );
+
+    if( out.p_picture == NULL )
+    {
+        msg_Warn( p_thumbnailer, "no picture decoded from %s", psz_uri );
+        goto end;
+    }
+
+    FitSize( &out.p_picture->format, p_fmt );
+    p_pic = image_Convert( p_thumbnailer->p_image, out.p_picture,
+                           &out.p_picture->format, p_fmt );
+    if( p_pic != NULL )
+        p_pic->date = out.p_picture->date;
+    picture_Release( out.p_picture );
+end:
+    free( psz_uri );
+    return p_pic;
+}
@@ -75,6 +75,9 @@ static int RecordCallback( vlc_object_t *p_this, char const *psz_cmd,
 static int FrameNextCallback( vlc_object_t *p_this, char const *psz_cmd,
                               vlc_value_t oldval, vlc_value_t newval,
                               void *p_data );
+static int VideoThrottleCallback( vlc_object_t *p_this, char const *psz_cmd,
+                                  vlc_value_t oldval, vlc_value_t newval,
+                                  void *p_data );
 
 typedef struct
 {
@@ -108,6 +111,7 @@ static const vlc_input_callback_t p_input_callbacks[] =
     CALLBACK( "spu-es", EsSpuCallback ),
     CALLBACK( "record", RecordCallback ),
     CALLBACK( "frame-next", FrameNextCallback ),
+    CALLBACK( "video-throttle", VideoThrottleCallback ),
 
     CALLBACK( NULL, NULL )
 };
@@ -458,6 +462,10 @@ void input_ConfigVarInit ( input_thread_t *p_input )
 
         var_Create( p_input, "input-repeat",
                     VLC_VAR_INTEGER|VLC_VAR_DOINHERIT );
+        var_Create( p_input, "input-loop-cache",
+                    VLC_VAR_INTEGER|VLC_VAR_DOINHERIT );
+        var_Create( p_input, "input-gapless-loop",
+                    VLC_VAR_BOOL|VLC_VAR_DOINHERIT );
         var_Create( p_input, "start-time", VLC_VAR_FLOAT|VLC_VAR_DOINHERIT );
         var_Create( p_input, "stop-time", VLC_VAR_FLOAT|VLC_VAR_DOINHERIT );
         var_Create( p_input, "run-time", VLC_VAR_FLOAT|VLC_VAR_DOINHERIT );
@@ -492,6 +500,8 @@ void input_ConfigVarInit ( input_thread_t *p_input )
     var_Create( p_input, "record", VLC_VAR_BOOL );
     var_SetBool( p_input, "record", false );
 
+    var_Create( p_input, "video-throttle", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT );
+
     var_Create( p_input, "teletext-es", VLC_VAR_INTEGER );
     var_SetInteger( p_input, "teletext-es", -1 );
 
@@ -507,6 +517,11 @@ void input_ConfigVarInit ( input_thread_t *p_input )
     var_Create( p_input, "cache", VLC_VAR_FLOAT );
     var_SetFloat( p_input, "cache", 0.0 );
 
+    /* Loop cache statistics */
+    var_Create( p_input, "loop-cache-hits", VLC_VAR_INTEGER );
+    var_Create( p_input, "loop-cache-misses", VLC_VAR_INTEGER );
+    var_Create( p_input, "loop-cache-size", VLC_VAR_INTEGER );
+
     /* */
     var_Create( p_input, "input-record-native", VLC_VAR_BOOL | VLC_VAR_DOINHERIT );
 
@@ -850,3 +865,15 @@ static int FrameNextCallback( vlc_object_t *p_this, char const *psz_cmd,
     return VLC_SUCCESS;
 }
 
+static int VideoThrottleCallback( vlc_object_t *p_this, char const *psz_cmd,
+                                  vlc_value_t oldval, vlc_value_t newval,
+                                  void *p_data )
+{
+    input_thread_t *p_input = (input_thread_t*)p_this;
+    VLC_UNUSED(psz_cmd); VLC_UNUSED(oldval); VLC_UNUSED(p_data);
+
+    input_ControlPush( p_input, INPUT_CONTROL_SET_VIDEO_THROTTLE, &newval );
+
+    return VLC_SUCCESS;
+}
+
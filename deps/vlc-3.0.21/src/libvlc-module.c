@@ -321,6 +321,17 @@ static const char *const ppsz_align_descriptions[] =
     "The wallpaper mode allows you to display the video as the desktop " \
     "background." )
 
+#define VIDEO_THROTTLE_TEXT N_("Video decoding throttle")
+#define VIDEO_THROTTLE_LONGTEXT N_( \
+    "Reduce the video decoding work when the video is not watched, e.g. " \
+    "when its window is occluded or on battery power. Keyframes only " \
+    "decodes intra frames and displays at most one picture per second. " \
+    "Hidden also stops displaying pictures.")
+static const int pi_video_throttle_values[] = { 0, 1, 2 };
+static const char * const ppsz_video_throttle_text[] = {
+    N_("None"), N_("Keyframes only"), N_("Hidden")
+};
+
 #define VIDEO_TITLE_SHOW_TEXT N_("Show media title on video")
 #define VIDEO_TITLE_SHOW_LONGTEXT N_( \
     "Display the title of the video on top of the movie.")
@@ -386,6 +397,13 @@ static const char *const ppsz_pos_descriptions[] =
     "picture quality, for instance deinterlacing, or distort " \
     "the video.")
 
+#define FILTER_THREADS_TEXT N_("Video filter threads")
+#define FILTER_THREADS_LONGTEXT N_( \
+    "Number of threads used by the video converters and filters that " \
+    "process pictures in horizontal slices. Each filter instance starts " \
+    "its own threads, so this is disabled (1) by default; 0 uses one per " \
+    "CPU.")
+
 #define SNAP_PATH_TEXT N_("Video snapshot directory (or filename)")
 #define SNAP_PATH_LONGTEXT N_( \
     "Directory where the video snapshots will be stored.")
@@ -631,6 +649,21 @@ static const char *const ppsz_prefres[] = {
 #define INPUT_REPEAT_LONGTEXT N_( \
     "Number of time the same input will be repeated")
 
+#define INPUT_LOOP_CACHE_TEXT N_("Loop cache size (MiB)")
+#define INPUT_LOOP_CACHE_LONGTEXT N_( \
+    "When the input is repeated, keep the decoded pictures of the first " \
+    "pass in memory and replay them instead of demuxing and decoding the " \
+    "stream again. The cache is only used if the whole video fits within " \
+    "this amount of memory and the input has no other elementary stream. " \
+    "0 disables the cache.")
+
+#define INPUT_GAPLESS_LOOP_TEXT N_("Gapless repetitions")
+#define INPUT_GAPLESS_LOOP_LONGTEXT N_( \
+    "When the input is repeated, rewind the demuxer as soon as it reaches " \
+    "the end of the stream and shift the timestamps of the next pass, " \
+    "instead of waiting for the decoders and outputs to drain. This is " \
+    "not used together with the loop cache.")
+
 #define START_TIME_TEXT N_("Start time")
 #define START_TIME_LONGTEXT N_( \
     "The stream will start at this position (in seconds)." )
@@ -917,6 +950,12 @@ static const char *const ppsz_prefres[] = {
     "This allows you to select a list of encoders that VLC will use in " \
     "priority.")
 
+#define DECODER_POOL_TEXT N_("Shared decoder threads")
+#define DECODER_POOL_LONGTEXT N_( \
+    "Run the video and subtitle decoders on a shared pool of threads, " \
+    "sized to the number of CPUs, instead of one thread per elementary " \
+    "stream. This scales better with many simultaneous inputs.")
+
 /*****************************************************************************
  * Sout
  ****************************************************************************/
@@ -1123,6 +1162,11 @@ static const char *const ppsz_prefres[] = {
 #define PREPARSE_TIMEOUT_LONGTEXT N_( \
     "Maximum time allowed to preparse an item, in milliseconds" )
 
+#define PREPARSE_THREADS_TEXT N_( "Preparsing threads" )
+#define PREPARSE_THREADS_LONGTEXT N_( \
+    "Maximum number of items preparsed at the same time. More threads " \
+    "speed up the scanning of large media libraries." )
+
 #define METADATA_NETWORK_TEXT N_( "Allow metadata network access" )
 
 static const char *const psz_recursive_list[] = {
@@ -1581,6 +1625,11 @@ vlc_module_begin ()
               WALLPAPER_LONGTEXT, false )
     add_bool( "disable-screensaver", true, SS_TEXT, SS_LONGTEXT,
               true )
+    add_integer( "video-throttle", 0, VIDEO_THROTTLE_TEXT,
+                 VIDEO_THROTTLE_LONGTEXT, true )
+        change_integer_list( pi_video_throttle_values,
+                             ppsz_video_throttle_text )
+        change_safe()
 
     add_bool( "video-title-show", 1, VIDEO_TITLE_SHOW_TEXT,
               VIDEO_TITLE_SHOW_LONGTEXT, false )
@@ -1660,6 +1709,8 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_VIDEO_VFILTER )
     add_module_list( "video-filter", "video filter", NULL,
                      VIDEO_FILTER_TEXT, VIDEO_FILTER_LONGTEXT, false )
+    add_integer_with_range( "filter-threads", 1, 0, 64,
+                            FILTER_THREADS_TEXT, FILTER_THREADS_LONGTEXT, true )
 
     set_subcategory( SUBCAT_VIDEO_SPLITTER )
     add_module_list( "video-splitter", "video splitter", NULL,
@@ -1755,6 +1806,13 @@ vlc_module_begin ()
                  INPUT_REPEAT_TEXT, INPUT_REPEAT_LONGTEXT, false )
         change_integer_range( 0, 65535 )
         change_safe ()
+    add_integer( "input-loop-cache", 0,
+                 INPUT_LOOP_CACHE_TEXT, INPUT_LOOP_CACHE_LONGTEXT, true )
+        change_integer_range( 0, 4096 )
+        change_safe ()
+    add_bool( "input-gapless-loop", false,
+              INPUT_GAPLESS_LOOP_TEXT, INPUT_GAPLESS_LOOP_LONGTEXT, true )
+        change_safe ()
     add_float( "start-time", 0,
                START_TIME_TEXT, START_TIME_LONGTEXT, true )
         change_safe ()
@@ -1939,6 +1997,8 @@ vlc_module_begin ()
                 CODEC_LONGTEXT, true )
     add_string( "encoder",  NULL, ENCODER_TEXT,
                 ENCODER_LONGTEXT, true )
+    add_bool( "decoder-pool", false, DECODER_POOL_TEXT,
+              DECODER_POOL_LONGTEXT, true )
 
     set_subcategory( SUBCAT_INPUT_ACCESS )
     add_category_hint( N_("Input"), INPUT_CAT_LONGTEXT , false )
@@ -2112,6 +2172,10 @@ vlc_module_begin ()
     add_integer( "preparse-timeout", 5000, PREPARSE_TIMEOUT_TEXT,
                  PREPARSE_TIMEOUT_LONGTEXT, false )
 
+    add_integer_with_range( "preparse-threads", 1, 1, 32,
+                            PREPARSE_THREADS_TEXT, PREPARSE_THREADS_LONGTEXT,
+                            true )
+
     add_obsolete_integer( "album-art" )
     add_bool( "metadata-network-access", false, METADATA_NETWORK_TEXT,
                  METADATA_NETWORK_TEXT, false )
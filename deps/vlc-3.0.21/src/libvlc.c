@@ -43,6 +43,7 @@
 #include "modules/modules.h"
 #include "config/configuration.h"
 #include "playlist/preparser.h"
+#include "input/decoder_pool.h"
 
 #include <stdio.h>                                              /* sprintf() */
 #include <string.h>
@@ -62,6 +63,7 @@
 #include <vlc_cpu.h>
 #include <vlc_url.h>
 #include <vlc_modules.h>
+#include <vlc_block.h>
 
 #include "libvlc.h"
 #include "playlist/playlist_internal.h"
@@ -92,6 +94,7 @@ libvlc_int_t * libvlc_InternalCreate( void )
 
     priv = libvlc_priv (p_libvlc);
     priv->playlist = NULL;
+    priv->decoder_pool = NULL;
     priv->p_vlm = NULL;
 
     vlc_ExitInit( &priv->exit );
@@ -244,6 +247,9 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
     if( !priv->parser )
         goto error;
 
+    if( var_InheritBool( p_libvlc, "decoder-pool" ) )
+        priv->decoder_pool = decoder_pool_New( VLC_OBJECT(p_libvlc) );
+
     /* Create a variable for showing the fullscreen interface */
     var_Create( p_libvlc, "intf-toggle-fscontrol", VLC_VAR_BOOL );
     var_SetBool( p_libvlc, "intf-toggle-fscontrol", true );
@@ -416,12 +422,18 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
     if (priv->parser != NULL)
         playlist_preparser_Delete(priv->parser);
 
+    if( priv->decoder_pool != NULL )
+        decoder_pool_Delete( priv->decoder_pool );
+
     libvlc_InternalActionsClean( p_libvlc );
 
     /* Save the configuration */
     if( !var_InheritBool( p_libvlc, "ignore-config" ) )
         config_AutoSaveConfigFile( VLC_OBJECT(p_libvlc) );
 
+    /* All the threads of the instance are joined: give their blocks back */
+    block_Trim ();
+
     /* Free module bank. It is refcounted, so we call this each time  */
     vlc_LogDeinit (p_libvlc);
     module_EndBank (true);
@@ -191,6 +191,7 @@ typedef struct libvlc_priv_t
     struct playlist_t *playlist; ///< Playlist for interfaces
     struct playlist_preparser_t *parser; ///< Input item meta data handler
     vlc_actions_t *actions; ///< Hotkeys handler
+    struct decoder_pool_t *decoder_pool; ///< Shared decoder threads (or NULL)
 
     /* Exit callback */
     vlc_exit_t       exit;
@@ -21,17 +21,28 @@
 #endif
 
 #include <assert.h>
+#include <search.h>
 #include <vlc_common.h>
 #include <vlc_threads.h>
-#include <vlc_arrays.h>
 
 #include "libvlc.h"
 #include "background_worker.h"
 
 struct bg_queued_item {
+    struct bg_queued_item* prev; /**< previous item of the same priority */
+    struct bg_queued_item* next; /**< next item of the same priority */
     void* id; /**< id associated with entity */
     void* entity; /**< the entity to process */
-    int timeout; /**< timeout duration in microseconds */
+    int timeout; /**< timeout duration in milliseconds */
+    int priority; /**< priority class of the entity */
+};
+
+struct bg_thread {
+    struct background_worker* worker;
+    bool active; /**< true if a thread is running in this slot */
+    bool probe_request; /**< true if a probe is requested */
+    vlc_tick_t deadline; /**< deadline of the current task */
+    struct bg_queued_item* item; /**< item of the current task, if any */
 };
 
 struct background_worker {
@@ -39,144 +50,244 @@ struct background_worker {
     struct background_worker_config conf;
 
     vlc_mutex_t lock; /**< acquire to inspect members that follow */
-    struct {
-        bool probe_request; /**< true if a probe is requested */
-        vlc_cond_t wait; /**< wait for update in terms of head */
-        vlc_cond_t worker_wait; /**< wait for probe request or cancelation */
-        vlc_tick_t deadline; /**< deadline of the current task */
-        void* id; /**< id of the current task */
-        bool active; /**< true if there is an active thread */
-    } head;
+    vlc_cond_t queue_wait; /**< wait for new items or termination */
+    vlc_cond_t task_wait; /**< wait for probe request or cancelation */
+    vlc_cond_t done_wait; /**< wait for the end of a task or thread */
+    bool terminating; /**< true if the idle threads shall exit */
+    unsigned thread_count; /**< number of running threads */
+    unsigned idle_count; /**< number of threads waiting for items */
+    struct bg_thread* threads; /**< conf.max_threads slots */
 
     struct {
-        vlc_cond_t wait; /**< wait for update in terms of tail */
-        vlc_array_t data; /**< queue of pending entities to process */
-    } tail;
+        struct bg_queued_item* first;
+        struct bg_queued_item* last;
+    } queue[BACKGROUND_WORKER_PRIORITIES]; /**< pending entities */
+    size_t queued; /**< number of pending entities */
+    void* ids; /**< search tree of the pending entities with an id */
 };
 
-static void* Thread( void* data )
+static int CompareId( const void* a, const void* b )
 {
-    struct background_worker* worker = data;
+    uintptr_t ida = (uintptr_t)((const struct bg_queued_item*)a)->id;
+    uintptr_t idb = (uintptr_t)((const struct bg_queued_item*)b)->id;
 
-    for( ;; )
+    return ( ida > idb ) - ( ida < idb );
+}
+
+static void QueueAppend( struct background_worker* worker,
+                         struct bg_queued_item* item )
+{
+    struct bg_queued_item** last = &worker->queue[item->priority].last;
+
+    item->prev = *last;
+    item->next = NULL;
+    if( *last )
+        (*last)->next = item;
+    else
+        worker->queue[item->priority].first = item;
+    *last = item;
+}
+
+static void QueueRemove( struct background_worker* worker,
+                         struct bg_queued_item* item )
+{
+    if( item->prev )
+        item->prev->next = item->next;
+    else
+        worker->queue[item->priority].first = item->next;
+
+    if( item->next )
+        item->next->prev = item->prev;
+    else
+        worker->queue[item->priority].last = item->prev;
+}
+
+static void Dequeue( struct background_worker* worker,
+                     struct bg_queued_item* item )
+{
+    QueueRemove( worker, item );
+    if( item->id )
+        tdelete( item, &worker->ids, CompareId );
+    worker->queued--;
+}
+
+static struct bg_queued_item* QueuePop( struct background_worker* worker )
+{
+    for( int i = BACKGROUND_WORKER_PRIORITIES - 1; i >= 0; --i )
     {
-        struct bg_queued_item* item = NULL;
-        void* handle;
+        struct bg_queued_item* item = worker->queue[i].first;
 
-        vlc_mutex_lock( &worker->lock );
-        for( ;; )
+        if( item )
         {
-            if( vlc_array_count( &worker->tail.data ) )
-            {
-                item = vlc_array_item_at_index( &worker->tail.data, 0 );
-                handle = NULL;
+            Dequeue( worker, item );
+            return item;
+        }
+    }
+    return NULL;
+}
 
-                vlc_array_remove( &worker->tail.data, 0 );
-            }
+static void RunTask( struct bg_thread* th, struct bg_queued_item* item )
+{
+    struct background_worker* worker = th->worker;
+    void* handle;
 
-            if( worker->head.deadline == VLC_TICK_0 && item == NULL )
-                worker->head.active = false;
-            worker->head.id = item ? item->id : NULL;
-            vlc_cond_broadcast( &worker->head.wait );
+    if( worker->conf.pf_start( worker->owner, item->entity, &handle ) )
+        return;
 
-            if( item )
-            {
-                if( item->timeout > 0 )
-                    worker->head.deadline = mdate() + item->timeout * 1000;
-                else
-                    worker->head.deadline = INT64_MAX;
-            }
-            else if( worker->head.deadline != VLC_TICK_0 )
-            {
-                /* Wait 1 seconds for new inputs before terminating */
-                vlc_tick_t deadline = mdate() + INT64_C(1000000);
-                int ret = vlc_cond_timedwait( &worker->tail.wait,
-                                              &worker->lock, deadline );
-                if( ret != 0 )
-                {
-                    /* Timeout: if there is still no items, the thread will be
-                     * terminated at next loop iteration (active = false). */
-                    worker->head.deadline = VLC_TICK_0;
-                }
-                continue;
-            }
-            break;
+    for( ;; )
+    {
+        vlc_mutex_lock( &worker->lock );
+
+        bool const b_timeout = th->deadline <= mdate();
+        th->probe_request = false;
+
+        vlc_mutex_unlock( &worker->lock );
+
+        if( b_timeout ||
+            worker->conf.pf_probe( worker->owner, handle ) )
+        {
+            worker->conf.pf_stop( worker->owner, handle );
+            return;
         }
 
-        if( !worker->head.active )
+        vlc_mutex_lock( &worker->lock );
+        if( th->probe_request == false && th->deadline > mdate() )
         {
-            vlc_mutex_unlock( &worker->lock );
-            break;
+            vlc_cond_timedwait( &worker->task_wait, &worker->lock,
+                                th->deadline );
         }
         vlc_mutex_unlock( &worker->lock );
+    }
+}
+
+static void* Thread( void* data )
+{
+    struct bg_thread* th = data;
+    struct background_worker* worker = th->worker;
 
-        assert( item != NULL );
+    /* The thread is counted in idle_count whenever it runs no task */
+    vlc_mutex_lock( &worker->lock );
+    while( !worker->terminating )
+    {
+        struct bg_queued_item* item = QueuePop( worker );
 
-        if( worker->conf.pf_start( worker->owner, item->entity, &handle ) )
+        if( item == NULL )
         {
-            worker->conf.pf_release( item->entity );
-            free( item );
+            /* Wait 1 seconds for new inputs before terminating */
+            vlc_tick_t deadline = mdate() + INT64_C(1000000);
+            int ret = 0;
+
+            while( ret == 0 && worker->queued == 0 && !worker->terminating )
+                ret = vlc_cond_timedwait( &worker->queue_wait,
+                                          &worker->lock, deadline );
+
+            if( worker->queued == 0 )
+                break;
             continue;
         }
 
-        for( ;; )
-        {
-            vlc_mutex_lock( &worker->lock );
+        worker->idle_count--;
+        th->item = item;
+        th->probe_request = false;
+        if( item->timeout > 0 )
+            th->deadline = mdate() + item->timeout * INT64_C(1000);
+        else
+            th->deadline = INT64_MAX;
+        vlc_mutex_unlock( &worker->lock );
 
-            bool const b_timeout = worker->head.deadline <= mdate();
-            worker->head.probe_request = false;
+        RunTask( th, item );
+        worker->conf.pf_release( item->entity );
 
-            vlc_mutex_unlock( &worker->lock );
+        vlc_mutex_lock( &worker->lock );
+        th->item = NULL;
+        worker->idle_count++;
+        vlc_cond_broadcast( &worker->done_wait );
+        free( item );
+    }
 
-            if( b_timeout ||
-                worker->conf.pf_probe( worker->owner, handle ) )
-            {
-                worker->conf.pf_stop( worker->owner, handle );
-                worker->conf.pf_release( item->entity );
-                free( item );
-                break;
-            }
+    th->active = false;
+    worker->idle_count--;
+    worker->thread_count--;
+    vlc_cond_broadcast( &worker->done_wait );
+    vlc_mutex_unlock( &worker->lock );
+    return NULL;
+}
 
-            vlc_mutex_lock( &worker->lock );
-            if( worker->head.probe_request == false &&
-                worker->head.deadline > mdate() )
-            {
-                vlc_cond_timedwait( &worker->head.worker_wait, &worker->lock,
-                                     worker->head.deadline );
-            }
-            vlc_mutex_unlock( &worker->lock );
+/* Starts threads until every pending entity has one, within the limit */
+static void SpawnThreads( struct background_worker* worker )
+{
+    for( unsigned i = 0; i < worker->conf.max_threads
+                      && worker->idle_count < worker->queued; ++i )
+    {
+        struct bg_thread* th = &worker->threads[i];
+
+        if( th->active )
+            continue;
+
+        th->active = true;
+        if( vlc_clone_detach( NULL, Thread, th, VLC_THREAD_PRIORITY_LOW ) )
+        {
+            th->active = false;
+            break;
         }
+        worker->thread_count++;
+        worker->idle_count++;
     }
-
-    return NULL;
 }
 
 static void BackgroundWorkerCancel( struct background_worker* worker, void* id)
 {
     vlc_mutex_lock( &worker->lock );
-    for( size_t i = 0; i < vlc_array_count( &worker->tail.data ); )
+    for( int i = 0; i < BACKGROUND_WORKER_PRIORITIES; ++i )
+    {
+        for( struct bg_queued_item* item = worker->queue[i].first; item; )
+        {
+            struct bg_queued_item* next = item->next;
+
+            if( id == NULL || item->id == id )
+            {
+                Dequeue( worker, item );
+                worker->conf.pf_release( item->entity );
+                free( item );
+            }
+            item = next;
+        }
+    }
+
+    if( id == NULL )
     {
-        struct bg_queued_item* item =
-            vlc_array_item_at_index( &worker->tail.data, i );
+        worker->terminating = true;
+        vlc_cond_broadcast( &worker->queue_wait );
+    }
+
+    for( ;; )
+    {
+        bool running = id == NULL && worker->thread_count > 0;
 
-        if( id == NULL || item->id == id )
+        for( unsigned i = 0; i < worker->conf.max_threads; ++i )
         {
-            vlc_array_remove( &worker->tail.data, i );
-            worker->conf.pf_release( item->entity );
-            free( item );
-            continue;
+            struct bg_thread* th = &worker->threads[i];
+
+            if( th->active && th->item != NULL
+             && ( id == NULL || th->item->id == id ) )
+            {
+                th->deadline = VLC_TICK_0;
+                running = true;
+            }
         }
 
-        ++i;
+        if( !running )
+            break;
+
+        vlc_cond_broadcast( &worker->task_wait );
+        vlc_cond_wait( &worker->done_wait, &worker->lock );
     }
 
-    while( ( id == NULL && worker->head.active )
-        || ( id != NULL && worker->head.id == id ) )
+    if( id == NULL )
     {
-        worker->head.deadline = VLC_TICK_0;
-        vlc_cond_signal( &worker->head.worker_wait );
-        vlc_cond_signal( &worker->tail.wait );
-        vlc_cond_wait( &worker->head.wait, &worker->lock );
+        /* Serve the entities pushed while the threads were terminating */
+        worker->terminating = false;
+        SpawnThreads( worker );
     }
     vlc_mutex_unlock( &worker->lock );
 }
@@ -190,24 +301,43 @@ struct background_worker* background_worker_New( void* owner,
         return NULL;
 
     worker->conf = *conf;
+    if( worker->conf.max_threads == 0 )
+        worker->conf.max_threads = 1;
+
+    worker->threads = calloc( worker->conf.max_threads,
+                              sizeof *worker->threads );
+    if( unlikely( !worker->threads ) )
+    {
+        free( worker );
+        return NULL;
+    }
+
+    for( unsigned i = 0; i < worker->conf.max_threads; ++i )
+        worker->threads[i].worker = worker;
+
     worker->owner = owner;
-    worker->head.id = NULL;
-    worker->head.active = false;
-    worker->head.deadline = VLC_TICK_INVALID;
+    worker->terminating = false;
+    worker->thread_count = 0;
+    worker->idle_count = 0;
 
-    vlc_mutex_init( &worker->lock );
-    vlc_cond_init( &worker->head.wait );
-    vlc_cond_init( &worker->head.worker_wait );
+    for( int i = 0; i < BACKGROUND_WORKER_PRIORITIES; ++i )
+        worker->queue[i].first = worker->queue[i].last = NULL;
+    worker->queued = 0;
+    worker->ids = NULL;
 
-    vlc_array_init( &worker->tail.data );
-    vlc_cond_init( &worker->tail.wait );
+    vlc_mutex_init( &worker->lock );
+    vlc_cond_init( &worker->queue_wait );
+    vlc_cond_init( &worker->task_wait );
+    vlc_cond_init( &worker->done_wait );
 
     return worker;
 }
 
 int background_worker_Push( struct background_worker* worker, void* entity,
-                        void* id, int timeout )
+                        void* id, int timeout, int priority )
 {
+    assert( priority >= 0 && priority < BACKGROUND_WORKER_PRIORITIES );
+
     struct bg_queued_item* item = malloc( sizeof( *item ) );
 
     if( unlikely( !item ) )
@@ -216,30 +346,57 @@ int background_worker_Push( struct background_worker* worker, void* entity,
     item->id = id;
     item->entity = entity;
     item->timeout = timeout < 0 ? worker->conf.default_timeout : timeout;
+    item->priority = priority;
 
     vlc_mutex_lock( &worker->lock );
-    int i_ret = vlc_array_append( &worker->tail.data, item );
-    vlc_cond_signal( &worker->tail.wait );
-    if( i_ret != 0 )
+    if( id != NULL )
     {
-        free( item );
-        return VLC_EGENERIC;
+        struct bg_queued_item** node = tsearch( item, &worker->ids,
+                                                CompareId );
+        if( unlikely( node == NULL ) )
+        {
+            vlc_mutex_unlock( &worker->lock );
+            free( item );
+            return VLC_EGENERIC;
+        }
+
+        if( *node != item )
+        {
+            /* Already pending: only raise its priority */
+            struct bg_queued_item* pending = *node;
+
+            if( pending->priority < priority )
+            {
+                QueueRemove( worker, pending );
+                pending->priority = priority;
+                QueueAppend( worker, pending );
+            }
+            vlc_mutex_unlock( &worker->lock );
+            free( item );
+            return VLC_SUCCESS;
+        }
     }
 
-    if( worker->head.active == false )
+    QueueAppend( worker, item );
+    worker->queued++;
+
+    if( !worker->terminating )
     {
-        worker->head.probe_request = false;
-        worker->head.active =
-            !vlc_clone_detach( NULL, Thread, worker, VLC_THREAD_PRIORITY_LOW );
+        SpawnThreads( worker );
+        if( worker->thread_count == 0 )
+        {
+            Dequeue( worker, item );
+            vlc_mutex_unlock( &worker->lock );
+            free( item );
+            return VLC_EGENERIC;
+        }
     }
 
-    if( worker->head.active )
-        worker->conf.pf_hold( item->entity );
-
-    int ret = worker->head.active ? VLC_SUCCESS : VLC_EGENERIC;
+    worker->conf.pf_hold( item->entity );
+    vlc_cond_signal( &worker->queue_wait );
     vlc_mutex_unlock( &worker->lock );
 
-    return ret;
+    return VLC_SUCCESS;
 }
 
 void background_worker_Cancel( struct background_worker* worker, void* id )
@@ -250,18 +407,20 @@ void background_worker_Cancel( struct background_worker* worker, void* id )
 void background_worker_RequestProbe( struct background_worker* worker )
 {
     vlc_mutex_lock( &worker->lock );
-    worker->head.probe_request = true;
-    vlc_cond_signal( &worker->head.worker_wait );
+    for( unsigned i = 0; i < worker->conf.max_threads; ++i )
+        worker->threads[i].probe_request = true;
+    vlc_cond_broadcast( &worker->task_wait );
     vlc_mutex_unlock( &worker->lock );
 }
 
 void background_worker_Delete( struct background_worker* worker )
 {
     BackgroundWorkerCancel( worker, NULL );
-    vlc_array_clear( &worker->tail.data );
+    assert( worker->queued == 0 && worker->thread_count == 0 );
     vlc_mutex_destroy( &worker->lock );
-    vlc_cond_destroy( &worker->head.wait );
-    vlc_cond_destroy( &worker->head.worker_wait );
-    vlc_cond_destroy( &worker->tail.wait );
+    vlc_cond_destroy( &worker->queue_wait );
+    vlc_cond_destroy( &worker->task_wait );
+    vlc_cond_destroy( &worker->done_wait );
+    free( worker->threads );
     free( worker );
 }
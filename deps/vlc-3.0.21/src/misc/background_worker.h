@@ -19,6 +19,18 @@
 #ifndef BACKGROUND_WORKER_H__
 #define BACKGROUND_WORKER_H__
 
+/**
+ * Priority classes of the queued entities
+ *
+ * Entities of a higher class are started before any entity of a lower class,
+ * and in the order in which they were pushed within a class.
+ **/
+enum background_worker_priority {
+    BACKGROUND_WORKER_PRIORITY_NORMAL,
+    BACKGROUND_WORKER_PRIORITY_HIGH, /**< e.g. items visible to the user */
+};
+#define BACKGROUND_WORKER_PRIORITIES 2
+
 struct background_worker_config {
     /**
      * Default timeout for completing a task
@@ -29,6 +41,15 @@ struct background_worker_config {
      **/
     vlc_tick_t default_timeout;
 
+    /**
+     * Maximum number of tasks running at the same time
+     *
+     * Each running task is driven by its own thread, which is started on
+     * demand and terminated after it has been idle for a while. `0` is
+     * treated as `1`, which processes the entities one at a time.
+     **/
+    unsigned max_threads;
+
     /**
      * Release an entity
      *
@@ -122,7 +143,7 @@ struct background_worker* background_worker_New( void* owner,
  * Request the background-worker to probe the current task
  *
  * This function is used to signal the background-worker that it should do
- * another probe to see whether the current task is still alive.
+ * another probe to see whether the current tasks are still alive.
  *
  * \warning Note that the function will not wait for the probing to finish, it
  *          will simply ask the background worker to recheck it as soon as
@@ -136,8 +157,13 @@ void background_worker_RequestProbe( struct background_worker* worker );
  * Push an entity into the background-worker
  *
  * This function is used to push an entity into the queue of pending work. The
- * entities will be processed in the order in which they are received (in terms
- * of the order of invocations in a single-threaded environment).
+ * entities of a given priority will be started in the order in which they are
+ * received (in terms of the order of invocations in a single-threaded
+ * environment), although they may finish in any order if the worker runs more
+ * than one thread.
+ *
+ * If an entity with the same non-`NULL` id is still queued, the entity is not
+ * queued again: the queued one is only raised to `priority` if needed.
  *
  * \param worker the background-worker
  * \param entity the entity which is to be queued
@@ -145,11 +171,13 @@ void background_worker_RequestProbe( struct background_worker* worker );
  * \param timeout the timeout of the entity in milliseconds, `0` denotes no
  *                timeout, a negative value will use the default timeout
  *                associated with the background-worker.
+ * \param priority the priority class of the entity
+ *                 (see \ref background_worker_priority)
  * \return VLC_SUCCESS if the entity was successfully queued, an error-code on
  *         failure.
  **/
 int background_worker_Push( struct background_worker* worker, void* entity,
-    void* id, int timeout );
+    void* id, int timeout, int priority );
 
 /**
  * Remove entities from the background-worker
@@ -158,12 +186,13 @@ int background_worker_Push( struct background_worker* worker, void* entity,
  * associated id, or to remove all queued (including currently running)
  * entities.
  *
- * \warning if the `id` passed refers to an entity that is currently being
- *          processed, the call will block until the task has been terminated.
+ * \warning if the `id` passed refers to entities that are currently being
+ *          processed, the call will block until the tasks have been
+ *          terminated.
  *
  * \param worker the background-worker
  * \param id NULL if every entity shall be removed, and the currently running
- *        task (if any) shall be cancelled.
+ *        tasks (if any) shall be cancelled.
  **/
 void background_worker_Cancel( struct background_worker* worker, void* id );
 
@@ -171,11 +200,11 @@ void background_worker_Cancel( struct background_worker* worker, void* id );
  * Delete a background-worker
  *
  * This function will destroy a background-worker created through \ref
- * background_worker_New. It will effectively stop the currently running task,
+ * background_worker_New. It will effectively stop the currently running tasks,
  * if any, and empty the queue of pending entities.
  *
- * \warning If there is a currently running task, the function will block until
- *          it has been stopped.
+ * \warning If there are currently running tasks, the function will block until
+ *          they have been stopped.
  *
  * \param worker the background-worker
  **/
@@ -34,6 +34,7 @@
 #include <vlc_common.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
+#include <vlc_atomic.h>
 
 #ifndef NDEBUG
 static void BlockNoRelease( block_t *b )
@@ -117,34 +118,312 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /** Initial reserved header and footer size. */
 #define BLOCK_PADDING      32
 
-block_t *block_Alloc (size_t size)
+/*
+ * Block slab allocator.
+ *
+ * Most blocks are small and come in a handful of sizes (MPEG-TS packets,
+ * UDP/RTP payloads, PES and elementary stream frames). Such blocks are carved
+ * from a few size classes and recycled instead of being given back to the C
+ * run-time on release.
+ *
+ * Each thread keeps a small magazine of free blocks per class, so that
+ * allocation and release are lock-free in the common case. Magazines exchange
+ * blocks in batches with a shared depot, as blocks are typically allocated by
+ * one thread (demux) and released by another one (decoder).
+ */
+
+/** Payload size of each size class.
+ * The first class fits single 188, 192 and 204-byte TS packets, the second
+ * one a full Ethernet frame (e.g. 7 TS packets over UDP/RTP). */
+static const size_t block_slab_sizes[] = {
+    256, 1504, 4096, 8192, 16384, 32768, 65536,
+};
+#define BLOCK_SLAB_CLASSES ARRAY_SIZE(block_slab_sizes)
+
+/** Free blocks cached per thread and per class: as many as fit in
+ * BLOCK_SLAB_MAGAZINE_BYTES, between 2 and BLOCK_SLAB_MAGAZINE. */
+#define BLOCK_SLAB_MAGAZINE 16
+#define BLOCK_SLAB_MAGAZINE_BYTES (64 << 10)
+
+/** Upper bound in bytes of free blocks kept in the depot, all classes. */
+#define BLOCK_SLAB_DEPOT_BYTES (1 << 20)
+
+typedef struct block_slab_t
 {
-    if (unlikely(size >> 27))
+    block_t self;
+    struct block_slab_t *next;
+    unsigned cls;
+} block_slab_t;
+
+typedef struct
+{
+    unsigned count[BLOCK_SLAB_CLASSES];
+    block_slab_t *free[BLOCK_SLAB_CLASSES][BLOCK_SLAB_MAGAZINE];
+} block_magazine_t;
+
+static struct
+{
+    vlc_mutex_t lock;
+    block_slab_t *free[BLOCK_SLAB_CLASSES];
+    size_t bytes;
+} block_depot = { .lock = VLC_STATIC_MUTEX };
+
+static vlc_threadvar_t block_slab_key;
+static atomic_bool block_slab_ready = ATOMIC_VAR_INIT(false);
+static atomic_ullong block_slab_hits = ATOMIC_VAR_INIT(0);
+static atomic_ullong block_slab_misses = ATOMIC_VAR_INIT(0);
+static atomic_ullong block_slab_bypass = ATOMIC_VAR_INIT(0);
+
+static size_t block_slab_AllocSize (size_t size)
+{
+    /* 2 * BLOCK_PADDING: pre + post padding */
+    return BLOCK_ALIGN + (2 * BLOCK_PADDING) + size;
+}
+
+static unsigned block_magazine_Max (unsigned cls)
+{
+    size_t max = BLOCK_SLAB_MAGAZINE_BYTES / block_slab_sizes[cls];
+
+    return VLC_CLIP (max, 2, BLOCK_SLAB_MAGAZINE);
+}
+
+static void block_slab_FreeList (block_slab_t *slab)
+{
+    while (slab != NULL)
     {
-        errno = ENOBUFS;
-        return NULL;
+        block_slab_t *next = slab->next;
+
+        free (slab);
+        slab = next;
     }
+}
 
-    /* 2 * BLOCK_PADDING: pre + post padding */
-    const size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
-                       + size;
-    if (unlikely(alloc <= size))
+/** Moves up to \p n blocks from a magazine into the depot.
+ * Blocks that do not fit in the depot are freed. */
+static void block_depot_Put (block_magazine_t *mag, unsigned cls, unsigned n)
+{
+    block_slab_t *overflow = NULL;
+    const size_t size = block_slab_sizes[cls];
+
+    vlc_mutex_lock (&block_depot.lock);
+    while (n > 0)
+    {
+        block_slab_t *slab = mag->free[cls][--mag->count[cls]];
+
+        n--;
+        if (block_depot.bytes + size <= BLOCK_SLAB_DEPOT_BYTES)
+        {
+            slab->next = block_depot.free[cls];
+            block_depot.free[cls] = slab;
+            block_depot.bytes += size;
+        }
+        else
+        {
+            slab->next = overflow;
+            overflow = slab;
+        }
+    }
+    vlc_mutex_unlock (&block_depot.lock);
+
+    block_slab_FreeList (overflow);
+}
+
+/** Refills a magazine with up to half its capacity from the depot. */
+static void block_depot_Get (block_magazine_t *mag, unsigned cls)
+{
+    const unsigned max = block_magazine_Max (cls) / 2;
+
+    vlc_mutex_lock (&block_depot.lock);
+    while (mag->count[cls] < max && block_depot.free[cls] != NULL)
+    {
+        block_slab_t *slab = block_depot.free[cls];
+
+        block_depot.free[cls] = slab->next;
+        block_depot.bytes -= block_slab_sizes[cls];
+        mag->free[cls][mag->count[cls]++] = slab;
+    }
+    vlc_mutex_unlock (&block_depot.lock);
+}
+
+/** Returns the cached blocks of an exiting thread to the depot. */
+static void block_magazine_Destroy (void *data)
+{
+    block_magazine_t *mag = data;
+
+    for (unsigned cls = 0; cls < BLOCK_SLAB_CLASSES; cls++)
+        block_depot_Put (mag, cls, mag->count[cls]);
+    free (mag);
+}
+
+static block_magazine_t *block_magazine_Get (void)
+{
+    if (unlikely(!atomic_load_explicit (&block_slab_ready,
+                                        memory_order_acquire)))
+    {
+        vlc_mutex_lock (&block_depot.lock);
+        if (!atomic_load_explicit (&block_slab_ready, memory_order_relaxed)
+         && vlc_threadvar_create (&block_slab_key,
+                                  block_magazine_Destroy) == 0)
+            atomic_store_explicit (&block_slab_ready, true,
+                                   memory_order_release);
+        vlc_mutex_unlock (&block_depot.lock);
+
+        if (!atomic_load_explicit (&block_slab_ready, memory_order_acquire))
+            return NULL;
+    }
+
+    block_magazine_t *mag = vlc_threadvar_get (block_slab_key);
+    if (likely(mag != NULL))
+        return mag;
+
+    mag = calloc (1, sizeof (*mag));
+    if (unlikely(mag == NULL))
+        return NULL;
+    if (unlikely(vlc_threadvar_set (block_slab_key, mag)))
+    {
+        free (mag);
         return NULL;
+    }
+    return mag;
+}
 
-    block_t *b = malloc (alloc);
-    if (unlikely(b == NULL))
+static void block_slab_Release (block_t *block)
+{
+    block_slab_t *slab = (block_slab_t *)block;
+    unsigned cls = slab->cls;
+
+    assert (block->p_start == (unsigned char *)(slab + 1));
+    block_Invalidate (block);
+
+    block_magazine_t *mag = block_magazine_Get ();
+    if (unlikely(mag == NULL))
+    {
+        free (slab);
+        return;
+    }
+
+    const unsigned max = block_magazine_Max (cls);
+    if (mag->count[cls] >= max)
+        block_depot_Put (mag, cls, max / 2);
+    mag->free[cls][mag->count[cls]++] = slab;
+}
+
+static block_t *block_slab_Alloc (unsigned cls)
+{
+    block_magazine_t *mag = block_magazine_Get ();
+    block_slab_t *slab = NULL;
+
+    if (likely(mag != NULL))
+    {
+        if (mag->count[cls] == 0)
+            block_depot_Get (mag, cls);
+        if (mag->count[cls] > 0)
+            slab = mag->free[cls][--mag->count[cls]];
+    }
+
+    size_t alloc = block_slab_AllocSize (block_slab_sizes[cls]);
+
+    if (slab != NULL)
+        atomic_fetch_add_explicit (&block_slab_hits, 1, memory_order_relaxed);
+    else
+    {
+        atomic_fetch_add_explicit (&block_slab_misses, 1,
+                                   memory_order_relaxed);
+        slab = malloc (sizeof (*slab) + alloc);
+        if (unlikely(slab == NULL))
+            return NULL;
+        slab->cls = cls;
+    }
+
+    block_Init (&slab->self, slab + 1, alloc);
+    slab->self.pf_release = block_slab_Release;
+    return &slab->self;
+}
+
+block_t *block_Alloc (size_t size)
+{
+    if (unlikely(size >> 27))
+    {
+        errno = ENOBUFS;
         return NULL;
+    }
 
-    block_Init (b, b + 1, alloc - sizeof (*b));
     static_assert ((BLOCK_PADDING % BLOCK_ALIGN) == 0,
                    "BLOCK_PADDING must be a multiple of BLOCK_ALIGN");
+
+    block_t *b = NULL;
+
+    for (unsigned cls = 0; cls < BLOCK_SLAB_CLASSES; cls++)
+        if (size <= block_slab_sizes[cls])
+        {
+            b = block_slab_Alloc (cls);
+            if (unlikely(b == NULL))
+                return NULL;
+            break;
+        }
+
+    if (b == NULL)
+    {
+        const size_t alloc = sizeof (block_t) + block_slab_AllocSize (size);
+        if (unlikely(alloc <= size))
+            return NULL;
+
+        atomic_fetch_add_explicit (&block_slab_bypass, 1,
+                                   memory_order_relaxed);
+        b = malloc (alloc);
+        if (unlikely(b == NULL))
+            return NULL;
+
+        block_Init (b, b + 1, alloc - sizeof (*b));
+        b->pf_release = block_generic_Release;
+    }
+
     b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
     b->p_buffer = (void *)(((uintptr_t)b->p_buffer) & ~(BLOCK_ALIGN - 1));
     b->i_buffer = size;
-    b->pf_release = block_generic_Release;
     return b;
 }
 
+void block_GetAllocStats (block_alloc_stats_t *stats)
+{
+    stats->hits = atomic_load_explicit (&block_slab_hits,
+                                        memory_order_relaxed);
+    stats->misses = atomic_load_explicit (&block_slab_misses,
+                                          memory_order_relaxed);
+    stats->oversized = atomic_load_explicit (&block_slab_bypass,
+                                             memory_order_relaxed);
+
+    vlc_mutex_lock (&block_depot.lock);
+    stats->cached = block_depot.bytes;
+    vlc_mutex_unlock (&block_depot.lock);
+}
+
+void block_Trim (void)
+{
+    block_slab_t *list[BLOCK_SLAB_CLASSES];
+
+    if (atomic_load_explicit (&block_slab_ready, memory_order_acquire))
+    {
+        block_magazine_t *mag = vlc_threadvar_get (block_slab_key);
+
+        if (mag != NULL)
+            for (unsigned cls = 0; cls < BLOCK_SLAB_CLASSES; cls++)
+                block_depot_Put (mag, cls, mag->count[cls]);
+    }
+
+    vlc_mutex_lock (&block_depot.lock);
+    for (unsigned cls = 0; cls < BLOCK_SLAB_CLASSES; cls++)
+    {
+        list[cls] = block_depot.free[cls];
+        block_depot.free[cls] = NULL;
+    }
+    block_depot.bytes = 0;
+    vlc_mutex_unlock (&block_depot.lock);
+
+    for (unsigned cls = 0; cls < BLOCK_SLAB_CLASSES; cls++)
+        block_slab_FreeList (list[cls]);
+}
+
 block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
 {
     block_Check( p_block );
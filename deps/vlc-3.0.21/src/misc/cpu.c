@@ -136,13 +136,13 @@ void vlc_CPU_init (void)
                    "cpuid\n\t" \
                    "xchgl %%ebx,%1\n\t" \
                    : "=a" (i_eax), "=r" (i_ebx), "=c" (i_ecx), "=d" (i_edx) \
-                   : "a" (reg) \
+                   : "a" (reg), "c" (0) \
                    : "cc");
 # else
 #  define cpuid(reg) \
      asm volatile ("cpuid\n\t" \
                    : "=a" (i_eax), "=b" (i_ebx), "=c" (i_ecx), "=d" (i_edx) \
-                   : "a" (reg) \
+                   : "a" (reg), "c" (0) \
                    : "cc");
 # endif
      /* Check if the OS really supports the requested instructions */
@@ -180,6 +180,8 @@ void vlc_CPU_init (void)
         goto out;
 #endif
 
+    const unsigned i_max_leaf = i_eax;
+
     /* borrowed from mpeg2dec */
     b_amd = ( i_ebx == 0x68747541 ) && ( i_ecx == 0x444d4163 )
                     && ( i_edx == 0x69746e65 );
@@ -212,6 +214,27 @@ void vlc_CPU_init (void)
             i_capabilities |= VLC_CPU_SSE4_2;
     }
 
+    /* AVX needs the OS to save the YMM registers (OSXSAVE and XCR0) */
+    if ((i_ecx & 0x18000000) == 0x18000000)
+    {
+        unsigned i_xcr0, i_xcr0_hi;
+
+        asm volatile (".byte 0x0f, 0x01, 0xd0" /* xgetbv */
+                      : "=a" (i_xcr0), "=d" (i_xcr0_hi) : "c" (0));
+        (void) i_xcr0_hi;
+        if ((i_xcr0 & 0x6) == 0x6)
+        {
+            i_capabilities |= VLC_CPU_AVX;
+
+            if (i_max_leaf >= 7)
+            {
+                cpuid( 0x00000007 );
+                if (i_ebx & 0x00000020)
+                    i_capabilities |= VLC_CPU_AVX2;
+            }
+        }
+    }
+
     /* test for additional capabilities */
     cpuid( 0x80000000 );
 
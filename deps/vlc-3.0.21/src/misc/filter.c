@@ -183,6 +183,171 @@ void filter_DeleteBlend( filter_t *p_blend )
     vlc_object_release( p_blend );
 }
 
+/* Slice threading */
+#define SLICES_MAX 64
+/* Automatic thread count: the memory bandwidth does not scale further */
+#define SLICES_AUTO_MAX 8
+
+struct vlc_slice_worker
+{
+    vlc_slices_t *p_slices;
+    vlc_thread_t  thread;
+    unsigned      i_slice;
+};
+
+struct vlc_slices_t
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait; /* signaled to the workers for each new job */
+    vlc_cond_t  done; /* signaled to vlc_slices_Run() by the last worker */
+
+    unsigned     i_generation;
+    unsigned     i_pending;
+    bool         b_quit;
+
+    /* Current job */
+    unsigned     i_lines;
+    unsigned     i_align;
+    vlc_slice_cb pf_slice;
+    void        *opaque;
+
+    unsigned     i_count;
+    struct vlc_slice_worker workers[];
+};
+
+unsigned filter_GetSliceCount( filter_t *p_filter )
+{
+    int64_t i_threads = var_InheritInteger( p_filter, "filter-threads" );
+
+    if( i_threads <= 0 )
+        i_threads = __MIN( vlc_GetCPUCount(), SLICES_AUTO_MAX );
+    return __MIN( i_threads, SLICES_MAX );
+}
+
+static void SliceRun( const vlc_slices_t *p_slices, unsigned i_slice )
+{
+    const unsigned i_count = p_slices->i_count;
+    const unsigned i_units = ( p_slices->i_lines + p_slices->i_align - 1 )
+                           / p_slices->i_align;
+    const unsigned i_first = i_units * i_slice / i_count * p_slices->i_align;
+    const unsigned i_last = __MIN( p_slices->i_lines,
+                            i_units * (i_slice + 1) / i_count * p_slices->i_align );
+
+    if( i_last > i_first )
+        p_slices->pf_slice( p_slices->opaque, i_slice,
+                            i_first, i_last - i_first );
+}
+
+static void *SliceThread( void *data )
+{
+    struct vlc_slice_worker *p_worker = data;
+    vlc_slices_t *p_slices = p_worker->p_slices;
+    unsigned i_generation = 0;
+
+    vlc_mutex_lock( &p_slices->lock );
+    for( ;; )
+    {
+        while( p_slices->i_generation == i_generation && !p_slices->b_quit )
+            vlc_cond_wait( &p_slices->wait, &p_slices->lock );
+        if( p_slices->b_quit )
+            break;
+        i_generation = p_slices->i_generation;
+        vlc_mutex_unlock( &p_slices->lock );
+
+        SliceRun( p_slices, p_worker->i_slice );
+
+        vlc_mutex_lock( &p_slices->lock );
+        if( --p_slices->i_pending == 0 )
+            vlc_cond_signal( &p_slices->done );
+    }
+    vlc_mutex_unlock( &p_slices->lock );
+    return NULL;
+}
+
+vlc_slices_t *vlc_slices_New( unsigned i_count )
+{
+    i_count = VLC_CLIP( i_count, 1, SLICES_MAX );
+
+    vlc_slices_t *p_slices = malloc( sizeof(*p_slices)
+                        + (i_count - 1) * sizeof(struct vlc_slice_worker) );
+    if( unlikely(p_slices == NULL) )
+        return NULL;
+
+    vlc_mutex_init( &p_slices->lock );
+    vlc_cond_init( &p_slices->wait );
+    vlc_cond_init( &p_slices->done );
+    p_slices->i_generation = 0;
+    p_slices->i_pending = 0;
+    p_slices->b_quit = false;
+    p_slices->i_count = 1;
+
+    /* The calling thread processes the slice i_count - 1 */
+    for( unsigned i = 0; i < i_count - 1; i++ )
+    {
+        struct vlc_slice_worker *p_worker = &p_slices->workers[i];
+
+        p_worker->p_slices = p_slices;
+        p_worker->i_slice = i;
+        if( vlc_clone( &p_worker->thread, SliceThread, p_worker,
+                       VLC_THREAD_PRIORITY_VIDEO ) )
+            break;
+        p_slices->i_count++;
+    }
+    return p_slices;
+}
+
+unsigned vlc_slices_Count( const vlc_slices_t *p_slices )
+{
+    return p_slices->i_count;
+}
+
+void vlc_slices_Run( vlc_slices_t *p_slices, unsigned i_lines, unsigned i_align,
+                     vlc_slice_cb pf_slice, void *opaque )
+{
+    const unsigned i_workers = p_slices->i_count - 1;
+
+    assert( i_align > 0 );
+    p_slices->i_lines = i_lines;
+    p_slices->i_align = i_align;
+    p_slices->pf_slice = pf_slice;
+    p_slices->opaque = opaque;
+
+    if( i_workers > 0 )
+    {
+        vlc_mutex_lock( &p_slices->lock );
+        p_slices->i_pending = i_workers;
+        p_slices->i_generation++;
+        vlc_cond_broadcast( &p_slices->wait );
+        vlc_mutex_unlock( &p_slices->lock );
+    }
+
+    SliceRun( p_slices, i_workers );
+
+    if( i_workers > 0 )
+    {
+        vlc_mutex_lock( &p_slices->lock );
+        while( p_slices->i_pending > 0 )
+            vlc_cond_wait( &p_slices->done, &p_slices->lock );
+        vlc_mutex_unlock( &p_slices->lock );
+    }
+}
+
+void vlc_slices_Delete( vlc_slices_t *p_slices )
+{
+    vlc_mutex_lock( &p_slices->lock );
+    p_slices->b_quit = true;
+    vlc_cond_broadcast( &p_slices->wait );
+    vlc_mutex_unlock( &p_slices->lock );
+
+    for( unsigned i = 0; i < p_slices->i_count - 1; i++ )
+        vlc_join( p_slices->workers[i].thread, NULL );
+
+    vlc_cond_destroy( &p_slices->done );
+    vlc_cond_destroy( &p_slices->wait );
+    vlc_mutex_destroy( &p_slices->lock );
+    free( p_slices );
+}
+
 /* */
 #include <vlc_video_splitter.h>
 
@@ -44,8 +44,12 @@ struct picture_pool_t {
     vlc_mutex_t lock;
     vlc_cond_t  wait;
 
-    bool               canceled;
-    unsigned long long available;
+    /* Pictures are claimed and given back with atomic bit operations on
+     * the available mask. The lock and condition variable only serve
+     * blocking waits and cancellation. */
+    atomic_bool        canceled;
+    atomic_ullong      available;
+    atomic_uint        waiters;
     atomic_ushort      refs;
     unsigned short     picture_count;
     picture_t  *picture[];
@@ -68,6 +72,51 @@ void picture_pool_Release(picture_pool_t *pool)
     picture_pool_Destroy(pool);
 }
 
+/**
+ * Claims one available picture slot, ignoring the slots in the skip mask.
+ * \return the slot index plus one, or zero if no slots are available.
+ */
+static unsigned picture_pool_Claim(picture_pool_t *pool,
+                                   unsigned long long skip)
+{
+    unsigned long long avail = atomic_load(&pool->available) & ~skip;
+
+    while (avail != 0)
+    {
+        unsigned long long bit = avail & -avail;
+        unsigned long long old = atomic_fetch_and(&pool->available, ~bit);
+
+        if (old & bit)
+            return ffsll(bit);
+        /* Lost the race for that slot, retry with the fresh mask. */
+        avail = old & ~skip;
+    }
+    return 0;
+}
+
+/**
+ * Gives picture slots back to the pool and wakes up blocked waiters if any.
+ */
+static void picture_pool_Put(picture_pool_t *pool, unsigned long long mask)
+{
+    unsigned long long old = atomic_fetch_or(&pool->available, mask);
+
+    assert(!(old & mask));
+    (void) old;
+
+    /* Waiters register before they try to claim a slot, so either they
+     * see the new mask, or they are seen here and need to be woken up. */
+    if (atomic_load(&pool->waiters) == 0)
+        return;
+
+    vlc_mutex_lock(&pool->lock);
+    if (mask & (mask - 1))
+        vlc_cond_broadcast(&pool->wait);
+    else
+        vlc_cond_signal(&pool->wait);
+    vlc_mutex_unlock(&pool->lock);
+}
+
 static void picture_pool_ReleasePicture(picture_t *clone)
 {
     picture_priv_t *priv = (picture_priv_t *)clone;
@@ -82,12 +131,7 @@ static void picture_pool_ReleasePicture(picture_t *clone)
         pool->pic_unlock(picture);
     picture_Release(picture);
 
-    vlc_mutex_lock(&pool->lock);
-    assert(!(pool->available & (1ULL << offset)));
-    pool->available |= 1ULL << offset;
-    vlc_cond_signal(&pool->wait);
-    vlc_mutex_unlock(&pool->lock);
-
+    picture_pool_Put(pool, 1ULL << offset);
     picture_pool_Destroy(pool);
 }
 
@@ -133,14 +177,15 @@ picture_pool_t *picture_pool_NewExtended(const picture_pool_configuration_t *cfg
     vlc_mutex_init(&pool->lock);
     vlc_cond_init(&pool->wait);
     if (cfg->picture_count == POOL_MAX)
-        pool->available = ~0ULL;
+        atomic_init(&pool->available, ~0ULL);
     else
-        pool->available = (1ULL << cfg->picture_count) - 1;
+        atomic_init(&pool->available, (1ULL << cfg->picture_count) - 1);
+    atomic_init(&pool->waiters, 0);
     atomic_init(&pool->refs,  1);
     pool->picture_count = cfg->picture_count;
     memcpy(pool->picture, cfg->picture,
            cfg->picture_count * sizeof (picture_t *));
-    pool->canceled = false;
+    atomic_init(&pool->canceled, false);
     return pool;
 }
 
@@ -201,96 +246,89 @@ error:
     return NULL;
 }
 
-/** Find next (bit) set */
-static int fnsll(unsigned long long x, unsigned i)
+static picture_t *picture_pool_Acquire(picture_pool_t *pool,
+                                       unsigned offset)
 {
-    if (i >= CHAR_BIT * sizeof (x))
-        return 0;
-    return ffsll(x & ~((1ULL << i) - 1));
+    picture_t *clone = picture_pool_ClonePicture(pool, offset);
+    if (clone != NULL) {
+        assert(clone->p_next == NULL);
+        atomic_fetch_add(&pool->refs, 1);
+    }
+    return clone;
 }
 
 picture_t *picture_pool_Get(picture_pool_t *pool)
 {
-    vlc_mutex_lock(&pool->lock);
-    assert(pool->refs > 0);
+    unsigned long long failed = 0;
+    picture_t *clone = NULL;
+    unsigned i;
 
-    if (pool->canceled)
-    {
-        vlc_mutex_unlock(&pool->lock);
+    assert(atomic_load(&pool->refs) > 0);
+
+    if (atomic_load(&pool->canceled))
         return NULL;
-    }
 
-    for (unsigned i = ffsll(pool->available); i; i = fnsll(pool->available, i))
+    while ((i = picture_pool_Claim(pool, failed)) != 0)
     {
-        pool->available &= ~(1ULL << (i - 1));
-        vlc_mutex_unlock(&pool->lock);
-
         picture_t *picture = pool->picture[i - 1];
 
         if (pool->pic_lock != NULL && pool->pic_lock(picture) != VLC_SUCCESS) {
-            vlc_mutex_lock(&pool->lock);
-            pool->available |= 1ULL << (i - 1);
+            /* Keep the slot until the end, so it is not claimed again. */
+            failed |= 1ULL << (i - 1);
             continue;
         }
 
-        picture_t *clone = picture_pool_ClonePicture(pool, i - 1);
-        if (clone != NULL) {
-            assert(clone->p_next == NULL);
-            atomic_fetch_add(&pool->refs, 1);
-        }
-        return clone;
+        clone = picture_pool_Acquire(pool, i - 1);
+        break;
     }
 
-    vlc_mutex_unlock(&pool->lock);
-    return NULL;
+    if (failed != 0)
+        picture_pool_Put(pool, failed);
+    return clone;
 }
 
 picture_t *picture_pool_Wait(picture_pool_t *pool)
 {
     unsigned i;
 
-    vlc_mutex_lock(&pool->lock);
-    assert(pool->refs > 0);
+    assert(atomic_load(&pool->refs) > 0);
 
-    while (pool->available == 0)
+    i = picture_pool_Claim(pool, 0);
+    if (i == 0)
     {
-        if (pool->canceled)
+        vlc_mutex_lock(&pool->lock);
+        atomic_fetch_add(&pool->waiters, 1);
+
+        while ((i = picture_pool_Claim(pool, 0)) == 0)
         {
-            vlc_mutex_unlock(&pool->lock);
-            return NULL;
+            if (atomic_load(&pool->canceled))
+                break;
+            vlc_cond_wait(&pool->wait, &pool->lock);
         }
-        vlc_cond_wait(&pool->wait, &pool->lock);
-    }
 
-    i = ffsll(pool->available);
-    assert(i > 0);
-    pool->available &= ~(1ULL << (i - 1));
-    vlc_mutex_unlock(&pool->lock);
+        atomic_fetch_sub(&pool->waiters, 1);
+        vlc_mutex_unlock(&pool->lock);
+
+        if (i == 0)
+            return NULL;
+    }
 
     picture_t *picture = pool->picture[i - 1];
 
     if (pool->pic_lock != NULL && pool->pic_lock(picture) != VLC_SUCCESS) {
-        vlc_mutex_lock(&pool->lock);
-        pool->available |= 1ULL << (i - 1);
-        vlc_cond_signal(&pool->wait);
-        vlc_mutex_unlock(&pool->lock);
+        picture_pool_Put(pool, 1ULL << (i - 1));
         return NULL;
     }
 
-    picture_t *clone = picture_pool_ClonePicture(pool, i - 1);
-    if (clone != NULL) {
-        assert(clone->p_next == NULL);
-        atomic_fetch_add(&pool->refs, 1);
-    }
-    return clone;
+    return picture_pool_Acquire(pool, i - 1);
 }
 
 void picture_pool_Cancel(picture_pool_t *pool, bool canceled)
 {
     vlc_mutex_lock(&pool->lock);
-    assert(pool->refs > 0);
+    assert(atomic_load(&pool->refs) > 0);
 
-    pool->canceled = canceled;
+    atomic_store(&pool->canceled, canceled);
     if (canceled)
         vlc_cond_broadcast(&pool->wait);
     vlc_mutex_unlock(&pool->lock);
@@ -1,5 +1,5 @@
 /*****************************************************************************
- * timer.c: simple threaded timer
+ * timer.c: timer wheel service
  *****************************************************************************
  * Copyright (C) 2009-2012 Rémi Denis-Courmont
  *
@@ -22,7 +22,6 @@
 # include "config.h"
 #endif
 
-#include <stdnoreturn.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <assert.h>
@@ -36,39 +35,428 @@
  * they typically require one thread per timer plus one thread per iteration,
  * which is inefficient and overkill (unless you need multiple iteration
  * of the same timer concurrently).
- * Thus, this is a generic manual implementation of timers using a thread.
+ *
+ * Thus, this is a generic manual implementation of timers. All the timers of
+ * the process are scheduled by a single thread, which exists as long as at
+ * least one timer does. The armed timers are sorted in a hierarchical timer
+ * wheel: each level has 256 slots, a level 0 slot spans one tick, a level 1
+ * slot spans 256 ticks, and so on. When the current tick reaches a slot of an
+ * upper level, its timers are spread in the lower levels ("cascade").
+ * The wheel only sorts the timers: within a level 0 slot, the timers still
+ * fire at their exact value, never before.
+ *
+ * The scheduling thread never runs the callbacks itself: expired timers are
+ * queued to a pool of worker threads. Callbacks may block (on network or
+ * child processes for instance), so whenever all the workers are busy and
+ * the queue has not moved for TIMER_STALL, another worker is started. The
+ * pool thus grows to the number of callbacks blocked at the same time.
  */
 
+#define TIMER_TICK    (CLOCK_FREQ / 1000)
+#define WHEEL_BITS    8
+#define WHEEL_SIZE    (1 << WHEEL_BITS)
+#define WHEEL_MASK    (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS  4
+#define WHEEL_SPAN    (WHEEL_BITS * WHEEL_LEVELS) /* in bits of ticks */
+#define TIMER_STALL   (CLOCK_FREQ / 200)
+
 struct vlc_timer
 {
-    vlc_thread_t thread;
-    vlc_cond_t   reschedule;
-    vlc_mutex_t  lock;
-    void       (*func) (void *);
-    void        *data;
-    vlc_tick_t   value, interval;
-    atomic_uint  overruns;
+    struct vlc_timer  *next;  /**< next timer in the same slot */
+    struct vlc_timer **pprev; /**< link to this timer, NULL if not armed */
+    void             (*func) (void *);
+    void              *data;
+    vlc_tick_t         value, interval;
+    atomic_uint        overruns;
+
+    struct vlc_timer  *queue_next; /**< next timer waiting for a worker */
+    vlc_tick_t         queued;  /**< when the timer was queued */
+    bool               pending; /**< queued, its callback did not start */
+    bool               running; /**< its callback is running */
+    bool               rerun;   /**< expired again while running */
 };
 
-noreturn static void *vlc_timer_thread (void *data)
+static struct
 {
-    struct vlc_timer *timer = data;
+    vlc_mutex_t       lock;
+    vlc_cond_t        wait;   /**< wakes the thread up */
+    vlc_cond_t        work;   /**< wakes an idle worker up */
+    vlc_cond_t        idle;   /**< signals the end of a callback */
+    vlc_tick_t        deadline; /**< current wake up time of the thread */
+    uint64_t          tick;   /**< current tick, all previous ones expired */
+    bool              exit;
+
+    uint32_t          bitmap[WHEEL_LEVELS][WHEEL_SIZE / 32];
+    struct vlc_timer *slots[WHEEL_LEVELS][WHEEL_SIZE];
+    struct vlc_timer *overflow; /**< timers beyond the wheel span */
+
+    /* Expired timers, in order, and their workers */
+    struct vlc_timer *queue;
+    struct vlc_timer **queue_tail;
+    vlc_thread_t     *workers;
+    unsigned          worker_count;
+    unsigned          idlers; /**< workers waiting for a timer */
+    vlc_tick_t        last_spawn;
 
-    vlc_mutex_lock (&timer->lock);
-    mutex_cleanup_push (&timer->lock);
+    /* Service lifetime, serialized by setup_lock */
+    vlc_thread_t      thread;
+    unsigned          users;
+} wheel = {
+    .lock = VLC_STATIC_MUTEX,
+};
+
+static vlc_mutex_t setup_lock = VLC_STATIC_MUTEX;
+
+static void TimerLink(struct vlc_timer **head, struct vlc_timer *timer)
+{
+    timer->next = *head;
+    if (timer->next != NULL)
+        timer->next->pprev = &timer->next;
+    timer->pprev = head;
+    *head = timer;
+}
+
+static struct vlc_timer **WheelSlot(uint64_t expires, unsigned *level,
+                                    unsigned *index)
+{
+    /* Lowest level where the timer shares the upper bits of the tick */
+    for (unsigned l = 0; l < WHEEL_LEVELS; l++)
+    {
+        unsigned shift = (l + 1) * WHEEL_BITS;
+
+        if ((expires >> shift) == (wheel.tick >> shift))
+        {
+            *level = l;
+            *index = (expires >> (l * WHEEL_BITS)) & WHEEL_MASK;
+            return &wheel.slots[l][*index];
+        }
+    }
+    return NULL;
+}
+
+/* Inserts an armed timer in the wheel, wheel.lock must be held */
+static void WheelAdd(struct vlc_timer *timer)
+{
+    uint64_t expires = timer->value / TIMER_TICK;
+    unsigned level, index;
+
+    if (expires < wheel.tick)
+        expires = wheel.tick;
+
+    struct vlc_timer **slot = WheelSlot(expires, &level, &index);
+    if (slot == NULL)
+    {
+        TimerLink(&wheel.overflow, timer);
+        return;
+    }
+    TimerLink(slot, timer);
+    wheel.bitmap[level][index / 32] |= 1u << (index % 32);
+}
+
+static void WheelRemove(struct vlc_timer *timer)
+{
+    struct vlc_timer **pprev = timer->pprev;
+
+    *pprev = timer->next;
+    if (timer->next != NULL)
+        timer->next->pprev = pprev;
+    timer->pprev = NULL;
+
+    /* Clears the bit of the slot if the timer was its last one */
+    if (*pprev != NULL || pprev == &wheel.overflow)
+        return;
+
+    for (unsigned l = 0; l < WHEEL_LEVELS; l++)
+    {
+        if (pprev >= &wheel.slots[l][0] && pprev <= &wheel.slots[l][WHEEL_MASK])
+        {
+            unsigned index = pprev - &wheel.slots[l][0];
+            wheel.bitmap[l][index / 32] &= ~(1u << (index % 32));
+            return;
+        }
+    }
+}
+
+/* Returns the first non-empty slot index from index, or WHEEL_SIZE */
+static unsigned WheelNextSlot(unsigned level, unsigned index)
+{
+    while (index < WHEEL_SIZE)
+    {
+        uint32_t bits = wheel.bitmap[level][index / 32] >> (index % 32);
+
+        if (bits != 0)
+            return index + ctz(bits);
+        index = (index | 31) + 1;
+    }
+    return WHEEL_SIZE;
+}
+
+/**
+ * Finds the first tick after the current one with timers to fire or to
+ * cascade, or UINT64_MAX if there are no armed timers.
+ */
+static uint64_t WheelNextTick(void)
+{
+    for (unsigned l = 0; l < WHEEL_LEVELS; l++)
+    {
+        unsigned shift = l * WHEEL_BITS;
+        unsigned cur = (wheel.tick >> shift) & WHEEL_MASK;
+        unsigned index = WheelNextSlot(l, cur + 1);
+
+        if (index < WHEEL_SIZE)
+        {
+            uint64_t base = wheel.tick >> (shift + WHEEL_BITS)
+                                       << (shift + WHEEL_BITS);
+            return base | ((uint64_t)index << shift);
+        }
+    }
+
+    if (wheel.overflow != NULL)
+        return ((wheel.tick >> WHEEL_SPAN) + 1) << WHEEL_SPAN;
+    return UINT64_MAX;
+}
+
+/* Moves the timers of a slot to their lower level slots */
+static void WheelCascade(struct vlc_timer **head)
+{
+    struct vlc_timer *timer = *head;
+
+    *head = NULL;
+    while (timer != NULL)
+    {
+        struct vlc_timer *next = timer->next;
+
+        WheelAdd(timer);
+        timer = next;
+    }
+}
+
+static void WheelAdvance(uint64_t tick)
+{
+    assert(tick > wheel.tick);
+    wheel.tick = tick;
+
+    if ((tick & ((UINT64_C(1) << WHEEL_SPAN) - 1)) == 0)
+        WheelCascade(&wheel.overflow);
+
+    for (unsigned l = WHEEL_LEVELS - 1; l > 0; l--)
+    {
+        unsigned shift = l * WHEEL_BITS;
+
+        if (tick & ((UINT64_C(1) << shift) - 1))
+            continue;
+
+        unsigned index = (tick >> shift) & WHEEL_MASK;
+        wheel.bitmap[l][index / 32] &= ~(1u << (index % 32));
+        WheelCascade(&wheel.slots[l][index]);
+    }
+}
+
+/* Returns an expired timer, removed from the wheel, or NULL */
+static struct vlc_timer *WheelExpire(vlc_tick_t now)
+{
+    const uint64_t now_tick = now / TIMER_TICK;
 
     for (;;)
     {
-        while (timer->value == 0)
+        unsigned index = wheel.tick & WHEEL_MASK;
+
+        for (struct vlc_timer *timer = wheel.slots[0][index];
+             timer != NULL; timer = timer->next)
+            if (timer->value <= now)
+            {
+                WheelRemove(timer);
+                return timer;
+            }
+
+        if (wheel.tick >= now_tick)
+            return NULL;
+
+        uint64_t next = WheelNextTick();
+        WheelAdvance(next < now_tick ? next : now_tick);
+    }
+}
+
+/* Returns when the thread shall wake up next, wheel.lock must be held */
+static vlc_tick_t WheelDeadline(void)
+{
+    unsigned index = WheelNextSlot(0, wheel.tick & WHEEL_MASK);
+
+    if (index < WHEEL_SIZE)
+    {   /* Exact value of the earliest timer of the slot */
+        vlc_tick_t deadline = INT64_MAX;
+
+        for (struct vlc_timer *timer = wheel.slots[0][index];
+             timer != NULL; timer = timer->next)
+            if (timer->value < deadline)
+                deadline = timer->value;
+        return deadline;
+    }
+
+    uint64_t next = WheelNextTick();
+    if (next == UINT64_MAX || next > INT64_MAX / TIMER_TICK)
+        return INT64_MAX;
+    return next * TIMER_TICK; /* cascade */
+}
+
+/* Queues an expired timer for a worker, wheel.lock must be held */
+static void QueuePush(struct vlc_timer *timer, vlc_tick_t now)
+{
+    if (timer->pending || timer->rerun)
+    {   /* The previous expiry is not served yet */
+        atomic_fetch_add_explicit(&timer->overruns, 1, memory_order_relaxed);
+        return;
+    }
+    if (timer->running)
+    {   /* Run again by the same worker, never concurrently */
+        timer->rerun = true;
+        return;
+    }
+
+    timer->queue_next = NULL;
+    timer->queued = now;
+    timer->pending = true;
+    *wheel.queue_tail = timer;
+    wheel.queue_tail = &timer->queue_next;
+    if (wheel.idlers > 0)
+        vlc_cond_signal(&wheel.work);
+}
+
+static struct vlc_timer *QueuePop(void)
+{
+    struct vlc_timer *timer = wheel.queue;
+
+    wheel.queue = timer->queue_next;
+    if (wheel.queue == NULL)
+        wheel.queue_tail = &wheel.queue;
+    timer->pending = false;
+    return timer;
+}
+
+static void QueueRemove(struct vlc_timer *timer)
+{
+    struct vlc_timer **pp = &wheel.queue;
+
+    while (*pp != timer)
+        pp = &(*pp)->queue_next;
+    *pp = timer->queue_next;
+    if (wheel.queue_tail == &timer->queue_next)
+        wheel.queue_tail = pp;
+    timer->pending = false;
+}
+
+/* Runs the callback of a queued timer, wheel.lock must be held */
+static void TimerRun(struct vlc_timer *timer)
+{
+    timer->running = true;
+    do
+    {
+        timer->rerun = false;
+        vlc_mutex_unlock(&wheel.lock);
+
+        timer->func(timer->data);
+
+        vlc_mutex_lock(&wheel.lock);
+    }
+    while (timer->rerun);
+    timer->running = false;
+    vlc_cond_broadcast(&wheel.idle);
+}
+
+static void *vlc_timer_worker(void *data)
+{
+    (void) data;
+    vlc_savecancel();
+
+    vlc_mutex_lock(&wheel.lock);
+    for (;;)
+    {
+        if (wheel.queue != NULL)
         {
-            assert(timer->interval == 0);
-            vlc_cond_wait (&timer->reschedule, &timer->lock);
+            TimerRun(QueuePop());
+            continue;
         }
+        if (wheel.exit)
+            break;
 
-        if (timer->interval != 0)
+        wheel.idlers++;
+        vlc_cond_wait(&wheel.work, &wheel.lock);
+        wheel.idlers--;
+    }
+    vlc_mutex_unlock(&wheel.lock);
+    return NULL;
+}
+
+/**
+ * Starts a worker if expired timers have been waiting for too long while all
+ * the workers are busy. Returns when to check again, INT64_MAX if there is
+ * nothing to wait for, or a time not after now to check again at once.
+ */
+static vlc_tick_t WorkersCheck(vlc_tick_t now)
+{
+    if (wheel.queue == NULL || wheel.idlers > 0)
+        return INT64_MAX;
+
+    if (wheel.worker_count > 0)
+    {
+        vlc_tick_t stall = __MAX(wheel.queue->queued, wheel.last_spawn)
+                         + TIMER_STALL;
+        if (now < stall)
+            return stall;
+    }
+
+    vlc_thread_t *workers = realloc(wheel.workers, (wheel.worker_count + 1)
+                                                   * sizeof (*workers));
+    if (likely(workers != NULL))
+    {
+        wheel.workers = workers;
+        if (vlc_clone(&workers[wheel.worker_count], vlc_timer_worker, NULL,
+                      VLC_THREAD_PRIORITY_INPUT) == 0)
+        {
+            wheel.worker_count++;
+            wheel.last_spawn = now;
+            return now + TIMER_STALL;
+        }
+    }
+
+    if (wheel.worker_count > 0)
+    {
+        wheel.last_spawn = now;
+        return now + TIMER_STALL;
+    }
+    /* No workers at all: run the callback from this thread */
+    TimerRun(QueuePop());
+    return now;
+}
+
+static void *vlc_timer_thread(void *data)
+{
+    (void) data;
+    vlc_savecancel();
+
+    vlc_mutex_lock(&wheel.lock);
+    while (!wheel.exit)
+    {
+        vlc_tick_t now = mdate();
+        struct vlc_timer *timer = WheelExpire(now);
+
+        if (timer == NULL)
         {
-            vlc_tick_t now = mdate();
+            vlc_tick_t check = WorkersCheck(now);
+            if (check <= now)
+                continue;
+
+            wheel.deadline = __MIN(WheelDeadline(), check);
+            if (wheel.deadline == INT64_MAX)
+                vlc_cond_wait(&wheel.wait, &wheel.lock);
+            else
+                vlc_cond_timedwait(&wheel.wait, &wheel.lock, wheel.deadline);
+            wheel.deadline = INT64_MIN; /* awake */
+            continue;
+        }
 
+        if (timer->interval != 0)
+        {
             if (now > timer->value)
             {   /* Update overrun counter */
                 unsigned misses = (now - timer->value) / timer->interval;
@@ -78,32 +466,16 @@ noreturn static void *vlc_timer_thread (void *data)
                 atomic_fetch_add_explicit(&timer->overruns, misses,
                                           memory_order_relaxed);
             }
-        }
-
-        vlc_tick_t value = timer->value;
-
-        if (vlc_cond_timedwait(&timer->reschedule, &timer->lock, value) == 0)
-            continue;
-
-        if (likely(timer->value <= value))
-        {
             timer->value += timer->interval; /* rearm */
-
-            if (timer->interval == 0)
-                timer->value = 0; /* disarm */
+            WheelAdd(timer);
         }
+        else
+            timer->value = 0; /* disarm */
 
-        vlc_mutex_unlock (&timer->lock);
-
-        int canc = vlc_savecancel ();
-        timer->func (timer->data);
-        vlc_restorecancel (canc);
-
-        vlc_mutex_lock (&timer->lock);
+        QueuePush(timer, now);
     }
-
-    vlc_cleanup_pop ();
-    vlc_assert_unreachable ();
+    vlc_mutex_unlock(&wheel.lock);
+    return NULL;
 }
 
 int vlc_timer_create (vlc_timer_t *id, void (*func) (void *), void *data)
@@ -112,23 +484,48 @@ int vlc_timer_create (vlc_timer_t *id, void (*func) (void *), void *data)
 
     if (unlikely(timer == NULL))
         return ENOMEM;
-    vlc_mutex_init (&timer->lock);
-    vlc_cond_init (&timer->reschedule);
     assert (func);
+    timer->next = NULL;
+    timer->pprev = NULL;
     timer->func = func;
     timer->data = data;
     timer->value = 0;
     timer->interval = 0;
     atomic_init(&timer->overruns, 0);
+    timer->queue_next = NULL;
+    timer->pending = false;
+    timer->running = false;
+    timer->rerun = false;
 
-    if (vlc_clone (&timer->thread, vlc_timer_thread, timer,
-                   VLC_THREAD_PRIORITY_INPUT))
+    vlc_mutex_lock (&setup_lock);
+    if (wheel.users == 0)
     {
-        vlc_cond_destroy (&timer->reschedule);
-        vlc_mutex_destroy (&timer->lock);
-        free (timer);
-        return ENOMEM;
+        vlc_cond_init (&wheel.wait);
+        vlc_cond_init (&wheel.work);
+        vlc_cond_init (&wheel.idle);
+        wheel.tick = mdate () / TIMER_TICK;
+        wheel.deadline = INT64_MIN;
+        wheel.queue = NULL;
+        wheel.queue_tail = &wheel.queue;
+        wheel.workers = NULL;
+        wheel.worker_count = 0;
+        wheel.idlers = 0;
+        wheel.last_spawn = 0;
+        wheel.exit = false;
+
+        if (vlc_clone (&wheel.thread, vlc_timer_thread, NULL,
+                       VLC_THREAD_PRIORITY_INPUT))
+        {
+            vlc_cond_destroy (&wheel.idle);
+            vlc_cond_destroy (&wheel.work);
+            vlc_cond_destroy (&wheel.wait);
+            vlc_mutex_unlock (&setup_lock);
+            free (timer);
+            return ENOMEM;
+        }
     }
+    wheel.users++;
+    vlc_mutex_unlock (&setup_lock);
 
     *id = timer;
     return 0;
@@ -136,10 +533,35 @@ int vlc_timer_create (vlc_timer_t *id, void (*func) (void *), void *data)
 
 void vlc_timer_destroy (vlc_timer_t timer)
 {
-    vlc_cancel (timer->thread);
-    vlc_join (timer->thread, NULL);
-    vlc_cond_destroy (&timer->reschedule);
-    vlc_mutex_destroy (&timer->lock);
+    vlc_mutex_lock (&wheel.lock);
+    if (timer->pprev != NULL)
+        WheelRemove (timer);
+    if (timer->pending)
+        QueueRemove (timer);
+    timer->rerun = false;
+    while (timer->running)
+        vlc_cond_wait (&wheel.idle, &wheel.lock);
+    vlc_mutex_unlock (&wheel.lock);
+
+    vlc_mutex_lock (&setup_lock);
+    if (--wheel.users == 0)
+    {
+        vlc_mutex_lock (&wheel.lock);
+        wheel.exit = true;
+        vlc_cond_signal (&wheel.wait);
+        vlc_cond_broadcast (&wheel.work);
+        vlc_mutex_unlock (&wheel.lock);
+
+        /* No more workers are started once the wheel thread is gone */
+        vlc_join (wheel.thread, NULL);
+        for (unsigned i = 0; i < wheel.worker_count; i++)
+            vlc_join (wheel.workers[i], NULL);
+        free (wheel.workers);
+        vlc_cond_destroy (&wheel.idle);
+        vlc_cond_destroy (&wheel.work);
+        vlc_cond_destroy (&wheel.wait);
+    }
+    vlc_mutex_unlock (&setup_lock);
     free (timer);
 }
 
@@ -152,11 +574,24 @@ void vlc_timer_schedule (vlc_timer_t timer, bool absolute,
     if (!absolute)
         value += mdate();
 
-    vlc_mutex_lock (&timer->lock);
+    vlc_mutex_lock (&wheel.lock);
+    if (timer->pprev != NULL)
+        WheelRemove (timer);
+    if (value == 0)
+    {   /* Also drop an expiry whose callback did not start yet */
+        if (timer->pending)
+            QueueRemove (timer);
+        timer->rerun = false;
+    }
     timer->value = value;
     timer->interval = interval;
-    vlc_cond_signal (&timer->reschedule);
-    vlc_mutex_unlock (&timer->lock);
+    if (value != 0)
+    {
+        WheelAdd (timer);
+        if (value < wheel.deadline)
+            vlc_cond_signal (&wheel.wait);
+    }
+    vlc_mutex_unlock (&wheel.lock);
 }
 
 unsigned vlc_timer_getoverrun (vlc_timer_t timer)
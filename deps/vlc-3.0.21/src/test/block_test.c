@@ -30,6 +30,8 @@
 #include <vlc_common.h>
 #include <vlc_block.h>
 
+#define BENCH_ITERATIONS 200000
+
 static const char text[] =
     "This is a test!\n"
     "This file can be deleted safely!\n";
@@ -86,11 +88,124 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+static void test_block_Recycle (void)
+{
+    block_alloc_stats_t before, after;
+
+    block_GetAllocStats (&before);
+    for (unsigned i = 0; i < 100; i++)
+    {
+        block_t *block = block_Alloc (188);
+        assert (block != NULL);
+        assert (block->i_buffer == 188);
+        assert (((uintptr_t)block->p_buffer % 32) == 0);
+        memset (block->p_buffer, 0x47, block->i_buffer);
+        block_Release (block);
+    }
+    block_GetAllocStats (&after);
+    assert (after.hits + after.misses - before.hits - before.misses == 100);
+    assert (after.misses - before.misses <= 1);
+
+    block_t *block = block_Alloc (1 << 20);
+    assert (block != NULL);
+    block_Release (block);
+    block_GetAllocStats (&before);
+    assert (before.oversized == after.oversized + 1);
+}
+
+static void test_block_Trim (void)
+{
+    block_alloc_stats_t before, after;
+    block_t *blocks[64];
+
+    /* Release more large blocks than the caches can keep */
+    for (unsigned i = 0; i < ARRAY_SIZE(blocks); i++)
+    {
+        blocks[i] = block_Alloc (65536);
+        assert (blocks[i] != NULL);
+    }
+    for (unsigned i = 0; i < ARRAY_SIZE(blocks); i++)
+        block_Release (blocks[i]);
+
+    block_GetAllocStats (&before);
+    assert (before.cached > 0);
+    assert (before.cached <= (1 << 20));
+
+    block_Trim ();
+    block_GetAllocStats (&after);
+    assert (after.cached == 0);
+
+    /* Nothing is left to recycle */
+    block_t *block = block_Alloc (65536);
+    assert (block != NULL);
+    block_GetAllocStats (&before);
+    assert (before.misses == after.misses + 1);
+    block_Release (block);
+    block_Trim ();
+}
+
+/* Packet sizes of a typical MPEG-TS playback: single TS packets, UDP/RTP
+ * payloads and a few PES sizes. */
+static const size_t bench_sizes[] = { 188, 1316, 188, 3760, 188, 12000 };
+
+static void bench (const char *name, bool use_malloc)
+{
+    block_t *pending[8] = { NULL };
+    mtime_t start = mdate ();
+
+    for (unsigned i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        size_t size = bench_sizes[i % ARRAY_SIZE(bench_sizes)];
+        unsigned slot = i % ARRAY_SIZE(pending);
+
+        if (use_malloc)
+        {
+            free (pending[slot]);
+            pending[slot] = malloc (sizeof (block_t) + 96 + size);
+            assert (pending[slot] != NULL);
+        }
+        else
+        {
+            if (pending[slot] != NULL)
+                block_Release (pending[slot]);
+            pending[slot] = block_Alloc (size);
+            assert (pending[slot] != NULL);
+        }
+        /* Touch the buffer like a demuxer would. */
+        ((volatile unsigned char *)pending[slot])[sizeof (block_t)] = 0x47;
+    }
+
+    for (unsigned i = 0; i < ARRAY_SIZE(pending); i++)
+    {
+        if (use_malloc)
+            free (pending[i]);
+        else if (pending[i] != NULL)
+            block_Release (pending[i]);
+    }
+
+    mtime_t duration = mdate () - start;
+
+    printf ("%s: %u ops in %"PRId64" us (%.0f ops/s)\n", name,
+            BENCH_ITERATIONS, duration,
+            (double)BENCH_ITERATIONS * CLOCK_FREQ
+                / (duration > 0 ? duration : 1));
+}
+
 int main (void)
 {
     test_block_File(false);
     test_block_File(true);
     test_block ();
+    test_block_Recycle ();
+    test_block_Trim ();
+
+    bench ("malloc", true);
+    bench ("block_Alloc", false);
+
+    block_alloc_stats_t stats;
+    block_GetAllocStats (&stats);
+    printf ("block_Alloc: %llu hits, %llu misses, %llu oversized\n",
+            stats.hits, stats.misses, stats.oversized);
     return 0;
 }
 
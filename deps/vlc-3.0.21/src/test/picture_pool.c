@@ -23,14 +23,18 @@
 #endif
 
 #include <stdbool.h>
+#include <stdio.h>
 #undef NDEBUG
 #include <assert.h>
 
 #include <vlc_common.h>
 #include <vlc_es.h>
 #include <vlc_picture_pool.h>
+#include <vlc_picture_fifo.h>
 
 #define PICTURES 10
+#define BENCH_THREADS 16
+#define BENCH_ITERATIONS 20000
 
 static video_format_t fmt;
 static picture_pool_t *pool, *reserve;
@@ -106,6 +110,75 @@ static void test(bool zombie)
             picture_Release(pics[i]);
 }
 
+struct bench
+{
+    picture_pool_t *pool;
+    picture_fifo_t *fifo;
+};
+
+/* Each thread repeatedly gets and releases a picture on its own. */
+static void *bench_get(void *data)
+{
+    struct bench *b = data;
+
+    for (unsigned i = 0; i < BENCH_ITERATIONS; i++) {
+        picture_t *pic = picture_pool_Get(b->pool);
+        assert(pic != NULL);
+        picture_Release(pic);
+    }
+    return NULL;
+}
+
+/* Each thread waits for a picture and hands it over to whichever thread
+ * pops it from the FIFO next, so pictures are mostly released by another
+ * thread than the one that got them. The pool is smaller than the number
+ * of threads, so the blocking path is exercised too. */
+static void *bench_wait(void *data)
+{
+    struct bench *b = data;
+
+    for (unsigned i = 0; i < BENCH_ITERATIONS; i++) {
+        picture_t *pic = picture_pool_Wait(b->pool);
+        assert(pic != NULL);
+        picture_fifo_Push(b->fifo, pic);
+
+        pic = picture_fifo_Pop(b->fifo);
+        assert(pic != NULL);
+        picture_Release(pic);
+    }
+    return NULL;
+}
+
+static void bench(const char *name, void *(*entry)(void *), unsigned threads)
+{
+    struct bench b;
+    vlc_thread_t th[BENCH_THREADS];
+
+    assert(threads <= BENCH_THREADS);
+    b.pool = picture_pool_NewFromFormat(&fmt, PICTURES);
+    assert(b.pool != NULL);
+    b.fifo = picture_fifo_New();
+    assert(b.fifo != NULL);
+
+    mtime_t start = mdate();
+
+    for (unsigned i = 0; i < threads; i++)
+        if (vlc_clone(&th[i], entry, &b, VLC_THREAD_PRIORITY_LOW))
+            abort();
+    for (unsigned i = 0; i < threads; i++)
+        vlc_join(th[i], NULL);
+
+    mtime_t duration = mdate() - start;
+    unsigned long long ops = 2ULL * threads * BENCH_ITERATIONS;
+
+    printf("%s: %2u threads, %llu ops in %"PRId64" us (%.0f ops/s)\n",
+           name, threads, ops, duration,
+           (double)ops * CLOCK_FREQ / (duration > 0 ? duration : 1));
+
+    picture_fifo_Delete(b.fifo);
+    picture_pool_Release(b.pool);
+}
+
 int main(void)
 {
     video_format_Setup(&fmt, VLC_CODEC_I420, 320, 200, 320, 200, 1, 1);
@@ -123,5 +196,10 @@ int main(void)
     test(false);
     test(true);
 
+    for (unsigned n = 1; n <= PICTURES; n *= 2)
+        bench("get", bench_get, n);
+    for (unsigned n = 1; n <= BENCH_THREADS; n *= 2)
+        bench("wait", bench_wait, n);
+
     return 0;
 }
@@ -0,0 +1,104 @@
+/*****************************************************************************
+ * slices.c: Test for the slice threading of the video filters
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_filter.h>
+
+#define MAX_LINES 2200
+
+struct job
+{
+    unsigned      lines;
+    unsigned      align;
+    unsigned      count;
+    atomic_uint   hits[MAX_LINES];
+    atomic_uint   slices[64];
+};
+
+static void Slice(void *opaque, unsigned slice, unsigned first, unsigned lines)
+{
+    struct job *job = opaque;
+
+    assert(slice < job->count);
+    assert(lines > 0);
+    assert(first + lines <= job->lines);
+    /* Only the last slice may end on a misaligned line */
+    assert(first % job->align == 0);
+    assert(lines % job->align == 0 || first + lines == job->lines);
+
+    atomic_fetch_add(&job->slices[slice], 1);
+    for (unsigned i = first; i < first + lines; i++)
+        atomic_fetch_add(&job->hits[i], 1);
+}
+
+static void test_slices(unsigned count, unsigned lines, unsigned align)
+{
+    static struct job job;
+    vlc_slices_t *slices = vlc_slices_New(count);
+
+    assert(slices != NULL);
+    job.count = vlc_slices_Count(slices);
+    assert(job.count >= 1 && job.count <= count);
+    job.lines = lines;
+    job.align = align;
+
+    for (int run = 0; run < 3; run++)
+    {
+        for (unsigned i = 0; i < MAX_LINES; i++)
+            atomic_init(&job.hits[i], 0);
+        for (unsigned i = 0; i < 64; i++)
+            atomic_init(&job.slices[i], 0);
+
+        vlc_slices_Run(slices, lines, align, Slice, &job);
+
+        /* Each line is processed exactly once, by at most one call per slice */
+        for (unsigned i = 0; i < lines; i++)
+            assert(atomic_load(&job.hits[i]) == 1);
+        for (unsigned i = lines; i < MAX_LINES; i++)
+            assert(atomic_load(&job.hits[i]) == 0);
+        for (unsigned i = 0; i < 64; i++)
+            assert(atomic_load(&job.slices[i]) <= 1);
+    }
+
+    vlc_slices_Delete(slices);
+}
+
+int main (void)
+{
+    static const unsigned counts[] = { 1, 2, 3, 4, 7, 8, 16, 64 };
+    static const unsigned lines[] = { 0, 1, 2, 5, 16, 17, 480, 1080, 2160 };
+    static const unsigned aligns[] = { 1, 2, 4, 16 };
+
+    for (size_t i = 0; i < ARRAY_SIZE(counts); i++)
+        for (size_t j = 0; j < ARRAY_SIZE(lines); j++)
+            for (size_t k = 0; k < ARRAY_SIZE(aligns); k++)
+                test_slices(counts[i], lines[j], aligns[k]);
+    return 0;
+}
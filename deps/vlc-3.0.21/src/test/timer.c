@@ -24,6 +24,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #undef NDEBUG
 #include <assert.h>
 
@@ -48,6 +49,228 @@ static void callback (void *ptr)
     vlc_mutex_unlock (&data->lock);
 }
 
+/* Many concurrent timers, to check the scheduling jitter */
+#define TIMERS 4000
+
+struct many_timer
+{
+    vlc_timer_t timer;
+    vlc_tick_t  deadline;
+    unsigned    count;
+    struct many_data *many;
+};
+
+struct many_data
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    unsigned    fired;
+    vlc_tick_t  late[TIMERS];
+    struct many_timer timers[TIMERS];
+};
+
+static void many_callback (void *ptr)
+{
+    struct many_timer *t = ptr;
+    struct many_data *many = t->many;
+    vlc_tick_t late = mdate () - t->deadline;
+
+    assert (late >= 0); /* never early */
+    vlc_mutex_lock (&many->lock);
+    assert (t->count == 0);
+    t->count++;
+    many->late[many->fired++] = late;
+    vlc_cond_signal (&many->wait);
+    vlc_mutex_unlock (&many->lock);
+}
+
+static void interval_callback (void *ptr)
+{
+    struct many_timer *t = ptr;
+
+    vlc_mutex_lock (&t->many->lock);
+    t->count += 1 + vlc_timer_getoverrun (t->timer);
+    vlc_mutex_unlock (&t->many->lock);
+}
+
+static void never_callback (void *ptr)
+{
+    (void) ptr;
+    abort ();
+}
+
+static int cmp_tick (const void *a, const void *b)
+{
+    const vlc_tick_t *ta = a, *tb = b;
+    return (*ta > *tb) - (*ta < *tb);
+}
+
+static void test_many (struct many_data *many)
+{
+    vlc_tick_t start, sum = 0;
+    uint32_t seed = 1;
+    int val;
+
+    vlc_mutex_init (&many->lock);
+    vlc_cond_init (&many->wait);
+    many->fired = 0;
+
+    for (unsigned i = 0; i < TIMERS; i++)
+    {
+        many->timers[i].many = many;
+        many->timers[i].count = 0;
+        val = vlc_timer_create (&many->timers[i].timer, many_callback,
+                                &many->timers[i]);
+        assert (val == 0);
+    }
+
+    /* One-shot timers spread over half a second */
+    start = mdate () + CLOCK_FREQ / 20;
+    for (unsigned i = 0; i < TIMERS; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        many->timers[i].deadline = start + (seed >> 8) % (CLOCK_FREQ / 2);
+        vlc_timer_schedule (many->timers[i].timer, true,
+                            many->timers[i].deadline, 0);
+    }
+
+    vlc_mutex_lock (&many->lock);
+    while (many->fired < TIMERS)
+        vlc_cond_wait (&many->wait, &many->lock);
+    vlc_mutex_unlock (&many->lock);
+
+    for (unsigned i = 0; i < TIMERS; i++)
+        sum += many->late[i];
+    qsort (many->late, TIMERS, sizeof (many->late[0]), cmp_tick);
+    printf ("%u timers, lateness: average %"PRId64" us, median %"PRId64
+            " us, 99%% %"PRId64" us, max %"PRId64" us\n", TIMERS,
+            sum / TIMERS, many->late[TIMERS / 2],
+            many->late[TIMERS * 99 / 100], many->late[TIMERS - 1]);
+
+    for (unsigned i = 0; i < TIMERS; i++)
+        vlc_timer_destroy (many->timers[i].timer);
+
+    /* Interval timers, each one shall fire about once per period */
+    const vlc_tick_t period = CLOCK_FREQ / 50;
+
+    start = mdate ();
+    for (unsigned i = 0; i < TIMERS; i++)
+    {
+        many->timers[i].count = 0;
+        val = vlc_timer_create (&many->timers[i].timer, interval_callback,
+                                &many->timers[i]);
+        assert (val == 0);
+        vlc_timer_schedule (many->timers[i].timer, false,
+                            period + i % period, period);
+    }
+    msleep (CLOCK_FREQ / 2);
+    for (unsigned i = 0; i < TIMERS; i++)
+        vlc_timer_schedule (many->timers[i].timer, false, 0, 0);
+    const vlc_tick_t elapsed = mdate () - start;
+
+    unsigned min = UINT_MAX, max = 0;
+    vlc_mutex_lock (&many->lock);
+    for (unsigned i = 0; i < TIMERS; i++)
+    {
+        min = __MIN(min, many->timers[i].count);
+        max = __MAX(max, many->timers[i].count);
+    }
+    vlc_mutex_unlock (&many->lock);
+    printf ("%u interval timers, %u to %u iterations each\n", TIMERS,
+            min, max);
+    assert (min > 0);
+    assert (max <= elapsed / period);
+
+    /* Timers destroyed while armed never fire */
+    for (unsigned i = 0; i < TIMERS; i++)
+    {
+        vlc_timer_destroy (many->timers[i].timer);
+        val = vlc_timer_create (&many->timers[i].timer, never_callback, NULL);
+        assert (val == 0);
+        vlc_timer_schedule (many->timers[i].timer, false, CLOCK_FREQ / 10, 0);
+    }
+    for (unsigned i = 0; i < TIMERS; i++)
+        vlc_timer_destroy (many->timers[i].timer);
+
+    vlc_cond_destroy (&many->wait);
+    vlc_mutex_destroy (&many->lock);
+}
+
+/* A blocked callback does not hold the other timers back */
+struct blocking_data
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    bool        blocked, released;
+    vlc_tick_t  fired;
+};
+
+static void blocking_callback (void *ptr)
+{
+    struct blocking_data *data = ptr;
+
+    vlc_mutex_lock (&data->lock);
+    data->blocked = true;
+    vlc_cond_broadcast (&data->wait);
+    while (!data->released)
+        vlc_cond_wait (&data->wait, &data->lock);
+    vlc_mutex_unlock (&data->lock);
+}
+
+static void fired_callback (void *ptr)
+{
+    struct blocking_data *data = ptr;
+
+    vlc_mutex_lock (&data->lock);
+    data->fired = mdate ();
+    vlc_cond_broadcast (&data->wait);
+    vlc_mutex_unlock (&data->lock);
+}
+
+static void test_blocking (void)
+{
+    struct blocking_data data;
+    vlc_timer_t blocking, other;
+    int val;
+
+    vlc_mutex_init (&data.lock);
+    vlc_cond_init (&data.wait);
+    data.blocked = data.released = false;
+    data.fired = 0;
+
+    val = vlc_timer_create (&blocking, blocking_callback, &data);
+    assert (val == 0);
+    val = vlc_timer_create (&other, fired_callback, &data);
+    assert (val == 0);
+
+    vlc_timer_schedule (blocking, false, 1, 0);
+    vlc_mutex_lock (&data.lock);
+    while (!data.blocked)
+        vlc_cond_wait (&data.wait, &data.lock);
+    vlc_mutex_unlock (&data.lock);
+
+    const vlc_tick_t deadline = mdate () + CLOCK_FREQ / 10;
+    vlc_timer_schedule (other, true, deadline, 0);
+
+    vlc_mutex_lock (&data.lock);
+    while (data.fired == 0
+        && vlc_cond_timedwait (&data.wait, &data.lock,
+                               deadline + CLOCK_FREQ) == 0);
+    const vlc_tick_t late = data.fired - deadline;
+    data.released = true;
+    vlc_cond_broadcast (&data.wait);
+    vlc_mutex_unlock (&data.lock);
+
+    printf ("timer fired %"PRId64" us late while another one is blocked\n",
+            late);
+    assert (data.fired != 0);
+    assert (late >= 0 && late < CLOCK_FREQ / 20);
+
+    vlc_timer_destroy (other);
+    vlc_timer_destroy (blocking);
+    vlc_cond_destroy (&data.wait);
+    vlc_mutex_destroy (&data.lock);
+}
 
 int main (void)
 {
@@ -108,5 +331,12 @@ int main (void)
     vlc_cond_destroy (&data.wait);
     vlc_mutex_destroy (&data.lock);
 
+    test_blocking ();
+
+    struct many_data *many = malloc (sizeof (*many));
+    assert (many != NULL);
+    test_many (many);
+    free (many);
+
     return 0;
 }
@@ -1379,18 +1379,88 @@ static void SplitterManage(vout_display_t *vd)
         vout_ManageDisplay(sys->display[i], true);
 }
 
+static picture_t *SplitterPictureGet(vout_display_t *vd)
+{
+    if (vout_IsDisplayFiltered(vd)) {
+        /* TODO use a pool ? */
+        return picture_NewFromFormat(&vd->source);
+    } else {
+        picture_pool_t *pool = vout_display_Pool(vd, 3);
+        return pool ? picture_pool_Get(pool) : NULL;
+    }
+}
+
 static int SplitterPictureNew(video_splitter_t *splitter, picture_t *picture[])
 {
     vout_display_sys_t *wsys = splitter->p_owner->wrapper->sys;
 
     for (int i = 0; i < wsys->count; i++) {
-        if (vout_IsDisplayFiltered(wsys->display[i])) {
-            /* TODO use a pool ? */
-            picture[i] = picture_NewFromFormat(&wsys->display[i]->source);
-        } else {
-            picture_pool_t *pool = vout_display_Pool(wsys->display[i], 3);
-            picture[i] = pool ? picture_pool_Get(pool) : NULL;
+        picture[i] = SplitterPictureGet(wsys->display[i]);
+        if (!picture[i]) {
+            for (int j = 0; j < i; j++)
+                picture_Release(picture[j]);
+            return VLC_EGENERIC;
         }
+    }
+    return VLC_SUCCESS;
+}
+
+/* Returns a read-only picture sharing the pixels of src at the position of
+ * the output, and holding a reference to src. */
+static picture_t *SplitterPictureRef(picture_t *src,
+                                     const video_splitter_output_t *output)
+{
+    const video_format_t *fmt = &output->fmt;
+    const vlc_chroma_description_t *dsc =
+        vlc_fourcc_GetChromaDescription(src->format.i_chroma);
+
+    if (dsc == NULL || dsc->plane_count != (unsigned)src->i_planes
+     || fmt->i_chroma != src->format.i_chroma
+     || output->source.i_x < 0 || output->source.i_y < 0
+     || output->source.i_x + fmt->i_width > src->format.i_width
+     || output->source.i_y + fmt->i_height > src->format.i_height)
+        return NULL;
+
+    picture_t *picture = picture_Clone(src);
+    if (picture == NULL)
+        return NULL;
+
+    for (int i = 0; i < picture->i_planes; i++) {
+        plane_t *p = &picture->p[i];
+        const unsigned x = output->source.i_x / dsc->p[i].w.den * dsc->p[i].w.num;
+        const unsigned y = output->source.i_y / dsc->p[i].h.den * dsc->p[i].h.num;
+
+        p->p_pixels += y * p->i_pitch + x * p->i_pixel_pitch;
+        p->i_lines -= y;
+        p->i_visible_lines = (fmt->i_visible_height + (dsc->p[i].h.den - 1))
+                           / dsc->p[i].h.den * dsc->p[i].h.num;
+        p->i_visible_pitch = (fmt->i_visible_width + (dsc->p[i].w.den - 1))
+                           / dsc->p[i].w.den * dsc->p[i].w.num * dsc->pixel_size;
+    }
+    picture->format.i_width = fmt->i_width;
+    picture->format.i_height = fmt->i_height;
+    picture->format.i_visible_width = fmt->i_visible_width;
+    picture->format.i_visible_height = fmt->i_visible_height;
+    picture->format.i_x_offset = fmt->i_x_offset;
+    picture->format.i_y_offset = fmt->i_y_offset;
+    return picture;
+}
+
+static int SplitterPictureShare(video_splitter_t *splitter, picture_t *picture[],
+                                bool shared[], picture_t *src)
+{
+    vout_display_sys_t *wsys = splitter->p_owner->wrapper->sys;
+
+    for (int i = 0; i < wsys->count; i++) {
+        /* The display converts the picture anyway: no need for a copy */
+        if (vout_IsDisplayFiltered(wsys->display[i]))
+            picture[i] = SplitterPictureRef(src, &splitter->p_output[i]);
+        else
+            picture[i] = NULL;
+        shared[i] = picture[i] != NULL;
+
+        if (!shared[i])
+            picture[i] = SplitterPictureGet(wsys->display[i]);
         if (!picture[i]) {
             for (int j = 0; j < i; j++)
                 picture_Release(picture[j]);
@@ -1470,6 +1540,7 @@ vout_display_t *vout_NewSplitter(vout_thread_t *vout,
     splitter->p_owner = vso;
     splitter->pf_picture_new = SplitterPictureNew;
     splitter->pf_picture_del = SplitterPictureDel;
+    splitter->pf_picture_share = SplitterPictureShare;
 
     /* */
     TAB_INIT(sys->count, sys->display);
@@ -0,0 +1,153 @@
+/*****************************************************************************
+ * decoder_pool.c: benchmark many concurrent inputs with shared decoder threads
+ *****************************************************************************
+ * Copyright © 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: test_libvlc_decoder_pool [inputs] [media path]
+ *
+ * Plays the media in as many players at once, with and without
+ * --decoder-pool, and prints the number of threads, the context switches and
+ * the pictures decoded per second. */
+
+#include "test.h"
+
+#include <vlc_common.h>
+#include <vlc_threads.h>
+#include <vlc_atomic.h>
+
+#include <dirent.h>
+#include <sys/resource.h>
+
+#define BENCH_WIDTH    64
+#define BENCH_HEIGHT   64
+#define BENCH_DURATION (3 * CLOCK_FREQ)
+#define BENCH_INPUTS   16
+
+static atomic_uint frames;
+
+static void *lock_cb(void *opaque, void **planes)
+{
+    planes[0] = opaque;
+    return NULL;
+}
+
+static void display_cb(void *opaque, void *picture)
+{
+    (void) opaque; (void) picture;
+    atomic_fetch_add_explicit(&frames, 1, memory_order_relaxed);
+}
+
+static int count_threads(void)
+{
+    DIR *dir = opendir("/proc/self/task");
+    if (dir == NULL)
+        return -1;
+
+    int count = 0;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL)
+        if (ent->d_name[0] != '.')
+            count++;
+    closedir(dir);
+    return count;
+}
+
+static long count_switches(void)
+{
+    struct rusage ru;
+
+    if (getrusage(RUSAGE_SELF, &ru))
+        return -1;
+    return ru.ru_nvcsw + ru.ru_nivcsw;
+}
+
+static void bench(const char *pool_arg, const char *path, unsigned inputs)
+{
+    const char *argv[] = {
+        "--ignore-config", "--quiet", "--no-audio", "--no-spu",
+        "--image-duration=30", "--image-fps=100/1", pool_arg,
+    };
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    libvlc_media_player_t *mps[inputs];
+    uint32_t (*pixels)[BENCH_WIDTH * BENCH_HEIGHT] =
+        malloc(inputs * sizeof (*pixels));
+    assert(pixels != NULL);
+
+    int threads_before = count_threads();
+
+    for (unsigned i = 0; i < inputs; i++)
+    {
+        libvlc_media_t *media = libvlc_media_new_path(vlc, path);
+        assert(media != NULL);
+        mps[i] = libvlc_media_player_new_from_media(media);
+        assert(mps[i] != NULL);
+        libvlc_media_release(media);
+
+        libvlc_video_set_callbacks(mps[i], lock_cb, NULL, display_cb,
+                                   pixels[i]);
+        libvlc_video_set_format(mps[i], "RV32", BENCH_WIDTH, BENCH_HEIGHT,
+                                BENCH_WIDTH * 4);
+    }
+
+    long switches = count_switches();
+    atomic_store(&frames, 0);
+    mtime_t start = mdate();
+
+    for (unsigned i = 0; i < inputs; i++)
+        libvlc_media_player_play(mps[i]);
+
+    /* Sample the threads once all the inputs are running */
+    msleep(BENCH_DURATION / 2);
+    int threads = count_threads();
+    msleep(BENCH_DURATION / 2);
+
+    unsigned decoded = atomic_load(&frames);
+    mtime_t elapsed = mdate() - start;
+    switches = count_switches() - switches;
+
+    for (unsigned i = 0; i < inputs; i++)
+    {
+        libvlc_media_player_stop(mps[i]);
+        libvlc_media_player_release(mps[i]);
+    }
+    free(pixels);
+    libvlc_release(vlc);
+
+    printf("%-18s %u inputs: %d threads (%d before), %ld context switches, "
+           "%.1f pictures/s\n", pool_arg, inputs, threads, threads_before,
+           switches, decoded * (double)CLOCK_FREQ / elapsed);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned inputs = argc > 1 ? strtoul(argv[1], NULL, 0) : BENCH_INPUTS;
+    const char *path = argc > 2 ? argv[2] : test_default_video;
+
+    test_init();
+    alarm(0);
+
+    if (inputs == 0)
+        inputs = 1;
+
+    bench("--no-decoder-pool", path, inputs);
+    bench("--decoder-pool", path, inputs);
+    return 0;
+}
@@ -0,0 +1,220 @@
+/*****************************************************************************
+ * fanout.c: test the display of a single decoded video on several outputs
+ *****************************************************************************
+ * Copyright © 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "test.h"
+
+#include <vlc_common.h>
+#include <vlc_threads.h>
+
+#include <unistd.h>
+
+#define FANOUT_FRAMES  10
+#define FANOUT_WIDTH   48
+#define FANOUT_HEIGHT  32
+#define FANOUT_OUTPUTS 3
+#define FANOUT_CROP    16 /* see --clone-crop */
+
+struct fanout_output
+{
+    unsigned  width;
+    unsigned  height;
+    unsigned  frames;
+    uint32_t *pixels;
+};
+
+struct fanout_ctx
+{
+    vlc_mutex_t          lock;
+    unsigned             count;
+    struct fanout_output outputs[FANOUT_OUTPUTS];
+    vlc_sem_t            end;
+};
+
+static struct fanout_ctx ctx;
+
+/* Each vmem output gets its own opaque pointer from the setup callback */
+static unsigned setup_cb(void **opaque, char *chroma, unsigned *width,
+                         unsigned *height, unsigned *pitches, unsigned *lines)
+{
+    struct fanout_output *out;
+
+    assert(*opaque == &ctx);
+
+    vlc_mutex_lock(&ctx.lock);
+    assert(ctx.count < FANOUT_OUTPUTS);
+    out = &ctx.outputs[ctx.count++];
+    vlc_mutex_unlock(&ctx.lock);
+
+    /* Converted by each output: the splitter does not copy the pictures */
+    memcpy(chroma, "RV32", 4);
+    out->width = *width;
+    out->height = *height;
+    out->frames = 0;
+    out->pixels = malloc(*width * *height * 4);
+    assert(out->pixels != NULL);
+
+    pitches[0] = *width * 4;
+    lines[0] = *height;
+    *opaque = out;
+    return 1;
+}
+
+static void cleanup_cb(void *opaque)
+{
+    struct fanout_output *out = opaque;
+
+    free(out->pixels);
+    out->pixels = NULL;
+}
+
+static void *lock_cb(void *opaque, void **planes)
+{
+    struct fanout_output *out = opaque;
+
+    planes[0] = out->pixels;
+    return NULL;
+}
+
+static void display_cb(void *opaque, void *picture)
+{
+    struct fanout_output *out = opaque;
+
+    (void) picture;
+    out->frames++;
+}
+
+static void end_reached(const libvlc_event_t *ev, void *opaque)
+{
+    (void) ev; (void) opaque;
+    vlc_sem_post(&ctx.end);
+}
+
+/* The image samples are too small to crop: write a raw video instead */
+static void write_video(int fd)
+{
+    char header[64];
+    int len = snprintf(header, sizeof (header),
+                       "YUV4MPEG2 W%d H%d F25:1 Ip A1:1 C420jpeg\n",
+                       FANOUT_WIDTH, FANOUT_HEIGHT);
+    assert(len > 0 && (size_t)len < sizeof (header));
+    assert(write(fd, header, len) == len);
+
+    uint8_t frame[FANOUT_WIDTH * FANOUT_HEIGHT * 3 / 2];
+    for (unsigned i = 0; i < FANOUT_FRAMES; i++)
+    {
+        for (size_t j = 0; j < sizeof (frame); j++)
+            frame[j] = i * 16 + j;
+        assert(write(fd, "FRAME\n", 6) == 6);
+        assert(write(fd, frame, sizeof (frame)) == sizeof (frame));
+    }
+}
+
+static void test_fanout(const char **argv, int argc, const char *path,
+                        bool crop)
+{
+    log("Testing fan-out to %d outputs%s\n", FANOUT_OUTPUTS,
+        crop ? " with a cropped output" : "");
+
+    vlc_mutex_init(&ctx.lock);
+    vlc_sem_init(&ctx.end, 0);
+    ctx.count = 0;
+
+    libvlc_instance_t *vlc = libvlc_new(argc, argv);
+    assert(vlc != NULL);
+
+    libvlc_media_t *media = libvlc_media_new_path(vlc, path);
+    assert(media != NULL);
+
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media(media);
+    assert(mp != NULL);
+    libvlc_media_release(media);
+
+    libvlc_video_set_callbacks(mp, lock_cb, NULL, display_cb, &ctx);
+    libvlc_video_set_format_callbacks(mp, setup_cb, cleanup_cb);
+
+    libvlc_event_manager_t *em = libvlc_media_player_event_manager(mp);
+    int ret = libvlc_event_attach(em, libvlc_MediaPlayerEndReached,
+                                  end_reached, NULL);
+    assert(ret == 0);
+
+    ret = libvlc_media_player_play(mp);
+    assert(ret == 0);
+
+    vlc_sem_wait(&ctx.end);
+    libvlc_media_player_stop(mp);
+
+    /* A single decoder feeds every output with every picture */
+    assert(ctx.count == FANOUT_OUTPUTS);
+    for (unsigned i = 0; i < ctx.count; i++)
+    {
+        const struct fanout_output *out = &ctx.outputs[i];
+
+        log("output %u: %ux%u, %u frames displayed\n", i, out->width,
+            out->height, out->frames);
+        assert(out->frames == FANOUT_FRAMES);
+    }
+
+    if (crop)
+    {
+        unsigned cropped = 0;
+        for (unsigned i = 0; i < ctx.count; i++)
+            if (ctx.outputs[i].width == FANOUT_CROP
+             && ctx.outputs[i].height == FANOUT_CROP)
+                cropped++;
+        assert(cropped == 1);
+    }
+
+    libvlc_event_detach(em, libvlc_MediaPlayerEndReached, end_reached, NULL);
+    libvlc_media_player_release(mp);
+    libvlc_release(vlc);
+
+    for (unsigned i = 0; i < ctx.count; i++)
+        assert(ctx.outputs[i].pixels == NULL);
+
+    vlc_sem_destroy(&ctx.end);
+    vlc_mutex_destroy(&ctx.lock);
+}
+
+int main(void)
+{
+    test_init();
+
+    char path[] = "/tmp/vlc-test-fanout-XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd != -1);
+    write_video(fd);
+    close(fd);
+
+    const char *argv[] = {
+        "-v", "--ignore-config", "--no-audio", "--no-spu", "--rawvid-fps=25",
+        "--video-splitter=clone", "--clone-count=3",
+    };
+    test_fanout(argv, ARRAY_SIZE(argv), path, false);
+
+    const char *argv_crop[] = {
+        "-v", "--ignore-config", "--no-audio", "--no-spu", "--rawvid-fps=25",
+        "--video-splitter=clone", "--clone-count=3",
+        "--clone-crop=,16x16+8+8,",
+    };
+    test_fanout(argv_crop, ARRAY_SIZE(argv_crop), path, true);
+
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,128 @@
+/*****************************************************************************
+ * loop.c: test gapless repetitions of an input
+ *****************************************************************************
+ * Copyright © 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "test.h"
+
+#include <vlc_common.h>
+#include <vlc_threads.h>
+
+#define LOOP_WIDTH  32
+#define LOOP_HEIGHT 32
+#define LOOP_FPS    25
+#define LOOP_FRAMES 10 /* per pass, see --image-duration */
+#define LOOP_REPEAT 2
+
+struct loop_ctx
+{
+    uint32_t  pixels[LOOP_WIDTH * LOOP_HEIGHT];
+    unsigned  frames;
+    int64_t   last;
+    int64_t   max_gap;
+    vlc_sem_t end;
+};
+
+static void *lock_cb(void *opaque, void **planes)
+{
+    struct loop_ctx *ctx = opaque;
+
+    planes[0] = ctx->pixels;
+    return NULL;
+}
+
+static void display_cb(void *opaque, void *picture)
+{
+    struct loop_ctx *ctx = opaque;
+    int64_t now = libvlc_clock();
+
+    (void) picture;
+    if (ctx->frames > 0 && now - ctx->last > ctx->max_gap)
+        ctx->max_gap = now - ctx->last;
+    ctx->last = now;
+    ctx->frames++;
+}
+
+static void end_reached(const libvlc_event_t *ev, void *opaque)
+{
+    struct loop_ctx *ctx = opaque;
+
+    (void) ev;
+    vlc_sem_post(&ctx->end);
+}
+
+static void test_gapless_loop(const char **argv, int argc)
+{
+    struct loop_ctx ctx = { .frames = 0, .max_gap = 0 };
+
+    log("Testing gapless loop\n");
+
+    vlc_sem_init(&ctx.end, 0);
+
+    libvlc_instance_t *vlc = libvlc_new(argc, argv);
+    assert(vlc != NULL);
+
+    libvlc_media_t *media = libvlc_media_new_path(vlc, test_default_video);
+    assert(media != NULL);
+
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media(media);
+    assert(mp != NULL);
+    libvlc_media_release(media);
+
+    libvlc_video_set_callbacks(mp, lock_cb, NULL, display_cb, &ctx);
+    libvlc_video_set_format(mp, "RV32", LOOP_WIDTH, LOOP_HEIGHT,
+                            LOOP_WIDTH * 4);
+
+    libvlc_event_manager_t *em = libvlc_media_player_event_manager(mp);
+    int ret = libvlc_event_attach(em, libvlc_MediaPlayerEndReached,
+                                  end_reached, &ctx);
+    assert(ret == 0);
+
+    ret = libvlc_media_player_play(mp);
+    assert(ret == 0);
+
+    vlc_sem_wait(&ctx.end);
+    libvlc_media_player_stop(mp);
+
+    log("%u frames displayed, longest gap %"PRId64" us\n", ctx.frames,
+        ctx.max_gap);
+
+    /* No picture may be dropped nor repeated at the loop points */
+    assert(ctx.frames == LOOP_FRAMES * (LOOP_REPEAT + 1));
+    /* and the output must not stall while the input is rewound */
+    assert(ctx.max_gap < 3 * CLOCK_FREQ / LOOP_FPS);
+
+    libvlc_event_detach(em, libvlc_MediaPlayerEndReached, end_reached, &ctx);
+    libvlc_media_player_release(mp);
+    libvlc_release(vlc);
+    vlc_sem_destroy(&ctx.end);
+}
+
+int main(void)
+{
+    test_init();
+
+    const char *argv[] = {
+        "-v", "--ignore-config", "--no-audio", "--no-spu",
+        "--image-duration=0.4", "--image-fps=25/1",
+        "--input-repeat=2", "--input-gapless-loop",
+    };
+    test_gapless_loop(argv, ARRAY_SIZE(argv));
+
+    return 0;
+}
@@ -0,0 +1,187 @@
+/*****************************************************************************
+ * preparser.c: benchmark the preparsing of a media library
+ *****************************************************************************
+ * Copyright © 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: test_libvlc_preparser [items]
+ *
+ * Generates a directory of small WAV files, preparses all of them with
+ * 1 to 8 --preparse-threads, and prints the items preparsed per second. */
+
+#include "test.h"
+
+#include <vlc_common.h>
+#include <vlc_threads.h>
+
+#define BENCH_ITEMS 256
+
+static const unsigned thread_counts[] = { 1, 2, 4, 8 };
+
+struct bench
+{
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+    unsigned parsed;
+};
+
+static void parsed_cb(const libvlc_event_t *event, void *data)
+{
+    struct bench *bench = data;
+    (void) event;
+
+    vlc_mutex_lock(&bench->lock);
+    bench->parsed++;
+    vlc_cond_signal(&bench->wait);
+    vlc_mutex_unlock(&bench->lock);
+}
+
+static void put_le(FILE *file, uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        fputc(value >> (8 * i), file);
+}
+
+/* 1 second of 8 kHz 8-bit mono silence */
+static void write_wav(const char *path)
+{
+    const uint32_t rate = 8000;
+    FILE *file = fopen(path, "wb");
+    assert(file != NULL);
+
+    fputs("RIFF", file);
+    put_le(file, 36 + rate, 4);
+    fputs("WAVEfmt ", file);
+    put_le(file, 16, 4);
+    put_le(file, 1, 2); /* PCM */
+    put_le(file, 1, 2); /* channels */
+    put_le(file, rate, 4);
+    put_le(file, rate, 4); /* bytes per second */
+    put_le(file, 1, 2); /* block align */
+    put_le(file, 8, 2); /* bits per sample */
+    fputs("data", file);
+    put_le(file, rate, 4);
+    for (uint32_t i = 0; i < rate; i++)
+        fputc(0x80, file);
+
+    assert(!ferror(file));
+    fclose(file);
+}
+
+static void bench(const char *dir, unsigned items, unsigned threads)
+{
+    char arg[32];
+    snprintf(arg, sizeof (arg), "--preparse-threads=%u", threads);
+
+    const char *argv[] = {
+        "--ignore-config", "--quiet", "--no-metadata-network-access", arg,
+    };
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    struct bench bench;
+    vlc_mutex_init(&bench.lock);
+    vlc_cond_init(&bench.wait);
+    bench.parsed = 0;
+
+    libvlc_media_t **medias = malloc(items * sizeof (*medias));
+    assert(medias != NULL);
+
+    for (unsigned i = 0; i < items; i++)
+    {
+        char path[256];
+        snprintf(path, sizeof (path), "%s/%05u.wav", dir, i);
+
+        medias[i] = libvlc_media_new_path(vlc, path);
+        assert(medias[i] != NULL);
+        libvlc_event_attach(libvlc_media_event_manager(medias[i]),
+                            libvlc_MediaParsedChanged, parsed_cb, &bench);
+    }
+
+    mtime_t start = mdate();
+
+    for (unsigned i = 0; i < items; i++)
+    {
+        int ret = libvlc_media_parse_with_options(medias[i],
+                                                  libvlc_media_parse_local,
+                                                  -1);
+        assert(ret == 0);
+    }
+
+    vlc_mutex_lock(&bench.lock);
+    while (bench.parsed < items)
+        vlc_cond_wait(&bench.wait, &bench.lock);
+    vlc_mutex_unlock(&bench.lock);
+
+    mtime_t elapsed = mdate() - start;
+    unsigned done = 0;
+
+    for (unsigned i = 0; i < items; i++)
+    {
+        if (libvlc_media_get_parsed_status(medias[i])
+             == libvlc_media_parsed_status_done)
+            done++;
+        libvlc_event_detach(libvlc_media_event_manager(medias[i]),
+                            libvlc_MediaParsedChanged, parsed_cb, &bench);
+        libvlc_media_release(medias[i]);
+    }
+    free(medias);
+    libvlc_release(vlc);
+    vlc_cond_destroy(&bench.wait);
+    vlc_mutex_destroy(&bench.lock);
+
+    printf("%u preparse threads: %u/%u items in %.2f s, %.1f items/s\n",
+           threads, done, items, (double)elapsed / CLOCK_FREQ,
+           items * (double)CLOCK_FREQ / elapsed);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned items = argc > 1 ? strtoul(argv[1], NULL, 0) : BENCH_ITEMS;
+    char dir[] = "/tmp/vlc-preparser-XXXXXX";
+    char path[sizeof (dir) + 16];
+
+    test_init();
+    alarm(0);
+
+    if (items == 0)
+        items = 1;
+
+    if (mkdtemp(dir) == NULL)
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    for (unsigned i = 0; i < items; i++)
+    {
+        snprintf(path, sizeof (path), "%s/%05u.wav", dir, i);
+        write_wav(path);
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(thread_counts); i++)
+        bench(dir, items, thread_counts[i]);
+
+    for (unsigned i = 0; i < items; i++)
+    {
+        snprintf(path, sizeof (path), "%s/%05u.wav", dir, i);
+        unlink(path);
+    }
+    rmdir(dir);
+    return 0;
+}
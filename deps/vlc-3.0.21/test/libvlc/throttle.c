@@ -0,0 +1,171 @@
+/*****************************************************************************
+ * throttle.c: test the video decoding throttle
+ *****************************************************************************
+ * Copyright © 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "test.h"
+
+#include <vlc_common.h>
+#include <vlc_threads.h>
+
+#include <unistd.h>
+
+#define THROTTLE_WIDTH  32
+#define THROTTLE_HEIGHT 32
+#define THROTTLE_FRAMES 50 /* 2 seconds at 25 fps */
+
+struct throttle_ctx
+{
+    uint32_t  pixels[THROTTLE_WIDTH * THROTTLE_HEIGHT];
+    uint32_t  last;
+    unsigned  frames;
+    vlc_sem_t end;
+};
+
+static void *lock_cb(void *opaque, void **planes)
+{
+    struct throttle_ctx *ctx = opaque;
+
+    planes[0] = ctx->pixels;
+    return NULL;
+}
+
+static void display_cb(void *opaque, void *picture)
+{
+    struct throttle_ctx *ctx = opaque;
+
+    (void) picture;
+    /* Each frame has its own color: do not count the refreshes of the
+     * video output */
+    if (ctx->pixels[0] != ctx->last)
+        ctx->frames++;
+    ctx->last = ctx->pixels[0];
+}
+
+static void end_reached(const libvlc_event_t *ev, void *opaque)
+{
+    struct throttle_ctx *ctx = opaque;
+
+    (void) ev;
+    vlc_sem_post(&ctx->end);
+}
+
+static void write_video(int fd)
+{
+    char header[64];
+    int len = snprintf(header, sizeof (header),
+                       "YUV4MPEG2 W%d H%d F25:1 Ip A1:1 C420jpeg\n",
+                       THROTTLE_WIDTH, THROTTLE_HEIGHT);
+    assert(len > 0 && (size_t)len < sizeof (header));
+    assert(write(fd, header, len) == len);
+
+    uint8_t frame[THROTTLE_WIDTH * THROTTLE_HEIGHT * 3 / 2];
+    for (unsigned i = 0; i < THROTTLE_FRAMES; i++)
+    {
+        /* A distinct gray level per frame */
+        memset(frame, 16 + i * 4, THROTTLE_WIDTH * THROTTLE_HEIGHT);
+        memset(frame + THROTTLE_WIDTH * THROTTLE_HEIGHT, 128,
+               THROTTLE_WIDTH * THROTTLE_HEIGHT / 2);
+        assert(write(fd, "FRAME\n", 6) == 6);
+        assert(write(fd, frame, sizeof (frame)) == sizeof (frame));
+    }
+}
+
+static unsigned test_throttle_play(libvlc_instance_t *vlc, const char *path,
+                                   libvlc_video_throttle_t throttle)
+{
+    struct throttle_ctx ctx = { .last = UINT32_MAX, .frames = 0 };
+
+    vlc_sem_init(&ctx.end, 0);
+
+    libvlc_media_t *media = libvlc_media_new_path(vlc, path);
+    assert(media != NULL);
+
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media(media);
+    assert(mp != NULL);
+    libvlc_media_release(media);
+
+    libvlc_video_set_callbacks(mp, lock_cb, NULL, display_cb, &ctx);
+    libvlc_video_set_format(mp, "RV32", THROTTLE_WIDTH, THROTTLE_HEIGHT,
+                            THROTTLE_WIDTH * 4);
+
+    assert(libvlc_video_get_throttle(mp) == libvlc_video_throttle_none);
+    int ret = libvlc_video_set_throttle(mp, throttle);
+    assert(ret == 0);
+    assert(libvlc_video_get_throttle(mp) == throttle);
+    ret = libvlc_video_set_throttle(mp, (libvlc_video_throttle_t) 42);
+    assert(ret == -1);
+    assert(libvlc_video_get_throttle(mp) == throttle);
+
+    libvlc_event_manager_t *em = libvlc_media_player_event_manager(mp);
+    ret = libvlc_event_attach(em, libvlc_MediaPlayerEndReached,
+                              end_reached, &ctx);
+    assert(ret == 0);
+
+    ret = libvlc_media_player_play(mp);
+    assert(ret == 0);
+
+    vlc_sem_wait(&ctx.end);
+    libvlc_media_player_stop(mp);
+
+    libvlc_event_detach(em, libvlc_MediaPlayerEndReached, end_reached, &ctx);
+    libvlc_media_player_release(mp);
+    vlc_sem_destroy(&ctx.end);
+
+    log("throttle %d: %u frames displayed\n", throttle, ctx.frames);
+    return ctx.frames;
+}
+
+static void test_throttle(const char **argv, int argc, const char *path)
+{
+    log("Testing video throttle\n");
+
+    libvlc_instance_t *vlc = libvlc_new(argc, argv);
+    assert(vlc != NULL);
+
+    unsigned frames = test_throttle_play(vlc, path, libvlc_video_throttle_none);
+    assert(frames == THROTTLE_FRAMES);
+
+    /* At most one picture per second */
+    frames = test_throttle_play(vlc, path, libvlc_video_throttle_keyframes);
+    assert(frames >= 1 && frames <= 3);
+
+    frames = test_throttle_play(vlc, path, libvlc_video_throttle_hidden);
+    assert(frames == 0);
+
+    libvlc_release(vlc);
+}
+
+int main(void)
+{
+    test_init();
+
+    char path[] = "/tmp/vlc-test-throttle-XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd != -1);
+    write_video(fd);
+    close(fd);
+
+    const char *argv[] = {
+        "-v", "--ignore-config", "--no-audio", "--no-spu", "--rawvid-fps=25",
+    };
+    test_throttle(argv, ARRAY_SIZE(argv), path);
+
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,250 @@
+/*****************************************************************************
+ * thumbnailer.c: benchmark the thumbnailing of a folder of clips
+ *****************************************************************************
+ * Copyright © 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: test_libvlc_thumbnailer [directory] [seconds]
+ *
+ * Makes a 160 pixels wide RV32 thumbnail of every file of the directory at
+ * the given time, with a media player and video callbacks, then with
+ * libvlc_media_thumbnail_request() and its batch mode, and prints the
+ * thumbnails made per second. Without a directory, the sample image is
+ * thumbnailed a number of times. */
+
+#include "test.h"
+
+#include <vlc_common.h>
+#include <vlc_threads.h>
+
+#include <dirent.h>
+
+#define BENCH_WIDTH   160
+#define BENCH_HEIGHT  90
+#define BENCH_SAMPLES 32
+#define BENCH_TIMEOUT 5000 /* ms */
+
+struct frame
+{
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+    bool displayed;
+    uint32_t pixels[BENCH_WIDTH * BENCH_HEIGHT];
+};
+
+static void *lock_cb(void *opaque, void **planes)
+{
+    struct frame *frame = opaque;
+    planes[0] = frame->pixels;
+    return NULL;
+}
+
+static void display_cb(void *opaque, void *picture)
+{
+    struct frame *frame = opaque;
+    (void) picture;
+
+    vlc_mutex_lock(&frame->lock);
+    frame->displayed = true;
+    vlc_cond_signal(&frame->wait);
+    vlc_mutex_unlock(&frame->lock);
+}
+
+static unsigned thumbnail_player(libvlc_instance_t *vlc, char **paths,
+                                 unsigned count, libvlc_time_t time)
+{
+    struct frame frame;
+    unsigned done = 0;
+    char option[32];
+
+    vlc_mutex_init(&frame.lock);
+    vlc_cond_init(&frame.wait);
+    snprintf(option, sizeof (option), ":start-time=%.3f", time / 1000.);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        libvlc_media_t *media = libvlc_media_new_path(vlc, paths[i]);
+        assert(media != NULL);
+        libvlc_media_add_option(media, option);
+
+        libvlc_media_player_t *mp = libvlc_media_player_new_from_media(media);
+        assert(mp != NULL);
+        libvlc_media_release(media);
+
+        libvlc_video_set_callbacks(mp, lock_cb, NULL, display_cb, &frame);
+        libvlc_video_set_format(mp, "RV32", BENCH_WIDTH, BENCH_HEIGHT,
+                                BENCH_WIDTH * 4);
+
+        frame.displayed = false;
+        libvlc_media_player_play(mp);
+
+        mtime_t deadline = mdate() + BENCH_TIMEOUT * INT64_C(1000);
+        vlc_mutex_lock(&frame.lock);
+        while (!frame.displayed
+            && vlc_cond_timedwait(&frame.wait, &frame.lock, deadline) == 0);
+        if (frame.displayed)
+            done++;
+        vlc_mutex_unlock(&frame.lock);
+
+        libvlc_media_player_stop(mp);
+        libvlc_media_player_release(mp);
+    }
+
+    vlc_cond_destroy(&frame.wait);
+    vlc_mutex_destroy(&frame.lock);
+    return done;
+}
+
+static unsigned thumbnail_request(libvlc_instance_t *vlc, char **paths,
+                                  unsigned count, libvlc_time_t time)
+{
+    unsigned done = 0;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        libvlc_media_t *media = libvlc_media_new_path(vlc, paths[i]);
+        assert(media != NULL);
+
+        libvlc_media_thumbnail_t *thumb =
+            libvlc_media_thumbnail_request(media, time, 0.f, "RV32",
+                                           BENCH_WIDTH, 0, BENCH_TIMEOUT);
+        if (thumb != NULL)
+        {
+            assert(thumb->i_width == BENCH_WIDTH);
+            assert(thumb->i_planes == 1);
+            libvlc_media_thumbnail_release(thumb);
+            done++;
+        }
+        libvlc_media_release(media);
+    }
+    return done;
+}
+
+static unsigned thumbnail_batch(libvlc_instance_t *vlc, char **paths,
+                                unsigned count, libvlc_time_t time)
+{
+    libvlc_media_t **medias = malloc(count * sizeof (*medias));
+    libvlc_media_thumbnail_t **thumbs = malloc(count * sizeof (*thumbs));
+    assert(medias != NULL && thumbs != NULL);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        medias[i] = libvlc_media_new_path(vlc, paths[i]);
+        assert(medias[i] != NULL);
+    }
+
+    unsigned done = libvlc_media_thumbnail_request_batch(medias, count, time,
+                                                         0.f, "RV32",
+                                                         BENCH_WIDTH, 0,
+                                                         BENCH_TIMEOUT,
+                                                         thumbs);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (thumbs[i] != NULL)
+            libvlc_media_thumbnail_release(thumbs[i]);
+        libvlc_media_release(medias[i]);
+    }
+    free(thumbs);
+    free(medias);
+    return done;
+}
+
+static void bench(const char *name,
+                  unsigned (*thumbnail)(libvlc_instance_t *, char **,
+                                        unsigned, libvlc_time_t),
+                  char **paths, unsigned count, libvlc_time_t time)
+{
+    const char *argv[] = {
+        "--ignore-config", "--quiet", "--no-audio", "--no-spu",
+        "--no-video-title-show",
+    };
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    mtime_t start = mdate();
+    unsigned done = thumbnail(vlc, paths, count, time);
+    mtime_t elapsed = mdate() - start;
+
+    libvlc_release(vlc);
+
+    printf("%-8s %u/%u thumbnails in %.2f s, %.1f thumbnails/s\n", name,
+           done, count, (double)elapsed / CLOCK_FREQ,
+           done * (double)CLOCK_FREQ / elapsed);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *dirname = argc > 1 ? argv[1] : NULL;
+    libvlc_time_t time = argc > 2 ? atof(argv[2]) * 1000 : 0;
+    char **paths = NULL;
+    unsigned count = 0;
+
+    test_init();
+    alarm(0);
+
+    if (dirname != NULL)
+    {
+        DIR *dir = opendir(dirname);
+        if (dir == NULL)
+        {
+            perror(dirname);
+            return 1;
+        }
+
+        struct dirent *ent;
+        while ((ent = readdir(dir)) != NULL)
+        {
+            if (ent->d_name[0] == '.')
+                continue;
+
+            paths = realloc(paths, (count + 1) * sizeof (*paths));
+            assert(paths != NULL);
+            if (asprintf(&paths[count], "%s/%s", dirname, ent->d_name) < 0)
+                abort();
+            count++;
+        }
+        closedir(dir);
+    }
+    else
+    {
+        count = BENCH_SAMPLES;
+        paths = malloc(count * sizeof (*paths));
+        assert(paths != NULL);
+        for (unsigned i = 0; i < count; i++)
+        {
+            paths[i] = strdup(test_default_video);
+            assert(paths[i] != NULL);
+        }
+    }
+
+    if (count == 0)
+    {
+        fprintf(stderr, "no files in %s\n", dirname);
+        return 1;
+    }
+
+    bench("player", thumbnail_player, paths, count, time);
+    bench("request", thumbnail_request, paths, count, time);
+    bench("batch", thumbnail_batch, paths, count, time);
+
+    for (unsigned i = 0; i < count; i++)
+        free(paths[i]);
+    free(paths);
+    return 0;
+}
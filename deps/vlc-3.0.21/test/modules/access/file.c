@@ -0,0 +1,248 @@
+/*****************************************************************************
+ * file.c: test the file access with and without memory mapping
+ *****************************************************************************
+ * Copyright © 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_access.h>
+#include <vlc_url.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+/*
+ * Reads a generated file through the file access with --file-mmap and with
+ * --no-file-mmap, at several read sizes, across the mapped windows, at the
+ * end of the file and after the file was truncated while open, and checks
+ * that both return the same data. Given a file, prints the throughput of
+ * both modes instead:
+ * $ cd vlc/build-<name>/test
+ * $ make test_modules_access_file
+ * $ ./test_modules_access_file [file]
+ */
+
+#define TEST_WINDOW (4 << 20) /* MMAP_WINDOW of modules/access/file.c */
+#define TEST_SIZE   (2 * TEST_WINDOW + 2 * TEST_WINDOW / 4 + 12345)
+#define TEST_TRUNC  (TEST_WINDOW + TEST_WINDOW / 2)
+
+static const size_t read_sizes[] = { 1, 188, 4096, 65536 + 3, (1 << 20) + 7 };
+
+static stream_t *Open(vlc_object_t *obj, const char *url, bool mmap)
+{
+    var_SetBool(obj, "file-mmap", mmap);
+
+    stream_t *access = vlc_access_NewMRL(obj, url);
+    assert(access != NULL);
+#ifdef HAVE_MMAP
+    /* Make sure that the mapped code path is the one under test. */
+    assert((access->pf_block != NULL) == mmap);
+#endif
+    return access;
+}
+
+static size_t ReadAll(stream_t *access, uint8_t *buf, size_t bufsize,
+                      size_t chunk)
+{
+    size_t total = 0;
+    ssize_t val;
+
+    while ((val = vlc_stream_Read(access, buf + total,
+                                  __MIN(chunk, bufsize - total))) > 0)
+    {
+        total += val;
+        if (total == bufsize)
+            break;
+    }
+
+    /* Once at the end, reads keep returning 0. */
+    uint8_t byte;
+    assert(vlc_stream_Read(access, &byte, 1) == 0);
+    assert(vlc_stream_Read(access, &byte, 1) == 0);
+    return total;
+}
+
+static void TestRead(vlc_object_t *obj, const char *url,
+                     const uint8_t *data, uint8_t *buf)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(read_sizes); i++)
+        for (int mmap = 0; mmap < 2; mmap++)
+        {
+            stream_t *access = Open(obj, url, mmap);
+
+            memset(buf, 0, TEST_SIZE);
+            assert(ReadAll(access, buf, TEST_SIZE + 1,
+                           read_sizes[i]) == TEST_SIZE);
+            assert(memcmp(buf, data, TEST_SIZE) == 0);
+            assert(vlc_stream_Tell(access) == TEST_SIZE);
+            vlc_stream_Delete(access);
+        }
+}
+
+static void TestSeek(vlc_object_t *obj, const char *url,
+                     const uint8_t *data, uint8_t *buf)
+{
+    static const uint64_t offsets[] = {
+        TEST_SIZE - 100, TEST_WINDOW - 10, 2 * TEST_WINDOW - 1, 4097, 0,
+    };
+
+    for (int mmap = 0; mmap < 2; mmap++)
+    {
+        stream_t *access = Open(obj, url, mmap);
+
+        for (size_t i = 0; i < ARRAY_SIZE(offsets); i++)
+        {
+            uint64_t offset = offsets[i];
+            size_t length = __MIN(1000, TEST_SIZE - offset);
+
+            assert(vlc_stream_Seek(access, offset) == VLC_SUCCESS);
+            assert(vlc_stream_Read(access, buf, 1000) == (ssize_t)length);
+            assert(memcmp(buf, data + offset, length) == 0);
+        }
+
+        /* Seeking at or past the end is allowed, and reads nothing. */
+        assert(vlc_stream_Seek(access, TEST_SIZE) == VLC_SUCCESS);
+        assert(vlc_stream_Read(access, buf, 1) == 0);
+        assert(vlc_stream_Seek(access, TEST_SIZE + 1000) == VLC_SUCCESS);
+        assert(vlc_stream_Read(access, buf, 1) == 0);
+        vlc_stream_Delete(access);
+    }
+}
+
+static void TestTruncate(vlc_object_t *obj, const char *path, const char *url,
+                         const uint8_t *data, uint8_t *buf)
+{
+    stream_t *access[2];
+
+    for (int mmap = 0; mmap < 2; mmap++)
+    {
+        access[mmap] = Open(obj, url, mmap);
+        assert(vlc_stream_Read(access[mmap], buf, 1 << 20) == 1 << 20);
+    }
+
+    /* Truncate beyond the window that is in use, but before the next one. */
+    assert(truncate(path, TEST_TRUNC) == 0);
+
+    for (int mmap = 0; mmap < 2; mmap++)
+    {
+        memset(buf, 0, TEST_SIZE);
+        assert(ReadAll(access[mmap], buf, TEST_SIZE, 65536) == TEST_TRUNC
+                                                               - (1 << 20));
+        assert(memcmp(buf, data + (1 << 20), TEST_TRUNC - (1 << 20)) == 0);
+        vlc_stream_Delete(access[mmap]);
+    }
+}
+
+static void Bench(vlc_object_t *obj, const char *path)
+{
+    char *url = vlc_path2uri(path, NULL);
+    assert(url != NULL);
+
+    size_t bufsize = 1 << 20;
+    uint8_t *buf = malloc(bufsize);
+    assert(buf != NULL);
+
+    for (size_t i = 0; i < ARRAY_SIZE(read_sizes); i++)
+        for (int mmap = 0; mmap < 2; mmap++)
+        {
+            size_t chunk = __MIN(read_sizes[i], bufsize);
+            stream_t *access = Open(obj, url, mmap);
+            uint64_t total = 0;
+            ssize_t val;
+            mtime_t start = mdate();
+
+            while ((val = vlc_stream_Read(access, buf, chunk)) > 0)
+                total += val;
+
+            mtime_t elapsed = mdate() - start;
+            vlc_stream_Delete(access);
+
+            printf("%-4s %7zu bytes reads: %"PRIu64" bytes in %.3f s, "
+                   "%.1f MB/s\n", mmap ? "mmap" : "read", chunk, total,
+                   (double)elapsed / CLOCK_FREQ,
+                   total * (double)CLOCK_FREQ / elapsed / 1e6);
+        }
+
+    free(buf);
+    free(url);
+}
+
+int main(int argc, char *argv[])
+{
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    const char *args[] = {
+        "-v", "--ignore-config", "-Idummy", "--no-media-library",
+    };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(args), args);
+    assert(vlc != NULL);
+
+    vlc_object_t *obj = vlc_object_create(vlc->p_libvlc_int, sizeof (*obj));
+    assert(obj != NULL);
+    var_Create(obj, "file-mmap", VLC_VAR_BOOL);
+
+    if (argc > 1)
+    {
+        Bench(obj, argv[1]);
+        vlc_object_release(obj);
+        libvlc_release(vlc);
+        return 0;
+    }
+
+    alarm(30);
+
+    char path[] = "/tmp/vlc-test-file-XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd != -1);
+
+    uint8_t *data = malloc(TEST_SIZE);
+    uint8_t *buf = malloc(TEST_SIZE + 1);
+    assert(data != NULL && buf != NULL);
+
+    srand(42);
+    for (size_t i = 0; i < TEST_SIZE; i++)
+        data[i] = rand();
+    assert(write(fd, data, TEST_SIZE) == TEST_SIZE);
+    close(fd);
+
+    char *url = vlc_path2uri(path, NULL);
+    assert(url != NULL);
+
+    TestRead(obj, url, data, buf);
+    TestSeek(obj, url, data, buf);
+    TestTruncate(obj, path, url, data, buf);
+
+    free(url);
+    unlink(path);
+    free(buf);
+    free(data);
+    vlc_object_release(obj);
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,186 @@
+/*****************************************************************************
+ * udp.c: benchmark of the UDP input over the loopback interface
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_access.h>
+#include <vlc_atomic.h>
+#include <vlc_block.h>
+#include <vlc_network.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+/*
+ * Floods the UDP input with MPEG-TS sized datagrams, one read per datagram
+ * and then in batches, and prints the datagrams received per second and the
+ * CPU time of the receiving thread per gigabit:
+ * $ cd vlc/build-<name>/test
+ * $ make test_modules_access_udp
+ * $ ./test_modules_access_udp [seconds]
+ */
+
+#define BENCH_PORT  12340
+#define BENCH_MTU   (7 * 188)
+#define BENCH_BURST 32
+
+static const unsigned batches[] = { 1, 8, 64 };
+
+struct sender
+{
+    int fd;
+    atomic_bool stop;
+    atomic_ullong sent;
+};
+
+static void *Send(void *data)
+{
+    struct sender *sender = data;
+    static char payload[BENCH_MTU];
+
+#ifdef __linux__
+    struct iovec iov[BENCH_BURST];
+    struct mmsghdr msgs[BENCH_BURST];
+
+    memset(msgs, 0, sizeof (msgs));
+    for (unsigned i = 0; i < BENCH_BURST; i++)
+    {
+        iov[i].iov_base = payload;
+        iov[i].iov_len = sizeof (payload);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+
+    while (!atomic_load_explicit(&sender->stop, memory_order_relaxed))
+    {
+#ifdef __linux__
+        int n = sendmmsg(sender->fd, msgs, BENCH_BURST, 0);
+#else
+        int n = send(sender->fd, payload, sizeof (payload), 0) >= 0;
+#endif
+        if (n > 0)
+            atomic_fetch_add_explicit(&sender->sent, n, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+static double ThreadTime(void)
+{
+    struct rusage ru;
+#ifdef RUSAGE_THREAD
+    int ret = getrusage(RUSAGE_THREAD, &ru);
+#else
+    int ret = getrusage(RUSAGE_SELF, &ru);
+#endif
+    assert(ret == 0);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec
+         + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static void Bench(vlc_object_t *parent, unsigned batch, mtime_t duration)
+{
+    vlc_object_t *obj = vlc_object_create(parent, sizeof (*obj));
+    assert(obj != NULL);
+
+    var_Create(obj, "udp-batch", VLC_VAR_INTEGER);
+    var_SetInteger(obj, "udp-batch", batch);
+    var_Create(obj, "udp-rcvbuf", VLC_VAR_INTEGER);
+    var_SetInteger(obj, "udp-rcvbuf", 4 << 20);
+    var_Create(obj, "udp-timeout", VLC_VAR_INTEGER);
+    var_SetInteger(obj, "udp-timeout", 1);
+
+    char mrl[32];
+    snprintf(mrl, sizeof (mrl), "udp://@127.0.0.1:%u", BENCH_PORT);
+    stream_t *access = vlc_access_NewMRL(obj, mrl);
+    assert(access != NULL);
+
+    struct sender sender;
+    sender.fd = net_ConnectUDP(obj, "127.0.0.1", BENCH_PORT, -1);
+    assert(sender.fd != -1);
+    atomic_init(&sender.stop, false);
+    atomic_init(&sender.sent, 0);
+
+    vlc_thread_t th;
+    if (vlc_clone(&th, Send, &sender, VLC_THREAD_PRIORITY_LOW))
+        abort();
+
+    uint64_t datagrams = 0, bytes = 0;
+    double cpu = ThreadTime();
+    mtime_t start = mdate(), end = start + duration, now;
+
+    do
+    {
+        block_t *block = vlc_stream_ReadBlock(access);
+        if (block != NULL)
+        {
+            datagrams++;
+            bytes += block->i_buffer;
+            block_Release(block);
+        }
+        now = mdate();
+    }
+    while (now < end && !vlc_stream_Eof(access));
+
+    cpu = ThreadTime() - cpu;
+    atomic_store(&sender.stop, true);
+    vlc_join(th, NULL);
+    net_Close(sender.fd);
+    vlc_stream_Delete(access);
+    vlc_object_release(obj);
+
+    double seconds = (double)(now - start) / CLOCK_FREQ;
+    double gbits = bytes * 8 / 1e9;
+    unsigned long long sent = atomic_load(&sender.sent);
+
+    printf("%4u datagrams/read: %9.0f datagrams/s, %5.2f Gbit/s, "
+           "%5.2f CPU s/Gbit, %4.1f%% lost\n", batch, datagrams / seconds,
+           gbits / seconds, gbits > 0. ? cpu / gbits : 0.,
+           sent > 0 ? 100. * (sent - datagrams) / sent : 0.);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned seconds = argc >= 2 ? strtoul(argv[1], NULL, 0) : 3;
+    assert(seconds > 0);
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    const char *args[] = { "--ignore-config", "--quiet" };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(args), args);
+    assert(vlc != NULL);
+
+    for (size_t i = 0; i < ARRAY_SIZE(batches); i++)
+        Bench(VLC_OBJECT(vlc->p_libvlc_int), batches[i],
+              seconds * CLOCK_FREQ);
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,205 @@
+/*****************************************************************************
+ * udp.c: benchmark of the paced UDP output over the loopback interface
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_network.h>
+#include <vlc_sout.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+/*
+ * Sends a constant bitrate stream of MPEG-TS sized packets with the UDP
+ * output, with a clock reference every 40 packets, and prints the bitrate
+ * received on the loopback interface, how late the packets arrive compared
+ * to their due date, and the system calls per second of the output:
+ * $ cd vlc/build-<name>/test
+ * $ make test_modules_access_output_udp
+ * $ ./test_modules_access_output_udp [Mbit/s seconds]
+ */
+
+#define BENCH_PORT    12350
+#define BENCH_PACKET  (7 * 188)
+#define BENCH_CACHING (300 * 1000) /* default sout-udp-caching */
+
+static const char *const accesses[] = {
+    "udp",
+    "udp{window=1}",
+    "udp{window=1,gso}",
+};
+
+struct receiver
+{
+    int fd;
+    unsigned count;
+    mtime_t *due;
+    mtime_t *arrival;
+};
+
+static void *Receive(void *data)
+{
+    struct receiver *rx = data;
+    uint8_t buf[BENCH_PACKET];
+
+    for (;;)
+    {
+        ssize_t len = recv(rx->fd, buf, sizeof (buf), 0);
+        mtime_t now = mdate();
+        uint32_t index;
+
+        if (len < (ssize_t)sizeof (index))
+            continue;
+        memcpy(&index, buf, sizeof (index));
+        if (index < rx->count)
+            rx->arrival[index] = now;
+    }
+    vlc_assert_unreachable();
+}
+
+static uint64_t sent_packets, sent_calls;
+
+static void Log(void *data, int level, const libvlc_log_t *ctx,
+                const char *fmt, va_list ap)
+{
+    char msg[256];
+
+    (void) data; (void) level; (void) ctx;
+    vsnprintf(msg, sizeof (msg), fmt, ap);
+    sscanf(msg, "%"SCNu64" packets sent in %"SCNu64" system calls",
+           &sent_packets, &sent_calls);
+}
+
+static void Bench(vlc_object_t *obj, const char *name,
+                  unsigned mbps, unsigned seconds)
+{
+    const mtime_t interval = BENCH_PACKET * 8 / mbps; /* µs per packet */
+    struct receiver rx;
+
+    rx.count = seconds * CLOCK_FREQ / interval;
+    rx.due = calloc(rx.count, sizeof (*rx.due));
+    rx.arrival = calloc(rx.count, sizeof (*rx.arrival));
+    assert(rx.due != NULL && rx.arrival != NULL);
+
+    rx.fd = net_OpenDgram(obj, "127.0.0.1", BENCH_PORT, NULL, 0, IPPROTO_UDP);
+    assert(rx.fd != -1);
+
+    vlc_thread_t th;
+    if (vlc_clone(&th, Receive, &rx, VLC_THREAD_PRIORITY_HIGHEST))
+        abort();
+
+    char dst[32];
+    snprintf(dst, sizeof (dst), "127.0.0.1:%u", BENCH_PORT);
+    sout_access_out_t *access = sout_AccessOutNew(obj, name, dst);
+    assert(access != NULL);
+
+    sent_packets = sent_calls = 0;
+
+    /* Groups of 7 packets share a date, as after the TS muxer */
+    mtime_t start = mdate() + CLOCK_FREQ / 10 - BENCH_CACHING;
+    for (unsigned i = 0; i < rx.count; i++)
+    {
+        mtime_t dts = start + (i - i % 7) * interval;
+
+        /* Stay at most 100 ms ahead of the sending dates */
+        mwait(dts + BENCH_CACHING - CLOCK_FREQ / 10);
+
+        block_t *block = block_Alloc(BENCH_PACKET);
+        assert(block != NULL);
+        memset(block->p_buffer, 0xFF, BENCH_PACKET);
+        memcpy(block->p_buffer, &(uint32_t){ i }, sizeof (uint32_t));
+        block->i_dts = dts;
+        if (i % 40 == 0)
+            block->i_flags |= BLOCK_FLAG_CLOCK;
+        rx.due[i] = dts + BENCH_CACHING;
+        sout_AccessOutWrite(access, block);
+    }
+
+    /* Let the last packets go out */
+    mwait(rx.due[rx.count - 1] + CLOCK_FREQ / 10);
+    sout_AccessOutDelete(access);
+    vlc_cancel(th);
+    vlc_join(th, NULL);
+    net_Close(rx.fd);
+
+    unsigned received = 0;
+    double sum = 0., sum2 = 0., max = 0.;
+    mtime_t first = INT64_MAX, last = INT64_MIN;
+
+    for (unsigned i = 0; i < rx.count; i++)
+    {
+        if (rx.arrival[i] == 0)
+            continue;
+
+        double late = rx.arrival[i] - rx.due[i];
+        received++;
+        sum += late;
+        sum2 += late * late;
+        if (fabs(late) > max)
+            max = fabs(late);
+        if (rx.arrival[i] < first)
+            first = rx.arrival[i];
+        if (rx.arrival[i] > last)
+            last = rx.arrival[i];
+    }
+    free(rx.arrival);
+    free(rx.due);
+
+    double mean = received ? sum / received : 0.;
+    double dev = received ? sqrt(sum2 / received - mean * mean) : 0.;
+
+    printf("%-18s %6.1f Mbit/s, lateness %5.0f us (sd %5.0f, max %6.0f), "
+           "%7.0f syscalls/s, %4.1f%% lost\n", name,
+           last > first ? received * BENCH_PACKET * 8. / (last - first) : 0.,
+           mean, dev, max, sent_calls * (double)CLOCK_FREQ / (last - first),
+           100. * (rx.count - received) / rx.count);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned mbps = argc >= 2 ? strtoul(argv[1], NULL, 0) : 200;
+    unsigned seconds = argc >= 3 ? strtoul(argv[2], NULL, 0) : 3;
+    assert(mbps > 0 && seconds > 0);
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    const char *args[] = { "--ignore-config", "--verbose=2" };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(args), args);
+    assert(vlc != NULL);
+    libvlc_log_set(vlc, Log, NULL);
+
+    for (size_t i = 0; i < ARRAY_SIZE(accesses); i++)
+        Bench(VLC_OBJECT(vlc->p_libvlc_int), accesses[i], mbps, seconds);
+
+    libvlc_log_unset(vlc);
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,713 @@
+/*****************************************************************************
+ * mp4.c: MP4 demultiplexer samples index benchmark and cache test
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_url.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+# include <malloc.h>
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+
+#include "../../src/input/common.h"
+
+/*
+ * Measures the heap used by the demultiplexer once a file is opened, i.e.
+ * mostly the boxes tree and the samples index, on a file or on a generated
+ * movie with 25 fps video with B-frames and 48 kHz AAC audio. With a
+ * generated movie, also checks that the samples read with the index cache,
+ * be it built, reused or rebuilt after it was corrupted, are the ones read
+ * without it:
+ * $ cd vlc/build-<name>/test
+ * $ make test_modules_demux_mp4
+ * $ ./test_modules_demux_mp4 [hours|file.mp4]
+ */
+
+#define VIDEO_RATE   25
+#define VIDEO_SCALE  90000
+#define AUDIO_RATE   48000
+#define AUDIO_FRAME  1024
+#define AUDIO_CHUNK  2 /* frames per chunk */
+
+/* Layout of the cache files, see modules/demux/mp4/indexcache.c */
+#define CACHE_TRACKS       32 /* header i_tracks */
+#define CACHE_HEADER       40
+#define CACHE_TRACK        40
+#define CACHE_CHUNK        56
+#define CACHE_SAMPLE_FIRST 32 /* chunk i_sample_first */
+#define CACHE_DTS_INDEX    36 /* chunk i_dts_index */
+
+static size_t HeapUsed(void)
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    return mallinfo2().uordblks;
+#elif defined(__GLIBC__)
+    return (unsigned) mallinfo().uordblks;
+#else
+    return 0;
+#endif
+}
+
+/* Boxes are built in memory, then their sizes are patched */
+struct buf
+{
+    uint8_t *data;
+    size_t   len, size;
+};
+
+static void Put(struct buf *b, const void *data, size_t len)
+{
+    if (b->len + len > b->size)
+    {
+        b->size = (b->len + len) * 2;
+        b->data = realloc(b->data, b->size);
+        assert(b->data != NULL);
+    }
+    if (data != NULL)
+        memcpy(&b->data[b->len], data, len);
+    else
+        memset(&b->data[b->len], 0, len);
+    b->len += len;
+}
+
+static void Put8(struct buf *b, uint8_t v)
+{
+    Put(b, &v, 1);
+}
+
+static void Put16(struct buf *b, uint16_t v)
+{
+    uint8_t d[2];
+    SetWBE(d, v);
+    Put(b, d, 2);
+}
+
+static void Put32(struct buf *b, uint32_t v)
+{
+    uint8_t d[4];
+    SetDWBE(d, v);
+    Put(b, d, 4);
+}
+
+static size_t Open(struct buf *b, const char *type)
+{
+    size_t pos = b->len;
+    Put32(b, 0);
+    Put(b, type, 4);
+    return pos;
+}
+
+static size_t OpenFull(struct buf *b, const char *type, uint32_t flags)
+{
+    size_t pos = Open(b, type);
+    Put32(b, flags);
+    return pos;
+}
+
+static void Close(struct buf *b, size_t pos)
+{
+    SetDWBE(&b->data[pos], b->len - pos);
+}
+
+static void PutMatrix(struct buf *b)
+{
+    static const uint32_t matrix[9] = {
+        0x10000, 0, 0, 0, 0x10000, 0, 0, 0, 0x40000000
+    };
+    for (int i = 0; i < 9; i++)
+        Put32(b, matrix[i]);
+}
+
+struct track
+{
+    uint32_t  id;
+    bool      video;
+    uint32_t  timescale;
+    uint32_t  delta;
+    uint32_t  samples;
+    uint32_t  per_chunk;
+    uint32_t *sizes;
+    uint32_t  chunks;
+    uint32_t *offsets;
+};
+
+static void PutSampleEntry(struct buf *b, const struct track *t)
+{
+    size_t entry, child;
+
+    if (t->video)
+    {
+        entry = Open(b, "avc1");
+        Put(b, NULL, 6);
+        Put16(b, 1);           /* data reference index */
+        Put(b, NULL, 16);
+        Put16(b, 1920);
+        Put16(b, 1080);
+        Put32(b, 0x480000);    /* 72 dpi */
+        Put32(b, 0x480000);
+        Put32(b, 0);
+        Put16(b, 1);           /* frame count */
+        Put(b, NULL, 32);      /* compressor name */
+        Put16(b, 0x18);
+        Put16(b, 0xffff);
+        child = Open(b, "avcC");
+        Put8(b, 1);
+        Put8(b, 100);          /* High profile */
+        Put8(b, 0);
+        Put8(b, 40);
+        Put8(b, 0xff);         /* 4 bytes NAL lengths */
+        Put8(b, 0xe0);         /* no SPS */
+        Put8(b, 0);            /* no PPS */
+        Close(b, child);
+    }
+    else
+    {
+        static const uint8_t esds[] = {
+            0x03, 25, 0x00, 0x02, 0x00,
+            0x04, 17, 0x40, 0x15, 0x00, 0x06, 0x00,
+                0x00, 0x02, 0xee, 0x00, 0x00, 0x02, 0xee, 0x00,
+            0x05, 2, 0x11, 0x90,
+            0x06, 1, 0x02,
+        };
+
+        entry = Open(b, "mp4a");
+        Put(b, NULL, 6);
+        Put16(b, 1);
+        Put(b, NULL, 8);
+        Put16(b, 2);           /* channels */
+        Put16(b, 16);
+        Put32(b, 0);
+        Put32(b, AUDIO_RATE << 16);
+        child = OpenFull(b, "esds", 0);
+        Put(b, esds, sizeof(esds));
+        Close(b, child);
+    }
+    Close(b, entry);
+}
+
+static void PutTrack(struct buf *b, const struct track *t)
+{
+    const uint32_t duration = t->samples * t->delta;
+    size_t trak = Open(b, "trak"), box;
+
+    box = OpenFull(b, "tkhd", 0x7);
+    Put32(b, 0);
+    Put32(b, 0);
+    Put32(b, t->id);
+    Put32(b, 0);
+    Put32(b, (uint64_t)duration * 1000 / t->timescale);
+    Put(b, NULL, 8);
+    Put16(b, 0);
+    Put16(b, 0);
+    Put16(b, t->video ? 0 : 0x100);
+    Put16(b, 0);
+    PutMatrix(b);
+    Put32(b, t->video ? 1920 << 16 : 0);
+    Put32(b, t->video ? 1080 << 16 : 0);
+    Close(b, box);
+
+    size_t mdia = Open(b, "mdia");
+    box = OpenFull(b, "mdhd", 0);
+    Put32(b, 0);
+    Put32(b, 0);
+    Put32(b, t->timescale);
+    Put32(b, duration);
+    Put16(b, 0x55c4);          /* und */
+    Put16(b, 0);
+    Close(b, box);
+
+    box = OpenFull(b, "hdlr", 0);
+    Put32(b, 0);
+    Put(b, t->video ? "vide" : "soun", 4);
+    Put(b, NULL, 12);
+    Put8(b, 0);
+    Close(b, box);
+
+    size_t minf = Open(b, "minf");
+    if (t->video)
+    {
+        box = OpenFull(b, "vmhd", 1);
+        Put(b, NULL, 8);
+    }
+    else
+    {
+        box = OpenFull(b, "smhd", 0);
+        Put32(b, 0);
+    }
+    Close(b, box);
+
+    size_t dinf = Open(b, "dinf");
+    box = OpenFull(b, "dref", 0);
+    Put32(b, 1);
+    Close(b, OpenFull(b, "url ", 1));
+    Close(b, box);
+    Close(b, dinf);
+
+    size_t stbl = Open(b, "stbl");
+    box = OpenFull(b, "stsd", 0);
+    Put32(b, 1);
+    PutSampleEntry(b, t);
+    Close(b, box);
+
+    box = OpenFull(b, "stts", 0);
+    Put32(b, 1);
+    Put32(b, t->samples);
+    Put32(b, t->delta);
+    Close(b, box);
+
+    if (t->video)
+    {
+        /* I P B B pattern, as muxers do not merge differing offsets */
+        static const uint32_t offsets[4] = { 1, 4, 0, 2 };
+
+        box = OpenFull(b, "ctts", 0);
+        Put32(b, t->samples);
+        for (uint32_t i = 0; i < t->samples; i++)
+        {
+            Put32(b, 1);
+            Put32(b, offsets[i % 4] * t->delta);
+        }
+        Close(b, box);
+
+        box = OpenFull(b, "stss", 0);
+        Put32(b, (t->samples + VIDEO_RATE - 1) / VIDEO_RATE);
+        for (uint32_t i = 0; i < t->samples; i += VIDEO_RATE)
+            Put32(b, i + 1);
+        Close(b, box);
+    }
+
+    box = OpenFull(b, "stsc", 0);
+    if (t->samples % t->per_chunk)
+    {
+        Put32(b, 2);
+        Put32(b, 1);
+        Put32(b, t->per_chunk);
+        Put32(b, 1);
+        Put32(b, t->chunks);
+        Put32(b, t->samples % t->per_chunk);
+        Put32(b, 1);
+    }
+    else
+    {
+        Put32(b, 1);
+        Put32(b, 1);
+        Put32(b, t->per_chunk);
+        Put32(b, 1);
+    }
+    Close(b, box);
+
+    box = OpenFull(b, "stsz", 0);
+    Put32(b, 0);
+    Put32(b, t->samples);
+    for (uint32_t i = 0; i < t->samples; i++)
+        Put32(b, t->sizes[i]);
+    Close(b, box);
+
+    box = OpenFull(b, "stco", 0);
+    Put32(b, t->chunks);
+    for (uint32_t i = 0; i < t->chunks; i++)
+        Put32(b, t->offsets[i]);
+    Close(b, box);
+
+    Close(b, stbl);
+    Close(b, minf);
+    Close(b, mdia);
+    Close(b, trak);
+}
+
+static void InitTrack(struct track *t, uint32_t id, bool video, double seconds)
+{
+    t->id = id;
+    t->video = video;
+    t->timescale = video ? VIDEO_SCALE : AUDIO_RATE;
+    t->delta = video ? VIDEO_SCALE / VIDEO_RATE : AUDIO_FRAME;
+    t->samples = seconds * t->timescale / t->delta;
+    t->per_chunk = video ? 1 : AUDIO_CHUNK;
+    t->chunks = (t->samples + t->per_chunk - 1) / t->per_chunk;
+    t->sizes = malloc(t->samples * sizeof (*t->sizes));
+    t->offsets = malloc(t->chunks * sizeof (*t->offsets));
+    assert(t->sizes != NULL && t->offsets != NULL);
+
+    /* Small samples, to keep the file size reasonable */
+    for (uint32_t i = 0; i < t->samples; i++)
+        t->sizes[i] = video ? 40 + (i * 7) % 23 : 20 + (i * 5) % 11;
+}
+
+/* Interleaves the chunks in time order, returns the mdat payload size */
+static uint32_t Interleave(struct track *video, struct track *audio,
+                           uint32_t offset)
+{
+    uint32_t vc = 0, ac = 0, vs = 0, as = 0, pos = offset;
+
+    while (vc < video->chunks || ac < audio->chunks)
+    {
+        bool pick_video = ac >= audio->chunks ||
+            (vc < video->chunks &&
+             (uint64_t)vs * video->delta * AUDIO_RATE <=
+             (uint64_t)as * audio->delta * VIDEO_SCALE);
+        struct track *t = pick_video ? video : audio;
+        uint32_t *c = pick_video ? &vc : &ac, *s = pick_video ? &vs : &as;
+
+        t->offsets[(*c)++] = pos;
+        for (uint32_t i = 0; i < t->per_chunk && *s < t->samples; i++)
+            pos += t->sizes[(*s)++];
+    }
+    return pos - offset;
+}
+
+static void Generate(const char *path, double hours)
+{
+    static const uint8_t ftyp[] = {
+        0, 0, 0, 24, 'f', 't', 'y', 'p', 'i', 's', 'o', 'm', 0, 0, 2, 0,
+        'i', 's', 'o', 'm', 'm', 'p', '4', '1',
+    };
+    struct track video, audio;
+    struct buf moov = { NULL, 0, 0 };
+
+    InitTrack(&video, 1, true, hours * 3600);
+    InitTrack(&audio, 2, false, hours * 3600);
+    uint32_t mdat = Interleave(&video, &audio, sizeof(ftyp) + 8);
+
+    size_t box = Open(&moov, "moov"), mvhd;
+    mvhd = OpenFull(&moov, "mvhd", 0);
+    Put32(&moov, 0);
+    Put32(&moov, 0);
+    Put32(&moov, 1000);
+    Put32(&moov, hours * 3600 * 1000);
+    Put32(&moov, 0x10000);
+    Put16(&moov, 0x100);
+    Put(&moov, NULL, 10);
+    PutMatrix(&moov);
+    Put(&moov, NULL, 24);
+    Put32(&moov, 3);
+    Close(&moov, mvhd);
+    PutTrack(&moov, &video);
+    PutTrack(&moov, &audio);
+    Close(&moov, box);
+
+    FILE *out = fopen(path, "wb");
+    assert(out != NULL);
+    fwrite(ftyp, 1, sizeof(ftyp), out);
+
+    uint8_t hdr[8], zero[4096] = { 0 };
+    SetDWBE(hdr, mdat + 8);
+    memcpy(&hdr[4], "mdat", 4);
+    fwrite(hdr, 1, sizeof(hdr), out);
+    for (uint32_t left = mdat; left > 0; )
+    {
+        size_t len = __MIN(left, sizeof(zero));
+        fwrite(zero, 1, len, out);
+        left -= len;
+    }
+    fwrite(moov.data, 1, moov.len, out);
+    assert(!ferror(out));
+    fclose(out);
+
+    free(moov.data);
+    free(video.sizes);
+    free(video.offsets);
+    free(audio.sizes);
+    free(audio.offsets);
+}
+
+/* Digest of the samples sent by the demultiplexer */
+struct es_out_sys_t
+{
+    uint64_t hash;
+    unsigned blocks;
+};
+
+static void Hash(uint64_t *hash, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    for (size_t i = 0; i < len; i++)
+        *hash = (*hash ^ p[i]) * UINT64_C(0x100000001b3);
+}
+
+static es_out_id_t *EsOutAdd(es_out_t *out, const es_format_t *fmt)
+{
+    (void) out; (void) fmt;
+    return malloc(1);
+}
+
+static int EsOutSend(es_out_t *out, es_out_id_t *id, block_t *block)
+{
+    struct es_out_sys_t *sys = out->p_sys;
+    (void) id;
+
+    if (sys != NULL)
+    {
+        Hash(&sys->hash, &block->i_dts, sizeof (block->i_dts));
+        Hash(&sys->hash, &block->i_pts, sizeof (block->i_pts));
+        Hash(&sys->hash, &block->i_buffer, sizeof (block->i_buffer));
+        sys->blocks++;
+    }
+    block_Release(block);
+    return VLC_SUCCESS;
+}
+
+static void EsOutDelete(es_out_t *out, es_out_id_t *id)
+{
+    (void) out;
+    free(id);
+}
+
+static int EsOutControl(es_out_t *out, int query, va_list args)
+{
+    (void) out;
+
+    if (query == ES_OUT_GET_ES_STATE)
+    {   /* all tracks are selected */
+        va_arg(args, es_out_id_t *);
+        *va_arg(args, bool *) = true;
+        return VLC_SUCCESS;
+    }
+    return VLC_EGENERIC;
+}
+
+/* Demultiplexes the whole file, returns the digest of its samples */
+static uint64_t Digest(vlc_object_t *obj, const char *url)
+{
+    struct es_out_sys_t sys = { UINT64_C(0xcbf29ce484222325), 0 };
+    es_out_t out = {
+        .pf_add = EsOutAdd,
+        .pf_send = EsOutSend,
+        .pf_del = EsOutDelete,
+        .pf_control = EsOutControl,
+        .p_sys = &sys,
+    };
+
+    stream_t *s = vlc_stream_NewURL(obj, url);
+    assert(s != NULL);
+
+    /* The location is the URL without its scheme, as for the input */
+    demux_t *demux = demux_New(obj, "mp4", url + strlen("file://"), s, &out);
+    assert(demux != NULL);
+    while (demux_Demux(demux) == VLC_DEMUXER_SUCCESS);
+    demux_Delete(demux);
+
+    assert(sys.blocks > 0);
+    return sys.hash;
+}
+
+static void *ReadFile(const char *path, size_t *len)
+{
+    FILE *in = fopen(path, "rb");
+    assert(in != NULL);
+    fseek(in, 0, SEEK_END);
+    *len = ftell(in);
+    rewind(in);
+
+    void *data = malloc(*len);
+    assert(data != NULL);
+    assert(fread(data, 1, *len, in) == *len);
+    fclose(in);
+    return data;
+}
+
+static void WriteFile(const char *path, const void *data, size_t len)
+{
+    FILE *out = fopen(path, "wb");
+    assert(out != NULL);
+    assert(fwrite(data, 1, len, out) == len);
+    fclose(out);
+}
+
+static ino_t Inode(const char *path)
+{
+    struct stat st;
+    assert(stat(path, &st) == 0);
+    return st.st_ino;
+}
+
+static void TestIndexCache(vlc_object_t *obj, const char *path)
+{
+    char dir[] = "/tmp/vlc-mp4index-XXXXXX";
+    assert(mkdtemp(dir) != NULL);
+    setenv("XDG_CACHE_HOME", dir, 1);
+
+    Generate(path, 60 / 3600.);
+    char *url = vlc_path2uri(path, NULL);
+    assert(url != NULL);
+    char *file = vlc_uri2path(url);
+    assert(file != NULL);
+
+    var_Create(obj, "mp4-index-cache", VLC_VAR_BOOL);
+    var_SetBool(obj, "mp4-index-cache", false);
+    const uint64_t reference = Digest(obj, url);
+
+    /* Built on the first opening... */
+    var_SetBool(obj, "mp4-index-cache", true);
+    assert(Digest(obj, url) == reference);
+
+    char subdir[sizeof (dir) + 16], cache[sizeof (subdir) + 256];
+    snprintf(subdir, sizeof (subdir), "%s/vlc/mp4index", dir);
+    DIR *d = opendir(subdir);
+    assert(d != NULL);
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL && ent->d_name[0] == '.');
+    assert(ent != NULL);
+    snprintf(cache, sizeof (cache), "%s/%s", subdir, ent->d_name);
+    closedir(d);
+
+    size_t len;
+    uint8_t *good = ReadFile(cache, &len);
+    const size_t chunks = CACHE_HEADER + ((strlen(file) + 7) & ~7)
+                        + CACHE_TRACK;
+    assert(len > chunks + 4 * CACHE_CHUNK);
+
+    /* ...then used as is, without being written again */
+    ino_t ino = Inode(cache);
+    assert(Digest(obj, url) == reference);
+    assert(Inode(cache) == ino);
+
+    /* Any inconsistency discards the whole cache, which is rebuilt */
+    const size_t chunk3 = chunks + 3 * CACHE_CHUNK;
+    const struct
+    {
+        const char *name;
+        size_t offset, len;
+        uint32_t delta; /* added to the 32-bits field at offset */
+    } corruptions[] = {
+        { "tracks count", CACHE_TRACKS, len, 1 },
+        { "chunk first sample", chunk3 + CACHE_SAMPLE_FIRST, len, 1 },
+        { "chunk stts entry", chunk3 + CACHE_DTS_INDEX, len, 2 },
+        { "truncated chunks", 0, chunk3 + 8, 0 },
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(corruptions); i++)
+    {
+        uint8_t *bad = malloc(len);
+        size_t badlen = corruptions[i].len;
+        assert(bad != NULL);
+        memcpy(bad, good, len);
+
+        if (corruptions[i].delta != 0)
+        {
+            uint32_t value;
+            memcpy(&value, &bad[corruptions[i].offset], sizeof (value));
+            value += corruptions[i].delta;
+            memcpy(&bad[corruptions[i].offset], &value, sizeof (value));
+        }
+        WriteFile(cache, bad, badlen);
+        free(bad);
+
+        ino = Inode(cache);
+        assert(Digest(obj, url) == reference);
+        assert(Inode(cache) != ino);
+
+        size_t newlen;
+        uint8_t *rebuilt = ReadFile(cache, &newlen);
+        assert(newlen == len && memcmp(rebuilt, good, len) == 0);
+        free(rebuilt);
+        printf("index cache: %s corruption rebuilt\n", corruptions[i].name);
+    }
+
+    var_SetBool(obj, "mp4-index-cache", false);
+    free(good);
+    unlink(cache);
+    rmdir(subdir);
+    snprintf(subdir, sizeof (subdir), "%s/vlc", dir);
+    rmdir(subdir);
+    rmdir(dir);
+    free(file);
+    free(url);
+    remove(path);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = "test_modules_demux_mp4.mp4";
+    double hours = 1.;
+    struct vlc_run_args args;
+
+    if (argc >= 2 && strtod(argv[1], NULL) > 0.)
+        hours = strtod(argv[1], NULL);
+    else if (argc >= 2)
+        path = argv[1];
+    const bool generated = path != argv[1];
+    if (generated)
+        Generate(path, hours);
+
+    vlc_run_args_init(&args);
+    libvlc_instance_t *vlc = libvlc_create(&args);
+    assert(vlc != NULL);
+
+    char *url = vlc_path2uri(path, NULL);
+    assert(url != NULL);
+
+    es_out_t out = {
+        .pf_add = EsOutAdd,
+        .pf_send = EsOutSend,
+        .pf_del = EsOutDelete,
+        .pf_control = EsOutControl,
+    };
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    stream_t *s = vlc_stream_NewURL(obj, url);
+    assert(s != NULL);
+
+    const size_t before = HeapUsed();
+    mtime_t start = mdate();
+    demux_t *demux = demux_New(obj, "mp4", "", s, &out);
+    mtime_t elapsed = mdate() - start;
+    const size_t after = HeapUsed();
+    assert(demux != NULL);
+
+    int64_t length = 0;
+    demux_Control(demux, DEMUX_GET_LENGTH, &length);
+    assert(length > 0);
+    const double media_hours = length / (3600. * CLOCK_FREQ);
+
+    printf("%s: %.2f hours of media opened in %.1f ms\n",
+           path, media_hours, elapsed / 1000.);
+    if (before == 0 && after == 0)
+        printf("heap usage not available\n");
+    else
+        printf("index: %zu bytes, %.0f bytes per hour\n", after - before,
+               (after - before) / media_hours);
+
+    demux_Delete(demux); /* and its stream */
+    free(url);
+
+    if (generated)
+    {
+        remove(path);
+        TestIndexCache(obj, path);
+    }
+    libvlc_release(vlc);
+    return 0;
+}
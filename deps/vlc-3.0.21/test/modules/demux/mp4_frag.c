@@ -0,0 +1,542 @@
+/*****************************************************************************
+ * mp4_frag.c: allocations benchmark of the fragmented MP4 demultiplexer
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_url.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+#include "../../src/input/common.h"
+
+/*
+ * Counts the heap allocations done while opening, i.e. probing all the
+ * fragments, then playing a fragmented file, as recorded by live encoders
+ * or served by DASH, on a file or on a generated movie with 2 seconds
+ * fragments of 25 fps video and 48 kHz AAC audio:
+ * $ cd vlc/build-<name>/test
+ * $ make test_modules_demux_mp4_frag
+ * $ ./test_modules_demux_mp4_frag [minutes|file.mp4]
+ */
+
+#define FRAGMENT     2 /* seconds */
+#define VIDEO_RATE   25
+#define VIDEO_SCALE  90000
+#define AUDIO_RATE   48000
+#define AUDIO_FRAME  1024
+
+#ifdef __GLIBC__
+/* Counts the calls into the C library allocator, from all threads */
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+
+static atomic_ulong allocs = ATOMIC_VAR_INIT(0);
+
+void *malloc(size_t size)
+{
+    atomic_fetch_add_explicit(&allocs, 1, memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    atomic_fetch_add_explicit(&allocs, 1, memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    atomic_fetch_add_explicit(&allocs, 1, memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+static unsigned long Allocs(void)
+{
+    return atomic_load_explicit(&allocs, memory_order_relaxed);
+}
+#else
+static unsigned long Allocs(void)
+{
+    return 0;
+}
+#endif
+
+/* Boxes are built in memory, then their sizes are patched */
+struct buf
+{
+    uint8_t *data;
+    size_t   len, size;
+};
+
+static void Put(struct buf *b, const void *data, size_t len)
+{
+    if (b->len + len > b->size)
+    {
+        b->size = (b->len + len) * 2;
+        b->data = realloc(b->data, b->size);
+        assert(b->data != NULL);
+    }
+    if (data != NULL)
+        memcpy(&b->data[b->len], data, len);
+    else
+        memset(&b->data[b->len], 0, len);
+    b->len += len;
+}
+
+static void Put8(struct buf *b, uint8_t v)
+{
+    Put(b, &v, 1);
+}
+
+static void Put16(struct buf *b, uint16_t v)
+{
+    uint8_t d[2];
+    SetWBE(d, v);
+    Put(b, d, 2);
+}
+
+static void Put32(struct buf *b, uint32_t v)
+{
+    uint8_t d[4];
+    SetDWBE(d, v);
+    Put(b, d, 4);
+}
+
+static void Put64(struct buf *b, uint64_t v)
+{
+    uint8_t d[8];
+    SetQWBE(d, v);
+    Put(b, d, 8);
+}
+
+static size_t Open(struct buf *b, const char *type)
+{
+    size_t pos = b->len;
+    Put32(b, 0);
+    Put(b, type, 4);
+    return pos;
+}
+
+static size_t OpenFull(struct buf *b, const char *type, uint32_t flags)
+{
+    size_t pos = Open(b, type);
+    Put32(b, flags);
+    return pos;
+}
+
+static void Close(struct buf *b, size_t pos)
+{
+    SetDWBE(&b->data[pos], b->len - pos);
+}
+
+static void PutMatrix(struct buf *b)
+{
+    static const uint32_t matrix[9] = {
+        0x10000, 0, 0, 0, 0x10000, 0, 0, 0, 0x40000000
+    };
+    for (int i = 0; i < 9; i++)
+        Put32(b, matrix[i]);
+}
+
+static void PutSampleEntry(struct buf *b, bool video)
+{
+    size_t entry, child;
+
+    if (video)
+    {
+        entry = Open(b, "avc1");
+        Put(b, NULL, 6);
+        Put16(b, 1);           /* data reference index */
+        Put(b, NULL, 16);
+        Put16(b, 1920);
+        Put16(b, 1080);
+        Put32(b, 0x480000);    /* 72 dpi */
+        Put32(b, 0x480000);
+        Put32(b, 0);
+        Put16(b, 1);           /* frame count */
+        Put(b, NULL, 32);      /* compressor name */
+        Put16(b, 0x18);
+        Put16(b, 0xffff);
+        child = Open(b, "avcC");
+        Put8(b, 1);
+        Put8(b, 100);          /* High profile */
+        Put8(b, 0);
+        Put8(b, 40);
+        Put8(b, 0xff);         /* 4 bytes NAL lengths */
+        Put8(b, 0xe0);         /* no SPS */
+        Put8(b, 0);            /* no PPS */
+        Close(b, child);
+    }
+    else
+    {
+        static const uint8_t esds[] = {
+            0x03, 25, 0x00, 0x02, 0x00,
+            0x04, 17, 0x40, 0x15, 0x00, 0x06, 0x00,
+                0x00, 0x02, 0xee, 0x00, 0x00, 0x02, 0xee, 0x00,
+            0x05, 2, 0x11, 0x90,
+            0x06, 1, 0x02,
+        };
+
+        entry = Open(b, "mp4a");
+        Put(b, NULL, 6);
+        Put16(b, 1);
+        Put(b, NULL, 8);
+        Put16(b, 2);           /* channels */
+        Put16(b, 16);
+        Put32(b, 0);
+        Put32(b, AUDIO_RATE << 16);
+        child = OpenFull(b, "esds", 0);
+        Put(b, esds, sizeof(esds));
+        Close(b, child);
+    }
+    Close(b, entry);
+}
+
+/* Empty samples tables, the samples are all in the fragments */
+static void PutTrack(struct buf *b, uint32_t id, bool video)
+{
+    size_t trak = Open(b, "trak"), box;
+
+    box = OpenFull(b, "tkhd", 0x7);
+    Put32(b, 0);
+    Put32(b, 0);
+    Put32(b, id);
+    Put32(b, 0);
+    Put32(b, 0);
+    Put(b, NULL, 8);
+    Put16(b, 0);
+    Put16(b, 0);
+    Put16(b, video ? 0 : 0x100);
+    Put16(b, 0);
+    PutMatrix(b);
+    Put32(b, video ? 1920 << 16 : 0);
+    Put32(b, video ? 1080 << 16 : 0);
+    Close(b, box);
+
+    size_t mdia = Open(b, "mdia");
+    box = OpenFull(b, "mdhd", 0);
+    Put32(b, 0);
+    Put32(b, 0);
+    Put32(b, video ? VIDEO_SCALE : AUDIO_RATE);
+    Put32(b, 0);
+    Put16(b, 0x55c4);          /* und */
+    Put16(b, 0);
+    Close(b, box);
+
+    box = OpenFull(b, "hdlr", 0);
+    Put32(b, 0);
+    Put(b, video ? "vide" : "soun", 4);
+    Put(b, NULL, 12);
+    Put8(b, 0);
+    Close(b, box);
+
+    size_t minf = Open(b, "minf");
+    if (video)
+    {
+        box = OpenFull(b, "vmhd", 1);
+        Put(b, NULL, 8);
+    }
+    else
+    {
+        box = OpenFull(b, "smhd", 0);
+        Put32(b, 0);
+    }
+    Close(b, box);
+
+    size_t dinf = Open(b, "dinf");
+    box = OpenFull(b, "dref", 0);
+    Put32(b, 1);
+    Close(b, OpenFull(b, "url ", 1));
+    Close(b, box);
+    Close(b, dinf);
+
+    size_t stbl = Open(b, "stbl");
+    box = OpenFull(b, "stsd", 0);
+    Put32(b, 1);
+    PutSampleEntry(b, video);
+    Close(b, box);
+    box = OpenFull(b, "stts", 0);
+    Put32(b, 0);
+    Close(b, box);
+    box = OpenFull(b, "stsc", 0);
+    Put32(b, 0);
+    Close(b, box);
+    box = OpenFull(b, "stsz", 0);
+    Put32(b, 0);
+    Put32(b, 0);
+    Close(b, box);
+    box = OpenFull(b, "stco", 0);
+    Put32(b, 0);
+    Close(b, box);
+    Close(b, stbl);
+
+    Close(b, minf);
+    Close(b, mdia);
+    Close(b, trak);
+}
+
+static void PutMoov(struct buf *b)
+{
+    size_t moov = Open(b, "moov"), box;
+
+    box = OpenFull(b, "mvhd", 0);
+    Put32(b, 0);
+    Put32(b, 0);
+    Put32(b, 1000);
+    Put32(b, 0);
+    Put32(b, 0x10000);
+    Put16(b, 0x100);
+    Put(b, NULL, 10);
+    PutMatrix(b);
+    Put(b, NULL, 24);
+    Put32(b, 3);
+    Close(b, box);
+
+    PutTrack(b, 1, true);
+    PutTrack(b, 2, false);
+
+    size_t mvex = Open(b, "mvex");
+    for (uint32_t id = 1; id <= 2; id++)
+    {
+        box = OpenFull(b, "trex", 0);
+        Put32(b, id);
+        Put32(b, 1);           /* sample description index */
+        Put32(b, 0);
+        Put32(b, 0);
+        Put32(b, 0);
+        Close(b, box);
+    }
+    Close(b, mvex);
+    Close(b, moov);
+}
+
+/* Appends a traf, returns the position of its trun data offset */
+static size_t PutTraf(struct buf *b, uint32_t id, bool video,
+                      uint64_t time, uint32_t samples)
+{
+    size_t traf = Open(b, "traf"), box, offset;
+
+    box = OpenFull(b, "tfhd", 0x020000); /* default base is moof */
+    Put32(b, id);
+    Close(b, box);
+
+    box = OpenFull(b, "tfdt", 0x01000000);
+    Put64(b, time);
+    Close(b, box);
+
+    if (video)
+    {
+        /* I P B B pattern */
+        static const uint32_t cts[4] = { 1, 4, 0, 2 };
+        const uint32_t delta = VIDEO_SCALE / VIDEO_RATE;
+
+        box = OpenFull(b, "trun", 0xf01);
+        Put32(b, samples);
+        offset = b->len;
+        Put32(b, 0);
+        for (uint32_t i = 0; i < samples; i++)
+        {
+            Put32(b, delta);
+            Put32(b, 40 + (i * 7) % 23);
+            Put32(b, i == 0 ? 0x02000000 : 0x01010000);
+            Put32(b, cts[i % 4] * delta);
+        }
+    }
+    else
+    {
+        box = OpenFull(b, "trun", 0x301);
+        Put32(b, samples);
+        offset = b->len;
+        Put32(b, 0);
+        for (uint32_t i = 0; i < samples; i++)
+        {
+            Put32(b, AUDIO_FRAME);
+            Put32(b, 20 + (i * 5) % 11);
+        }
+    }
+    Close(b, box);
+    Close(b, traf);
+    return offset;
+}
+
+static uint32_t SamplesSize(bool video, uint32_t samples)
+{
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < samples; i++)
+        size += video ? 40 + (i * 7) % 23 : 20 + (i * 5) % 11;
+    return size;
+}
+
+static void Generate(const char *path, unsigned fragments)
+{
+    static const uint8_t ftyp[] = {
+        0, 0, 0, 24, 'f', 't', 'y', 'p', 'i', 's', 'o', '6', 0, 0, 2, 0,
+        'i', 's', 'o', '6', 'd', 'a', 's', 'h',
+    };
+    const uint32_t vsamples = FRAGMENT * VIDEO_RATE;
+    const uint32_t asamples = FRAGMENT * AUDIO_RATE / AUDIO_FRAME;
+    const uint32_t vsize = SamplesSize(true, vsamples);
+    const uint32_t asize = SamplesSize(false, asamples);
+    struct buf b = { NULL, 0, 0 };
+
+    FILE *out = fopen(path, "wb");
+    assert(out != NULL);
+    fwrite(ftyp, 1, sizeof(ftyp), out);
+    PutMoov(&b);
+    fwrite(b.data, 1, b.len, out);
+
+    uint8_t zero[4096] = { 0 };
+    for (unsigned f = 0; f < fragments; f++)
+    {
+        b.len = 0;
+
+        size_t moof = Open(&b, "moof"), box;
+        box = OpenFull(&b, "mfhd", 0);
+        Put32(&b, f + 1);
+        Close(&b, box);
+        size_t voffset = PutTraf(&b, 1, true,
+                                 (uint64_t)f * vsamples * (VIDEO_SCALE / VIDEO_RATE),
+                                 vsamples);
+        size_t aoffset = PutTraf(&b, 2, false,
+                                 (uint64_t)f * asamples * AUDIO_FRAME, asamples);
+        Close(&b, moof);
+
+        SetDWBE(&b.data[voffset], b.len + 8);
+        SetDWBE(&b.data[aoffset], b.len + 8 + vsize);
+        Put32(&b, 8 + vsize + asize);
+        Put(&b, "mdat", 4);
+        fwrite(b.data, 1, b.len, out);
+        for (uint32_t left = vsize + asize; left > 0; )
+        {
+            size_t len = __MIN(left, sizeof(zero));
+            fwrite(zero, 1, len, out);
+            left -= len;
+        }
+    }
+    assert(!ferror(out));
+    fclose(out);
+    free(b.data);
+}
+
+static es_out_id_t *EsOutAdd(es_out_t *out, const es_format_t *fmt)
+{
+    (void) out; (void) fmt;
+    return malloc(1);
+}
+
+static int EsOutSend(es_out_t *out, es_out_id_t *id, block_t *block)
+{
+    (void) out; (void) id;
+    block_Release(block);
+    return VLC_SUCCESS;
+}
+
+static void EsOutDelete(es_out_t *out, es_out_id_t *id)
+{
+    (void) out;
+    free(id);
+}
+
+static int EsOutControl(es_out_t *out, int query, va_list args)
+{
+    (void) out; (void) query; (void) args;
+    return VLC_EGENERIC;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = "test_modules_demux_mp4_frag.mp4";
+    unsigned minutes = 60;
+    struct vlc_run_args args;
+
+    if (argc >= 2 && strtoul(argv[1], NULL, 0) > 0)
+        minutes = strtoul(argv[1], NULL, 0);
+    else if (argc >= 2)
+        path = argv[1];
+    const bool generated = path != argv[1];
+    const unsigned fragments = minutes * 60 / FRAGMENT;
+    if (generated)
+        Generate(path, fragments);
+
+    vlc_run_args_init(&args);
+    libvlc_instance_t *vlc = libvlc_create(&args);
+    assert(vlc != NULL);
+
+    char *url = vlc_path2uri(path, NULL);
+    assert(url != NULL);
+
+    es_out_t out = {
+        .pf_add = EsOutAdd,
+        .pf_send = EsOutSend,
+        .pf_del = EsOutDelete,
+        .pf_control = EsOutControl,
+    };
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    stream_t *s = vlc_stream_NewURL(obj, url);
+    assert(s != NULL);
+
+    unsigned long before = Allocs();
+    mtime_t start = mdate();
+    demux_t *demux = demux_New(obj, "mp4", "", s, &out);
+    mtime_t elapsed = mdate() - start;
+    assert(demux != NULL);
+    const unsigned long open = Allocs() - before;
+
+    before = Allocs();
+    start = mdate();
+    while (demux_Demux(demux) == VLC_DEMUXER_SUCCESS);
+    const mtime_t play = mdate() - start;
+    const unsigned long demuxed = Allocs() - before;
+
+    printf("%s: opened in %.1f ms, demuxed in %.1f ms\n", path,
+           elapsed / 1000., play / 1000.);
+    if (!generated)
+        printf("open: %lu allocations, demux: %lu allocations\n",
+               open, demuxed);
+    else if (open == 0 && demuxed == 0)
+        printf("allocations count not available\n");
+    else
+        printf("%u fragments, open: %lu allocations (%.1f per fragment), "
+               "demux: %lu allocations (%.1f per fragment)\n", fragments,
+               open, (double) open / fragments,
+               demuxed, (double) demuxed / fragments);
+
+    demux_Delete(demux); /* and its stream */
+    free(url);
+    libvlc_release(vlc);
+
+    if (generated)
+        remove(path);
+    return 0;
+}
@@ -0,0 +1,217 @@
+/*****************************************************************************
+ * ts.c: benchmark of the MPEG transport stream demultiplexer
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+#include "../../src/input/demux-run.h"
+
+/*
+ * Measures the demultiplexing throughput, on a file or on a generated
+ * multi-program broadcast-like stream:
+ * $ cd vlc/build-<name>/test
+ * $ make test_modules_demux_ts
+ * $ ./test_modules_demux_ts [file.ts]
+ */
+
+#define PROGRAMS      8
+#define TICKS         1500 /* 40ms each, i.e. one minute */
+#define VIDEO_PACKETS 60   /* ~ 2.2 Mbit/s per program */
+#define AUDIO_PACKETS 2
+#define RUNS          3
+
+static uint32_t Crc32(const uint8_t *p, size_t len)
+{
+    uint32_t crc = 0xffffffff;
+
+    while (len--)
+    {
+        crc ^= (uint32_t)*p++ << 24;
+        for (int i = 0; i < 8; i++)
+            crc = (crc << 1) ^ ((crc & 0x80000000) ? 0x04c11db7 : 0);
+    }
+    return crc;
+}
+
+static uint8_t cc[8192];
+
+static void Header(uint8_t *pkt, unsigned pid, bool start)
+{
+    memset(pkt, 0xff, 188);
+    pkt[0] = 0x47;
+    pkt[1] = (start ? 0x40 : 0) | (pid >> 8);
+    pkt[2] = pid;
+    pkt[3] = 0x10 | (cc[pid]++ & 0xf);
+}
+
+/* Writes a single packet section, given from its table_id */
+static void Section(FILE *out, unsigned pid, const uint8_t *sec, size_t len)
+{
+    uint8_t pkt[188];
+
+    Header(pkt, pid, true);
+    pkt[4] = 0; /* pointer field */
+    memcpy(&pkt[5], sec, len);
+    SetDWBE(&pkt[5 + len], Crc32(sec, len));
+    fwrite(pkt, 1, sizeof(pkt), out);
+}
+
+static void WritePSI(FILE *out)
+{
+    uint8_t sec[184];
+    size_t len = 8;
+
+    /* PAT */
+    sec[0] = 0x00;
+    sec[3] = 0x00; sec[4] = 0x01; /* transport_stream_id */
+    sec[5] = 0xc1;
+    sec[6] = sec[7] = 0;
+    for (unsigned p = 0; p < PROGRAMS; p++, len += 4)
+    {
+        SetWBE(&sec[len], p + 1);
+        SetWBE(&sec[len + 2], 0xe000 | (0x100 + p));
+    }
+    SetWBE(&sec[1], 0xb000 | (len + 4 - 3));
+    Section(out, 0, sec, len);
+
+    /* PMT: MPEG-2 video carrying the PCR, and MPEG audio */
+    for (unsigned p = 0; p < PROGRAMS; p++)
+    {
+        const unsigned video = 0x200 + p * 16, audio = video + 1;
+
+        sec[0] = 0x02;
+        SetWBE(&sec[3], p + 1);
+        sec[5] = 0xc1;
+        sec[6] = sec[7] = 0;
+        SetWBE(&sec[8], 0xe000 | video);
+        SetWBE(&sec[10], 0xf000);
+        sec[12] = 0x02; SetWBE(&sec[13], 0xe000 | video); SetWBE(&sec[15], 0xf000);
+        sec[17] = 0x03; SetWBE(&sec[18], 0xe000 | audio); SetWBE(&sec[20], 0xf000);
+        len = 22;
+        SetWBE(&sec[1], 0xb000 | (len + 4 - 3));
+        Section(out, 0x100 + p, sec, len);
+    }
+}
+
+static void WritePES(FILE *out, unsigned pid, uint8_t stream_id,
+                     unsigned packets, uint64_t pts, bool pcr)
+{
+    for (unsigned i = 0; i < packets; i++)
+    {
+        uint8_t pkt[188];
+        size_t pos = 4;
+
+        Header(pkt, pid, i == 0);
+        if (i == 0 && pcr)
+        {
+            const uint64_t base = pts - 9000;
+
+            pkt[3] |= 0x20;
+            pkt[4] = 7;
+            pkt[5] = 0x10;
+            SetDWBE(&pkt[6], base >> 1);
+            pkt[10] = ((base & 1) << 7) | 0x7e;
+            pkt[11] = 0;
+            pos = 12;
+        }
+        if (i == 0)
+        {
+            const uint8_t pes[] = {
+                0x00, 0x00, 0x01, stream_id, 0x00, 0x00, 0x80, 0x80, 0x05,
+                0x21 | ((pts >> 29) & 0x0e), pts >> 22, 0x01 | (pts >> 14),
+                pts >> 7, 0x01 | (pts << 1),
+            };
+            memcpy(&pkt[pos], pes, sizeof(pes));
+            pos += sizeof(pes);
+        }
+        for (; pos < 188; pos++)
+            pkt[pos] = (pos * 31 + i) & 0x7f; /* no start code emulation */
+        fwrite(pkt, 1, sizeof(pkt), out);
+    }
+}
+
+static void Generate(const char *path)
+{
+    FILE *out = fopen(path, "wb");
+    assert(out != NULL);
+
+    for (unsigned t = 0; t < TICKS; t++)
+    {
+        const uint64_t pts = 90000 + t * 3600;
+
+        if (t % 10 == 0)
+            WritePSI(out);
+        for (unsigned p = 0; p < PROGRAMS; p++)
+        {
+            const unsigned video = 0x200 + p * 16;
+
+            WritePES(out, video, 0xe0, VIDEO_PACKETS, pts, true);
+            WritePES(out, video + 1, 0xc0, AUDIO_PACKETS, pts, false);
+        }
+    }
+    assert(!ferror(out));
+    fclose(out);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = "test_modules_demux_ts.ts";
+    struct vlc_run_args args;
+
+    if (argc >= 2)
+        path = argv[1];
+    else
+        Generate(path);
+
+    FILE *in = fopen(path, "rb");
+    assert(in != NULL);
+    fseek(in, 0, SEEK_END);
+    const long size = ftell(in);
+    fclose(in);
+
+    vlc_run_args_init(&args);
+    args.name = "ts";
+
+    double best = 0.;
+    for (int i = 0; i < RUNS; i++)
+    {
+        mtime_t start = mdate();
+        assert(vlc_demux_process_path(&args, path) == 0);
+        double mbps = size / 1048576. * CLOCK_FREQ / (mdate() - start);
+
+        printf("run %d: %ld bytes, %.1f MB/s\n", i + 1, size, mbps);
+        best = __MAX(best, mbps);
+    }
+    printf("best: %.1f MB/s\n", best);
+
+    if (argc < 2)
+        remove(path);
+    return 0;
+}
@@ -0,0 +1,189 @@
+/*****************************************************************************
+ * slices.c: benchmark of the slice threaded video converters
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+/*
+ * Measures the scaling of the converters with --filter-threads:
+ * $ cd vlc/build-<name>/test
+ * $ make test_modules_video_chroma_slices
+ * $ ./test_modules_video_chroma_slices [frames]
+ */
+
+static const struct
+{
+    const char  *name;
+    vlc_fourcc_t in;
+    unsigned     in_width, in_height;
+    vlc_fourcc_t out;
+    unsigned     out_width, out_height;
+} cases[] = {
+    { "i420_rgb",       VLC_CODEC_I420, 3840, 2160, VLC_CODEC_RGB32, 3840, 2160 },
+    { "i420_rgb_sse2",  VLC_CODEC_I420, 3840, 2160, VLC_CODEC_RGB32, 3840, 2160 },
+    { "i420_yuy2",      VLC_CODEC_I420, 3840, 2160, VLC_CODEC_YUYV,  3840, 2160 },
+    { "i420_yuy2_sse2", VLC_CODEC_I420, 3840, 2160, VLC_CODEC_YUYV,  3840, 2160 },
+    { "swscale",        VLC_CODEC_I420, 3840, 2160, VLC_CODEC_RGB32, 3840, 2160 },
+    { "swscale",        VLC_CODEC_I420, 1920, 1080, VLC_CODEC_I420,  3840, 2160 },
+    { "scale",          VLC_CODEC_I420, 1920, 1080, VLC_CODEC_I420,  3840, 2160 },
+};
+
+static const unsigned threads[] = { 1, 2, 4, 8 };
+
+static picture_t *NewPicture(filter_t *filter)
+{
+    return picture_NewFromFormat(&filter->fmt_out.video);
+}
+
+static void Fill(picture_t *pic)
+{
+    uint32_t seed = 0;
+
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+        for (int y = 0; y < p->i_lines; y++)
+            for (int x = 0; x < p->i_pitch; x++)
+            {
+                seed = seed * 1103515245 + 12345;
+                p->p_pixels[y * p->i_pitch + x] = seed >> 24;
+            }
+    }
+}
+
+static void SetupFormat(es_format_t *fmt, vlc_fourcc_t chroma,
+                        unsigned width, unsigned height)
+{
+    es_format_Init(fmt, VIDEO_ES, chroma);
+    video_format_Setup(&fmt->video, chroma, width, height,
+                       width, height, 1, 1);
+    if (chroma == VLC_CODEC_RGB32)
+    {
+        fmt->video.i_rmask = 0xff0000;
+        fmt->video.i_gmask = 0x00ff00;
+        fmt->video.i_bmask = 0x0000ff;
+        video_format_FixRgb(&fmt->video);
+    }
+}
+
+/* Returns the average conversion time in ms, or -1 if not supported */
+static double Bench(vlc_object_t *obj, size_t c, unsigned frames)
+{
+    filter_t *filter = vlc_object_create(obj, sizeof(*filter));
+    assert(filter != NULL);
+
+    SetupFormat(&filter->fmt_in, cases[c].in,
+                cases[c].in_width, cases[c].in_height);
+    SetupFormat(&filter->fmt_out, cases[c].out,
+                cases[c].out_width, cases[c].out_height);
+    filter->owner.video.buffer_new = NewPicture;
+
+    double ms = -1.;
+    module_t *module = module_need(filter, "video converter",
+                                   cases[c].name, true);
+    if (module != NULL)
+    {
+        picture_t *src = picture_NewFromFormat(&filter->fmt_in.video);
+        assert(src != NULL);
+        Fill(src);
+
+        /* Warm up the worker threads and the output picture allocations */
+        picture_Release(filter->pf_video_filter(filter, picture_Hold(src)));
+
+        mtime_t start = mdate();
+        for (unsigned i = 0; i < frames; i++)
+        {
+            picture_t *dst = filter->pf_video_filter(filter, picture_Hold(src));
+            assert(dst != NULL);
+            picture_Release(dst);
+        }
+        ms = (mdate() - start) / 1000. / frames;
+
+        picture_Release(src);
+        module_unneed(filter, module);
+    }
+
+    es_format_Clean(&filter->fmt_out);
+    es_format_Clean(&filter->fmt_in);
+    vlc_object_release(filter);
+    return ms;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned frames = 50;
+    double results[ARRAY_SIZE(cases)][ARRAY_SIZE(threads)];
+
+    if (argc >= 2)
+        frames = strtoul(argv[1], NULL, 0);
+    assert(frames > 0);
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    /* The thread count is read when the converters are opened */
+    for (size_t t = 0; t < ARRAY_SIZE(threads); t++)
+    {
+        char arg[32];
+        snprintf(arg, sizeof(arg), "--filter-threads=%u", threads[t]);
+
+        const char *args[] = { "--ignore-config", "--quiet", arg };
+        libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(args), args);
+        assert(vlc != NULL);
+
+        for (size_t c = 0; c < ARRAY_SIZE(cases); c++)
+            results[c][t] = Bench(VLC_OBJECT(vlc->p_libvlc_int), c, frames);
+        libvlc_release(vlc);
+    }
+
+    printf("%u frames, time per frame and speedup over 1 thread\n", frames);
+    for (size_t c = 0; c < ARRAY_SIZE(cases); c++)
+    {
+        printf("%-14s %4.4s %4ux%-4u -> %4.4s %4ux%-4u",
+               cases[c].name, (const char *)&cases[c].in,
+               cases[c].in_width, cases[c].in_height,
+               (const char *)&cases[c].out,
+               cases[c].out_width, cases[c].out_height);
+        if (results[c][0] < 0.)
+        {
+            printf(" not available\n");
+            continue;
+        }
+        for (size_t t = 0; t < ARRAY_SIZE(threads); t++)
+            printf(" | %u: %7.2f ms x%.2f", threads[t], results[c][t],
+                   results[c][0] / results[c][t]);
+        printf("\n");
+    }
+    return 0;
+}
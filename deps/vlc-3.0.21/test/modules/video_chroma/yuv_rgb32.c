@@ -0,0 +1,197 @@
+/*****************************************************************************
+ * yuv_rgb32.c: benchmark of the YUV to RGB32 video converters
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+/*
+ * Compares the converters able to output RV32, on the same pictures:
+ * $ cd vlc/build-<name>/test
+ * $ make test_modules_video_chroma_yuv_rgb32
+ * $ ./test_modules_video_chroma_yuv_rgb32 [width height frames]
+ */
+
+static const char *const converters[] = {
+    "yuv_rgb32", "i420_rgb", "i420_rgb_mmx", "i420_rgb_sse2", "swscale",
+};
+
+static const vlc_fourcc_t inputs[] = {
+    VLC_CODEC_I420, VLC_CODEC_NV12, VLC_CODEC_P010,
+};
+
+static picture_t *NewPicture(filter_t *filter)
+{
+    return picture_NewFromFormat(&filter->fmt_out.video);
+}
+
+static void Fill(picture_t *pic)
+{
+    uint32_t seed = 0;
+
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+        for (int y = 0; y < p->i_lines; y++)
+            for (int x = 0; x < p->i_pitch; x++)
+            {
+                seed = seed * 1103515245 + 12345;
+                p->p_pixels[y * p->i_pitch + x] = seed >> 24;
+            }
+    }
+}
+
+/* Returns the average conversion time in ms, or -1 if not supported */
+static double Bench(vlc_object_t *obj, const char *name, vlc_fourcc_t chroma,
+                    unsigned width, unsigned height, unsigned frames,
+                    picture_t **out)
+{
+    filter_t *filter = vlc_object_create(obj, sizeof(*filter));
+    assert(filter != NULL);
+
+    es_format_Init(&filter->fmt_in, VIDEO_ES, chroma);
+    video_format_Setup(&filter->fmt_in.video, chroma, width, height,
+                       width, height, 1, 1);
+    filter->fmt_in.video.space = COLOR_SPACE_BT709;
+    es_format_Init(&filter->fmt_out, VIDEO_ES, VLC_CODEC_RGB32);
+    video_format_Setup(&filter->fmt_out.video, VLC_CODEC_RGB32, width, height,
+                       width, height, 1, 1);
+    filter->fmt_out.video.i_rmask = 0xff0000;
+    filter->fmt_out.video.i_gmask = 0x00ff00;
+    filter->fmt_out.video.i_bmask = 0x0000ff;
+    video_format_FixRgb(&filter->fmt_out.video);
+    filter->owner.video.buffer_new = NewPicture;
+
+    double ms = -1.;
+    module_t *module = module_need(filter, "video converter", name, true);
+    if (module != NULL)
+    {
+        picture_t *src = picture_NewFromFormat(&filter->fmt_in.video);
+        assert(src != NULL);
+        Fill(src);
+
+        mtime_t start = mdate();
+        for (unsigned i = 0; i < frames; i++)
+        {
+            picture_t *dst = filter->pf_video_filter(filter, picture_Hold(src));
+            assert(dst != NULL);
+            if (i + 1 < frames)
+                picture_Release(dst);
+            else
+                *out = dst;
+        }
+        ms = (mdate() - start) / 1000. / frames;
+
+        picture_Release(src);
+        module_unneed(filter, module);
+    }
+
+    es_format_Clean(&filter->fmt_out);
+    es_format_Clean(&filter->fmt_in);
+    vlc_object_release(filter);
+    return ms;
+}
+
+/* Largest difference of any color component */
+static int Compare(const picture_t *a, const picture_t *b,
+                   unsigned width, unsigned height)
+{
+    int diff = 0;
+
+    for (unsigned y = 0; y < height; y++)
+    {
+        const uint8_t *pa = &a->p[0].p_pixels[y * a->p[0].i_pitch];
+        const uint8_t *pb = &b->p[0].p_pixels[y * b->p[0].i_pitch];
+
+        for (unsigned x = 0; x < 4 * width; x++)
+            if ((x & 3) != 3)
+                diff = __MAX(diff, abs(pa[x] - pb[x]));
+    }
+    return diff;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned width = 1920, height = 1080, frames = 100;
+
+    if (argc >= 4)
+    {
+        width = strtoul(argv[1], NULL, 0) & ~1u;
+        height = strtoul(argv[2], NULL, 0) & ~1u;
+        frames = strtoul(argv[3], NULL, 0);
+    }
+    assert(width > 0 && height > 0 && frames > 0);
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    const char *args[] = { "--ignore-config", "--quiet" };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(args), args);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    printf("%ux%u, %u frames, BT.709 limited range to RV32\n",
+           width, height, frames);
+    for (size_t i = 0; i < ARRAY_SIZE(inputs); i++)
+    {
+        picture_t *ref = NULL;
+
+        for (size_t j = 0; j < ARRAY_SIZE(converters); j++)
+        {
+            picture_t *out = NULL;
+            double ms = Bench(obj, converters[j], inputs[i],
+                              width, height, frames, &out);
+
+            printf("%4.4s %-14s ", (const char *)&inputs[i], converters[j]);
+            if (ms < 0.)
+            {
+                printf("not available\n");
+                continue;
+            }
+            printf("%8.3f ms", ms);
+            if (ref != NULL)
+            {
+                printf(", max difference %d", Compare(ref, out, width, height));
+                picture_Release(out);
+            }
+            else
+                ref = out;
+            printf("\n");
+        }
+        if (ref != NULL)
+            picture_Release(ref);
+    }
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,168 @@
+/*****************************************************************************
+ * blend.c: benchmark of the alpha blending of pictures
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+/*
+ * Blends pictures of the same size with the blending module, replacing the
+ * former blendbench video filter:
+ * $ cd vlc/build-<name>/test
+ * $ make test_modules_video_filter_blend
+ * $ ./test_modules_video_filter_blend [width height frames]
+ */
+
+static const struct
+{
+    vlc_fourcc_t src;
+    vlc_fourcc_t dst;
+} pairs[] = {
+    /* Vectorized */
+    { VLC_CODEC_YUVA, VLC_CODEC_I420 },
+    { VLC_CODEC_YUVA, VLC_CODEC_YV12 },
+    { VLC_CODEC_YUVA, VLC_CODEC_RGB32 },
+    { VLC_CODEC_RGBA, VLC_CODEC_RGB32 },
+    /* Generic */
+    { VLC_CODEC_YUVA, VLC_CODEC_NV12 },
+    { VLC_CODEC_YUVA, VLC_CODEC_YUYV },
+    { VLC_CODEC_RGBA, VLC_CODEC_I420 },
+};
+
+static void Setup(video_format_t *fmt, vlc_fourcc_t chroma,
+                  unsigned width, unsigned height)
+{
+    video_format_Setup(fmt, chroma, width, height, width, height, 1, 1);
+    if (chroma == VLC_CODEC_RGB32)
+    {
+        fmt->i_rmask = 0xff0000;
+        fmt->i_gmask = 0x00ff00;
+        fmt->i_bmask = 0x0000ff;
+        video_format_FixRgb(fmt);
+    }
+}
+
+static picture_t *NewPicture(const video_format_t *fmt)
+{
+    picture_t *pic = picture_NewFromFormat(fmt);
+    uint32_t seed = 0;
+
+    assert(pic != NULL);
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+        for (int y = 0; y < p->i_lines; y++)
+            for (int x = 0; x < p->i_pitch; x++)
+            {
+                seed = seed * 1103515245 + 12345;
+                p->p_pixels[y * p->i_pitch + x] = seed >> 24;
+            }
+    }
+    return pic;
+}
+
+/* Returns the blending rate in megapixels per second, or -1 if not
+ * supported */
+static double Bench(vlc_object_t *obj, vlc_fourcc_t src_chroma,
+                    vlc_fourcc_t dst_chroma, unsigned width, unsigned height,
+                    unsigned frames)
+{
+    filter_t *filter = vlc_object_create(obj, sizeof(*filter));
+    assert(filter != NULL);
+
+    es_format_Init(&filter->fmt_in, VIDEO_ES, src_chroma);
+    Setup(&filter->fmt_in.video, src_chroma, width, height);
+    es_format_Init(&filter->fmt_out, VIDEO_ES, dst_chroma);
+    Setup(&filter->fmt_out.video, dst_chroma, width, height);
+
+    double rate = -1.;
+    module_t *module = module_need(filter, "video blending", "blend", true);
+    if (module != NULL)
+    {
+        picture_t *src = NewPicture(&filter->fmt_in.video);
+        picture_t *dst = NewPicture(&filter->fmt_out.video);
+
+        mtime_t start = mdate();
+        for (unsigned i = 0; i < frames; i++)
+            filter->pf_video_blend(filter, dst, src, 0, 0, 255);
+        mtime_t elapsed = mdate() - start;
+
+        rate = (double)width * height * frames / __MAX(elapsed, 1);
+        picture_Release(dst);
+        picture_Release(src);
+        module_unneed(filter, module);
+    }
+
+    es_format_Clean(&filter->fmt_out);
+    es_format_Clean(&filter->fmt_in);
+    vlc_object_release(filter);
+    return rate;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned width = 1920, height = 1080, frames = 100;
+
+    if (argc >= 4)
+    {
+        width = strtoul(argv[1], NULL, 0) & ~1u;
+        height = strtoul(argv[2], NULL, 0) & ~1u;
+        frames = strtoul(argv[3], NULL, 0);
+    }
+    assert(width > 0 && height > 0 && frames > 0);
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    const char *args[] = { "--ignore-config", "--quiet" };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(args), args);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    printf("%ux%u, %u frames, full opacity\n", width, height, frames);
+    for (size_t i = 0; i < ARRAY_SIZE(pairs); i++)
+    {
+        double rate = Bench(obj, pairs[i].src, pairs[i].dst,
+                            width, height, frames);
+
+        printf("%4.4s -> %4.4s ", (const char *)&pairs[i].src,
+               (const char *)&pairs[i].dst);
+        if (rate < 0.)
+            printf("not available\n");
+        else
+            printf("%8.1f Mpix/s\n", rate);
+    }
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,182 @@
+/*****************************************************************************
+ * deinterlace.c: benchmark of the Yadif deinterlacer
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+/*
+ * Deinterlaces synthetic interlaced pictures with Yadif, single threaded and
+ * with one slice per CPU, and prints the output frame rates:
+ * $ cd vlc/build-<name>/test
+ * $ make test_modules_video_filter_deinterlace
+ * $ ./test_modules_video_filter_deinterlace [frames]
+ */
+
+static const struct
+{
+    unsigned width;
+    unsigned height;
+} sizes[] = {
+    {  720,  576 },
+    { 1920, 1080 },
+    { 3840, 2160 },
+};
+
+static const vlc_fourcc_t chromas[] = {
+    VLC_CODEC_I420, VLC_CODEC_I420_10L,
+};
+
+/* Distinct input pictures, so that Yadif sees motion between them */
+#define INPUTS 4
+
+static picture_t *NewPicture(filter_t *filter)
+{
+    return picture_NewFromFormat(&filter->fmt_out.video);
+}
+
+static void Fill(picture_t *pic, uint32_t seed)
+{
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+        for (int y = 0; y < p->i_lines; y++)
+            for (int x = 0; x < p->i_pitch; x++)
+            {
+                seed = seed * 1103515245 + 12345;
+                p->p_pixels[y * p->i_pitch + x] = seed >> 24;
+            }
+    }
+}
+
+/* Returns the output frame rate, or -1 if not supported */
+static double Bench(vlc_object_t *obj, vlc_fourcc_t chroma,
+                    unsigned width, unsigned height, unsigned frames,
+                    unsigned threads)
+{
+    filter_t *filter = vlc_object_create(obj, sizeof(*filter));
+    assert(filter != NULL);
+
+    es_format_Init(&filter->fmt_in, VIDEO_ES, chroma);
+    video_format_Setup(&filter->fmt_in.video, chroma, width, height,
+                       width, height, 1, 1);
+    filter->fmt_in.video.i_frame_rate = 25;
+    filter->fmt_in.video.i_frame_rate_base = 1;
+    es_format_Copy(&filter->fmt_out, &filter->fmt_in);
+    filter->owner.video.buffer_new = NewPicture;
+
+    var_Create(filter, "sout-deinterlace-mode", VLC_VAR_STRING);
+    var_SetString(filter, "sout-deinterlace-mode", "yadif");
+    var_Create(filter, "filter-threads", VLC_VAR_INTEGER);
+    var_SetInteger(filter, "filter-threads", threads);
+
+    double fps = -1.;
+    module_t *module = module_need(filter, "video filter", "deinterlace", true);
+    if (module != NULL)
+    {
+        picture_t *inputs[INPUTS];
+        unsigned outputs = 0;
+
+        for (unsigned i = 0; i < INPUTS; i++)
+        {
+            inputs[i] = picture_NewFromFormat(&filter->fmt_in.video);
+            assert(inputs[i] != NULL);
+            Fill(inputs[i], i);
+            inputs[i]->b_progressive = false;
+            inputs[i]->b_top_field_first = true;
+            inputs[i]->i_nb_fields = 2;
+        }
+
+        mtime_t start = mdate();
+        for (unsigned i = 0; i < frames; i++)
+        {
+            picture_t *in = picture_Hold(inputs[i % INPUTS]);
+            in->date = VLC_TS_0 + i * CLOCK_FREQ / 25;
+
+            picture_t *out = filter->pf_video_filter(filter, in);
+            while (out != NULL)
+            {
+                picture_t *next = out->p_next;
+                picture_Release(out);
+                out = next;
+                outputs++;
+            }
+        }
+        fps = outputs * (double)CLOCK_FREQ / (mdate() - start);
+
+        for (unsigned i = 0; i < INPUTS; i++)
+            picture_Release(inputs[i]);
+        module_unneed(filter, module);
+    }
+
+    es_format_Clean(&filter->fmt_out);
+    es_format_Clean(&filter->fmt_in);
+    vlc_object_release(filter);
+    return fps;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned frames = argc >= 2 ? strtoul(argv[1], NULL, 0) : 100;
+    assert(frames > 0);
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    const char *args[] = { "--ignore-config", "--quiet" };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(args), args);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    printf("Yadif, %u frames: 1 thread / 1 slice per CPU\n", frames);
+    for (size_t i = 0; i < ARRAY_SIZE(chromas); i++)
+        for (size_t j = 0; j < ARRAY_SIZE(sizes); j++)
+        {
+            printf("%4.4s %4ux%-4u ", (const char *)&chromas[i],
+                   sizes[j].width, sizes[j].height);
+
+            double single = Bench(obj, chromas[i], sizes[j].width,
+                                  sizes[j].height, frames, 1);
+            if (single < 0.)
+            {
+                printf("not available\n");
+                continue;
+            }
+            double sliced = Bench(obj, chromas[i], sizes[j].width,
+                                  sizes[j].height, frames, 0);
+            printf("%8.1f fps / %8.1f fps\n", single, sliced);
+        }
+
+    libvlc_release(vlc);
+    return 0;
+}
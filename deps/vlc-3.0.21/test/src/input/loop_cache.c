@@ -0,0 +1,346 @@
+/*****************************************************************************
+ * loop_cache.c: test the decoded-picture loop cache
+ *****************************************************************************
+ * Copyright © 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* A demuxer injected as a static module outputs raw pictures numbered in
+ * their first luma byte, and a display module records the number and the
+ * date of every displayed picture. The input is repeated from the loop cache,
+ * and seeked while a pass is being replayed. */
+
+#define MODULE_NAME test_src_input_loop_cache
+#define MODULE_STRING "test_src_input_loop_cache"
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_demux.h>
+#include <vlc_input.h>
+#include <vlc_vout_display.h>
+#include <vlc_picture_pool.h>
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#define LOOP_WIDTH  16
+#define LOOP_HEIGHT 16
+#define LOOP_FPS    50
+#define LOOP_FRAMES 50
+#define LOOP_REPEAT 3
+#define LOOP_SEEK   (LOOP_FRAMES - 5) /* frame seeked to */
+#define LOOP_SEEK_AT (LOOP_FRAMES + 2) /* during the first replayed pass */
+#define LOOP_FRAME_DURATION (CLOCK_FREQ / LOOP_FPS)
+#define LOOP_DISPLAYED_MAX (LOOP_FRAMES * (LOOP_REPEAT + 3))
+
+static struct
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    unsigned    count;
+    uint8_t     index[LOOP_DISPLAYED_MAX];
+    vlc_tick_t  date[LOOP_DISPLAYED_MAX];
+} displayed;
+
+/* Demuxer */
+
+struct demux_sys_t
+{
+    es_out_id_t *es;
+    unsigned     frame;
+};
+
+static int Demux(demux_t *demux)
+{
+    demux_sys_t *sys = demux->p_sys;
+    const size_t luma = LOOP_WIDTH * LOOP_HEIGHT;
+
+    if (sys->frame >= LOOP_FRAMES)
+        return VLC_DEMUXER_EOF;
+
+    block_t *block = block_Alloc(luma * 3 / 2);
+    if (block == NULL)
+        return VLC_DEMUXER_EGENERIC;
+
+    memset(block->p_buffer, sys->frame, luma);
+    memset(block->p_buffer + luma, 0x80, luma / 2);
+    block->i_dts = block->i_pts =
+        VLC_TICK_0 + sys->frame * LOOP_FRAME_DURATION;
+    block->i_length = LOOP_FRAME_DURATION;
+
+    es_out_SetPCR(demux->out, block->i_dts);
+    es_out_Send(demux->out, sys->es, block);
+    sys->frame++;
+    return VLC_DEMUXER_SUCCESS;
+}
+
+static int Control(demux_t *demux, int query, va_list args)
+{
+    demux_sys_t *sys = demux->p_sys;
+
+    switch (query)
+    {
+        case DEMUX_CAN_SEEK:
+        case DEMUX_CAN_PAUSE:
+        case DEMUX_CAN_CONTROL_PACE:
+            *va_arg(args, bool *) = true;
+            return VLC_SUCCESS;
+        case DEMUX_SET_PAUSE_STATE:
+            return VLC_SUCCESS;
+        case DEMUX_GET_PTS_DELAY:
+            *va_arg(args, int64_t *) = DEFAULT_PTS_DELAY;
+            return VLC_SUCCESS;
+        case DEMUX_GET_LENGTH:
+            *va_arg(args, int64_t *) = LOOP_FRAMES * LOOP_FRAME_DURATION;
+            return VLC_SUCCESS;
+        case DEMUX_GET_TIME:
+            *va_arg(args, int64_t *) = sys->frame * LOOP_FRAME_DURATION;
+            return VLC_SUCCESS;
+        case DEMUX_SET_TIME:
+            sys->frame = va_arg(args, int64_t) / LOOP_FRAME_DURATION;
+            return VLC_SUCCESS;
+        case DEMUX_GET_POSITION:
+            *va_arg(args, double *) = (double)sys->frame / LOOP_FRAMES;
+            return VLC_SUCCESS;
+        case DEMUX_SET_POSITION:
+            sys->frame = va_arg(args, double) * LOOP_FRAMES;
+            return VLC_SUCCESS;
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+static int OpenDemux(vlc_object_t *obj)
+{
+    demux_t *demux = (demux_t *)obj;
+    demux_sys_t *sys = vlc_obj_malloc(obj, sizeof (*sys));
+    if (sys == NULL)
+        return VLC_ENOMEM;
+
+    es_format_t fmt;
+    es_format_Init(&fmt, VIDEO_ES, VLC_CODEC_I420);
+    video_format_Setup(&fmt.video, VLC_CODEC_I420, LOOP_WIDTH, LOOP_HEIGHT,
+                       LOOP_WIDTH, LOOP_HEIGHT, 1, 1);
+    fmt.video.i_frame_rate = LOOP_FPS;
+    fmt.video.i_frame_rate_base = 1;
+
+    sys->es = es_out_Add(demux->out, &fmt);
+    if (sys->es == NULL)
+        return VLC_EGENERIC;
+    sys->frame = 0;
+
+    demux->p_sys = sys;
+    demux->pf_demux = Demux;
+    demux->pf_control = Control;
+    return VLC_SUCCESS;
+}
+
+static void CloseDemux(vlc_object_t *obj)
+{
+    demux_t *demux = (demux_t *)obj;
+    es_out_Del(demux->out, demux->p_sys->es);
+}
+
+/* Display */
+
+struct vout_display_sys_t
+{
+    picture_pool_t *pool;
+};
+
+static picture_pool_t *Pool(vout_display_t *vd, unsigned count)
+{
+    vout_display_sys_t *sys = vd->sys;
+
+    if (sys->pool == NULL)
+        sys->pool = picture_pool_NewFromFormat(&vd->fmt, count);
+    return sys->pool;
+}
+
+static void Display(vout_display_t *vd, picture_t *pic, subpicture_t *subpic)
+{
+    (void) vd;
+
+    vlc_mutex_lock(&displayed.lock);
+    assert(displayed.count < LOOP_DISPLAYED_MAX);
+    displayed.index[displayed.count] = pic->p[0].p_pixels[0];
+    displayed.date[displayed.count] = pic->date;
+    displayed.count++;
+    vlc_cond_signal(&displayed.wait);
+    vlc_mutex_unlock(&displayed.lock);
+
+    picture_Release(pic);
+    if (subpic != NULL)
+        subpicture_Delete(subpic);
+}
+
+static int DisplayControl(vout_display_t *vd, int query, va_list args)
+{
+    (void) vd; (void) query; (void) args;
+    return VLC_SUCCESS;
+}
+
+static int OpenDisplay(vlc_object_t *obj)
+{
+    vout_display_t *vd = (vout_display_t *)obj;
+    vout_display_sys_t *sys = vlc_obj_malloc(obj, sizeof (*sys));
+    if (sys == NULL)
+        return VLC_ENOMEM;
+
+    sys->pool = NULL;
+    vd->fmt.i_chroma = VLC_CODEC_I420;
+    vd->sys = sys;
+    vd->pool = Pool;
+    vd->prepare = NULL;
+    vd->display = Display;
+    vd->control = DisplayControl;
+    vout_display_DeleteWindow(vd, NULL);
+    return VLC_SUCCESS;
+}
+
+static void CloseDisplay(vlc_object_t *obj)
+{
+    vout_display_t *vd = (vout_display_t *)obj;
+
+    if (vd->sys->pool != NULL)
+        picture_pool_Release(vd->sys->pool);
+}
+
+vlc_module_begin()
+    set_capability("access_demux", 0)
+    add_shortcut("loopcache")
+    set_callbacks(OpenDemux, CloseDemux)
+    add_submodule()
+    set_capability("vout display", 0)
+    add_shortcut("loopcache")
+    set_callbacks(OpenDisplay, CloseDisplay)
+vlc_module_end()
+
+typedef int (*vlc_plugin_cb)(vlc_set_cb, void *);
+
+VLC_EXPORT vlc_plugin_cb vlc_static_modules[] = {
+    vlc_entry__test_src_input_loop_cache, NULL
+};
+
+/* Test */
+
+static int InputEvent(vlc_object_t *obj, const char *var,
+                      vlc_value_t old, vlc_value_t cur, void *data)
+{
+    (void) obj; (void) var; (void) old;
+
+    if (cur.i_int == INPUT_EVENT_DEAD)
+        vlc_sem_post(data);
+    return VLC_SUCCESS;
+}
+
+static void check_displayed(void)
+{
+    unsigned seeks = 0;
+
+    assert(displayed.count > LOOP_FRAMES);
+    assert(displayed.index[0] == 0);
+
+    for (unsigned i = 1; i < displayed.count; i++)
+    {
+        unsigned prev = displayed.index[i - 1], cur = displayed.index[i];
+        vlc_tick_t gap = displayed.date[i] - displayed.date[i - 1];
+
+        if (cur == LOOP_SEEK && prev + 1 != LOOP_SEEK)
+        {   /* The seek flushed the pictures queued after prev */
+            seeks++;
+            continue;
+        }
+
+        /* Pictures are replayed in order and every pass starts from the
+         * first picture, even after a flush */
+        assert(cur == (prev + 1) % LOOP_FRAMES);
+        /* and they are dated back to back (the first picture is shown as
+         * soon as it is decoded, before the clock starts) */
+        assert(i == 1 || (gap > LOOP_FRAME_DURATION * 3 / 4
+                       && gap < LOOP_FRAME_DURATION * 5 / 4));
+    }
+
+    assert(seeks == 1);
+    assert(displayed.index[displayed.count - 1] == LOOP_FRAMES - 1);
+}
+
+int main(void)
+{
+    const char *argv[] = {
+        "-v", "--ignore-config", "--no-audio", "--no-spu", "--no-osd",
+        "--no-video-title-show", "--vout=loopcache",
+        "--no-drop-late-frames", "--no-skip-frames",
+        "--input-loop-cache=1", "--input-repeat=3", /* LOOP_REPEAT */
+    };
+    vlc_sem_t dead;
+
+    test_init();
+
+    vlc_mutex_init(&displayed.lock);
+    vlc_cond_init(&displayed.wait);
+    vlc_sem_init(&dead, 0);
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    input_item_t *item = input_item_New("loopcache://", "loop cache");
+    assert(item != NULL);
+
+    input_thread_t *input = input_Create(vlc->p_libvlc_int, item, NULL, NULL,
+                                         NULL);
+    assert(input != NULL);
+    var_AddCallback(input, "intf-event", InputEvent, &dead);
+    assert(input_Start(input) == VLC_SUCCESS);
+
+    /* Seek while the first pass is replayed from the cache */
+    vlc_mutex_lock(&displayed.lock);
+    while (displayed.count < LOOP_SEEK_AT)
+        vlc_cond_wait(&displayed.wait, &displayed.lock);
+    vlc_mutex_unlock(&displayed.lock);
+
+    /* The cache is released with the decoder, read its size meanwhile */
+    int64_t size = var_GetInteger(input, "loop-cache-size");
+
+    input_Control(input, INPUT_SET_TIME,
+                  (int64_t)LOOP_SEEK * LOOP_FRAME_DURATION);
+
+    vlc_sem_wait(&dead);
+
+    int64_t hits = var_GetInteger(input, "loop-cache-hits");
+    int64_t misses = var_GetInteger(input, "loop-cache-misses");
+
+    var_DelCallback(input, "intf-event", InputEvent, &dead);
+    input_Stop(input);
+    input_Close(input);
+    input_item_Release(item);
+    libvlc_release(vlc);
+
+    log("%u pictures displayed, %"PRId64" hits, %"PRId64" misses, "
+        "%"PRId64" bytes cached\n", displayed.count, hits, misses, size);
+
+    check_displayed();
+
+    /* The pass interrupted by the seek does not count, and the repetitions
+     * left after the seek are all replayed */
+    assert(hits == LOOP_REPEAT);
+    assert(misses == 0);
+    assert(size >= LOOP_FRAMES * LOOP_WIDTH * LOOP_HEIGHT * 3 / 2);
+
+    vlc_sem_destroy(&dead);
+    vlc_cond_destroy(&displayed.wait);
+    vlc_mutex_destroy(&displayed.lock);
+    return 0;
+}
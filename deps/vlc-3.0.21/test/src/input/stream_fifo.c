@@ -39,6 +39,60 @@ static libvlc_instance_t *vlc;
 static vlc_object_t *parent;
 static stream_t *s;
 
+static block_t *Chain(const char *const *strv, size_t count)
+{
+    block_t *chain = NULL, **pp = &chain;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t len = strlen(strv[i]);
+        block_t *block = block_Alloc(len);
+
+        assert(block != NULL);
+        memcpy(block->p_buffer, strv[i], len);
+        *pp = block;
+        pp = &block->p_next;
+    }
+    return chain;
+}
+
+/* Returns chains of blocks, as the UDP access does, with empty blocks */
+static block_t *ChainBlock(stream_t *stream, bool *restrict eof)
+{
+    static const char *const first[] = { "", "1st", "", "", "2nd", "" };
+    static const char *const second[] = { "" };
+    static const char *const third[] = { "", "3rd" };
+    unsigned *calls = stream->p_sys;
+
+    switch ((*calls)++)
+    {
+        case 0:
+            return Chain(first, ARRAY_SIZE(first));
+        case 1:
+            return Chain(second, ARRAY_SIZE(second));
+        case 2:
+            return Chain(third, ARRAY_SIZE(third));
+    }
+    *eof = true;
+    return NULL;
+}
+
+static void ChainDestroy(stream_t *stream)
+{
+    (void) stream;
+}
+
+static stream_t *ChainNew(unsigned *calls)
+{
+    stream_t *stream = vlc_stream_CommonNew(parent, ChainDestroy);
+    assert(stream != NULL);
+
+    *calls = 0;
+    stream->pf_block = ChainBlock;
+    stream->p_sys = calls;
+    return stream;
+}
+
 int main(void)
 {
     block_t *block;
@@ -240,6 +294,34 @@ int main(void)
     vlc_stream_Delete(s);
     block_Release(block);
 
+    /* Empty blocks in the chains, including at their heads, are skipped */
+    unsigned calls;
+
+    s = ChainNew(&calls);
+    val = vlc_stream_Read(s, buf, 2);
+    assert(val == 2);
+    assert(memcmp(buf, "1s", 2) == 0);
+    val = vlc_stream_Read(s, buf, sizeof (buf));
+    assert(val == 7);
+    assert(vlc_stream_Tell(s) == 9);
+    assert(memcmp(buf, "t2nd3rd", 7) == 0);
+    assert(vlc_stream_Eof(s));
+    assert(calls == 4);
+    vlc_stream_Delete(s);
+
+    s = ChainNew(&calls);
+    val = vlc_stream_Read(s, buf, 3);
+    assert(val == 3);
+    assert(memcmp(buf, "1st", 3) == 0);
+    val = vlc_stream_Peek(s, &peek, 6);
+    assert(val == 6);
+    assert(memcmp(peek, "2nd3rd", 6) == 0);
+    val = vlc_stream_Read(s, buf, sizeof (buf));
+    assert(val == 6);
+    assert(vlc_stream_Tell(s) == 9);
+    assert(vlc_stream_Eof(s));
+    vlc_stream_Delete(s);
+
     libvlc_release(vlc);
 
     return 0;
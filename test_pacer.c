@@ -0,0 +1,109 @@
+/*
+ * Video Wallpaper Engine - Frame pacing core tests
+ * Checks that the render loop wakes up once per frame at most, never while
+ * idle, and that a quit posted from another thread ends it.
+ *
+ * MIT License - Copyright (c) 2025 B.D.D.Devendra
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include "wallpaper_pacer.h"
+
+#define TEST_FRAMES   100
+#define TEST_INTERVAL 2  // ms between frames
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+// --- Video thread: posts frames, then quits as the teardown path does ---
+static void* post_frames(void* data) {
+    wp_pacer* pacer = (wp_pacer*)data;
+
+    for (int i = 0; i < TEST_FRAMES; i++) {
+        // Every 10th frame also comes with a display change
+        wp_pacer_post(pacer, i % 10 ? WP_EVENT_FRAME : WP_EVENT_REPAINT);
+        sleep_ms(TEST_INTERVAL);
+    }
+    wp_pacer_post(pacer, WP_EVENT_QUIT);
+    return NULL;
+}
+
+// Events posted before the wait are merged into a single wakeup
+static void test_coalesce(wp_pacer* pacer) {
+    wp_pacer_stats stats;
+    wp_pacer_get_stats(pacer, &stats);
+
+    wp_pacer_post(pacer, WP_EVENT_FRAME);
+    wp_pacer_post(pacer, WP_EVENT_FRAME);
+    wp_pacer_post(pacer, WP_EVENT_DISPLAY);
+    assert(wp_pacer_wait(pacer, WP_WAIT_INFINITE) == WP_EVENT_REPAINT);
+    assert(wp_pacer_wait(pacer, 0) == 0);
+
+    unsigned long long before = stats.wakeups;
+    wp_pacer_get_stats(pacer, &stats);
+    assert(stats.wakeups - before == 2);
+}
+
+// Nothing to paint: one wakeup for the whole timeout, no spinning
+static void test_idle(wp_pacer* pacer) {
+    wp_pacer_stats stats;
+    wp_pacer_get_stats(pacer, &stats);
+
+    unsigned long long before = stats.wakeups;
+    assert(wp_pacer_wait(pacer, 50) == 0);
+    wp_pacer_get_stats(pacer, &stats);
+    assert(stats.wakeups - before == 1);
+}
+
+// The render loop of video_wallpaper.c without the window
+static void test_render_loop(wp_pacer* pacer) {
+    wp_pacer_stats stats;
+    wp_pacer_get_stats(pacer, &stats);
+    unsigned long long before = stats.wakeups;
+    unsigned frames = 0;
+
+    pthread_t thread;
+    int ret = pthread_create(&thread, NULL, post_frames, pacer);
+    assert(ret == 0);
+
+    for (;;) {
+        unsigned events = wp_pacer_wait(pacer, WP_WAIT_INFINITE);
+        assert(events != 0);
+        if (events & WP_EVENT_REPAINT) {
+            frames++;
+            wp_pacer_repainted(pacer);
+        }
+        if (events & WP_EVENT_QUIT) break;
+    }
+    pthread_join(thread, NULL);
+
+    wp_pacer_get_stats(pacer, &stats);
+    unsigned long long wakeups = stats.wakeups - before;
+
+    printf("%d frames: %llu wakeups, %u repaints, %.2f wakeups per frame\n",
+        TEST_FRAMES, wakeups, frames, (double)wakeups / TEST_FRAMES);
+
+    // Late frames are merged: at most one wakeup per frame, plus the one
+    // for the quit.
+    assert(frames <= TEST_FRAMES);
+    assert(wakeups <= TEST_FRAMES + 1);
+    assert(stats.repaints == frames);
+}
+
+int main(void) {
+    wp_pacer* pacer = wp_pacer_create();
+    assert(pacer != NULL);
+
+    test_coalesce(pacer);
+    test_idle(pacer);
+    test_render_loop(pacer);
+
+    wp_pacer_destroy(pacer);
+    printf("All pacer tests passed\n");
+    return 0;
+}
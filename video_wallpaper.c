@@ -1,6 +1,6 @@
 /*
  * Video Wallpaper Engine - AGGRESSIVE VISIBILITY METHOD
- * Forces window visibility with periodic refreshes
+ * Keeps the window visible, repainting only when the display changes
  *
  * MIT License - Copyright (c) 2025 B.D.D.Devendra
  */
@@ -15,6 +15,7 @@
 #include <mfreadwrite.h>
 #include <mferror.h>
 #include <evr.h>
+#include "wallpaper_pacer.h"
 
 #pragma comment(lib, "mf.lib")
 #pragma comment(lib, "mfplat.lib")
@@ -26,7 +27,7 @@
 
 #define CONFIG_FILE "config.txt"
 #define MAX_PATH_LEN 512
-#define REFRESH_TIMER_ID 1
+#define WM_APP_MEDIA_EVENT (WM_APP + 1)
 
  // --- Globals ---
 HWND g_hwnd = NULL;
@@ -36,6 +37,8 @@ IMFMediaSource* g_pSource = NULL;
 IMFTopology* g_pTopology = NULL;
 IMFVideoDisplayControl* g_pVideoDisplay = NULL;
 IMFMediaEventGenerator* g_pEventGenerator = NULL;
+IMFAsyncCallback* g_pEventCallback = NULL;
+wp_pacer* g_pacer = NULL;
 BOOL g_bPlaying = FALSE;
 
 // --- Function Prototypes ---
@@ -45,14 +48,87 @@ HWND create_wallpaper_window(HINSTANCE);
 HRESULT CreateMediaSource(const WCHAR*, IMFMediaSource**);
 HRESULT CreatePlaybackTopology(IMFMediaSource*, IMFTopology**, HWND);
 void cleanup_media_foundation();
-void force_window_refresh();
+void refresh_window(unsigned events);
+
+// --- Media event callback ---
+// Media Foundation delivers session events on one of its worker threads.
+// They are forwarded to the window thread, so that the main loop can sleep
+// until something happens instead of polling the session.
+class MediaEventCallback : public IMFAsyncCallback {
+public:
+    MediaEventCallback(IMFMediaEventGenerator* pGenerator, HWND hwnd)
+        : m_cRef(1), m_pGenerator(pGenerator), m_hwnd(hwnd) {
+        m_pGenerator->AddRef();
+    }
+
+    STDMETHODIMP QueryInterface(REFIID riid, void** ppv) {
+        if (riid == __uuidof(IUnknown) || riid == __uuidof(IMFAsyncCallback)) {
+            *ppv = static_cast<IMFAsyncCallback*>(this);
+            AddRef();
+            return S_OK;
+        }
+        *ppv = NULL;
+        return E_NOINTERFACE;
+    }
+    STDMETHODIMP_(ULONG) AddRef() { return InterlockedIncrement(&m_cRef); }
+    STDMETHODIMP_(ULONG) Release() {
+        ULONG cRef = InterlockedDecrement(&m_cRef);
+        if (cRef == 0) {
+            m_pGenerator->Release();
+            delete this;
+        }
+        return cRef;
+    }
+
+    STDMETHODIMP GetParameters(DWORD*, DWORD*) { return E_NOTIMPL; }
+
+    STDMETHODIMP Invoke(IMFAsyncResult* pResult) {
+        IMFMediaEvent* pEvent = NULL;
+        HRESULT hr = m_pGenerator->EndGetEvent(pResult, &pEvent);
+        if (FAILED(hr)) return hr;
+
+        MediaEventType met = MEUnknown;
+        pEvent->GetType(&met);
+        if (met != MESessionClosed) {
+            m_pGenerator->BeginGetEvent(this, NULL);
+        }
+
+        // The window thread owns the event from now on
+        if (!PostMessage(m_hwnd, WM_APP_MEDIA_EVENT, 0, (LPARAM)pEvent)) {
+            pEvent->Release();
+        }
+        return S_OK;
+    }
+
+private:
+    LONG m_cRef;
+    IMFMediaEventGenerator* m_pGenerator;
+    HWND m_hwnd;
+};
+
+// --- Console control handler ---
+// Ctrl+C, Ctrl+Break and closing the console stop the render loop, which
+// then releases the session instead of the process being killed mid-frame.
+BOOL WINAPI ConsoleCtrlHandler(DWORD ctrlType) {
+    switch (ctrlType) {
+    case CTRL_C_EVENT:
+    case CTRL_BREAK_EVENT:
+    case CTRL_CLOSE_EVENT:
+        wp_pacer_post(g_pacer, WP_EVENT_QUIT);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+// --- Refresh the window ---
+// Only called when a new frame or a display change requires it.
+void refresh_window(unsigned events) {
+    if (!g_hwnd || !g_pVideoDisplay) return;
 
-// --- Force window refresh ---
-void force_window_refresh() {
-    if (g_hwnd && g_pVideoDisplay) {
-        // Force repaint
-        InvalidateRect(g_hwnd, NULL, FALSE);
-        g_pVideoDisplay->RepaintVideo();
+    if (events & WP_EVENT_DISPLAY) {
+        RECT rc;
+        GetClientRect(g_hwnd, &rc);
+        g_pVideoDisplay->SetVideoPosition(NULL, &rc);
 
         // Ensure proper Z-order
         if (g_hShellDefView) {
@@ -60,6 +136,45 @@ void force_window_refresh() {
                 SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE | SWP_NOREDRAW);
         }
     }
+
+    // Repainted by WM_PAINT
+    InvalidateRect(g_hwnd, NULL, FALSE);
+}
+
+// --- Start playback once the topology is ready ---
+void start_playback() {
+    printf("Starting playback...\n");
+
+    HRESULT hrService = MFGetService(g_pSession, MR_VIDEO_RENDER_SERVICE,
+        IID_PPV_ARGS(&g_pVideoDisplay));
+
+    if (SUCCEEDED(hrService) && g_pVideoDisplay) {
+        RECT rc;
+        GetClientRect(g_hwnd, &rc);
+
+        g_pVideoDisplay->SetVideoWindow(g_hwnd);
+        g_pVideoDisplay->SetVideoPosition(NULL, &rc);
+
+        // Try different aspect ratio modes
+        g_pVideoDisplay->SetAspectRatioMode(MFVideoARMode_None);
+
+        SIZE videoSize, aspectRatio;
+        if (SUCCEEDED(g_pVideoDisplay->GetNativeVideoSize(&videoSize, &aspectRatio))) {
+            printf("Video: %dx%d\n", videoSize.cx, videoSize.cy);
+        }
+
+        PROPVARIANT varStart;
+        PropVariantInit(&varStart);
+        g_pSession->Start(&GUID_NULL, &varStart);
+        PropVariantClear(&varStart);
+
+        g_bPlaying = TRUE;
+        printf("SUCCESS! Video is playing.\n");
+        printf("\nTroubleshooting:\n");
+        printf("  - Press Win+D to show desktop\n");
+        printf("  - Hide desktop icons (right-click > View)\n");
+        printf("  - The video is repainted on display changes\n\n");
+    }
 }
 
 // --- Handle media events ---
@@ -70,7 +185,18 @@ HRESULT HandleMediaEvent(IMFMediaEvent* pEvent) {
     HRESULT hr = pEvent->GetType(&type);
     if (FAILED(hr)) return hr;
 
-    if (type == MESessionEnded) {
+    if (type == MESessionTopologyStatus && !g_pVideoDisplay) {
+        UINT32 status;
+        if (SUCCEEDED(pEvent->GetUINT32(MF_EVENT_TOPOLOGY_STATUS, &status)) &&
+            status == MF_TOPOSTATUS_READY) {
+            start_playback();
+        }
+    }
+    else if (type == MESessionStarted) {
+        // First frame of a new pass
+        wp_pacer_post(g_pacer, WP_EVENT_FRAME);
+    }
+    else if (type == MESessionEnded) {
         printf("Looping video...\n");
         PROPVARIANT varStart;
         PropVariantInit(&varStart);
@@ -102,6 +228,11 @@ int init_media_foundation_player(HWND hwnd, const char* video_path) {
     if (FAILED(hr)) goto fail;
 
     hr = g_pSession->QueryInterface(IID_PPV_ARGS(&g_pEventGenerator));
+    if (FAILED(hr)) goto fail;
+
+    g_pEventCallback = new MediaEventCallback(g_pEventGenerator, hwnd);
+    hr = g_pEventGenerator->BeginGetEvent(g_pEventCallback, NULL);
+    if (FAILED(hr)) goto fail;
 
     hr = CreatePlaybackTopology(g_pSource, &g_pTopology, hwnd);
     if (FAILED(hr)) goto fail;
@@ -131,97 +262,60 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
         return 1;
     }
 
+    g_pacer = wp_pacer_create();
+    if (!g_pacer) {
+        MessageBox(NULL, "Failed to create render loop", "Error", MB_ICONERROR);
+        return 1;
+    }
+
     g_hwnd = create_wallpaper_window(hInstance);
     if (!g_hwnd) {
         MessageBox(NULL, "Failed to create window", "Error", MB_ICONERROR);
+        wp_pacer_destroy(g_pacer);
         return 1;
     }
 
     if (!init_media_foundation_player(g_hwnd, video_path)) {
         MessageBox(NULL, "Failed to initialize player", "Error", MB_ICONERROR);
         DestroyWindow(g_hwnd);
+        wp_pacer_destroy(g_pacer);
         return 1;
     }
 
-    // Set up refresh timer (every 100ms)
-    SetTimer(g_hwnd, REFRESH_TIMER_ID, 100, NULL);
-
     MSG msg = { 0 };
-    BOOL bPlayerReady = FALSE;
+    BOOL running = TRUE;
 
+    SetConsoleCtrlHandler(ConsoleCtrlHandler, TRUE);
     printf("Running... Press Ctrl+C to stop.\n\n");
 
-    while (TRUE) {
-        if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
-            if (msg.message == WM_QUIT) break;
+    // Sleep until a window message or a pacer event arrives
+    HANDLE hPacer = (HANDLE)wp_pacer_handle(g_pacer);
+    while (running) {
+        MsgWaitForMultipleObjects(1, &hPacer, FALSE, INFINITE, QS_ALLINPUT);
+
+        while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
+            if (msg.message == WM_QUIT) {
+                running = FALSE;
+                break;
+            }
             TranslateMessage(&msg);
             DispatchMessage(&msg);
         }
-        else if (g_pEventGenerator) {
-            IMFMediaEvent* pEvent = NULL;
-            HRESULT hrEvent = g_pEventGenerator->GetEvent(MF_EVENT_FLAG_NO_WAIT, &pEvent);
-
-            if (SUCCEEDED(hrEvent)) {
-                MediaEventType met;
-                pEvent->GetType(&met);
-
-                if (met == MESessionTopologyStatus && !bPlayerReady) {
-                    UINT32 status;
-                    pEvent->GetUINT32(MF_EVENT_TOPOLOGY_STATUS, &status);
-
-                    if (status == MF_TOPOSTATUS_READY) {
-                        printf("Starting playback...\n");
-
-                        HRESULT hrService = MFGetService(g_pSession, MR_VIDEO_RENDER_SERVICE,
-                            IID_PPV_ARGS(&g_pVideoDisplay));
-
-                        if (SUCCEEDED(hrService) && g_pVideoDisplay) {
-                            RECT rc;
-                            GetClientRect(g_hwnd, &rc);
-
-                            g_pVideoDisplay->SetVideoWindow(g_hwnd);
-                            g_pVideoDisplay->SetVideoPosition(NULL, &rc);
-
-                            // Try different aspect ratio modes
-                            g_pVideoDisplay->SetAspectRatioMode(MFVideoARMode_None);
-
-                            SIZE videoSize, aspectRatio;
-                            if (SUCCEEDED(g_pVideoDisplay->GetNativeVideoSize(&videoSize, &aspectRatio))) {
-                                printf("Video: %dx%d\n", videoSize.cx, videoSize.cy);
-                            }
-
-                            PROPVARIANT varStart;
-                            PropVariantInit(&varStart);
-                            g_pSession->Start(&GUID_NULL, &varStart);
-                            PropVariantClear(&varStart);
-
-                            g_bPlaying = TRUE;
-                            printf("SUCCESS! Video is playing.\n");
-                            printf("\nTroubleshooting:\n");
-                            printf("  - Press Win+D to show desktop\n");
-                            printf("  - Hide desktop icons (right-click > View)\n");
-                            printf("  - The video refreshes every 100ms\n\n");
-                        }
-
-                        bPlayerReady = TRUE;
-                    }
-                }
-                else {
-                    HandleMediaEvent(pEvent);
-                }
-                pEvent->Release();
-            }
-            else {
-                Sleep(5);
-            }
-        }
-        else {
-            Sleep(5);
+
+        unsigned events = wp_pacer_wait(g_pacer, 0);
+        if (events & WP_EVENT_QUIT) break;
+        if ((events & WP_EVENT_REPAINT) && g_bPlaying) {
+            refresh_window(events);
         }
     }
 
-    KillTimer(g_hwnd, REFRESH_TIMER_ID);
+    wp_pacer_stats stats;
+    wp_pacer_get_stats(g_pacer, &stats);
+    printf("Render loop: %llu wakeups, %llu repaints\n", stats.wakeups, stats.repaints);
+
+    SetConsoleCtrlHandler(ConsoleCtrlHandler, FALSE);
     cleanup_media_foundation();
+    wp_pacer_destroy(g_pacer);
     return (int)msg.wParam;
 }
 
@@ -237,6 +331,7 @@ void cleanup_media_foundation() {
     if (g_pTopology) { g_pTopology->Release(); g_pTopology = NULL; }
     if (g_pSource) { g_pSource->Release(); g_pSource = NULL; }
     if (g_pEventGenerator) { g_pEventGenerator->Release(); g_pEventGenerator = NULL; }
+    if (g_pEventCallback) { g_pEventCallback->Release(); g_pEventCallback = NULL; }
     MFShutdown();
     CoUninitialize();
 }
@@ -260,14 +355,16 @@ int read_config(char* video_path, size_t max_len) {
 // --- Window procedure ---
 LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
     switch (msg) {
-    case WM_TIMER:
-        if (wParam == REFRESH_TIMER_ID && g_bPlaying) {
-            force_window_refresh();
-        }
+    case WM_APP_MEDIA_EVENT: {
+        IMFMediaEvent* pEvent = (IMFMediaEvent*)lParam;
+        HandleMediaEvent(pEvent);
+        pEvent->Release();
         return 0;
+    }
 
     case WM_DESTROY:
         PostQuitMessage(0);
+        wp_pacer_post(g_pacer, WP_EVENT_QUIT);
         return 0;
 
     case WM_ERASEBKGND:
@@ -281,6 +378,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             // Only repaint video if playing
             if (g_bPlaying) {
                 g_pVideoDisplay->RepaintVideo();
+                wp_pacer_repainted(g_pacer);
             }
         }
         else {
@@ -297,22 +395,18 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
     }
 
     case WM_SIZE:
-        if (g_pVideoDisplay) {
-            RECT rc;
-            GetClientRect(hwnd, &rc);
-            g_pVideoDisplay->SetVideoPosition(NULL, &rc);
-            InvalidateRect(hwnd, NULL, FALSE);
-        }
+    case WM_DISPLAYCHANGE:
+        wp_pacer_post(g_pacer, WP_EVENT_DISPLAY);
         return 0;
 
-    case WM_DISPLAYCHANGE:
-        if (g_pVideoDisplay) {
-            RECT rc;
-            GetClientRect(hwnd, &rc);
-            g_pVideoDisplay->SetVideoPosition(NULL, &rc);
-            InvalidateRect(hwnd, NULL, FALSE);
+    case WM_WINDOWPOSCHANGED: {
+        // Something else changed our Z-order: go back behind the icons
+        const WINDOWPOS* pos = (const WINDOWPOS*)lParam;
+        if (!(pos->flags & SWP_NOZORDER) && pos->hwndInsertAfter != g_hShellDefView) {
+            wp_pacer_post(g_pacer, WP_EVENT_DISPLAY);
         }
-        return 0;
+        break; // DefWindowProc sends WM_SIZE and WM_MOVE
+    }
     }
     return DefWindowProc(hwnd, msg, wParam, lParam);
 }
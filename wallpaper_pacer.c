@@ -0,0 +1,183 @@
+/*
+ * Video Wallpaper Engine - Frame pacing core
+ * Blocking event queue and wakeup/repaint counters shared by all platforms.
+ *
+ * MIT License - Copyright (c) 2025 B.D.D.Devendra
+ */
+
+#include <stdlib.h>
+#include "wallpaper_pacer.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#endif
+
+struct wp_pacer {
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+    HANDLE event;  // Manual reset, signalled while pending != 0
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t wait;
+#endif
+    unsigned pending;
+    unsigned long long wakeups;
+    unsigned long long repaints;
+
+    // Snapshot of the previous wp_pacer_get_stats() call
+    double last_time;
+    unsigned long long last_wakeups;
+    unsigned long long last_repaints;
+};
+
+// --- Monotonic clock in seconds ---
+static double wp_now(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#endif
+}
+
+wp_pacer* wp_pacer_create(void) {
+    wp_pacer* pacer = (wp_pacer*)calloc(1, sizeof(*pacer));
+    if (!pacer) return NULL;
+
+#ifdef _WIN32
+    pacer->event = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!pacer->event) {
+        free(pacer);
+        return NULL;
+    }
+    InitializeCriticalSection(&pacer->lock);
+#else
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&pacer->lock, NULL);
+    pthread_cond_init(&pacer->wait, &attr);
+    pthread_condattr_destroy(&attr);
+#endif
+    pacer->last_time = wp_now();
+    return pacer;
+}
+
+void wp_pacer_destroy(wp_pacer* pacer) {
+    if (!pacer) return;
+#ifdef _WIN32
+    DeleteCriticalSection(&pacer->lock);
+    CloseHandle(pacer->event);
+#else
+    pthread_cond_destroy(&pacer->wait);
+    pthread_mutex_destroy(&pacer->lock);
+#endif
+    free(pacer);
+}
+
+void wp_pacer_post(wp_pacer* pacer, unsigned events) {
+#ifdef _WIN32
+    EnterCriticalSection(&pacer->lock);
+    pacer->pending |= events;
+    SetEvent(pacer->event);
+    LeaveCriticalSection(&pacer->lock);
+#else
+    pthread_mutex_lock(&pacer->lock);
+    pacer->pending |= events;
+    pthread_cond_signal(&pacer->wait);
+    pthread_mutex_unlock(&pacer->lock);
+#endif
+}
+
+unsigned wp_pacer_wait(wp_pacer* pacer, int timeout_ms) {
+    unsigned events;
+
+#ifdef _WIN32
+    WaitForSingleObject(pacer->event,
+        timeout_ms < 0 ? INFINITE : (DWORD)timeout_ms);
+
+    EnterCriticalSection(&pacer->lock);
+    events = pacer->pending;
+    pacer->pending = 0;
+    ResetEvent(pacer->event);
+    pacer->wakeups++;
+    LeaveCriticalSection(&pacer->lock);
+#else
+    struct timespec deadline;
+    if (timeout_ms > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    pthread_mutex_lock(&pacer->lock);
+    while (pacer->pending == 0 && timeout_ms != 0) {
+        if (timeout_ms < 0)
+            pthread_cond_wait(&pacer->wait, &pacer->lock);
+        else if (pthread_cond_timedwait(&pacer->wait, &pacer->lock,
+                                        &deadline) == ETIMEDOUT)
+            break;
+    }
+    events = pacer->pending;
+    pacer->pending = 0;
+    pacer->wakeups++;
+    pthread_mutex_unlock(&pacer->lock);
+#endif
+    return events;
+}
+
+void wp_pacer_repainted(wp_pacer* pacer) {
+#ifdef _WIN32
+    EnterCriticalSection(&pacer->lock);
+    pacer->repaints++;
+    LeaveCriticalSection(&pacer->lock);
+#else
+    pthread_mutex_lock(&pacer->lock);
+    pacer->repaints++;
+    pthread_mutex_unlock(&pacer->lock);
+#endif
+}
+
+void wp_pacer_get_stats(wp_pacer* pacer, wp_pacer_stats* stats) {
+    double now = wp_now();
+
+#ifdef _WIN32
+    EnterCriticalSection(&pacer->lock);
+#else
+    pthread_mutex_lock(&pacer->lock);
+#endif
+    double elapsed = now - pacer->last_time;
+    if (elapsed <= 0.0) elapsed = 1e-9;
+
+    stats->wakeups = pacer->wakeups;
+    stats->repaints = pacer->repaints;
+    stats->wakeups_per_sec = (pacer->wakeups - pacer->last_wakeups) / elapsed;
+    stats->repaints_per_sec = (pacer->repaints - pacer->last_repaints) / elapsed;
+
+    pacer->last_time = now;
+    pacer->last_wakeups = pacer->wakeups;
+    pacer->last_repaints = pacer->repaints;
+#ifdef _WIN32
+    LeaveCriticalSection(&pacer->lock);
+#else
+    pthread_mutex_unlock(&pacer->lock);
+#endif
+}
+
+#ifdef _WIN32
+void* wp_pacer_handle(wp_pacer* pacer) {
+    return pacer->event;
+}
+#endif
@@ -0,0 +1,61 @@
+/*
+ * Video Wallpaper Engine - Frame pacing core
+ * Platform independent part of the render loop: the render thread sleeps
+ * until something visible changes and only then repaints.
+ *
+ * MIT License - Copyright (c) 2025 B.D.D.Devendra
+ */
+
+#ifndef WALLPAPER_PACER_H
+#define WALLPAPER_PACER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --- Events ---
+#define WP_EVENT_FRAME   0x1  // A new video frame is ready
+#define WP_EVENT_DISPLAY 0x2  // Display mode, size or Z-order changed
+#define WP_EVENT_QUIT    0x4  // The render loop must exit
+
+// Events that require the video to be repainted
+#define WP_EVENT_REPAINT (WP_EVENT_FRAME | WP_EVENT_DISPLAY)
+
+#define WP_WAIT_INFINITE (-1)
+
+typedef struct wp_pacer wp_pacer;
+
+typedef struct wp_pacer_stats {
+    unsigned long long wakeups;   // Total wakeups of the render loop
+    unsigned long long repaints;  // Total repaints
+    double wakeups_per_sec;       // Since the previous call
+    double repaints_per_sec;      // Since the previous call
+} wp_pacer_stats;
+
+wp_pacer* wp_pacer_create(void);
+void wp_pacer_destroy(wp_pacer* pacer);
+
+// Queues events and wakes the render loop up. Safe from any thread.
+void wp_pacer_post(wp_pacer* pacer, unsigned events);
+
+// Blocks until events are queued or the timeout (in ms) expires, then
+// returns and clears the queued events. Returns 0 on timeout.
+unsigned wp_pacer_wait(wp_pacer* pacer, int timeout_ms);
+
+// Records a repaint done by the caller.
+void wp_pacer_repainted(wp_pacer* pacer);
+
+void wp_pacer_get_stats(wp_pacer* pacer, wp_pacer_stats* stats);
+
+#ifdef _WIN32
+// Event handle signalled while events are queued, to be waited on together
+// with the message queue (MsgWaitForMultipleObjects). Call
+// wp_pacer_wait(pacer, 0) once it is signalled.
+void* wp_pacer_handle(wp_pacer* pacer);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WALLPAPER_PACER_H